@@ -0,0 +1,57 @@
+/**
+ * @file bench.h
+ * @brief elog_bench の計測ループ共通定義
+ */
+
+#ifndef ELOG_BENCH_H
+#define ELOG_BENCH_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+static inline uint64_t bench_now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+/* 空ループが消されないようにする */
+#define BENCH_BARRIER() __asm__ __volatile__("" ::: "memory")
+
+/* 計測関数: lat が NULL なら連続実行、そうでなければ1回ごとの時間を記録 */
+typedef void (*bench_fn)(long iters, uint64_t *lat);
+
+#define BENCH_DEFINE(name, stmt)                 \
+  void name(long iters, uint64_t *lat) {         \
+    long i;                                      \
+    if (lat == NULL) {                           \
+      for (i = 0; i < iters; i++) {              \
+        stmt;                                    \
+        BENCH_BARRIER();                         \
+      }                                          \
+    } else {                                     \
+      for (i = 0; i < iters; i++) {              \
+        uint64_t t0 = bench_now();               \
+        stmt;                                    \
+        lat[i] = bench_now() - t0;               \
+      }                                          \
+    }                                            \
+  }
+
+/* ELOG_COMPILED_LEVEL=ELOG_LEVEL_OFF でビルドした呼び出し（bench_off.c） */
+void bench_off_args4(long iters, uint64_t *lat);
+
+/* ELOG_USE_JUMP_LABEL=0 でビルドした呼び出し（bench_load.c） */
+void bench_load_args4(long iters, uint64_t *lat);
+
+/*
+ * 除外されるログ呼び出しを BENCH_COLD_SITES 個含むホットループ
+ * （bench_cold_loop.c を変種ごとにビルド）
+ */
+#define BENCH_COLD_SITES 16
+uint64_t bench_cold_loop_off(const uint32_t *data, size_t n);
+uint64_t bench_cold_loop_inline(const uint32_t *data, size_t n);
+uint64_t bench_cold_loop_cold(const uint32_t *data, size_t n);
+
+#endif /* ELOG_BENCH_H */
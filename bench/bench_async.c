@@ -0,0 +1,156 @@
+/**
+ * @file bench_async.c
+ * @brief 非同期バックエンドと同期 printf 出力のスループット・レイテンシ比較
+ *
+ * 標準出力をパイプに差し替え、読み出しスレッドで改行数を数えて
+ * 実際に出力された行数も確認する。
+ *
+ * 使い方: elog_bench_async [呼び出し回数/スレッド] [最大スレッド数]
+ */
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "elog/elog.h"
+
+/* 同期 printf 出力（ELOG_USE_ASYNC=0 の ELOG_IMPL と同じ展開） */
+#define BENCH_PRINTF_INFO(fmt, ...)                              \
+  printf("%s%s " ELOG_FILE_LINE_FMT " " fmt "%s\n",              \
+         ELOG_COLOR_BEGIN(ELOG_COLOR_INFO),                      \
+         ELOG_LEVEL_FMT_INFO ELOG_FILE_LINE_ARGS, ##__VA_ARGS__, \
+         ELOG_COLOR_END)
+
+typedef struct {
+  int async;
+  long iters;
+  uint64_t *lat;
+} bench_thread_t;
+
+static uint64_t now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static void *bench_worker(void *arg) {
+  bench_thread_t *t = (bench_thread_t *)arg;
+  long i;
+
+  for (i = 0; i < t->iters; i++) {
+    uint64_t t0 = now_ns();
+    if (t->async) {
+      ELOG_INFO("request id=%ld status=%d path=%s latency=%.3f", i, 200,
+                "/api/v1/items", 1.25);
+    } else {
+      BENCH_PRINTF_INFO("request id=%ld status=%d path=%s latency=%.3f", i,
+                        200, "/api/v1/items", 1.25);
+    }
+    t->lat[i] = now_ns() - t0;
+  }
+  return NULL;
+}
+
+/* 出力を読み捨てて行数を数える */
+static int bench_pipe_fd;
+static volatile uint64_t bench_lines;
+
+static void *bench_reader(void *arg) {
+  char buf[65536];
+  ssize_t n;
+
+  (void)arg;
+  while ((n = read(bench_pipe_fd, buf, sizeof(buf))) > 0) {
+    ssize_t i;
+    for (i = 0; i < n; i++) {
+      if (buf[i] == '\n') {
+        __atomic_fetch_add(&bench_lines, 1, __ATOMIC_RELAXED);
+      }
+    }
+  }
+  return NULL;
+}
+
+static int cmp_u64(const void *a, const void *b) {
+  uint64_t x = *(const uint64_t *)a;
+  uint64_t y = *(const uint64_t *)b;
+  return x < y ? -1 : x > y;
+}
+
+static void bench_run(int async, int nthreads, long iters) {
+  pthread_t th[64];
+  bench_thread_t args[64];
+  uint64_t *all = malloc(sizeof(uint64_t) * (size_t)iters * (size_t)nthreads);
+  uint64_t lines0 = __atomic_load_n(&bench_lines, __ATOMIC_RELAXED);
+  uint64_t t0, t_call, t_end;
+  size_t total = (size_t)iters * (size_t)nthreads;
+  int i;
+
+  t0 = now_ns();
+  for (i = 0; i < nthreads; i++) {
+    args[i].async = async;
+    args[i].iters = iters;
+    args[i].lat = all + (size_t)i * (size_t)iters;
+    pthread_create(&th[i], NULL, bench_worker, &args[i]);
+  }
+  for (i = 0; i < nthreads; i++) {
+    pthread_join(th[i], NULL);
+  }
+  t_call = now_ns();
+  if (async) {
+    elog_async_flush();
+  } else {
+    fflush(stdout);
+  }
+  t_end = now_ns();
+
+  qsort(all, total, sizeof(uint64_t), cmp_u64);
+  /* パイプの読み出しが追いつくのを少し待つ */
+  usleep(20000);
+  fprintf(stderr,
+          "%-7s threads=%-2d calls/s=%10.0f lines/s=%10.0f delivered=%5.1f%% "
+          "p50=%5llu ns p99=%6llu ns p99.9=%7llu ns max=%8llu ns\n",
+          async ? "async" : "printf", nthreads,
+          (double)total * 1e9 / (double)(t_call - t0),
+          (double)(__atomic_load_n(&bench_lines, __ATOMIC_RELAXED) - lines0) *
+              1e9 / (double)(t_end - t0),
+          100.0 * (double)(__atomic_load_n(&bench_lines, __ATOMIC_RELAXED) -
+                           lines0) /
+              (double)total,
+          (unsigned long long)all[total / 2],
+          (unsigned long long)all[total * 99 / 100],
+          (unsigned long long)all[total * 999 / 1000],
+          (unsigned long long)all[total - 1]);
+  free(all);
+}
+
+int main(int argc, char **argv) {
+  long iters = argc > 1 ? atol(argv[1]) : 100000;
+  int max_threads = argc > 2 ? atoi(argv[2]) : 4;
+  pthread_t reader;
+  int fds[2];
+  int n;
+
+  if (max_threads > 64) {
+    max_threads = 64;
+  }
+  if (pipe(fds) != 0) {
+    perror("pipe");
+    return 1;
+  }
+  bench_pipe_fd = fds[0];
+  pthread_create(&reader, NULL, bench_reader, NULL);
+  fflush(stdout);
+  dup2(fds[1], STDOUT_FILENO);
+  close(fds[1]);
+
+  for (n = 1; n <= max_threads; n *= 2) {
+    bench_run(0, n, iters);
+    bench_run(1, n, iters);
+  }
+  return 0;
+}
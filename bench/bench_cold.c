@@ -0,0 +1,158 @@
+/**
+ * @file bench_cold.c
+ * @brief 除外されたログ呼び出しがホットループに与える影響の計測
+ *
+ * bench_cold_loop.c の3つの変種（呼び出しなし・その場で printf・
+ * コールド経路）を同じデータで実行し、1反復あたりの時間と、
+ * Linux では perf_event_open で数えた命令数・サイクル数から IPC を表示する。
+ * ループ中のログはすべて実行時レベル（WARN）で除外される。
+ * コールサイトあたりの .text サイズは elog_callsite_size ターゲットで表示する。
+ *
+ * 使い方: elog_bench_cold [反復回数]
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "elog/elog.h"
+
+#include "bench.h"
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#define BENCH_COLD_DATA 4096
+
+typedef uint64_t (*bench_cold_fn)(const uint32_t *data, size_t n);
+
+static const struct {
+  const char *name;
+  bench_cold_fn fn;
+} bench_cold_variants[] = {
+    {"off", bench_cold_loop_off},
+    {"inline", bench_cold_loop_inline},
+    {"cold", bench_cold_loop_cold},
+};
+
+static uint32_t bench_data[BENCH_COLD_DATA];
+static volatile uint64_t bench_sink;
+
+/* ============================================================
+ * 1. ハードウェアカウンタ（Linux のみ、使えなければ -1）
+ * ============================================================ */
+
+#ifdef __linux__
+static int bench_counter_open(uint64_t config) {
+  struct perf_event_attr attr;
+
+  memset(&attr, 0, sizeof(attr));
+  attr.size = sizeof(attr);
+  attr.type = PERF_TYPE_HARDWARE;
+  attr.config = config;
+  attr.disabled = 1;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  return (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+static void bench_counter_start(int fd) {
+  if (fd >= 0) {
+    ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+    ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+  }
+}
+
+static uint64_t bench_counter_stop(int fd) {
+  uint64_t v = 0;
+
+  if (fd >= 0) {
+    ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+    if (read(fd, &v, sizeof(v)) != (ssize_t)sizeof(v)) {
+      v = 0;
+    }
+  }
+  return v;
+}
+#else
+static int bench_counter_open(uint64_t config) {
+  (void)config;
+  return -1;
+}
+static void bench_counter_start(int fd) { (void)fd; }
+static uint64_t bench_counter_stop(int fd) {
+  (void)fd;
+  return 0;
+}
+#define PERF_COUNT_HW_INSTRUCTIONS 0
+#define PERF_COUNT_HW_CPU_CYCLES 0
+#endif
+
+/* ============================================================
+ * 2. メイン
+ * ============================================================ */
+
+int main(int argc, char **argv) {
+  long reps = 2000;
+  int insn_fd, cycle_fd;
+  size_t v;
+  long i;
+  uint64_t x = 88172645463325252ull;
+
+  if (argc > 1) {
+    reps = strtol(argv[1], NULL, 10);
+  }
+  for (i = 0; i < BENCH_COLD_DATA; i++) {
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    bench_data[i] = (uint32_t)x;
+  }
+
+  /* ループ中の ELOG_INFO をすべて実行時に除外する */
+  ELOG_SET_LEVEL(ELOG_LEVEL_WARN);
+
+  insn_fd = bench_counter_open(PERF_COUNT_HW_INSTRUCTIONS);
+  cycle_fd = bench_counter_open(PERF_COUNT_HW_CPU_CYCLES);
+  if (insn_fd < 0 || cycle_fd < 0) {
+    printf("hardware counters unavailable (IPC not reported)\n");
+  }
+
+  printf("sites=%d data=%d reps=%ld cold_path=%d\n", BENCH_COLD_SITES,
+         BENCH_COLD_DATA, reps, ELOG_USE_COLD_PATH);
+  printf("%-8s %10s %14s %8s\n", "variant", "ns/iter", "insn/iter", "IPC");
+  for (v = 0; v < sizeof(bench_cold_variants) / sizeof(bench_cold_variants[0]);
+       v++) {
+    bench_cold_fn fn = bench_cold_variants[v].fn;
+    double iters = (double)reps * BENCH_COLD_DATA;
+    uint64_t t0, ns, insn, cycles;
+
+    /* ウォームアップ */
+    bench_sink = fn(bench_data, BENCH_COLD_DATA);
+
+    bench_counter_start(insn_fd);
+    bench_counter_start(cycle_fd);
+    t0 = bench_now();
+    for (i = 0; i < reps; i++) {
+      bench_sink = fn(bench_data, BENCH_COLD_DATA);
+    }
+    ns = bench_now() - t0;
+    cycles = bench_counter_stop(cycle_fd);
+    insn = bench_counter_stop(insn_fd);
+
+    if (insn != 0 && cycles != 0) {
+      printf("%-8s %10.2f %14.1f %8.2f\n", bench_cold_variants[v].name,
+             (double)ns / iters, (double)insn / iters,
+             (double)insn / (double)cycles);
+    } else {
+      printf("%-8s %10.2f %14s %8s\n", bench_cold_variants[v].name,
+             (double)ns / iters, "-", "-");
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,64 @@
+/**
+ * @file bench_cold_loop.c
+ * @brief 実行時に除外されるログ呼び出しを含むホットループ
+ *
+ * BENCH_COLD_VARIANT ごとに別のオブジェクトとしてビルドし、
+ * elog_bench_cold と elog_callsite_size で比較する。
+ *   0  ELOG_COMPILED_LEVEL=OFF（呼び出しなし。サイズの基準）
+ *   1  ELOG_USE_COLD_PATH=0（printf の呼び出しをその場に展開）
+ *   2  ELOG_USE_COLD_PATH=1（レベル判定と elog_print の呼び出しだけ）
+ */
+
+#if BENCH_COLD_VARIANT == 0
+#undef ELOG_COMPILED_LEVEL
+#define ELOG_COMPILED_LEVEL ELOG_LEVEL_OFF
+#define BENCH_COLD_LOOP bench_cold_loop_off
+#elif BENCH_COLD_VARIANT == 1
+#undef ELOG_USE_COLD_PATH
+#define ELOG_USE_COLD_PATH 0
+#define BENCH_COLD_LOOP bench_cold_loop_inline
+#else
+#undef ELOG_USE_COLD_PATH
+#define ELOG_USE_COLD_PATH 1
+#define BENCH_COLD_LOOP bench_cold_loop_cold
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "elog/elog.h"
+
+#include "bench.h"
+
+/* 1つのコールサイト: 軽い演算と、除外される4引数のログ */
+#define BENCH_COLD_SITE(k)                                                   \
+  h = (h ^ (v + (k))) * 0x100000001b3ull;                                    \
+  ELOG_INFO("site " #k " value=%u index=%zu hash=%llx ratio=%.3f", v, i,     \
+            (unsigned long long)h, (double)v / 7.0)
+
+uint64_t BENCH_COLD_LOOP(const uint32_t *data, size_t n) {
+  uint64_t h = 0xcbf29ce484222325ull;
+  size_t i;
+
+  for (i = 0; i < n; i++) {
+    uint32_t v = data[i];
+
+    BENCH_COLD_SITE(0);
+    BENCH_COLD_SITE(1);
+    BENCH_COLD_SITE(2);
+    BENCH_COLD_SITE(3);
+    BENCH_COLD_SITE(4);
+    BENCH_COLD_SITE(5);
+    BENCH_COLD_SITE(6);
+    BENCH_COLD_SITE(7);
+    BENCH_COLD_SITE(8);
+    BENCH_COLD_SITE(9);
+    BENCH_COLD_SITE(10);
+    BENCH_COLD_SITE(11);
+    BENCH_COLD_SITE(12);
+    BENCH_COLD_SITE(13);
+    BENCH_COLD_SITE(14);
+    BENCH_COLD_SITE(15);
+  }
+  return h;
+}
@@ -0,0 +1,178 @@
+/**
+ * @file bench_cpp.cpp
+ * @brief C++ フロントエンド（ELOGPP_*）の確認
+ *
+ * 子プロセスの stdout をファイルへ向けて次を行い、exit() で終了する。
+ *   1. 同じ行に並べた ELOGPP_INFO と ELOG_INFO に同じフォーマット・同じ値を
+ *      渡す（std::string などは C 側では c_str() を渡す）
+ *   2. 引数4つの ELOGPP_INFO と ELOG_INFO をそれぞれ繰り返す
+ * 親プロセスは 1 の行を2行ずつ読み、レベル以降（時刻を除く）が一致するかを
+ * 確かめ、2 の1呼び出しあたりの時間を表示する。合わなければ 0 以外で終了する。
+ *
+ * 使い方: elog_bench_cpp [呼び出し回数]
+ */
+
+#include <fcntl.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <string_view>
+
+#include "bench.h"
+#include "elog/elog.hpp"
+
+/* 比べる行の目印（時間を計る行と区別する） */
+#define BENCH_CPP_TAG "chk "
+
+/* 比べる呼び出しの組の数（親プロセスが数える行の半分） */
+#define BENCH_CPP_PAIRS 18
+
+/* 同じ行に置き、ファイル名:行番号まで同じにする */
+#define BENCH_SAME(fmt, ...)                       \
+  do {                                             \
+    ELOGPP_INFO(BENCH_CPP_TAG fmt, ##__VA_ARGS__); \
+    ELOG_INFO(BENCH_CPP_TAG fmt, ##__VA_ARGS__);   \
+  } while (0)
+
+/* C++ だけが受け付ける型の引数と、C 側に渡す同じ値 */
+#define BENCH_PAIR(fmt, cpp_arg, c_arg)      \
+  do {                                       \
+    ELOGPP_INFO(BENCH_CPP_TAG fmt, cpp_arg); \
+    ELOG_INFO(BENCH_CPP_TAG fmt, c_arg);     \
+  } while (0)
+
+static long bench_iters = 200000;
+
+enum bench_color { bench_red, bench_green };
+
+/* ============================================================
+ * 1. 子プロセス
+ * ============================================================ */
+
+static void bench_pairs(void) {
+  std::string str = "std::string";
+  std::string_view view("view-tail", 4);
+  const char *null_str = nullptr;
+  const char no_nul[3] = {'a', 'b', 'c'}; /* 精度の分だけ読む */
+  short s = -3;
+  unsigned char uc = 200;
+
+  BENCH_SAME("no arguments");
+  BENCH_SAME("%d %i", -42, 7);
+  BENCH_SAME("%u %x %X %o", 42u, 255u, 255u, 8u);
+  BENCH_SAME("%x", -1);
+  BENCH_SAME("%ld %lld %zu %jd", -1L, -9000000000LL, (size_t)123,
+             (intmax_t)-5);
+  BENCH_SAME("%hd %hhu", s, uc);
+  BENCH_SAME("%c%c", 'o', 'k');
+  BENCH_SAME("%s|%.3s|%-6s|", "abc", "abcdef", "x");
+  BENCH_SAME("%*d|%-*d|%.*s|", 5, 42, 4, 7, 2, "xyz");
+  BENCH_SAME("%.*s|%.3s|", 3, no_nul, no_nul);
+  BENCH_SAME("%f %.2f %e %g", 3.5, 2.0 / 3, 12345.678, 0.0001);
+  BENCH_SAME("100%% %d", 5);
+  BENCH_SAME("%p", (void *)0x1234);
+  BENCH_PAIR("s=%s", str, str.c_str());
+  BENCH_PAIR("v=%s|", view, "view");
+  BENCH_PAIR("e=%d", bench_green, (int)bench_green);
+  BENCH_PAIR("n=%p", nullptr, (void *)0);
+  BENCH_PAIR("n=%s", null_str, "(null)");
+}
+
+static void bench_child(const char *out) {
+  int fd = open(out, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  uint64_t t0, cpp_ns, c_ns;
+  long i;
+
+  dup2(fd, STDOUT_FILENO);
+  close(fd);
+
+  bench_pairs();
+
+  t0 = bench_now();
+  for (i = 0; i < bench_iters; i++) {
+    ELOGPP_INFO("bench cpp %ld %s %u %f", i, "str", 7u, 1.5);
+    BENCH_BARRIER();
+  }
+  cpp_ns = bench_now() - t0;
+  t0 = bench_now();
+  for (i = 0; i < bench_iters; i++) {
+    ELOG_INFO("bench c %ld %s %u %f", i, "str", 7u, 1.5);
+    BENCH_BARRIER();
+  }
+  c_ns = bench_now() - t0;
+
+  /* 非同期ではリングが満杯で捨てられうるので、ログを通さずに書く */
+  printf("summary cpp_ns=%llu c_ns=%llu\n",
+         (unsigned long long)(cpp_ns * 1000 / (uint64_t)bench_iters),
+         (unsigned long long)(c_ns * 1000 / (uint64_t)bench_iters));
+  fflush(stdout);
+  exit(0);
+}
+
+/* ============================================================
+ * 2. 親プロセス: 行の比較
+ * ============================================================ */
+
+/* レベルの表示以降（時刻・カラーの開始を除く） */
+static const char *bench_body(const char *line) {
+  const char *p = strstr(line, "INFO]");
+
+  return p != nullptr ? p : line;
+}
+
+int main(int argc, char **argv) {
+  char out[] = "/tmp/elog_bench_cpp_XXXXXX";
+  char line[2][1024];
+  unsigned long long cpp_ns = 0, c_ns = 0;
+  long lines = 0, mismatches = 0;
+  int status = 0;
+  int ok;
+  pid_t pid;
+  FILE *f;
+
+  if (argc > 1) {
+    bench_iters = strtol(argv[1], nullptr, 10);
+  }
+  close(mkstemp(out));
+  fflush(stdout);
+  pid = fork();
+  if (pid == 0) {
+    bench_child(out);
+  }
+  waitpid(pid, &status, 0);
+
+  f = fopen(out, "r");
+  while (f != nullptr &&
+         fgets(line[lines % 2], sizeof(line[0]), f) != nullptr) {
+    const char *p;
+
+    if (strstr(line[lines % 2], BENCH_CPP_TAG) != nullptr) {
+      if (lines % 2 == 1 &&
+          strcmp(bench_body(line[0]), bench_body(line[1])) != 0) {
+        printf("mismatch:\n  C++: %s  C:   %s", line[0], line[1]);
+        mismatches++;
+      }
+      lines++;
+    } else if ((p = strstr(line[lines % 2], "summary cpp_ns=")) != nullptr) {
+      sscanf(p, "summary cpp_ns=%llu c_ns=%llu", &cpp_ns, &c_ns);
+    }
+  }
+  if (f != nullptr) {
+    fclose(f);
+  }
+  unlink(out);
+
+  ok = WIFEXITED(status) && WEXITSTATUS(status) == 0 &&
+       lines == 2 * BENCH_CPP_PAIRS && mismatches == 0 && cpp_ns > 0;
+  printf("pairs=%ld/%d mismatches=%ld\n", lines / 2, BENCH_CPP_PAIRS,
+         mismatches);
+  printf("ns/call (4 args): ELOGPP_INFO %.1f, ELOG_INFO %.1f\n",
+         (double)cpp_ns / 1000, (double)c_ns / 1000);
+  printf("%s\n", ok ? "ok" : "FAIL");
+  return ok ? 0 : 1;
+}
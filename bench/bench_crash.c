@@ -0,0 +1,129 @@
+/**
+ * @file bench_crash.c
+ * @brief 致命的なシグナルのハンドラ（ELOG_USE_CRASH_HANDLER=1）の確認
+ *
+ * 子プロセスの stdout をファイルへ向け（stdio は全バッファリングになる）、
+ * 行を書いた直後に NULL ポインタへの書き込みで落とす。
+ * ハンドラなしとありのそれぞれで、ファイルに残った行数と
+ * "fatal signal" のレコードの有無を表示する。
+ * シンクが有効な構成では、バッファ付きの fd シンクのファイルも確認する。
+ * ハンドラありで行が欠けるか、クラッシュのレコードがない、または子プロセスが
+ * SIGSEGV で終わらなかった場合は 0 以外で終了する。
+ *
+ * 使い方: elog_bench_crash [行数]
+ */
+
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "elog/elog.h"
+#include "elog/elog_sink.h"
+
+static long bench_lines = 1000;
+static int *volatile bench_null;
+
+/* 子プロセス: n 行書いて落ちる */
+static void bench_child(int install, const char *out, const char *sink_out) {
+  int fd = open(out, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  long i;
+
+  dup2(fd, STDOUT_FILENO);
+  close(fd);
+#if ELOG_SINK_ENABLED
+  {
+    static elog_fd_sink_t file_sink;
+    static char buf[64 * 1024];
+
+    if (elog_file_sink_open(&file_sink, sink_out, buf, sizeof(buf)) == 0) {
+      elog_sink_add(&file_sink.sink);
+    }
+  }
+#else
+  (void)sink_out;
+#endif
+  if (install) {
+    elog_crash_handler_install();
+  }
+  for (i = 0; i < bench_lines; i++) {
+    ELOG_INFO("request id=%ld status=%d", i, 200);
+  }
+  *bench_null = 0;
+  _exit(0);
+}
+
+/* id が 0 から連続している行数と、クラッシュのレコードの有無 */
+static long bench_count(const char *path, int *crash) {
+  FILE *f = fopen(path, "r");
+  char line[1024];
+  long next = 0;
+
+  *crash = 0;
+  if (f == NULL) {
+    return 0;
+  }
+  while (fgets(line, sizeof(line), f) != NULL) {
+    const char *id = strstr(line, "id=");
+
+    if (id != NULL && strtol(id + 3, NULL, 10) == next) {
+      next++;
+    }
+    if (strstr(line, "fatal signal 11 (SIGSEGV)") != NULL) {
+      *crash = 1;
+    }
+  }
+  fclose(f);
+  return next;
+}
+
+/* 1ケース分: 落ちた子プロセスの出力を数えて表示する */
+static int bench_case(int install) {
+  char out[] = "/tmp/elog_bench_crash_XXXXXX";
+  char sink_out[] = "/tmp/elog_bench_crash_sink_XXXXXX";
+  int status = 0;
+  int crash, sink_crash;
+  long lines, sink_lines;
+  pid_t pid;
+  int ok;
+
+  close(mkstemp(out));
+  close(mkstemp(sink_out));
+  fflush(stdout);
+  pid = fork();
+  if (pid == 0) {
+    bench_child(install, out, sink_out);
+  }
+  waitpid(pid, &status, 0);
+
+  lines = bench_count(out, &crash);
+  sink_lines = ELOG_SINK_ENABLED ? bench_count(sink_out, &sink_crash) : 0;
+  ok = WIFSIGNALED(status) && WTERMSIG(status) == SIGSEGV &&
+       lines == bench_lines && crash &&
+       (!ELOG_SINK_ENABLED || (sink_lines == bench_lines && sink_crash));
+  printf("%-8s signal=%-3d stdout=%ld/%ld%s", install ? "handler" : "none",
+         WIFSIGNALED(status) ? WTERMSIG(status) : 0, lines, bench_lines,
+         crash ? " +crash" : "");
+#if ELOG_SINK_ENABLED
+  printf(" fd_sink=%ld/%ld%s", sink_lines, bench_lines,
+         sink_crash ? " +crash" : "");
+#endif
+  printf("%s\n", install ? (ok ? " ok" : " FAIL") : "");
+  unlink(out);
+  unlink(sink_out);
+  return install && !ok;
+}
+
+int main(int argc, char **argv) {
+  int failed = 0;
+
+  if (argc > 1) {
+    bench_lines = strtol(argv[1], NULL, 10);
+  }
+  failed |= bench_case(0);
+  failed |= bench_case(1);
+  return failed;
+}
@@ -0,0 +1,167 @@
+/**
+ * @file bench_format.c
+ * @brief elog のフォーマッタと snprintf の比較
+ *
+ * 引数の組み合わせごとに、可変長引数からの整形（elog_vformat と vsnprintf）と
+ * エンコード済み引数からの復元（elog_args_format、非同期・バイナリの出力側）
+ * の ns/call を測る。あわせて各ケースで出力が snprintf と一致するかを確認する。
+ *
+ * 使い方: elog_bench_format [呼び出し回数]
+ */
+
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench.h"
+#include "elog_internal.h"
+
+#define BENCH_FORMAT_BUF 256
+
+/*
+ * 引数の組み合わせ（ケースごとに同じ引数で3通りの整形を呼ぶ）
+ * line は printf 出力の1行と同じ形。ファイル名:行番号は ELOG_USE_FILE_LINE に
+ * よらず含める（ELOG_FILE_LINE_FMT は無効時に空になり、引数とずれるため）
+ */
+#define BENCH_FORMAT_CASES(X)                                             \
+  X(int_small, "status=%d code=%d", 200, -7)                              \
+  X(int_large, "id=%lld size=%zu seq=%u", -9123456789012345ll,            \
+    (size_t)123456789012u, 4000000000u)                                   \
+  X(hex, "addr=%#018llx mask=%08x flags=%X", 0x7ffd1234abcdull, 0xbeefu,  \
+    0xfeu)                                                                \
+  X(width, "[%5d|%-5d|%+d|% d|%05d]", 42, 42, 42, 42, -42)                \
+  X(string, "user=%s path=%-16s tag=%.3s", "alice", "/api/v1/items",      \
+    "abcdef")                                                             \
+  X(float, "latency=%.3f ratio=%f temp=%.1f", 1.25, 0.333333333, -40.0)   \
+  X(mixed, "request id=%ld status=%d path=%s latency=%.3f", 123456L, 200, \
+    "/api/v1/items", 1.25)                                                \
+  X(char_ptr, "c=%c p=%p", 'x', (void *)0x7ffd1234abcdu)                  \
+  X(line, "%s%s [%s: %d] request id=%ld status=%d path=%s "               \
+    "latency=%.3f%s\n", ELOG_COLOR_BEGIN(ELOG_COLOR_INFO),                \
+    ELOG_LEVEL_FMT_INFO, "bench_format.c", 120, 123456L, 200,             \
+    "/api/v1/items", 1.25, ELOG_COLOR_END)
+
+static long bench_iters = 1000000;
+static char bench_out[BENCH_FORMAT_BUF];
+static int bench_mismatch;
+
+static size_t bench_libc(char *dst, size_t cap, const char *fmt, ...) {
+  va_list ap;
+  int n;
+
+  va_start(ap, fmt);
+  n = vsnprintf(dst, cap, fmt, ap);
+  va_end(ap);
+  return n > 0 ? (size_t)n : 0;
+}
+
+static size_t bench_encode(uint8_t *dst, size_t cap, const char *fmt, ...) {
+  va_list ap;
+  size_t n;
+
+  va_start(ap, fmt);
+  n = elog_args_encode(dst, cap, fmt, ap);
+  va_end(ap);
+  return n;
+}
+
+static double bench_ns(uint64_t t0) {
+  return (double)(bench_now() - t0) / (double)bench_iters;
+}
+
+/* 1ケース分: 一致の確認と3通りの計測 */
+#define BENCH_FORMAT_RUN(name, fmt, ...)                                      \
+  {                                                                           \
+    char expect[BENCH_FORMAT_BUF];                                            \
+    uint8_t args[BENCH_FORMAT_BUF];                                           \
+    size_t args_len;                                                          \
+    double libc_ns, vformat_ns, args_ns;                                      \
+    uint64_t t0;                                                              \
+    long i;                                                                   \
+                                                                              \
+    snprintf(expect, sizeof(expect), fmt, __VA_ARGS__);                       \
+    args_len = bench_encode(args, sizeof(args), fmt, __VA_ARGS__);            \
+    elog_format(bench_out, sizeof(bench_out), fmt, __VA_ARGS__);              \
+    if (strcmp(bench_out, expect) != 0) {                                     \
+      printf("MISMATCH %s vformat: \"%s\" != \"%s\"\n", #name, bench_out,     \
+             expect);                                                         \
+      bench_mismatch = 1;                                                     \
+    }                                                                         \
+    elog_args_format(bench_out, sizeof(bench_out), fmt, args, args_len);      \
+    if (strcmp(bench_out, expect) != 0) {                                     \
+      printf("MISMATCH %s args: \"%s\" != \"%s\"\n", #name, bench_out,        \
+             expect);                                                         \
+      bench_mismatch = 1;                                                     \
+    }                                                                         \
+                                                                              \
+    t0 = bench_now();                                                         \
+    for (i = 0; i < bench_iters; i++) {                                       \
+      bench_libc(bench_out, sizeof(bench_out), fmt, __VA_ARGS__);             \
+      BENCH_BARRIER();                                                        \
+    }                                                                         \
+    libc_ns = bench_ns(t0);                                                   \
+    t0 = bench_now();                                                         \
+    for (i = 0; i < bench_iters; i++) {                                       \
+      elog_format(bench_out, sizeof(bench_out), fmt, __VA_ARGS__);            \
+      BENCH_BARRIER();                                                        \
+    }                                                                         \
+    vformat_ns = bench_ns(t0);                                                \
+    t0 = bench_now();                                                         \
+    for (i = 0; i < bench_iters; i++) {                                       \
+      elog_args_format(bench_out, sizeof(bench_out), fmt, args, args_len);    \
+      BENCH_BARRIER();                                                        \
+    }                                                                         \
+    args_ns = bench_ns(t0);                                                   \
+    printf("%-10s %10.1f %10.1f %10.1f %8.2fx\n", #name, libc_ns, vformat_ns, \
+           args_ns, libc_ns / vformat_ns);                                    \
+  }
+
+/* 丸めの確認: 乱数の double を各精度で snprintf と比べる */
+static void bench_check_float(void) {
+  uint64_t x = 88172645463325252ull;
+  elog_spec_t spec;
+  char expect[64];
+  char one[16];
+  int prec;
+  long i;
+
+  memset(&spec, 0, sizeof(spec));
+  spec.width = -1;
+  spec.conv = 'f';
+  for (i = 0; i < 200000; i++) {
+    double v;
+
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    v = (double)(int64_t)x / (double)(1ull << (x & 63));
+    for (prec = 0; prec <= 9; prec++) {
+      spec.precision = prec;
+      snprintf(one, sizeof(one), "%%.%df", prec);
+      snprintf(expect, sizeof(expect), one, v);
+      elog_format_double(bench_out, sizeof(bench_out), &spec, v);
+      if (strcmp(bench_out, expect) != 0) {
+        printf("MISMATCH %%.%df: \"%s\" != \"%s\"\n", prec, bench_out,
+               expect);
+        bench_mismatch = 1;
+        return;
+      }
+    }
+  }
+}
+
+int main(int argc, char **argv) {
+  if (argc > 1) {
+    bench_iters = strtol(argv[1], NULL, 10);
+  }
+
+  printf("fast_format=%d iters=%ld\n", ELOG_USE_FAST_FORMAT, bench_iters);
+  printf("%-10s %10s %10s %10s %9s\n", "case", "snprintf", "vformat",
+         "args", "speedup");
+  BENCH_FORMAT_CASES(BENCH_FORMAT_RUN)
+  bench_check_float();
+
+  return bench_mismatch;
+}
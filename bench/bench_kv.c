@@ -0,0 +1,199 @@
+/**
+ * @file bench_kv.c
+ * @brief 構造化ログ（ELOG_*_KV）のエンコーダ
+ *
+ * 組み込みの3つのエンコーダ（text / logfmt / JSON）の ns/call を、
+ * エスケープの要らないフィールドと要るフィールドのそれぞれで測る。
+ * あわせて決まった入力に対する出力と、長さ・位置を変えた文字列の
+ * エスケープ結果が1文字ずつの素朴な実装と一致するかを確認する。
+ *
+ * 使い方: elog_bench_kv [呼び出し回数]
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench.h"
+#include "elog/elog.h"
+
+#define BENCH_KV_BUF 512
+
+static long bench_iters = 1000000;
+static int bench_mismatch;
+
+/* ファイル名なし・時刻なしで出力が決まるコールサイト */
+static elog_callsite_t bench_cs = {.fmt = "request done",
+                                   .level = ELOG_LEVEL_INFO};
+
+static void bench_expect(const char *name, const char *got,
+                         const char *expect) {
+  if (strcmp(got, expect) != 0) {
+    printf("MISMATCH %s:\n  got    %s  expect %s", name, got, expect);
+    bench_mismatch = 1;
+  }
+}
+
+/* 決まった入力に対する各エンコーダの出力 */
+static void bench_check_format(void) {
+  const elog_kv_t kv[] = {
+      ELOG_KV_INT("status", -7),         ELOG_KV_UINT("bytes", 4000000000u),
+      ELOG_KV_FLOAT("latency", 1.25),    ELOG_KV_BOOL("cached", 0),
+      ELOG_KV_STR("path", "/api/v1"),    ELOG_KV_STR("q", "a b=\"c\"\n"),
+      ELOG_KV_STR("none", NULL),
+  };
+  size_t n = sizeof(kv) / sizeof(kv[0]);
+  char buf[BENCH_KV_BUF];
+  size_t len;
+
+  len = elog_kv_encode_logfmt(buf, sizeof(buf), &bench_cs, kv, n, 0);
+  buf[len] = '\0';
+  bench_expect("logfmt", buf,
+               "level=info msg=\"request done\" status=-7 bytes=4000000000 "
+               "latency=1.25 cached=false path=/api/v1 "
+               "q=\"a b=\\\"c\\\"\\n\" none=null\n");
+
+  len = elog_kv_encode_json(buf, sizeof(buf), &bench_cs, kv, n, 0);
+  buf[len] = '\0';
+  bench_expect("json", buf,
+               "{\"level\":\"info\",\"msg\":\"request done\",\"status\":-7,"
+               "\"bytes\":4000000000,\"latency\":1.25,\"cached\":false,"
+               "\"path\":\"/api/v1\",\"q\":\"a b=\\\"c\\\"\\n\","
+               "\"none\":null}\n");
+
+  /* 入りきらないフィールドは落とし、行の形は保つ */
+  len = elog_kv_encode_json(buf, 80, &bench_cs, kv, n, 0);
+  buf[len] = '\0';
+  bench_expect("json_truncated", buf,
+               "{\"level\":\"info\",\"msg\":\"request done\",\"status\":-7,"
+               "\"bytes\":4000000000}\n");
+
+  /* メッセージまで入らない場合もフィールドは正しい JSON で残す */
+  {
+    static char long_fmt[BENCH_KV_BUF + 200];
+    elog_callsite_t long_cs = {.fmt = long_fmt, .level = ELOG_LEVEL_INFO};
+    const elog_kv_t one[] = {ELOG_KV_INT("k", 1)};
+
+    memset(long_fmt, 'm', sizeof(long_fmt) - 1);
+    len = elog_kv_encode_json(buf, sizeof(buf), &long_cs, one, 1, 0);
+    buf[len] = '\0';
+    bench_expect("json_long_msg", buf, "{\"k\":1}\n");
+  }
+}
+
+/* 1文字ずつエスケープする素朴な実装（比較用） */
+static size_t bench_escape_ref(char *dst, const char *s) {
+  char *p = dst;
+
+  for (; *s != '\0'; s++) {
+    unsigned char c = (unsigned char)*s;
+    if (c == '"' || c == '\\') {
+      *p++ = '\\';
+      *p++ = (char)c;
+    } else if (c == '\n') {
+      p += sprintf(p, "\\n");
+    } else if (c == '\r') {
+      p += sprintf(p, "\\r");
+    } else if (c == '\t') {
+      p += sprintf(p, "\\t");
+    } else if (c < 0x20) {
+      p += sprintf(p, "\\u%04x", c);
+    } else {
+      *p++ = (char)c;
+    }
+  }
+  *p = '\0';
+  return (size_t)(p - dst);
+}
+
+/* 長さと特別な文字の位置を変えて、JSON の文字列値を比較する */
+static void bench_check_escape(void) {
+  static const char specials[] = {'"', '\\', '\n', '\t', 0x01, 0x1f, ' ', '='};
+  char s[64];
+  /* 最悪は全文字が \uXXXX（6文字）。expect はその前後の固定部分の分だけ大きく */
+  char ref[sizeof(s) * 6];
+  char expect[sizeof(ref) + 64];
+  char buf[BENCH_KV_BUF];
+  size_t len, pos, k;
+
+  for (len = 1; len < sizeof(s); len++) {
+    for (pos = 0; pos < len; pos++) {
+      for (k = 0; k < sizeof(specials); k++) {
+        elog_kv_t kv;
+        size_t n;
+
+        memset(s, 'a' + (int)(len % 26), len);
+        s[len] = '\0';
+        s[pos] = specials[k];
+        kv = elog_kv_str("v", s);
+        bench_escape_ref(ref, s);
+        snprintf(expect, sizeof(expect),
+                 "{\"level\":\"info\",\"msg\":\"request done\",\"v\":\"%s\"}\n",
+                 ref);
+        n = elog_kv_encode_json(buf, sizeof(buf), &bench_cs, &kv, 1, 0);
+        buf[n] = '\0';
+        if (strcmp(buf, expect) != 0) {
+          printf("MISMATCH escape len=%zu pos=%zu char=0x%02x\n", len, pos,
+                 (unsigned char)specials[k]);
+          bench_mismatch = 1;
+          return;
+        }
+      }
+    }
+  }
+}
+
+static double bench_ns(uint64_t t0) {
+  return (double)(bench_now() - t0) / (double)bench_iters;
+}
+
+static void bench_run(const char *name, elog_kv_encoder_t enc,
+                      const elog_kv_t *kv, size_t n) {
+  char buf[BENCH_KV_BUF];
+  uint64_t t0;
+  long i;
+
+  t0 = bench_now();
+  for (i = 0; i < bench_iters; i++) {
+    enc(buf, sizeof(buf), &bench_cs, kv, n, 0);
+    BENCH_BARRIER();
+  }
+  printf("%-8s %10.1f\n", name, bench_ns(t0));
+}
+
+int main(int argc, char **argv) {
+  const elog_kv_t plain[] = {
+      ELOG_KV_STR("method", "GET"),
+      ELOG_KV_STR("path", "/api/v1/items/0123456789abcdef"),
+      ELOG_KV_INT("status", 200),
+      ELOG_KV_FLOAT("latency", 1.25),
+      ELOG_KV_STR("agent", "Mozilla/5.0-compatible-bench-client-0123456789"),
+  };
+  const elog_kv_t escaped[] = {
+      ELOG_KV_STR("method", "GET"),
+      ELOG_KV_STR("path", "/api/v1/items?q=\"a b\""),
+      ELOG_KV_INT("status", 200),
+      ELOG_KV_FLOAT("latency", 1.25),
+      ELOG_KV_STR("error", "line one\nline two\twith \\ backslash"),
+  };
+  size_t n = sizeof(plain) / sizeof(plain[0]);
+
+  if (argc > 1) {
+    bench_iters = strtol(argv[1], NULL, 10);
+  }
+
+  bench_check_format();
+  bench_check_escape();
+
+  printf("iters=%ld fields=%zu (ns/call)\n", bench_iters, n);
+  printf("-- plain values\n");
+  bench_run("text", elog_kv_encode_text, plain, n);
+  bench_run("logfmt", elog_kv_encode_logfmt, plain, n);
+  bench_run("json", elog_kv_encode_json, plain, n);
+  printf("-- values needing escapes\n");
+  bench_run("text", elog_kv_encode_text, escaped, n);
+  bench_run("logfmt", elog_kv_encode_logfmt, escaped, n);
+  bench_run("json", elog_kv_encode_json, escaped, n);
+  return bench_mismatch;
+}
@@ -0,0 +1,170 @@
+/**
+ * @file bench_line.c
+ * @brief 1行単位の書き込み（ELOG_USE_ATOMIC_LINE=1）と printf 出力の比較
+ *
+ * O_APPEND で開いたファイルを stdout にして、2つのプロセスがそれぞれ
+ * 1/8/32 スレッドで書き込む。printf は従来の ELOG_IMPL と同じ形の行を
+ * その場の printf で、atomic は ELOG_INFO（elog_print の write(2) 1回）で書く。
+ * 1行あたりの時間（経過時間 / 全行数）と、書き終えたファイルのうち
+ * 形の崩れた行（別の書き込みと混ざった行）の数を表示する。
+ * atomic で崩れた行があれば 0 以外で終了する。
+ *
+ * 使い方: elog_bench_line [スレッドあたりの行数]
+ */
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "bench.h"
+#include "elog/elog.h"
+
+#define BENCH_LINE_PROCS 2
+#define BENCH_LINE_MAX_THREADS 32
+
+/* 行の先頭（カラー・レベル）と末尾（最後の引数・リセットコード） */
+#define BENCH_LINE_HEAD ELOG_COLOR_BEGIN(ELOG_COLOR_INFO) ELOG_LEVEL_FMT_INFO
+#define BENCH_LINE_TAIL "latency=1.250" ELOG_COLOR_END
+
+static long bench_iters = 20000;
+
+/* 従来の printf 出力（ELOG_USE_COLD_PATH=0 の ELOG_IMPL と同じ形） */
+static void *bench_printf_main(void *arg) {
+  long i;
+
+  (void)arg;
+  for (i = 0; i < bench_iters; i++) {
+    printf("%s%s " ELOG_FILE_LINE_FMT
+           " request id=%ld status=%d path=%s latency=%.3f%s\n",
+           ELOG_COLOR_BEGIN(ELOG_COLOR_INFO),
+           ELOG_LEVEL_FMT_INFO ELOG_FILE_LINE_ARGS, i, 200, "/api/v1/items",
+           1.25, ELOG_COLOR_END);
+  }
+  return NULL;
+}
+
+static void *bench_atomic_main(void *arg) {
+  long i;
+
+  (void)arg;
+  for (i = 0; i < bench_iters; i++) {
+    ELOG_INFO("request id=%ld status=%d path=%s latency=%.3f", i, 200,
+              "/api/v1/items", 1.25);
+  }
+  return NULL;
+}
+
+/* 1プロセス分: threads 個のスレッドで書き、stdout を吐き出して終わる */
+static void bench_child(void *(*fn)(void *), int threads) {
+  pthread_t th[BENCH_LINE_MAX_THREADS];
+  int i;
+
+  for (i = 0; i < threads; i++) {
+    pthread_create(&th[i], NULL, fn, NULL);
+  }
+  for (i = 0; i < threads; i++) {
+    pthread_join(th[i], NULL);
+  }
+  fflush(stdout);
+  _exit(0);
+}
+
+/* 形の崩れた行と全行数を数える */
+static long bench_check(const char *path, long *lines) {
+  FILE *f = fopen(path, "r");
+  char line[1024];
+  long broken = 0;
+
+  *lines = 0;
+  if (f == NULL) {
+    return -1;
+  }
+  while (fgets(line, sizeof(line), f) != NULL) {
+    size_t len = strlen(line);
+    char *first = strstr(line, "id=");
+
+    (*lines)++;
+    if (len < 1 || line[len - 1] != '\n' ||
+        strncmp(line, BENCH_LINE_HEAD, strlen(BENCH_LINE_HEAD)) != 0 ||
+        len - 1 < strlen(BENCH_LINE_TAIL) ||
+        memcmp(line + len - 1 - strlen(BENCH_LINE_TAIL), BENCH_LINE_TAIL,
+               strlen(BENCH_LINE_TAIL)) != 0 ||
+        first == NULL || strstr(first + 3, "id=") != NULL) {
+      broken++;
+    }
+  }
+  fclose(f);
+  return broken;
+}
+
+/* 1ケース分: 2プロセス × threads スレッドで書き、ns/line と崩れた行を返す */
+static double bench_case(void *(*fn)(void *), int threads, long *broken) {
+  char path[] = "/tmp/elog_bench_line_XXXXXX";
+  int saved = dup(STDOUT_FILENO);
+  int fd = mkstemp(path);
+  pid_t pid[BENCH_LINE_PROCS];
+  uint64_t t0, elapsed;
+  long lines;
+  int p;
+
+  close(fd);
+  fd = open(path, O_WRONLY | O_TRUNC | O_APPEND);
+  fflush(stdout);
+  dup2(fd, STDOUT_FILENO);
+  close(fd);
+
+  t0 = bench_now();
+  for (p = 0; p < BENCH_LINE_PROCS; p++) {
+    pid[p] = fork();
+    if (pid[p] == 0) {
+      bench_child(fn, threads);
+    }
+  }
+  for (p = 0; p < BENCH_LINE_PROCS; p++) {
+    waitpid(pid[p], NULL, 0);
+  }
+  elapsed = bench_now() - t0;
+
+  dup2(saved, STDOUT_FILENO);
+  close(saved);
+  *broken = bench_check(path, &lines);
+  if (lines != BENCH_LINE_PROCS * threads * bench_iters) {
+    *broken += BENCH_LINE_PROCS * threads * bench_iters - lines;
+  }
+  unlink(path);
+  return (double)elapsed / (double)(BENCH_LINE_PROCS * threads * bench_iters);
+}
+
+int main(int argc, char **argv) {
+  static const int threads[] = {1, 8, BENCH_LINE_MAX_THREADS};
+  int failed = 0;
+  size_t t;
+
+  if (argc > 1) {
+    bench_iters = strtol(argv[1], NULL, 10);
+  }
+
+  printf("procs=%d lines/thread=%ld (O_APPEND file)\n", BENCH_LINE_PROCS,
+         bench_iters);
+  printf("%-8s %14s %10s %14s %10s\n", "threads", "printf ns/line", "broken",
+         "atomic ns/line", "broken");
+  for (t = 0; t < sizeof(threads) / sizeof(threads[0]); t++) {
+    long printf_broken, atomic_broken;
+    double printf_ns = bench_case(bench_printf_main, threads[t],
+                                  &printf_broken);
+    double atomic_ns = bench_case(bench_atomic_main, threads[t],
+                                  &atomic_broken);
+
+    printf("%-8d %14.1f %10ld %14.1f %10ld\n", threads[t], printf_ns,
+           printf_broken, atomic_ns, atomic_broken);
+    if (atomic_broken != 0) {
+      failed = 1;
+    }
+  }
+  return failed;
+}
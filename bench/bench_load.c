@@ -0,0 +1,18 @@
+/**
+ * @file bench_load.c
+ * @brief 変数の読み出しで実行時に除外される呼び出しの計測
+ *
+ * このファイルだけ ELOG_USE_JUMP_LABEL を無効にし、
+ * ジャンプラベル（NOP）との比較対象にする。
+ */
+
+#undef ELOG_USE_JUMP_LABEL
+#define ELOG_USE_JUMP_LABEL 0
+
+#include "elog/elog.h"
+
+#include "bench.h"
+
+BENCH_DEFINE(bench_load_args4,
+             ELOG_INFO("request id=%ld status=%d path=%s latency=%.3f", i, 200,
+                       "/api/v1/items", 1.25))
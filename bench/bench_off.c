@@ -0,0 +1,17 @@
+/**
+ * @file bench_off.c
+ * @brief コンパイル時に除去されたログ呼び出しの計測
+ *
+ * このファイルだけ ELOG_COMPILED_LEVEL を OFF に差し替える。
+ */
+
+#undef ELOG_COMPILED_LEVEL
+#define ELOG_COMPILED_LEVEL ELOG_LEVEL_OFF
+
+#include "elog/elog.h"
+
+#include "bench.h"
+
+BENCH_DEFINE(bench_off_args4,
+             ELOG_CRITICAL("request id=%ld status=%d path=%s latency=%.3f", i,
+                           200, "/api/v1/items", 1.25))
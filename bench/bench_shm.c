@@ -0,0 +1,185 @@
+/**
+ * @file bench_shm.c
+ * @brief 共有メモリのリング（elog_shm_sink_t）と fd シンクの比較
+ *
+ * 1行あたりの時間を、共有メモリのリング・バッファ付きの fd シンク・
+ * 1行ごとに write(2) する fd シンクで測る。
+ * あわせて子プロセスにリングへ書かせてから SIGSEGV で落とし、
+ * 親プロセスで elog_shm_recover() が最後の行まで順番どおり
+ * 取り出せるかを確認する（リングが一周しない場合と一周する場合）。
+ * 取り出した行が欠けていれば 0 以外で終了する。
+ *
+ * 使い方: elog_bench_shm [行数]
+ */
+
+#include <fcntl.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "bench.h"
+#include "elog/elog_sink.h"
+#include "elog_internal.h"
+
+#define BENCH_SHM_SMALL (1u << 20)
+#define BENCH_SHM_LARGE (64u << 20)
+
+static long bench_iters = 200000;
+static char bench_path[64];
+
+/* 取り出した行の検査: 連続した id の先頭と末尾、崩れた行の数 */
+static long bench_first, bench_next, bench_broken;
+
+static void bench_collect(const void *data, size_t len) {
+  const char *p = (const char *)data;
+  const char *end = p + len;
+
+  while (p < end) {
+    const char *nl = memchr(p, '\n', (size_t)(end - p));
+    char line[256];
+    const char *id;
+    long v;
+
+    if (nl == NULL || (size_t)(nl - p) >= sizeof(line)) {
+      bench_broken++;
+      return;
+    }
+    memcpy(line, p, (size_t)(nl - p));
+    line[nl - p] = '\0';
+    id = strstr(line, "id=");
+    if (id == NULL) {
+      bench_broken++;
+      return;
+    }
+    v = strtol(id + 3, NULL, 10);
+    if (bench_next < 0) {
+      bench_first = v;
+    } else if (v != bench_next) {
+      bench_broken++;
+    }
+    bench_next = v + 1;
+    p = nl + 1;
+  }
+}
+
+static void bench_lines(long n) {
+  long i;
+
+  for (i = 0; i < n; i++) {
+    ELOG_INFO("request id=%ld status=%d path=%s", i, 200, "/api/v1/items");
+  }
+}
+
+static double bench_ns(uint64_t t0, long n) {
+  return (double)(bench_now() - t0) / (double)n;
+}
+
+/* ============================================================
+ * 1. 異常終了からの取り出し
+ * ============================================================ */
+
+/* 子プロセスに n 行書かせて落とし、取り出した行を確認する */
+static int bench_crash(size_t size, long n) {
+  struct stat st;
+  void *map;
+  long count;
+  pid_t pid;
+  int status = 0;
+  int fd;
+  int ok;
+
+  unlink(bench_path);
+  pid = fork();
+  if (pid == 0) {
+    static elog_shm_sink_t shm;
+
+    if (elog_shm_sink_open(&shm, bench_path, size) != 0) {
+      _exit(3);
+    }
+    elog_sink_add(&shm.sink);
+    bench_lines(n);
+    raise(SIGSEGV);
+    _exit(0);
+  }
+  waitpid(pid, &status, 0);
+
+  fd = open(bench_path, O_RDONLY);
+  if (fd < 0 || fstat(fd, &st) != 0) {
+    printf("FAIL crash size=%zu: cannot open %s\n", size, bench_path);
+    return 1;
+  }
+  map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED) {
+    return 1;
+  }
+  bench_next = -1;
+  bench_first = -1;
+  bench_broken = 0;
+  count = elog_shm_recover(map, (size_t)st.st_size, bench_collect);
+  munmap(map, (size_t)st.st_size);
+
+  /* 一周しない大きさなら全行、一周するなら末尾まで連続した行 */
+  ok = WIFSIGNALED(status) && count > 0 && bench_broken == 0 &&
+       bench_next == n && ((uint64_t)n * 128 > size || bench_first == 0);
+  printf("crash size=%-9zu signal=%-3d records=%-8ld lines=%ld..%ld %s\n",
+         size, WIFSIGNALED(status) ? WTERMSIG(status) : 0, count, bench_first,
+         bench_next - 1, ok ? "ok" : "FAIL");
+  unlink(bench_path);
+  return ok ? 0 : 1;
+}
+
+/* ============================================================
+ * 2. 1行あたりの時間
+ * ============================================================ */
+
+static double bench_sink(elog_sink_t *sink) {
+  uint64_t t0;
+
+  elog_sink_add(sink);
+  t0 = bench_now();
+  bench_lines(bench_iters);
+  elog_sink_flush();
+  elog_sink_remove(sink);
+  return bench_ns(t0, bench_iters);
+}
+
+int main(int argc, char **argv) {
+  static elog_shm_sink_t shm;
+  static elog_fd_sink_t fd_sink;
+  static char buf[64 * 1024];
+  int failed = 0;
+
+  if (argc > 1) {
+    bench_iters = strtol(argv[1], NULL, 10);
+  }
+  snprintf(bench_path, sizeof(bench_path), "%s/elog_bench_shm_%d",
+           access("/dev/shm", W_OK) == 0 ? "/dev/shm" : "/tmp", (int)getpid());
+
+  /* 標準出力シンクを外して、計測するシンクだけに書く */
+  elog_sink_remove(elog_sink_stdout());
+
+  failed |= bench_crash(BENCH_SHM_LARGE, bench_iters);
+  failed |= bench_crash(BENCH_SHM_SMALL, bench_iters);
+
+  printf("lines=%ld (ns/line)\n", bench_iters);
+  if (elog_shm_sink_open(&shm, bench_path, BENCH_SHM_SMALL) == 0) {
+    printf("%-12s %10.1f\n", "shm", bench_sink(&shm.sink));
+    unlink(bench_path);
+  }
+  if (elog_file_sink_open(&fd_sink, bench_path, buf, sizeof(buf)) == 0) {
+    printf("%-12s %10.1f\n", "fd buffered", bench_sink(&fd_sink.sink));
+    unlink(bench_path);
+  }
+  if (elog_file_sink_open(&fd_sink, bench_path, NULL, 0) == 0) {
+    printf("%-12s %10.1f\n", "fd write(2)", bench_sink(&fd_sink.sink));
+    unlink(bench_path);
+  }
+  return failed;
+}
@@ -0,0 +1,222 @@
+/**
+ * @file bench_sigsafe.c
+ * @brief シグナルハンドラからの出力（ELOG_*_SIGSAFE）の確認
+ *
+ * 子プロセスの stdout をファイルへ向け、複数のスレッドが ELOG_INFO で
+ * 書き続ける間、ITIMER_REAL の SIGALRM ハンドラから ELOG_INFO_SIGSAFE で
+ * 通し番号付きの行を書く（ハンドラは stdio やシンクのロックを持った
+ * スレッドにも割り込む）。
+ * 親プロセスはファイルから通し番号を集め、欠け・重複・崩れた行と
+ * 破棄の報告件数を数えて、ハンドラ内の1回あたりの時間とともに表示する。
+ * 子プロセスが時間内に終わらない（デッドロック）、または
+ * 「書いた数 = 出力された数 + 破棄された数」にならない場合は 0 以外で終了する。
+ *
+ * 使い方: elog_bench_sigsafe [スレッドあたりの行数] [SIGALRM の間隔(us)]
+ */
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "bench.h"
+#include "elog/elog.h"
+
+#define BENCH_SIGSAFE_THREADS 4
+#define BENCH_SIGSAFE_TIMEOUT_S 60
+
+static long bench_iters = 100000;
+static long bench_interval_us = 50;
+
+/* ============================================================
+ * 1. 子プロセス
+ * ============================================================ */
+
+static long bench_alarm_seq;
+static uint64_t bench_alarm_ns;
+
+static void bench_on_alarm(int sig) {
+  long seq = __atomic_fetch_add(&bench_alarm_seq, 1, __ATOMIC_RELAXED);
+  uint64_t t0 = bench_now();
+
+  (void)sig;
+  ELOG_INFO_SIGSAFE("alarm seq=%ld end", seq);
+  __atomic_fetch_add(&bench_alarm_ns, bench_now() - t0, __ATOMIC_RELAXED);
+}
+
+static void *bench_worker(void *arg) {
+  long id = (long)(intptr_t)arg;
+  long i;
+
+  for (i = 0; i < bench_iters; i++) {
+    ELOG_INFO("worker=%ld line=%ld path=%s", id, i, "/api/v1/items");
+  }
+  return NULL;
+}
+
+static void bench_child(const char *out) {
+  pthread_t threads[BENCH_SIGSAFE_THREADS];
+  struct itimerval it;
+  struct sigaction sa;
+  sigset_t set;
+  uint64_t t0, elapsed;
+  long total;
+  int fd = open(out, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  int i;
+
+  dup2(fd, STDOUT_FILENO);
+  close(fd);
+
+  memset(&sa, 0, sizeof(sa));
+  sa.sa_handler = bench_on_alarm;
+  sa.sa_flags = SA_RESTART;
+  sigemptyset(&sa.sa_mask);
+  sigaction(SIGALRM, &sa, NULL);
+  memset(&it, 0, sizeof(it));
+  it.it_interval.tv_usec = bench_interval_us;
+  it.it_value.tv_usec = bench_interval_us;
+  setitimer(ITIMER_REAL, &it, NULL);
+
+  t0 = bench_now();
+  for (i = 0; i < BENCH_SIGSAFE_THREADS; i++) {
+    pthread_create(&threads[i], NULL, bench_worker, (void *)(intptr_t)i);
+  }
+  for (i = 0; i < BENCH_SIGSAFE_THREADS; i++) {
+    pthread_join(threads[i], NULL);
+  }
+  elapsed = bench_now() - t0;
+
+  /* タイマーを止め、実行中のハンドラが終わるのを待つ */
+  memset(&it, 0, sizeof(it));
+  setitimer(ITIMER_REAL, &it, NULL);
+  sigemptyset(&set);
+  sigaddset(&set, SIGALRM);
+  pthread_sigmask(SIG_BLOCK, &set, NULL);
+  usleep(10000);
+  total = __atomic_load_n(&bench_alarm_seq, __ATOMIC_RELAXED);
+
+  ELOG_INFO("summary alarms=%ld handler_ns=%llu line_ns=%llu", total,
+            (unsigned long long)(total > 0 ? bench_alarm_ns / (uint64_t)total
+                                           : 0),
+            (unsigned long long)(elapsed /
+                                 (uint64_t)(bench_iters *
+                                            BENCH_SIGSAFE_THREADS)));
+#if ELOG_USE_ASYNC
+  elog_async_flush();
+#endif
+  fflush(stdout);
+  _exit(0);
+}
+
+/* ============================================================
+ * 2. 親プロセス: 出力の検査
+ * ============================================================ */
+
+/* 子プロセスを待つ（時間内に終わらなければ止めて 0 を返す） */
+static int bench_wait(pid_t pid, int *status) {
+  int i;
+
+  for (i = 0; i < BENCH_SIGSAFE_TIMEOUT_S * 100; i++) {
+    if (waitpid(pid, status, WNOHANG) == pid) {
+      return 1;
+    }
+    usleep(10000);
+  }
+  kill(pid, SIGKILL);
+  waitpid(pid, status, 0);
+  return 0;
+}
+
+int main(int argc, char **argv) {
+  char out[] = "/tmp/elog_bench_sigsafe_XXXXXX";
+  char line[1024];
+  unsigned char *seen = NULL;
+  long cap = 0;
+  long total = -1, handler_ns = 0, line_ns = 0;
+  long count = 0, dup = 0, broken = 0, dropped = 0, missing = 0;
+  int status = 0;
+  int finished;
+  pid_t pid;
+  FILE *f;
+  long i;
+  int ok;
+
+  if (argc > 1) {
+    bench_iters = strtol(argv[1], NULL, 10);
+  }
+  if (argc > 2) {
+    bench_interval_us = strtol(argv[2], NULL, 10);
+  }
+  close(mkstemp(out));
+  fflush(stdout);
+  pid = fork();
+  if (pid == 0) {
+    bench_child(out);
+  }
+  finished = bench_wait(pid, &status);
+
+  f = fopen(out, "r");
+  while (f != NULL && fgets(line, sizeof(line), f) != NULL) {
+    const char *p;
+
+    if ((p = strstr(line, "alarm seq=")) != NULL) {
+      char *end;
+      long seq = strtol(p + 10, &end, 10);
+
+      if (strncmp(end, " end", 4) != 0 || seq < 0) {
+        broken++;
+        continue;
+      }
+      if (seq >= cap) {
+        long n = cap > 0 ? cap : 4096;
+
+        while (n <= seq) {
+          n *= 2;
+        }
+        seen = (unsigned char *)realloc(seen, (size_t)n);
+        memset(seen + cap, 0, (size_t)(n - cap));
+        cap = n;
+      }
+      dup += seen[seq]++ > 0;
+      count++;
+    } else if ((p = strstr(line, " records dropped (signal-safe")) != NULL) {
+      /* 件数は報告の行の直前の数字 */
+      while (p > line && p[-1] >= '0' && p[-1] <= '9') {
+        p--;
+      }
+      dropped += strtol(p, NULL, 10);
+    } else if ((p = strstr(line, "summary alarms=")) != NULL) {
+      sscanf(p, "summary alarms=%ld handler_ns=%ld line_ns=%ld", &total,
+             &handler_ns, &line_ns);
+    }
+  }
+  if (f != NULL) {
+    fclose(f);
+  }
+  for (i = 0; i < total && i < cap; i++) {
+    missing += seen[i] == 0;
+  }
+  if (total > cap) {
+    missing += total - (cap > 0 ? cap : 0);
+  }
+  free(seen);
+  unlink(out);
+
+  ok = finished && WIFEXITED(status) && WEXITSTATUS(status) == 0 && total > 0 &&
+       dup == 0 && broken == 0 && count + dropped == total &&
+       missing == dropped;
+  printf("threads=%d lines/thread=%ld interval=%ldus\n", BENCH_SIGSAFE_THREADS,
+         bench_iters, bench_interval_us);
+  printf("alarms=%ld written=%ld dropped=%ld missing=%ld dup=%ld broken=%ld\n",
+         total, count, dropped, missing, dup, broken);
+  printf("ns/call: handler ELOG_INFO_SIGSAFE %ld, thread ELOG_INFO %ld\n",
+         handler_ns, line_ns);
+  printf("%s\n", ok ? "ok" : finished ? "FAIL" : "FAIL (timeout: deadlock?)");
+  return ok ? 0 : 1;
+}
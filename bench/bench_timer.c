@@ -0,0 +1,237 @@
+/**
+ * @file bench_timer.c
+ * @brief スコープタイマー（ELOG_*_SCOPE_TIMER）の確認
+ *
+ * 子プロセスの stdout をファイルへ向けて次を行い、exit() で終了する
+ * （最後の集計はプロセス終了時の処理で出る）。
+ *   1. 分布が分かっている所要時間を elog_timer_record() で直接記録する
+ *      （一様分布と、2% だけ遅い二峰の分布）
+ *   2. 複数のスレッドが ELOG_INFO_SCOPE_TIMER のスコープを繰り返す
+ *      （2回に分け、2回目は終了したスレッドのヒストグラムを引き継ぐ）
+ *   3. 実行時レベルで除外した ELOG_INFO_SCOPE_TIMER を繰り返す
+ * 親プロセスは集計の行を読み、件数の合計・最大が正確か、p50 / p99 が
+ * 真の値からバケットの幅（+6.25%）以内かを確かめ、1スコープあたりの時間を
+ * 表示する。合わなければ 0 以外で終了する。
+ *
+ * 使い方: elog_bench_timer [スレッドあたりのスコープ数]
+ */
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "bench.h"
+#include "elog/elog.h"
+
+#define BENCH_TIMER_THREADS 4
+#define BENCH_TIMER_WAVES 2
+#define BENCH_TIMER_KNOWN 100000
+
+static long bench_iters = 1000000;
+
+/* 分布が分かっている所要時間を記録するタイマー */
+static elog_callsite_t bench_uniform_cs ELOG_CALLSITE_ATTR = {
+    ELOG_TIMER_FMT("uniform"), "bench", 0, ELOG_LEVEL_INFO, 0, 0
+#if ELOG_USE_DYNAMIC_DEBUG
+    , "bench"
+#endif
+};
+static elog_callsite_t bench_bimodal_cs ELOG_CALLSITE_ATTR = {
+    ELOG_TIMER_FMT("bimodal"), "bench", 0, ELOG_LEVEL_INFO, 0, 0
+#if ELOG_USE_DYNAMIC_DEBUG
+    , "bench"
+#endif
+};
+static elog_timer_t bench_uniform = {&bench_uniform_cs, 0, 0, 0, 0, 0};
+static elog_timer_t bench_bimodal = {&bench_bimodal_cs, 0, 0, 0, 0, 0};
+
+/* 真の値: uniform は 1 ~ 100000 ns、bimodal は 98% が 1000 ns、2% が 1 ms */
+typedef struct {
+  const char *name;
+  unsigned long long count, p50, p99, max;
+} bench_expect_t;
+
+static const bench_expect_t bench_expects[] = {
+    {"uniform", BENCH_TIMER_KNOWN, BENCH_TIMER_KNOWN / 2,
+     BENCH_TIMER_KNOWN / 100 * 99, BENCH_TIMER_KNOWN},
+    {"bimodal", BENCH_TIMER_KNOWN, 1000, 1000000, 1000000},
+};
+
+#define BENCH_EXPECTS (sizeof(bench_expects) / sizeof(bench_expects[0]))
+
+/* ============================================================
+ * 1. 子プロセス
+ * ============================================================ */
+
+static void *bench_worker(void *arg) {
+  long i;
+
+  (void)arg;
+  for (i = 0; i < bench_iters; i++) {
+    ELOG_INFO_SCOPE_TIMER("work");
+    BENCH_BARRIER();
+  }
+  return NULL;
+}
+
+static void bench_disabled(long iters) {
+  long i;
+
+  for (i = 0; i < iters; i++) {
+    ELOG_INFO_SCOPE_TIMER("disabled");
+    BENCH_BARRIER();
+  }
+}
+
+static void bench_child(const char *out) {
+  pthread_t threads[BENCH_TIMER_THREADS];
+  elog_timer_hist_t *h;
+  uint64_t t0, enabled_ns, disabled_ns;
+  int fd = open(out, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  long v;
+  int w, i;
+
+  dup2(fd, STDOUT_FILENO);
+  close(fd);
+
+  h = elog_timer_attach(&bench_uniform);
+  for (v = 1; v <= BENCH_TIMER_KNOWN; v++) {
+    elog_timer_record(h, 0, (uint64_t)v);
+  }
+  h = elog_timer_attach(&bench_bimodal);
+  for (v = 0; v < BENCH_TIMER_KNOWN; v++) {
+    elog_timer_record(h, 0, v % 50 == 0 ? 1000000 : 1000);
+  }
+
+  t0 = bench_now();
+  for (w = 0; w < BENCH_TIMER_WAVES; w++) {
+    for (i = 0; i < BENCH_TIMER_THREADS; i++) {
+      pthread_create(&threads[i], NULL, bench_worker, NULL);
+    }
+    for (i = 0; i < BENCH_TIMER_THREADS; i++) {
+      pthread_join(threads[i], NULL);
+    }
+  }
+  enabled_ns = bench_now() - t0;
+
+  ELOG_SET_LEVEL(ELOG_LEVEL_WARN);
+  t0 = bench_now();
+  bench_disabled(bench_iters);
+  disabled_ns = bench_now() - t0;
+  ELOG_SET_LEVEL(ELOG_LEVEL_INFO);
+
+  ELOG_INFO("summary scopes=%ld enabled_ns=%llu disabled_ns=%llu",
+            bench_iters * BENCH_TIMER_THREADS * BENCH_TIMER_WAVES,
+            (unsigned long long)(enabled_ns * 1000 /
+                                 (uint64_t)(bench_iters * BENCH_TIMER_THREADS *
+                                            BENCH_TIMER_WAVES)),
+            (unsigned long long)(disabled_ns * 1000 / (uint64_t)bench_iters));
+  fflush(stdout);
+  /* 最後の集計は終了時の処理で出る */
+  exit(0);
+}
+
+/* ============================================================
+ * 2. 親プロセス: 集計の行の検査
+ * ============================================================ */
+
+typedef struct {
+  unsigned long long count, p50, p99, max;
+  long lines;
+} bench_sum_t;
+
+/* 真の値以上、バケットの幅以内 */
+static int bench_within(unsigned long long got, unsigned long long want) {
+  return got >= want && got <= want + want / 16 + 1;
+}
+
+int main(int argc, char **argv) {
+  char out[] = "/tmp/elog_bench_timer_XXXXXX";
+  char line[1024];
+  bench_sum_t known[BENCH_EXPECTS], work, disabled;
+  long scopes = -1;
+  unsigned long long enabled_ns = 0, disabled_ns = 0;
+  int status = 0;
+  int ok = 1;
+  pid_t pid;
+  FILE *f;
+  size_t k;
+
+  if (argc > 1) {
+    bench_iters = strtol(argv[1], NULL, 10);
+  }
+  memset(known, 0, sizeof(known));
+  memset(&work, 0, sizeof(work));
+  memset(&disabled, 0, sizeof(disabled));
+  close(mkstemp(out));
+  fflush(stdout);
+  pid = fork();
+  if (pid == 0) {
+    bench_child(out);
+  }
+  waitpid(pid, &status, 0);
+
+  f = fopen(out, "r");
+  while (f != NULL && fgets(line, sizeof(line), f) != NULL) {
+    unsigned long long count, p50, p99, max;
+    char name[32];
+    const char *p;
+
+    if ((p = strstr(line, "timer ")) != NULL &&
+        sscanf(p, "timer %31[^:]: count=%llu p50=%lluns p99=%lluns max=%lluns",
+               name, &count, &p50, &p99, &max) == 5) {
+      bench_sum_t *s = strcmp(name, "work") == 0       ? &work
+                       : strcmp(name, "disabled") == 0 ? &disabled
+                                                       : NULL;
+
+      for (k = 0; k < BENCH_EXPECTS; k++) {
+        if (strcmp(name, bench_expects[k].name) == 0) {
+          s = &known[k];
+        }
+      }
+      if (s != NULL) {
+        s->count += count;
+        s->p50 = p50;
+        s->p99 = p99;
+        s->max = max > s->max ? max : s->max;
+        s->lines++;
+      }
+    } else if ((p = strstr(line, "summary scopes=")) != NULL) {
+      sscanf(p, "summary scopes=%ld enabled_ns=%llu disabled_ns=%llu", &scopes,
+             &enabled_ns, &disabled_ns);
+    }
+  }
+  if (f != NULL) {
+    fclose(f);
+  }
+  unlink(out);
+
+  printf("threads=%d waves=%d scopes/thread=%ld period=%dms\n",
+         BENCH_TIMER_THREADS, BENCH_TIMER_WAVES, bench_iters,
+         ELOG_TIMER_PERIOD_MS);
+  for (k = 0; k < BENCH_EXPECTS; k++) {
+    const bench_expect_t *e = &bench_expects[k];
+    int match = known[k].lines == 1 && known[k].count == e->count &&
+                bench_within(known[k].p50, e->p50) &&
+                bench_within(known[k].p99, e->p99) && known[k].max == e->max;
+
+    printf("%-8s count=%llu p50=%llu (%llu) p99=%llu (%llu) max=%llu (%llu)"
+           " %s\n",
+           e->name, known[k].count, known[k].p50, e->p50, known[k].p99, e->p99,
+           known[k].max, e->max, match ? "ok" : "FAIL");
+    ok &= match;
+  }
+  printf("work     count=%llu/%ld lines=%ld disabled lines=%ld\n", work.count,
+         scopes, work.lines, disabled.lines);
+  printf("ns/scope: enabled %.1f, runtime-disabled %.1f\n",
+         (double)enabled_ns / 1000, (double)disabled_ns / 1000);
+  ok &= WIFEXITED(status) && WEXITSTATUS(status) == 0 && scopes > 0 &&
+        work.count == (unsigned long long)scopes && disabled.lines == 0;
+  printf("%s\n", ok ? "ok" : "FAIL");
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,133 @@
+/**
+ * @file bench_tiny.c
+ * @brief 小さな printf（ELOG_USE_TINY_PRINTF=1）と snprintf の比較
+ *
+ * 出力先をメモリへ書くだけの関数に差し替え、引数の組み合わせごとに
+ * elog_tiny_printf の出力が snprintf と一致するかを確認して ns/call を測る。
+ * ELOG_INFO の出力がその出力先へ届くことも確認する。
+ *
+ * 使い方: elog_bench_tiny [呼び出し回数]
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench.h"
+#include "elog/elog.h"
+
+#define BENCH_TINY_BUF 256
+
+/* 引数の組み合わせ（%f は ELOG_TINY_FLOAT=1 のときだけ） */
+#define BENCH_TINY_INT_CASES(X)                                              \
+  X(int_small, "status=%d code=%d", 200, -7)                                 \
+  X(int_large, "id=%lld size=%zu seq=%u", -9123456789012345ll,               \
+    (size_t)123456789012u, 4000000000u)                                      \
+  X(hex, "addr=%#018llx mask=%08x flags=%X oct=%#o", 0x7ffd1234abcdull,      \
+    0xbeefu, 0xfeu, 8u)                                                      \
+  X(width, "[%5d|%-5d|%+d|% d|%05d|%.3d|%*d]", 42, 42, 42, 42, -42, 7, 4, 9) \
+  X(string, "user=%s path=%-16s tag=%.3s pct=%%", "alice", "/api/v1/items", \
+    "abcdef")                                                                \
+  X(char_ptr, "c=%c p=%p", 'x', (void *)0x7ffd1234abcdu)                    \
+  X(long_line, "%s %s %s %s", "0123456789abcdef0123456789abcdef",           \
+    "0123456789abcdef0123456789abcdef", "0123456789abcdef0123456789abcdef", \
+    "0123456789abcdef0123456789abcdef")
+
+#if ELOG_TINY_FLOAT
+#define BENCH_TINY_FLOAT_CASES(X)                                            \
+  X(float, "latency=%.3f ratio=%f temp=%.1f", 1.25, 0.333333333, -40.0)      \
+  X(float_pad, "[%8.2f|%-8.2f|%+.0f]", 3.14159, 2.5, 99.5)
+#else
+#define BENCH_TINY_FLOAT_CASES(X)
+#endif
+
+static long bench_iters = 1000000;
+static char bench_out[BENCH_TINY_BUF];
+static size_t bench_out_len;
+static size_t bench_max_chunk;
+static int bench_mismatch;
+
+/* 出力先（テスト用）: メモリへ連結する */
+static void bench_tiny_output(const char *data, size_t len) {
+  if (len > bench_max_chunk) {
+    bench_max_chunk = len;
+  }
+  if (bench_out_len + len < sizeof(bench_out)) {
+    memcpy(bench_out + bench_out_len, data, len);
+    bench_out_len += len;
+  }
+  bench_out[bench_out_len] = '\0';
+}
+
+static double bench_ns(uint64_t t0) {
+  return (double)(bench_now() - t0) / (double)bench_iters;
+}
+
+/* 1ケース分: 一致の確認と2通りの計測 */
+#define BENCH_TINY_RUN(name, fmt, ...)                                        \
+  {                                                                           \
+    char expect[BENCH_TINY_BUF];                                              \
+    double libc_ns, tiny_ns;                                                  \
+    uint64_t t0;                                                              \
+    long i;                                                                   \
+    int n;                                                                    \
+                                                                              \
+    snprintf(expect, sizeof(expect), fmt, __VA_ARGS__);                       \
+    bench_out_len = 0;                                                        \
+    n = elog_tiny_printf(fmt, __VA_ARGS__);                                   \
+    if (strcmp(bench_out, expect) != 0 || n != (int)strlen(expect)) {         \
+      printf("MISMATCH %s: \"%s\" != \"%s\"\n", #name, bench_out, expect);    \
+      bench_mismatch = 1;                                                     \
+    }                                                                         \
+                                                                              \
+    t0 = bench_now();                                                         \
+    for (i = 0; i < bench_iters; i++) {                                       \
+      snprintf(bench_out, sizeof(bench_out), fmt, __VA_ARGS__);               \
+      BENCH_BARRIER();                                                        \
+    }                                                                         \
+    libc_ns = bench_ns(t0);                                                   \
+    t0 = bench_now();                                                         \
+    for (i = 0; i < bench_iters; i++) {                                       \
+      bench_out_len = 0;                                                      \
+      elog_tiny_printf(fmt, __VA_ARGS__);                                     \
+      BENCH_BARRIER();                                                        \
+    }                                                                         \
+    tiny_ns = bench_ns(t0);                                                   \
+    printf("%-10s %10.1f %10.1f %8.2fx\n", #name, libc_ns, tiny_ns,           \
+           libc_ns / tiny_ns);                                                \
+  }
+
+/* ELOG_INFO が出力先へ届くこと */
+static void bench_check_macro(void) {
+  bench_out_len = 0;
+  ELOG_INFO("macro %d %s", 42, "ok");
+  if (strstr(bench_out, "macro 42 ok") == NULL) {
+    printf("MISMATCH macro: \"%s\"\n", bench_out);
+    bench_mismatch = 1;
+  }
+}
+
+int main(int argc, char **argv) {
+  if (argc > 1) {
+    bench_iters = strtol(argv[1], NULL, 10);
+  }
+
+  elog_tiny_set_output(bench_tiny_output);
+  bench_check_macro();
+  bench_max_chunk = 0;
+
+  printf("tiny_float=%d buf=%d iters=%ld\n", ELOG_TINY_FLOAT,
+         ELOG_TINY_BUF_SIZE, bench_iters);
+  printf("%-10s %10s %10s %9s\n", "case", "snprintf", "tiny", "speedup");
+  BENCH_TINY_INT_CASES(BENCH_TINY_RUN)
+  BENCH_TINY_FLOAT_CASES(BENCH_TINY_RUN)
+
+  elog_tiny_set_output(NULL);
+  if (bench_max_chunk > ELOG_TINY_BUF_SIZE) {
+    printf("chunk of %zu bytes exceeds ELOG_TINY_BUF_SIZE\n",
+           bench_max_chunk);
+    bench_mismatch = 1;
+  }
+  return bench_mismatch;
+}
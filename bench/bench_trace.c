@@ -0,0 +1,243 @@
+/**
+ * @file bench_trace.c
+ * @brief トレースイベント（ELOG_SPAN_BEGIN / END・ELOG_INSTANT・ELOG_COUNTER）の確認
+ *
+ * このファイルだけ ELOG_COMPILED_LEVEL を TRACE に差し替える。
+ *   1. 1イベントあたりの時間: 実行時に除外（ELOG_TRACE との比較）、
+ *      記録していない間、記録中（リングの半分ずつ書き、書き出しを待つ）
+ *   2. 複数のスレッドが BEGIN・INSTANT・COUNTER・END を繰り返したトレースを
+ *      読み、イベント数、スレッドごとの時刻の順序、BEGIN / END の対応、
+ *      カウンタの値を確かめる
+ *   3. もう一度開き直し、前回のイベントが混ざらないことを確かめる
+ * 「書き出された数 + 捨てられた数 = 記録した数」にならない場合や、
+ * 捨てられずに順序・対応が崩れている場合は 0 以外で終了する。
+ *
+ * 使い方: elog_bench_trace [スレッドあたりの繰り返し数]
+ */
+
+#undef ELOG_COMPILED_LEVEL
+#define ELOG_COMPILED_LEVEL ELOG_LEVEL_TRACE
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "bench.h"
+#include "elog/elog.h"
+
+#define BENCH_TRACE_THREADS 4
+#define BENCH_TRACE_MAX_TIDS 64
+#define BENCH_TRACE_ITERS 1000000
+
+static long bench_iters = 20000;
+
+/* ============================================================
+ * 1. 1イベントあたりの時間
+ * ============================================================ */
+
+BENCH_DEFINE(bench_trace_log, ELOG_TRACE("tick i=%ld", i))
+BENCH_DEFINE(bench_trace_instant, ELOG_INSTANT("tick"))
+
+static double bench_ns(bench_fn fn, long iters) {
+  uint64_t t0 = bench_now();
+
+  fn(iters, NULL);
+  return (double)(bench_now() - t0) / (double)iters;
+}
+
+/* リングの半分ずつ書き、その間に書き出させる（書いている時間だけを数える） */
+static double bench_recording_ns(long iters) {
+  long burst = ELOG_TRACE_EVENTS / 2;
+  uint64_t total = 0;
+  long done;
+
+  for (done = 0; done < iters; done += burst) {
+    uint64_t t0 = bench_now();
+
+    bench_trace_instant(burst, NULL);
+    total += bench_now() - t0;
+    usleep(5000);
+  }
+  return (double)total / (double)done;
+}
+
+/* ============================================================
+ * 2. 複数スレッドのトレース
+ * ============================================================ */
+
+static void *bench_worker(void *arg) {
+  long i;
+
+  (void)arg;
+  for (i = 0; i < bench_iters; i++) {
+    ELOG_SPAN_BEGIN("request");
+    ELOG_INSTANT("tick");
+    ELOG_COUNTER("i", i);
+    ELOG_SPAN_END("request");
+    /* 書き出しが追いつくように時々休む */
+    if (i % 256 == 255) {
+      usleep(2000);
+    }
+  }
+  return NULL;
+}
+
+typedef struct {
+  long tid;
+  double last_ts;
+  long long last_value;
+  long depth;
+} bench_tid_t;
+
+typedef struct {
+  long events, spans, instants, counters;
+  long dropped;
+  long order_errors; /* 時刻の逆行・カウンタの逆行 */
+  long span_errors;  /* BEGIN のない END・閉じていない BEGIN */
+  int complete;      /* JSON が閉じている */
+} bench_check_t;
+
+static bench_tid_t *bench_tid(bench_tid_t *tids, long *n, long tid) {
+  long i;
+
+  for (i = 0; i < *n; i++) {
+    if (tids[i].tid == tid) {
+      return &tids[i];
+    }
+  }
+  if (*n == BENCH_TRACE_MAX_TIDS) {
+    return NULL;
+  }
+  memset(&tids[*n], 0, sizeof(tids[*n]));
+  tids[*n].tid = tid;
+  tids[*n].last_value = -1;
+  return &tids[(*n)++];
+}
+
+/* 1イベント1行の JSON を読んで数える */
+static void bench_check(const char *path, bench_check_t *c) {
+  bench_tid_t tids[BENCH_TRACE_MAX_TIDS];
+  long ntids = 0;
+  char line[1024];
+  FILE *f = fopen(path, "r");
+  long i;
+
+  memset(c, 0, sizeof(*c));
+  while (f != NULL && fgets(line, sizeof(line), f) != NULL) {
+    const char *ph = strstr(line, "\"ph\":\"");
+    const char *ts = strstr(line, "\"ts\":");
+    const char *tid = strstr(line, "\"tid\":");
+    const char *other = strstr(line, "\"otherData\":{\"dropped\":");
+    bench_tid_t *t;
+    double when;
+
+    if (other != NULL) {
+      c->dropped = strtol(other + 23, NULL, 10);
+      c->complete = 1;
+      continue;
+    }
+    if (ph == NULL || ts == NULL || tid == NULL ||
+        (t = bench_tid(tids, &ntids, strtol(tid + 6, NULL, 10))) == NULL) {
+      continue;
+    }
+    c->events++;
+    when = strtod(ts + 5, NULL);
+    c->order_errors += when < t->last_ts;
+    t->last_ts = when;
+    switch (ph[6]) {
+    case 'B':
+      c->spans++;
+      t->depth++;
+      break;
+    case 'E':
+      c->span_errors += --t->depth < 0;
+      break;
+    case 'i':
+      c->instants++;
+      break;
+    case 'C': {
+      const char *v = strstr(line, "\"value\":");
+      long long value = v != NULL ? strtoll(v + 8, NULL, 10) : -1;
+
+      c->counters++;
+      c->order_errors += value <= t->last_value;
+      t->last_value = value;
+      break;
+    }
+    default:
+      break;
+    }
+  }
+  if (f != NULL) {
+    fclose(f);
+  }
+  for (i = 0; i < ntids; i++) {
+    c->span_errors += tids[i].depth != 0;
+  }
+}
+
+int main(int argc, char **argv) {
+  char out[] = "/tmp/elog_bench_trace_XXXXXX";
+  pthread_t threads[BENCH_TRACE_THREADS];
+  double log_ns, off_ns, idle_ns, rec_ns;
+  bench_check_t c, c2;
+  long expected;
+  int ok, ok2;
+  int i;
+
+  if (argc > 1) {
+    bench_iters = strtol(argv[1], NULL, 10);
+  }
+  close(mkstemp(out));
+
+  /* 1. 時間 */
+  ELOG_SET_LEVEL(ELOG_LEVEL_INFO);
+  log_ns = bench_ns(bench_trace_log, BENCH_TRACE_ITERS);
+  off_ns = bench_ns(bench_trace_instant, BENCH_TRACE_ITERS);
+  ELOG_SET_LEVEL(ELOG_LEVEL_TRACE);
+  idle_ns = bench_ns(bench_trace_instant, BENCH_TRACE_ITERS);
+  elog_trace_open(out);
+  rec_ns = bench_recording_ns(BENCH_TRACE_ITERS / 4);
+  elog_trace_close();
+
+  /* 2. 複数スレッド */
+  if (elog_trace_open(out) != 0) {
+    fprintf(stderr, "cannot open %s\n", out);
+    return 1;
+  }
+  for (i = 0; i < BENCH_TRACE_THREADS; i++) {
+    pthread_create(&threads[i], NULL, bench_worker, NULL);
+  }
+  for (i = 0; i < BENCH_TRACE_THREADS; i++) {
+    pthread_join(threads[i], NULL);
+  }
+  elog_trace_close();
+  bench_check(out, &c);
+  expected = bench_iters * BENCH_TRACE_THREADS * 4;
+  ok = c.complete && c.events + c.dropped == expected &&
+       (c.dropped > 0 || (c.spans * 4 == expected && c.order_errors == 0 &&
+                          c.span_errors == 0));
+
+  /* 3. 開き直し（前回のイベントを含まない） */
+  elog_trace_open(out);
+  ELOG_SPAN_BEGIN("second");
+  ELOG_SPAN_END("second");
+  elog_trace_close();
+  bench_check(out, &c2);
+  ok2 = c2.complete && c2.events == 2 && c2.spans == 1 && c2.span_errors == 0;
+  unlink(out);
+
+  printf("ns/event: ELOG_TRACE filtered %.1f, ELOG_INSTANT filtered %.1f, "
+         "not recording %.1f, recording %.1f\n",
+         log_ns, off_ns, idle_ns, rec_ns);
+  printf("threads=%d iters/thread=%ld events=%ld/%ld dropped=%ld "
+         "(B=%ld i=%ld C=%ld) order_errors=%ld span_errors=%ld %s\n",
+         BENCH_TRACE_THREADS, bench_iters, c.events, expected, c.dropped,
+         c.spans, c.instants, c.counters, c.order_errors, c.span_errors,
+         ok ? "ok" : "FAIL");
+  printf("reopen events=%ld %s\n", c2.events, ok2 ? "ok" : "FAIL");
+  return ok && ok2 ? 0 : 1;
+}
@@ -0,0 +1,440 @@
+/**
+ * @file elog_bench.c
+ * @brief ELOG_IMPL の各経路のマイクロベンチマーク
+ *
+ * 計測するケース:
+ *   off       ELOG_COMPILED_LEVEL でコンパイル時に除去された呼び出し
+ *   filtered  elog_runtime_level で実行時に弾かれる呼び出し
+ *             （ELOG_USE_JUMP_LABEL=1 では NOP。filtered_load が従来の判定。
+ *             ELOG_USE_FLIGHT_RECORDER=1 ではリングへの記録を含み、
+ *             filtered_norec が記録を止めた場合）
+ *   enabled   出力される呼び出し（出力先 /dev/null・ファイル・パイプ）
+ * それぞれ引数 0/1/4/8 個、1 ~ 最大スレッド数（2倍ずつ）で実行し、
+ * 1回あたりの平均時間（経過時間 × スレッド数 / 呼び出し回数）・
+ * スループット・レイテンシ分位点を表示する。
+ * -j を指定すると結果を JSON で書き出す（コミット間の比較用）。
+ *
+ * 使い方: elog_bench [-n 呼び出し回数/スレッド] [-t 最大スレッド数]
+ *                    [-j 出力JSON] [-l ラベル] [-f ケース名の部分一致]
+ */
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "elog/elog.h"
+
+#include "bench.h"
+
+#define BENCH_MAX_THREADS 64
+
+/* ============================================================
+ * 1. 計測対象
+ * ============================================================ */
+
+BENCH_DEFINE(bench_args0, ELOG_INFO("request done"))
+BENCH_DEFINE(bench_args1, ELOG_INFO("request id=%ld", i))
+BENCH_DEFINE(bench_args4,
+             ELOG_INFO("request id=%ld status=%d path=%s latency=%.3f", i, 200,
+                       "/api/v1/items", 1.25))
+BENCH_DEFINE(bench_args8,
+             ELOG_INFO("id=%ld st=%d path=%s lat=%.3f user=%u ratio=%g "
+                       "tag=%c bytes=%zu",
+                       i, 200, "/api/v1/items", 1.25, 42u, 0.5, 'x',
+                       (size_t)4096))
+
+static const struct {
+  int nargs;
+  bench_fn fn;
+} bench_enabled[] = {
+    {0, bench_args0},
+    {1, bench_args1},
+    {4, bench_args4},
+    {8, bench_args8},
+};
+
+/* ============================================================
+ * 2. 出力先
+ * ============================================================ */
+
+typedef enum {
+  BENCH_OUT_NONE,
+  BENCH_OUT_DEVNULL,
+  BENCH_OUT_FILE,
+  BENCH_OUT_PIPE
+} bench_out_t;
+
+static const char *const bench_out_names[] = {"none", "devnull", "file",
+                                              "pipe"};
+
+static int bench_stdout_saved = -1;
+static int bench_pipe_rd = -1;
+static pthread_t bench_reader;
+static char bench_file_path[] = "/tmp/elog_bench_XXXXXX";
+
+static void *bench_reader_main(void *arg) {
+  char buf[65536];
+
+  (void)arg;
+  while (read(bench_pipe_rd, buf, sizeof(buf)) > 0) {
+  }
+  return NULL;
+}
+
+/* 標準出力を差し替える */
+static int bench_out_open(bench_out_t out) {
+  int fd = -1;
+  int fds[2];
+
+  if (out == BENCH_OUT_NONE) {
+    return 0;
+  }
+  switch (out) {
+    case BENCH_OUT_DEVNULL:
+      fd = open("/dev/null", O_WRONLY);
+      break;
+    case BENCH_OUT_FILE:
+      fd = mkstemp(bench_file_path);
+      break;
+    case BENCH_OUT_PIPE:
+      if (pipe(fds) == 0) {
+        bench_pipe_rd = fds[0];
+        fd = fds[1];
+        pthread_create(&bench_reader, NULL, bench_reader_main, NULL);
+      }
+      break;
+    default:
+      break;
+  }
+  if (fd < 0) {
+    perror(bench_out_names[out]);
+    return -1;
+  }
+  fflush(stdout);
+  bench_stdout_saved = dup(STDOUT_FILENO);
+  dup2(fd, STDOUT_FILENO);
+  close(fd);
+  return 0;
+}
+
+static void bench_out_close(bench_out_t out) {
+  if (out == BENCH_OUT_NONE) {
+    return;
+  }
+  fflush(stdout);
+  dup2(bench_stdout_saved, STDOUT_FILENO);
+  close(bench_stdout_saved);
+  if (out == BENCH_OUT_FILE) {
+    unlink(bench_file_path);
+    strcpy(bench_file_path, "/tmp/elog_bench_XXXXXX");
+  } else if (out == BENCH_OUT_PIPE) {
+    pthread_join(bench_reader, NULL);
+    close(bench_pipe_rd);
+  }
+}
+
+/* 出力が残っていれば書き出す */
+static void bench_drain(void) {
+#if ELOG_USE_ASYNC
+  elog_async_flush();
+#endif
+  fflush(stdout);
+}
+
+/* ============================================================
+ * 3. 実行と集計
+ * ============================================================ */
+
+typedef struct {
+  bench_fn fn;
+  long iters;
+  uint64_t *lat;
+} bench_thread_t;
+
+typedef struct {
+  char name[64];
+  const char *kind;
+  bench_out_t out;
+  int nargs;
+  int threads;
+  double ns_per_call;
+  double calls_per_sec;
+  uint64_t p50, p99, p999, max;
+} bench_result_t;
+
+static uint64_t bench_timer_overhead;
+
+static void *bench_worker(void *arg) {
+  bench_thread_t *t = (bench_thread_t *)arg;
+  t->fn(t->iters, t->lat);
+  return NULL;
+}
+
+/* nthreads スレッドで fn を実行し、全体の経過時間を返す */
+static uint64_t bench_parallel(bench_fn fn, int nthreads, long iters,
+                               uint64_t *lat) {
+  pthread_t th[BENCH_MAX_THREADS];
+  bench_thread_t args[BENCH_MAX_THREADS];
+  uint64_t t0 = bench_now();
+  int i;
+
+  for (i = 0; i < nthreads; i++) {
+    args[i].fn = fn;
+    args[i].iters = iters;
+    args[i].lat = lat != NULL ? lat + (size_t)i * (size_t)iters : NULL;
+    pthread_create(&th[i], NULL, bench_worker, &args[i]);
+  }
+  for (i = 0; i < nthreads; i++) {
+    pthread_join(th[i], NULL);
+  }
+  bench_drain();
+  return bench_now() - t0;
+}
+
+static int bench_cmp_u64(const void *a, const void *b) {
+  uint64_t x = *(const uint64_t *)a;
+  uint64_t y = *(const uint64_t *)b;
+  return x < y ? -1 : x > y;
+}
+
+/* clock_gettime 2回分のコスト（分位点から差し引く） */
+static uint64_t bench_measure_timer(void) {
+  uint64_t lat[10001];
+  int i;
+
+  for (i = 0; i < 10001; i++) {
+    uint64_t t0 = bench_now();
+    lat[i] = bench_now() - t0;
+  }
+  qsort(lat, 10001, sizeof(uint64_t), bench_cmp_u64);
+  return lat[5000];
+}
+
+static uint64_t bench_pct(const uint64_t *sorted, size_t n, double q) {
+  uint64_t v = sorted[(size_t)((double)(n - 1) * q)];
+  return v > bench_timer_overhead ? v - bench_timer_overhead : 0;
+}
+
+static void bench_run(bench_result_t *r, bench_fn fn, long iters) {
+  size_t total = (size_t)iters * (size_t)r->threads;
+  uint64_t *lat = (uint64_t *)malloc(sizeof(uint64_t) * total);
+  uint64_t elapsed;
+
+  if (bench_out_open(r->out) != 0) {
+    free(lat);
+    exit(1);
+  }
+  /* ウォームアップ、時間計測なしの実行、1回ごとの計測の順 */
+  bench_parallel(fn, r->threads, iters / 10 + 1, NULL);
+  elapsed = bench_parallel(fn, r->threads, iters, NULL);
+  bench_parallel(fn, r->threads, iters, lat);
+  bench_out_close(r->out);
+
+  qsort(lat, total, sizeof(uint64_t), bench_cmp_u64);
+  r->ns_per_call = (double)elapsed * (double)r->threads / (double)total;
+  r->calls_per_sec = (double)total * 1e9 / (double)elapsed;
+  r->p50 = bench_pct(lat, total, 0.50);
+  r->p99 = bench_pct(lat, total, 0.99);
+  r->p999 = bench_pct(lat, total, 0.999);
+  r->max = bench_pct(lat, total, 1.0);
+  free(lat);
+
+  fprintf(stderr,
+          "%-28s ns/call=%8.1f calls/s=%12.0f p50=%6llu p99=%7llu "
+          "p99.9=%8llu max=%9llu\n",
+          r->name, r->ns_per_call, r->calls_per_sec,
+          (unsigned long long)r->p50, (unsigned long long)r->p99,
+          (unsigned long long)r->p999, (unsigned long long)r->max);
+}
+
+static void bench_write_json(const char *path, const char *label,
+                             const bench_result_t *res, size_t n, long iters) {
+  FILE *fp = fopen(path, "w");
+  size_t i;
+
+  if (fp == NULL) {
+    perror(path);
+    return;
+  }
+  fprintf(fp, "{\n  \"label\": \"%s\",\n  \"iters\": %ld,\n", label, iters);
+  fprintf(fp,
+          "  \"config\": {\"compiled_level\": %d, \"runtime_level\": %d, "
+          "\"async\": %d, \"binary\": %d, \"sink\": %d, "
+          "\"static_prefix\": %d, \"jump_label\": %d, \"dedup\": %d, "
+          "\"timestamp\": %d, \"color\": %d, \"file_line\": %d},\n",
+          ELOG_COMPILED_LEVEL, ELOG_USE_RUNTIME_LEVEL, ELOG_USE_ASYNC,
+          ELOG_USE_BINARY, ELOG_USE_SINK, ELOG_USE_STATIC_PREFIX,
+          ELOG_USE_JUMP_LABEL, ELOG_USE_DEDUP, ELOG_USE_TIMESTAMP,
+          ELOG_USE_COLOR, ELOG_USE_FILE_LINE);
+  fprintf(fp, "  \"timer_overhead_ns\": %llu,\n  \"results\": [\n",
+          (unsigned long long)bench_timer_overhead);
+  for (i = 0; i < n; i++) {
+    const bench_result_t *r = &res[i];
+    fprintf(fp,
+            "    {\"name\": \"%s\", \"kind\": \"%s\", \"output\": \"%s\", "
+            "\"args\": %d, \"threads\": %d, \"ns_per_call\": %.2f, "
+            "\"calls_per_sec\": %.0f, \"p50_ns\": %llu, \"p99_ns\": %llu, "
+            "\"p999_ns\": %llu, \"max_ns\": %llu}%s\n",
+            r->name, r->kind, bench_out_names[r->out], r->nargs, r->threads,
+            r->ns_per_call, r->calls_per_sec, (unsigned long long)r->p50,
+            (unsigned long long)r->p99, (unsigned long long)r->p999,
+            (unsigned long long)r->max, i + 1 < n ? "," : "");
+  }
+  fprintf(fp, "  ]\n}\n");
+  fclose(fp);
+}
+
+/* ============================================================
+ * 4. メイン
+ * ============================================================ */
+
+static void usage(void) {
+  fprintf(stderr,
+          "usage: elog_bench [-n iters] [-t max_threads] [-j out.json] "
+          "[-l label] [-f filter]\n");
+}
+
+int main(int argc, char **argv) {
+  static bench_result_t results[256];
+  size_t nresults = 0;
+  long iters = 100000;
+  int max_threads = 4;
+  const char *json = NULL;
+  const char *label = "";
+  const char *filter = NULL;
+  int opt;
+  int threads;
+
+  while ((opt = getopt(argc, argv, "n:t:j:l:f:h")) != -1) {
+    switch (opt) {
+      case 'n':
+        iters = atol(optarg);
+        break;
+      case 't':
+        max_threads = atoi(optarg);
+        break;
+      case 'j':
+        json = optarg;
+        break;
+      case 'l':
+        label = optarg;
+        break;
+      case 'f':
+        filter = optarg;
+        break;
+      default:
+        usage();
+        return 2;
+    }
+  }
+  if (iters <= 0 || max_threads <= 0) {
+    usage();
+    return 2;
+  }
+  if (max_threads > BENCH_MAX_THREADS) {
+    max_threads = BENCH_MAX_THREADS;
+  }
+
+  bench_timer_overhead = bench_measure_timer();
+  fprintf(stderr, "timer overhead %llu ns (subtracted from percentiles)\n",
+          (unsigned long long)bench_timer_overhead);
+
+  for (threads = 1; threads <= max_threads; threads *= 2) {
+    bench_result_t *r;
+    int out;
+    size_t a;
+
+    /* コンパイル時に除去 */
+    r = &results[nresults];
+    snprintf(r->name, sizeof(r->name), "off/args4/t%d", threads);
+    if (filter == NULL || strstr(r->name, filter) != NULL) {
+      r->kind = "off";
+      r->out = BENCH_OUT_NONE;
+      r->nargs = 4;
+      r->threads = threads;
+      bench_run(r, bench_off_args4, iters);
+      nresults++;
+    }
+
+#if ELOG_USE_RUNTIME_LEVEL
+    /* 実行時に除外 */
+    r = &results[nresults];
+    snprintf(r->name, sizeof(r->name), "filtered/args4/t%d", threads);
+    if (filter == NULL || strstr(r->name, filter) != NULL) {
+      uint8_t saved = ELOG_GET_LEVEL();
+      r->kind = "filtered";
+      r->out = BENCH_OUT_NONE;
+      r->nargs = 4;
+      r->threads = threads;
+      ELOG_SET_LEVEL(ELOG_LEVEL_WARN);
+      bench_run(r, bench_args4, iters);
+      ELOG_SET_LEVEL(saved);
+      nresults++;
+    }
+#endif
+
+#if ELOG_USE_FLIGHT_RECORDER && ELOG_USE_RUNTIME_LEVEL
+    /* 実行時に除外（フライトレコーダへの記録なし） */
+    r = &results[nresults];
+    snprintf(r->name, sizeof(r->name), "filtered_norec/args4/t%d", threads);
+    if (filter == NULL || strstr(r->name, filter) != NULL) {
+      uint8_t saved = ELOG_GET_LEVEL();
+      uint8_t saved_flight = elog_flight_level;
+      r->kind = "filtered_norec";
+      r->out = BENCH_OUT_NONE;
+      r->nargs = 4;
+      r->threads = threads;
+      ELOG_SET_LEVEL(ELOG_LEVEL_WARN);
+      elog_flight_level = ELOG_LEVEL_OFF;
+      bench_run(r, bench_args4, iters);
+      elog_flight_level = saved_flight;
+      ELOG_SET_LEVEL(saved);
+      nresults++;
+    }
+#endif
+
+#if ELOG_USE_JUMP_LABEL && ELOG_USE_RUNTIME_LEVEL
+    /* 実行時に除外（ジャンプラベルなし） */
+    r = &results[nresults];
+    snprintf(r->name, sizeof(r->name), "filtered_load/args4/t%d", threads);
+    if (filter == NULL || strstr(r->name, filter) != NULL) {
+      uint8_t saved = ELOG_GET_LEVEL();
+      r->kind = "filtered_load";
+      r->out = BENCH_OUT_NONE;
+      r->nargs = 4;
+      r->threads = threads;
+      ELOG_SET_LEVEL(ELOG_LEVEL_WARN);
+      bench_run(r, bench_load_args4, iters);
+      ELOG_SET_LEVEL(saved);
+      nresults++;
+    }
+#endif
+
+    /* 出力あり */
+    for (out = BENCH_OUT_DEVNULL; out <= BENCH_OUT_PIPE; out++) {
+      for (a = 0; a < sizeof(bench_enabled) / sizeof(bench_enabled[0]); a++) {
+        r = &results[nresults];
+        snprintf(r->name, sizeof(r->name), "enabled/%s/args%d/t%d",
+                 bench_out_names[out], bench_enabled[a].nargs, threads);
+        if (filter != NULL && strstr(r->name, filter) == NULL) {
+          continue;
+        }
+        r->kind = "enabled";
+        r->out = (bench_out_t)out;
+        r->nargs = bench_enabled[a].nargs;
+        r->threads = threads;
+        bench_run(r, bench_enabled[a].fn, iters);
+        nresults++;
+      }
+    }
+  }
+
+  if (json != NULL) {
+    bench_write_json(json, label, results, nresults, iters);
+  }
+  return 0;
+}
@@ -0,0 +1,50 @@
+# elog_callsite_size: コールサイトあたりの .text サイズを表示する
+#
+# 入力（-D で渡す）
+#   SIZE_TOOL : size / llvm-size（-A でセクションごとのサイズを出せるもの）
+#   SITES     : 各オブジェクトのループに含まれるログ呼び出しの数
+#   BASE      : 呼び出しをコンパイル時に除去したオブジェクト
+#   INLINE    : ELOG_USE_COLD_PATH=0 のオブジェクト
+#   COLD      : ELOG_USE_COLD_PATH=1 のオブジェクト
+#
+# .text.unlikely*（コールド関数の呼び出し準備など、まれにしか通らないコード）は
+# cold、それ以外の .text* は hot として数え、BASE との差を SITES で割る
+
+function(elog_text_size obj out_hot out_cold)
+    execute_process(
+        COMMAND ${SIZE_TOOL} -A ${obj}
+        OUTPUT_VARIABLE size_out
+        RESULT_VARIABLE size_result
+    )
+    if(NOT size_result EQUAL 0)
+        message(FATAL_ERROR "${SIZE_TOOL} -A ${obj} failed")
+    endif()
+    string(REPLACE "\n" ";" size_lines "${size_out}")
+    set(hot 0)
+    set(cold 0)
+    foreach(line IN LISTS size_lines)
+        if(line MATCHES "^(\\.text[^ \t]*)[ \t]+([0-9]+)")
+            set(section "${CMAKE_MATCH_1}")
+            set(bytes "${CMAKE_MATCH_2}")
+            if(section MATCHES "^\\.text\\.unlikely")
+                math(EXPR cold "${cold} + ${bytes}")
+            else()
+                math(EXPR hot "${hot} + ${bytes}")
+            endif()
+        endif()
+    endforeach()
+    set(${out_hot} ${hot} PARENT_SCOPE)
+    set(${out_cold} ${cold} PARENT_SCOPE)
+endfunction()
+
+elog_text_size("${BASE}" base_hot base_cold)
+message(STATUS "callsites per object: ${SITES}")
+message(STATUS "variant   hot .text  cold .text  hot bytes/callsite  cold bytes/callsite")
+foreach(variant INLINE COLD)
+    elog_text_size("${${variant}}" hot cold)
+    math(EXPR hot_per "(${hot} - ${base_hot}) / ${SITES}")
+    math(EXPR cold_per "(${cold} - ${base_cold}) / ${SITES}")
+    string(TOLOWER "${variant}" name)
+    message(STATUS "${name}\t  ${hot}\t     ${cold}\t ${hot_per}\t\t     ${cold_per}")
+endforeach()
+message(STATUS "off\t  ${base_hot}\t     ${base_cold}")
@@ -0,0 +1,54 @@
+# elog_size_report: 小さな printf のコードサイズと関数ごとのスタック使用量を表示する
+#
+# 入力（-D で渡す）
+#   OBJECTS   : elog_tiny_size のオブジェクトファイル（; 区切り）
+#   SIZE_TOOL : size / llvm-size（見つからなければサイズは省略）
+#
+# スタック使用量は -fstack-usage がオブジェクトの隣に出力する .su から読む。
+# elog_tiny_printf の最大使用量は、呼び出し階層をたどった各関数の合計になる
+
+foreach(obj IN LISTS OBJECTS)
+    message(STATUS "elog tiny printf: ${obj}")
+
+    if(SIZE_TOOL)
+        execute_process(
+            COMMAND ${SIZE_TOOL} ${obj}
+            OUTPUT_VARIABLE size_out
+            OUTPUT_STRIP_TRAILING_WHITESPACE
+        )
+        message(STATUS "code size (bytes):\n${size_out}")
+    else()
+        message(STATUS "code size: size tool not found")
+    endif()
+
+    # .su は foo.c.o に対して foo.c.su、コンパイラによっては foo.su
+    string(REGEX REPLACE "\\.o(bj)?$" ".su" su_file "${obj}")
+    if(NOT EXISTS "${su_file}")
+        string(REGEX REPLACE "\\.c\\.o(bj)?$" ".su" su_file "${obj}")
+    endif()
+    if(NOT EXISTS "${su_file}")
+        message(STATUS "stack usage: ${su_file} not found (needs -fstack-usage)")
+        continue()
+    endif()
+
+    file(STRINGS "${su_file}" su_lines)
+    set(stack_total 0)
+    message(STATUS "stack usage (bytes per frame):")
+    foreach(line IN LISTS su_lines)
+        # <file>:<line>:<col>:<function>\t<bytes>\t<static|dynamic|bounded>
+        if(line MATCHES ":([A-Za-z0-9_]+)\t([0-9]+)\t([a-z,]+)$")
+            set(fn "${CMAKE_MATCH_1}")
+            set(bytes "${CMAKE_MATCH_2}")
+            set(kind "${CMAKE_MATCH_3}")
+            string(LENGTH "${fn}" fn_len)
+            math(EXPR pad "28 - ${fn_len}")
+            if(pad LESS 1)
+                set(pad 1)
+            endif()
+            string(REPEAT " " ${pad} spaces)
+            message(STATUS "  ${fn}${spaces}${bytes}\t${kind}")
+            math(EXPR stack_total "${stack_total} + ${bytes}")
+        endif()
+    endforeach()
+    message(STATUS "stack usage upper bound (sum of all frames): ${stack_total}")
+endforeach()
@@ -25,15 +25,19 @@ extern "C" {
  * 1. ログレベル定義
  * ============================================================ */
 
-typedef enum {
-  ELOG_LEVEL_OFF = 0,
-  ELOG_LEVEL_CRITICAL,
-  ELOG_LEVEL_ERROR,
-  ELOG_LEVEL_WARN,
-  ELOG_LEVEL_INFO,
-  ELOG_LEVEL_DEBUG,
-  ELOG_LEVEL_TRACE
-} elog_level_t;
+/*
+ * ELOG_COMPILED_LEVEL との比較を #if で行うため、レベルはマクロで定義する
+ * （enum の列挙子はプリプロセッサでは常に 0 として評価される）
+ */
+#define ELOG_LEVEL_OFF 0
+#define ELOG_LEVEL_CRITICAL 1
+#define ELOG_LEVEL_ERROR 2
+#define ELOG_LEVEL_WARN 3
+#define ELOG_LEVEL_INFO 4
+#define ELOG_LEVEL_DEBUG 5
+#define ELOG_LEVEL_TRACE 6
+
+typedef uint8_t elog_level_t;
 
 /* ============================================================
  * 2. コンパイル時設定（デフォルト値）
@@ -61,6 +65,41 @@ typedef enum {
 #define ELOG_USE_FILE_LINE 1
 #endif
 
+/* タイムスタンプの取得元 */
+#define ELOG_CLOCK_TSC 1    /* rdtsc（x86 のみ、起動後に一度だけ較正） */
+#define ELOG_CLOCK_COARSE 2 /* CLOCK_MONOTONIC_COARSE */
+
+/**
+ * 行頭タイムスタンプの有効化
+ * 有効時、ログ呼び出しでは ELOG_TIMESTAMP_CLOCK の値を取るだけで、
+ * 日時への変換と整形は出力側（シンク・コンシューマ・デコーダ）で行う
+ * （シンク経由の出力のみ）
+ */
+#ifndef ELOG_USE_TIMESTAMP
+#define ELOG_USE_TIMESTAMP 0
+#endif
+
+#ifndef ELOG_TIMESTAMP_CLOCK
+#if defined(__x86_64__) || defined(__i386__)
+#define ELOG_TIMESTAMP_CLOCK ELOG_CLOCK_TSC
+#else
+#define ELOG_TIMESTAMP_CLOCK ELOG_CLOCK_COARSE
+#endif
+#endif
+
+#if ELOG_USE_TIMESTAMP && ELOG_TIMESTAMP_CLOCK == ELOG_CLOCK_TSC && \
+    !(defined(__x86_64__) || defined(__i386__))
+#error "ELOG_TIMESTAMP_CLOCK=ELOG_CLOCK_TSC requires x86"
+#endif
+
+/**
+ * 行頭タイムスタンプの書式（strftime 形式、秒の単位まで）
+ * この後ろにマイクロ秒 ".uuuuuu" が続く
+ */
+#ifndef ELOG_TIMESTAMP_FMT
+#define ELOG_TIMESTAMP_FMT "%Y-%m-%d %H:%M:%S"
+#endif
+
 /**
  * ANSI カラーコード使用の有効化
  */
@@ -68,6 +107,344 @@ typedef enum {
 #define ELOG_USE_COLOR 1
 #endif
 
+/**
+ * 非同期バックエンドの有効化
+ * 有効時、ログ呼び出しは引数をキューへコピーするだけになり、
+ * 整形と出力はバックグラウンドスレッドで行われる
+ */
+#ifndef ELOG_USE_ASYNC
+#define ELOG_USE_ASYNC 0
+#endif
+
+/**
+ * バイナリ出力の有効化
+ * 有効時、ログ呼び出しはコールサイト ID・タイムスタンプ・生の引数だけを
+ * 書き出し、テキストへの復元はデコーダ（elog_binary_decode）で行う
+ */
+#ifndef ELOG_USE_BINARY
+#define ELOG_USE_BINARY 0
+#endif
+
+/**
+ * 行頭プレフィックスのコンパイル時連結
+ * 有効時、カラー・レベル表示・ファイル名・行番号（文字列化した __LINE__）を
+ * フォーマット文字列リテラルに連結し、実行時にはユーザー引数だけを整形する。
+ * ファイル名:行番号は ELOG_FILE_LINE_FMT ではなく ELOG_FILE_LINE_STATIC で
+ * 組み立てる（幅指定などは使えない）
+ */
+#ifndef ELOG_USE_STATIC_PREFIX
+#define ELOG_USE_STATIC_PREFIX 0
+#endif
+
+/**
+ * 出力処理をコールサイトの外（コールド関数）へ出す
+ * 有効時、printf 出力の ELOG_IMPL はレベル判定と elog_print() の呼び出し
+ * （記述子のポインタと引数のみ）だけになり、プレフィックスの整形は
+ * ライブラリ内で行う。elog_emit() もコールド関数として宣言され、
+ * 呼び出し側の準備コードはホットな関数の外（.text.unlikely）へ置かれる。
+ * ELOG_USE_STATIC_PREFIX=1 の printf 出力は従来どおりその場で printf を呼ぶ
+ */
+#ifndef ELOG_USE_COLD_PATH
+#define ELOG_USE_COLD_PATH 1
+#endif
+
+/**
+ * printf 出力の1行を write(2) 1回で書き出す
+ * 有効時、printf 出力の ELOG_IMPL は elog_print() を呼び、1行全体を
+ * スレッドごとのバッファ（ELOG_LINE_MAX バイト）に整形して stdout の
+ * ファイルディスクリプタへ直接書く。stdio のロックを取らず、パイプ
+ * （PIPE_BUF 以下）や O_APPEND のファイルでは行が他の書き込みと混ざらない。
+ * ELOG_USE_STATIC_PREFIX・ELOG_USE_COLD_PATH の設定より優先し、
+ * ELOG_USE_TINY_PRINTF=1 では使われない
+ */
+#ifndef ELOG_USE_ATOMIC_LINE
+#define ELOG_USE_ATOMIC_LINE 0
+#endif
+
+/**
+ * シンク経由の出力の有効化
+ * 有効時、同期テキスト出力も printf ではなく elog_sink.h のシンクへ渡される
+ * （非同期・バイナリ出力は常にシンク経由）
+ */
+#ifndef ELOG_USE_SINK
+#define ELOG_USE_SINK 0
+#endif
+
+/**
+ * 重複メッセージの抑止
+ * 有効時、直前と同じコールサイト・同じ引数のレコードは出力せずに数え、
+ * 別のレコードが来たとき、または ELOG_DEDUP_WINDOW_MS ごとに
+ * "last message repeated N times" の1行にまとめる（シンク経由の出力のみ）
+ */
+#ifndef ELOG_USE_DEDUP
+#define ELOG_USE_DEDUP 0
+#endif
+
+/**
+ * 重複の件数をまとめて報告する間隔（ミリ秒）
+ */
+#ifndef ELOG_DEDUP_WINDOW_MS
+#define ELOG_DEDUP_WINDOW_MS 10000
+#endif
+
+/**
+ * 繰り返し件数を報告する行のフォーマット（%u に件数）
+ */
+#ifndef ELOG_DEDUP_REPEAT_FMT
+#define ELOG_DEDUP_REPEAT_FMT "last message repeated %u times"
+#endif
+
+/**
+ * フライトレコーダ
+ * 有効時、実行時レベルで除外されたレコードのうち elog_flight_level 以下の
+ * ものを、整形せずにスレッドごとのリングへ記録する。
+ * ELOG_FLIGHT_TRIGGER_LEVEL 以下のレコードを出力する直前、または
+ * elog_flight_dump() の呼び出し時に、そのスレッドのリングを古い順に出力する
+ */
+#ifndef ELOG_USE_FLIGHT_RECORDER
+#define ELOG_USE_FLIGHT_RECORDER 0
+#endif
+
+/**
+ * フライトレコーダのリングに保持するレコード数（スレッドごと、2のべき乗）
+ */
+#ifndef ELOG_FLIGHT_RECORDS
+#define ELOG_FLIGHT_RECORDS 64
+#endif
+
+/**
+ * フライトレコーダの1レコードのバイト数（ヘッダー + エンコード済み引数）
+ */
+#ifndef ELOG_FLIGHT_RECORD_SIZE
+#define ELOG_FLIGHT_RECORD_SIZE 128
+#endif
+
+/**
+ * このレベル以下のレコードでリングを出力する
+ */
+#ifndef ELOG_FLIGHT_TRIGGER_LEVEL
+#define ELOG_FLIGHT_TRIGGER_LEVEL ELOG_LEVEL_ERROR
+#endif
+
+/**
+ * 致命的なシグナルのハンドラ
+ * 有効時、elog_crash_handler_install() で SIGSEGV / SIGBUS / SIGFPE / SIGILL /
+ * SIGABRT のハンドラを登録できる。ハンドラはまだ出力されていないレコード
+ * （stdout のバッファ・fd シンクのバッファ・非同期キュー）を write(2) で書き出し、
+ * シグナルの情報とバックトレースを ELOG_LEVEL_CRITICAL のレコードとして
+ * 出力してから、元の処理でシグナルを再送する
+ */
+#ifndef ELOG_USE_CRASH_HANDLER
+#define ELOG_USE_CRASH_HANDLER 0
+#endif
+
+/**
+ * シグナルハンドラ・割り込みから使える出力（ELOG_*_SIGSAFE）
+ * 有効時、ELOG_*_SIGSAFE マクロはロック・malloc・stdio を使わない。
+ * シンクを使う構成では引数をエンコードしたまま固定長のリングへ1回の予約で
+ * 書き込み、通常の出力（elog_emit / elog_sink_flush など）のついでに
+ * 出力する。それ以外の構成では小さな printf のフォーマッタでスタック上に
+ * 1行を組み立て、write(2)（ELOG_USE_TINY_PRINTF=1 では出力先の関数）へ渡す
+ */
+#ifndef ELOG_USE_SIGSAFE
+#define ELOG_USE_SIGSAFE 0
+#endif
+
+/**
+ * ELOG_*_SIGSAFE のリングに保持するレコード数（プロセス全体、2のべき乗）
+ */
+#ifndef ELOG_SIGSAFE_RECORDS
+#define ELOG_SIGSAFE_RECORDS 64
+#endif
+
+/**
+ * ELOG_*_SIGSAFE のリングの1レコードのバイト数（ヘッダー + エンコード済み引数）
+ */
+#ifndef ELOG_SIGSAFE_RECORD_SIZE
+#define ELOG_SIGSAFE_RECORD_SIZE 256
+#endif
+
+/**
+ * スコープタイマー（ELOG_*_SCOPE_TIMER）
+ * 有効時、ELOG_*_SCOPE_TIMER はスコープを抜けるまでの所要時間を
+ * コールサイト・スレッドごとの対数線形ヒストグラムに記録する（ロックなし）。
+ * ELOG_TIMER_PERIOD_MS ごとに、その間の件数・p50・p99・最大を
+ * 通常の出力で1行にまとめる（GCC / Clang のみ）
+ */
+#ifndef ELOG_USE_SCOPE_TIMER
+#define ELOG_USE_SCOPE_TIMER 0
+#endif
+
+/**
+ * スコープタイマーの集計を出力する間隔（ミリ秒）
+ */
+#ifndef ELOG_TIMER_PERIOD_MS
+#define ELOG_TIMER_PERIOD_MS 1000
+#endif
+
+/**
+ * トレースイベント（ELOG_SPAN_BEGIN / END・ELOG_INSTANT・ELOG_COUNTER）
+ * 有効時、これらのマクロは elog_trace_open() で開いたファイルがある間、
+ * 時刻・記述子・値だけのイベントをスレッドごとのリングへ記録する。
+ * 書き出しスレッドがリングを読み、Chrome のトレースイベント形式の JSON
+ * （chrome://tracing・Perfetto UI で表示できる）としてファイルへ書く
+ */
+#ifndef ELOG_USE_TRACE_EVENTS
+#define ELOG_USE_TRACE_EVENTS 0
+#endif
+
+/**
+ * スレッドごとのトレースイベントのリングのイベント数（2のべき乗）
+ */
+#ifndef ELOG_TRACE_EVENTS
+#define ELOG_TRACE_EVENTS 4096
+#endif
+
+/**
+ * elog 独自のフォーマッタの使用
+ * 有効時、シンク・非同期・バイナリの復元で行う整形（%d %u %x %o %c %s %p %f と
+ * 幅・精度・フラグ）を libc の snprintf ではなく表引きの変換で行う。
+ * 出力は snprintf と同じで、それ以外の変換や丸めが際どい浮動小数点は
+ * snprintf に任せる（printf 出力の ELOG_IMPL は対象外）
+ */
+#ifndef ELOG_USE_FAST_FORMAT
+#define ELOG_USE_FAST_FORMAT 1
+#endif
+
+/**
+ * 組み込み向けの小さな printf の使用
+ * 有効時、printf 出力の ELOG_IMPL は libc の printf ではなく
+ * elog_tiny_printf を呼び、出力は elog_tiny_set_output() で設定した関数へ渡す。
+ * スタック使用量は固定（バッファは ELOG_TINY_BUF_SIZE バイト）で再入可能。
+ * シンク・非同期・バイナリ出力とは併用できない
+ */
+#ifndef ELOG_USE_TINY_PRINTF
+#define ELOG_USE_TINY_PRINTF 0
+#endif
+
+/**
+ * elog_tiny_printf が出力先へまとめて渡すバイト数（スタック上に確保する）
+ */
+#ifndef ELOG_TINY_BUF_SIZE
+#define ELOG_TINY_BUF_SIZE 64
+#endif
+
+/**
+ * elog_tiny_printf で浮動小数点（%f）を整形する
+ * 無効時は引数を読み飛ばして "?" を出力する（浮動小数点演算のコードを含めない）
+ */
+#ifndef ELOG_TINY_FLOAT
+#define ELOG_TINY_FLOAT 0
+#endif
+
+/* 構造化ログ（ELOG_*_KV）のエンコーダ */
+#define ELOG_KV_FORMAT_TEXT 1   /* 通常の行と同じプレフィックス + key=value */
+#define ELOG_KV_FORMAT_LOGFMT 2 /* logfmt（level=info msg="..." key=value） */
+#define ELOG_KV_FORMAT_JSON 3   /* 1行1オブジェクトの JSON */
+
+/**
+ * 構造化ログの既定のエンコーダ（elog_kv_set_encoder() で実行時に変更できる）
+ */
+#ifndef ELOG_KV_FORMAT
+#define ELOG_KV_FORMAT ELOG_KV_FORMAT_TEXT
+#endif
+
+#if ELOG_USE_SINK || ELOG_USE_ASYNC || ELOG_USE_BINARY || ELOG_USE_DEDUP || \
+    ELOG_USE_TIMESTAMP
+#define ELOG_SINK_ENABLED 1
+#else
+#define ELOG_SINK_ENABLED 0
+#endif
+
+#if ELOG_USE_TINY_PRINTF && ELOG_SINK_ENABLED
+#error "ELOG_USE_TINY_PRINTF cannot be combined with sink, async, binary, dedup or timestamp output"
+#endif
+
+/**
+ * コールサイト記述子を専用リンカセクション（elog_meta）へ配置する
+ * ELF ターゲットの GCC/Clang では自動で有効。記述子をインデックスで参照でき、
+ * elog-decode が実行ファイルから記述子を読み出せるようになる
+ */
+#ifndef ELOG_USE_CALLSITE_SECTION
+#if defined(__ELF__) && (defined(__GNUC__) || defined(__clang__))
+#define ELOG_USE_CALLSITE_SECTION 1
+#else
+#define ELOG_USE_CALLSITE_SECTION 0
+#endif
+#endif
+
+/**
+ * コールサイトごとの有効化フラグ（動的デバッグ）
+ * 有効時、各ログ呼び出しは実行時レベルで除外される場合でも記述子の
+ * フラグを確認し、elog_callsite_query() で個別に有効化できる。
+ * 記述子の列挙に elog_meta セクションが必要
+ */
+#ifndef ELOG_USE_DYNAMIC_DEBUG
+#define ELOG_USE_DYNAMIC_DEBUG 0
+#endif
+
+#if ELOG_USE_DYNAMIC_DEBUG && !ELOG_USE_CALLSITE_SECTION
+#error "ELOG_USE_DYNAMIC_DEBUG requires ELOG_USE_CALLSITE_SECTION"
+#endif
+
+/**
+ * ジャンプラベルによる実行時レベル判定（x86-64 の ELF のみ）
+ * 有効時、各ログ呼び出しの判定は5バイトの命令1つになり、
+ * 除外中は NOP、出力中は JMP に ELOG_SET_LEVEL が書き換える。
+ * ELOG_MODULE を定義した翻訳単位と ELOG_USE_DYNAMIC_DEBUG=1 では
+ * 従来どおり変数を読んで判定する
+ */
+#ifndef ELOG_USE_JUMP_LABEL
+#define ELOG_USE_JUMP_LABEL 0
+#endif
+
+#if ELOG_USE_JUMP_LABEL &&                             \
+    !(defined(__x86_64__) && defined(__ELF__) &&       \
+      (defined(__GNUC__) || defined(__clang__)))
+#error "ELOG_USE_JUMP_LABEL requires GCC or Clang on x86-64 ELF"
+#endif
+
+/**
+ * バイナリストリームにコールサイト定義（フォーマット文字列等）を含める
+ * 0 の場合、デコードには elog-decode -e で実行ファイルを渡す必要がある
+ */
+#ifndef ELOG_BINARY_EMBED_CALLSITES
+#define ELOG_BINARY_EMBED_CALLSITES 1
+#endif
+
+/**
+ * 非同期バックエンドでスレッドごとに持つリングのレコード数（2のべき乗）
+ */
+#ifndef ELOG_ASYNC_QUEUE_SIZE
+#define ELOG_ASYNC_QUEUE_SIZE 1024
+#endif
+
+/**
+ * 非同期キュー1レコードのバイト数（ヘッダー + エンコード済み引数）
+ */
+#ifndef ELOG_ASYNC_RECORD_SIZE
+#define ELOG_ASYNC_RECORD_SIZE 256
+#endif
+
+/**
+ * ライブラリ内で整形する1行の最大バイト数（超過分は切り捨て）
+ */
+#ifndef ELOG_LINE_MAX
+#define ELOG_LINE_MAX 512
+#endif
+
+/**
+ * elog_emit_args() に渡すエンコード済み引数の最大バイト数
+ * （非同期バックエンドでは1レコードに入る分）
+ */
+#if ELOG_USE_ASYNC
+#define ELOG_ARGS_MAX                                               \
+  (ELOG_ASYNC_RECORD_SIZE - sizeof(void *) - sizeof(uint64_t) - \
+   sizeof(uint16_t))
+#else
+#define ELOG_ARGS_MAX ELOG_LINE_MAX
+#endif
+
 /* ============================================================
  * 3. 実行時ログレベル変数
  * ============================================================ */
@@ -79,11 +456,27 @@ typedef enum {
  */
 extern volatile uint8_t elog_runtime_level;
 
+#if ELOG_USE_JUMP_LABEL
+/**
+ * 実行時ログレベルを設定し、ジャンプラベルを書き換える
+ * コードページの書き換えが拒否された場合（mprotect の失敗）は -1 を返し、
+ * 以降は書き換えを行わない（レベルは設定され、JMP のままの呼び出しは
+ * 変数による判定で出力される）
+ */
+int elog_set_level(uint8_t level);
+
+/**
+ * 実行時ログレベルを設定するマクロ
+ * @param level 設定するログレベル (ELOG_LEVEL_OFF ~ ELOG_LEVEL_TRACE)
+ */
+#define ELOG_SET_LEVEL(level) elog_set_level(level)
+#else
 /**
  * 実行時ログレベルを設定するマクロ
  * @param level 設定するログレベル (ELOG_LEVEL_OFF ~ ELOG_LEVEL_TRACE)
  */
 #define ELOG_SET_LEVEL(level) (elog_runtime_level = (level))
+#endif
 
 /**
  * 現在の実行時ログレベルを取得するマクロ
@@ -95,6 +488,89 @@ extern volatile uint8_t elog_runtime_level;
 #define ELOG_GET_LEVEL() (ELOG_COMPILED_LEVEL)
 #endif
 
+/* ============================================================
+ * 3.1 モジュールごとの実行時ログレベル
+ * ============================================================ */
+
+/**
+ * モジュール（ログの出力元をまとめる単位）
+ * ELOG_MODULE_DEFINE() でいずれか1つの翻訳単位に定義し、
+ * そのモジュールに属する翻訳単位では elog.h より前に
+ *   #define ELOG_MODULE net
+ * とする（または target_compile_definitions で ELOG_MODULE=net）。
+ * その翻訳単位のログは elog_runtime_level の代わりに
+ * モジュールのレベルで判定される（判定コストは同じ1回の読み出し）
+ */
+typedef struct elog_module {
+  const char *name;          /**< モジュール名 */
+  volatile uint8_t level;    /**< 実行時ログレベル */
+  struct elog_module *next;  /**< 登録リスト（セクション非対応環境用） */
+} elog_module_t;
+
+#define ELOG_MODULE_VAR_(name) elog_module_##name
+#define ELOG_MODULE_VAR(name) ELOG_MODULE_VAR_(name)
+
+/* C++ の翻訳単位で定義しても C から参照できるよう、先に C リンケージで宣言する */
+#ifdef __cplusplus
+#define ELOG_MODULE_DECLARE(name) extern "C" elog_module_t ELOG_MODULE_VAR(name)
+#else
+#define ELOG_MODULE_DECLARE(name) extern elog_module_t ELOG_MODULE_VAR(name)
+#endif
+
+/**
+ * モジュールを定義する（プログラム全体で1回）
+ * ELF ターゲットでは elog_modules セクションに置かれ、名前で検索できる。
+ * それ以外の GCC/Clang ではコンストラクタで登録する
+ * @param name  モジュール名（識別子）
+ * @param level 実行時ログレベルの初期値
+ */
+#if ELOG_USE_CALLSITE_SECTION
+/* 配列として走査するため、コンパイラによる過剰アラインメントを抑止する */
+#define ELOG_MODULE_DEFINE(name, level)                                  \
+  ELOG_MODULE_DECLARE(name);                                             \
+  elog_module_t ELOG_MODULE_VAR(name)                                    \
+      __attribute__((section("elog_modules"), used,                      \
+                     aligned(sizeof(void *)))) = {#name, (level), NULL}
+#elif defined(__GNUC__) || defined(__clang__)
+#define ELOG_MODULE_DEFINE(name, level)                              \
+  ELOG_MODULE_DECLARE(name);                                         \
+  elog_module_t ELOG_MODULE_VAR(name) = {#name, (level), NULL};      \
+  __attribute__((constructor)) static void elog_module_init_##name( \
+      void) {                                                        \
+    elog_module_register(&ELOG_MODULE_VAR(name));                    \
+  }                                                                  \
+  typedef int elog_module_defined_##name
+#else
+#define ELOG_MODULE_DEFINE(name, level) \
+  ELOG_MODULE_DECLARE(name);            \
+  elog_module_t ELOG_MODULE_VAR(name) = {#name, (level), NULL}
+#endif
+
+/**
+ * 名前でモジュールを探す
+ * @return 見つからない場合 NULL
+ */
+elog_module_t *elog_module_find(const char *name);
+
+/**
+ * モジュールの実行時ログレベルを設定する
+ * @return 成功時 0、モジュールが見つからない場合 -1
+ */
+int elog_set_module_level(const char *name, uint8_t level);
+
+/**
+ * 登録されているモジュールを順に返す
+ * @param prev 前回の戻り値（最初は NULL）
+ * @return 次のモジュール。終端では NULL
+ */
+elog_module_t *elog_module_next(const elog_module_t *prev);
+
+/**
+ * モジュールを登録する（ELOG_MODULE_DEFINE が自動で呼ぶ。
+ * ELF 以外で GCC/Clang 以外のコンパイラを使う場合のみ手動で呼ぶ）
+ */
+void elog_module_register(elog_module_t *module);
+
 /* ============================================================
  * 4. ANSI カラーコード定義
  * ============================================================ */
@@ -169,17 +645,30 @@ extern volatile uint8_t elog_runtime_level;
 #define ELOG_STRINGIFY(x) #x
 #define ELOG_TOSTRING(x) ELOG_STRINGIFY(x)
 
-/* ファイル名:行番号のフォーマット */
+/* マクロを展開してから識別子を連結する */
+#define ELOG_CONCAT_(a, b) a##b
+#define ELOG_CONCAT(a, b) ELOG_CONCAT_(a, b)
+
+/*
+ * ファイル名:行番号のフォーマットと引数
+ * 引数は先頭のカンマごと展開する（無効時は両方とも空で、引数の並びが崩れない）
+ */
 #if ELOG_USE_FILE_LINE
 #ifndef ELOG_FILE_LINE_FMT
 #define ELOG_FILE_LINE_FMT "[%s: %d]"
 #endif
-#define ELOG_FILE_LINE_ARGS __FILE_NAME__, __LINE__
+#define ELOG_FILE_LINE_ARGS , __FILE_NAME__, __LINE__
 #else
+#undef ELOG_FILE_LINE_FMT
 #define ELOG_FILE_LINE_FMT
 #define ELOG_FILE_LINE_ARGS
 #endif
 
+/* ファイル名:行番号のリテラル（ELOG_USE_STATIC_PREFIX=1 用、'%' を含めないこと） */
+#ifndef ELOG_FILE_LINE_STATIC
+#define ELOG_FILE_LINE_STATIC(file, line) "[" file ": " line "]"
+#endif
+
 /* カラーコードの開始・終了 */
 #if ELOG_USE_COLOR
 #define ELOG_COLOR_BEGIN(color) color
@@ -189,86 +678,496 @@ extern volatile uint8_t elog_runtime_level;
 #define ELOG_COLOR_END ""
 #endif
 
-/* ============================================================
- * 7. 実装マクロ（ELOG_IMPL）
- * ============================================================ */
+/* 行頭プレフィックス全体のリテラル（ELOG_USE_STATIC_PREFIX=1 用） */
+#if ELOG_USE_FILE_LINE
+#define ELOG_PREFIX_LITERAL(level_str, color)    \
+  ELOG_COLOR_BEGIN(color) level_str " "          \
+  ELOG_FILE_LINE_STATIC(__FILE_NAME__, ELOG_TOSTRING(__LINE__)) " "
+#else
+#define ELOG_PREFIX_LITERAL(level_str, color) \
+  ELOG_COLOR_BEGIN(color) level_str "  "
+#endif
 
-#if ELOG_USE_RUNTIME_LEVEL
-/* 実行時レベル判定あり */
-#define ELOG_IMPL(level, level_str, color, fmt, ...)                  \
-  do {                                                                \
-    if ((level) <= elog_runtime_level) {                              \
-      printf("%s%s " ELOG_FILE_LINE_FMT " " fmt "%s\n",               \
-             ELOG_COLOR_BEGIN(color), level_str, ELOG_FILE_LINE_ARGS, \
-             ELOG_COLOR_RESET, ##__VA_ARGS__);                        \
-    }                                                                 \
-  } while (0)
+/* 実行時レベル判定（ELOG_MODULE があればモジュールのレベル） */
+#if ELOG_USE_RUNTIME_LEVEL && defined(ELOG_MODULE)
+ELOG_MODULE_DECLARE(ELOG_MODULE);
+#define ELOG_RUNTIME_CHECK(lv) ((lv) <= ELOG_MODULE_VAR(ELOG_MODULE).level)
+#elif ELOG_USE_RUNTIME_LEVEL
+#define ELOG_RUNTIME_CHECK(level) ((level) <= elog_runtime_level)
 #else
-/* 実行時レベル判定なし */
-#define ELOG_IMPL(level, level_str, color, fmt, ...)                           \
-  do {                                                                         \
-    printf("%s%s " ELOG_FILE_LINE_FMT " " fmt "%s\n", ELOG_COLOR_BEGIN(color), \
-           level_str, ELOG_FILE_LINE_ARGS, ELOG_COLOR_RESET, ##__VA_ARGS__);   \
-  } while (0)
+#define ELOG_RUNTIME_CHECK(level) (1)
 #endif
 
-/* CRITICAL */
-#if ELOG_COMPILED_LEVEL >= ELOG_LEVEL_CRITICAL
-#define ELOG_CRITICAL(fmt, ...)                                                \
-  ELOG_IMPL(ELOG_LEVEL_CRITICAL, ELOG_LEVEL_FMT_CRITICAL, ELOG_COLOR_CRITICAL, \
-            fmt, ##__VA_ARGS__)
+/*
+ * ジャンプラベル: 出力中は JMP、除外中は NOP になる5バイトの命令
+ * 命令は 8 バイト境界をまたがないように置かれ、1回のストアで書き換えられる。
+ * elog_jump セクションに {命令, 飛び先, レベル} を相対位置で記録する
+ */
+#if ELOG_USE_JUMP_LABEL && ELOG_USE_RUNTIME_LEVEL && \
+    !ELOG_USE_DYNAMIC_DEBUG && !defined(ELOG_MODULE)
+#define ELOG_JUMP_LABEL_ACTIVE 1
+#define ELOG_JUMP_LABEL(lv)                                        \
+  __extension__({                                                  \
+    __label__ elog_jump_on_;                                       \
+    int elog_jump_hit_ = 0;                                        \
+    __asm__ goto(                                                  \
+        ".balign 8, , 4\n\t"                                       \
+        "1: .byte 0xe9\n\t"                                        \
+        ".long %l[elog_jump_on_] - 2f\n\t"                         \
+        "2:\n\t"                                                   \
+        ".pushsection elog_jump, \"a\"\n\t"                        \
+        ".balign 4\n\t"                                            \
+        ".long 1b - ., %l[elog_jump_on_] - ., %c[level]\n\t"       \
+        ".popsection"                                              \
+        :                                                          \
+        : [level] "i"(lv)                                          \
+        :                                                          \
+        : elog_jump_on_);                                          \
+    if (0) {                                                       \
+    elog_jump_on_:                                                 \
+      elog_jump_hit_ = 1;                                          \
+    }                                                              \
+    elog_jump_hit_;                                                \
+  })
 #else
-#define ELOG_CRITICAL(fmt, ...) ((void)0)
+#define ELOG_JUMP_LABEL_ACTIVE 0
 #endif
 
-/* ERROR */
-#if ELOG_COMPILED_LEVEL >= ELOG_LEVEL_ERROR
-#define ELOG_ERROR(fmt, ...)                                               \
-  ELOG_IMPL(ELOG_LEVEL_ERROR, ELOG_LEVEL_FMT_ERROR, ELOG_COLOR_ERROR, fmt, \
-            ##__VA_ARGS__)
+/* printf 形式チェック用の属性 */
+#if defined(__GNUC__) || defined(__clang__)
+#define ELOG_PRINTF_ATTR(fmt_idx, arg_idx) \
+  __attribute__((format(printf, fmt_idx, arg_idx)))
 #else
-#define ELOG_ERROR(fmt, ...) ((void)0)
+#define ELOG_PRINTF_ATTR(fmt_idx, arg_idx)
 #endif
 
-/* WARN */
-#if ELOG_COMPILED_LEVEL >= ELOG_LEVEL_WARN
-#define ELOG_WARN(fmt, ...)                                             \
-  ELOG_IMPL(ELOG_LEVEL_WARN, ELOG_LEVEL_FMT_WARN, ELOG_COLOR_WARN, fmt, \
-            ##__VA_ARGS__)
+/* 出力関数の属性（呼び出しを分岐予測・配置の上で「まれ」として扱わせる） */
+#if defined(__GNUC__) || defined(__clang__)
+#define ELOG_COLD __attribute__((cold, noinline))
 #else
-#define ELOG_WARN(fmt, ...) ((void)0)
+#define ELOG_COLD
 #endif
 
-/* INFO */
-#if ELOG_COMPILED_LEVEL >= ELOG_LEVEL_INFO
-#define ELOG_INFO(fmt, ...)                                             \
-  ELOG_IMPL(ELOG_LEVEL_INFO, ELOG_LEVEL_FMT_INFO, ELOG_COLOR_INFO, fmt, \
-            ##__VA_ARGS__)
+#if ELOG_USE_COLD_PATH
+#define ELOG_EMIT_ATTR ELOG_COLD
 #else
-#define ELOG_INFO(fmt, ...) ((void)0)
+#define ELOG_EMIT_ATTR
 #endif
 
-/* DEBUG */
-#if ELOG_COMPILED_LEVEL >= ELOG_LEVEL_DEBUG
-#define ELOG_DEBUG(fmt, ...)                                               \
-  ELOG_IMPL(ELOG_LEVEL_DEBUG, ELOG_LEVEL_FMT_DEBUG, ELOG_COLOR_DEBUG, fmt, \
-            ##__VA_ARGS__)
+/* コールサイト記述子の配置属性（配列として走査するためアラインメントを固定） */
+#if ELOG_USE_CALLSITE_SECTION
+#define ELOG_CALLSITE_ATTR \
+  __attribute__((section("elog_meta"), used, aligned(sizeof(void *))))
 #else
-#define ELOG_DEBUG(fmt, ...) ((void)0)
+#define ELOG_CALLSITE_ATTR
 #endif
 
-/* TRACE */
-#if ELOG_COMPILED_LEVEL >= ELOG_LEVEL_TRACE
-#define ELOG_TRACE(fmt, ...)                                               \
-  ELOG_IMPL(ELOG_LEVEL_TRACE, ELOG_LEVEL_FMT_TRACE, ELOG_COLOR_TRACE, fmt, \
-            ##__VA_ARGS__)
+/* コールサイト記述子に格納するファイル名 */
+#if ELOG_USE_FILE_LINE
+#define ELOG_CALLSITE_FILE __FILE_NAME__
 #else
-#define ELOG_TRACE(fmt, ...) ((void)0)
+#define ELOG_CALLSITE_FILE NULL
 #endif
 
-/* WARN */
-#if ELOG_COMPILED_LEVEL >= ELOG_LEVEL_WARN
-#define ELOG_WARN(fmt, ...)                                             \
+/* ============================================================
+ * 7. コールサイト記述子・バックエンド API
+ * ============================================================ */
+
+/**
+ * ログ呼び出し箇所ごとの静的情報
+ * ELOG_IMPL の展開ごとに static に1つ生成され、
+ * バックエンドにはこのポインタと引数だけが渡される
+ *
+ * ELOG_USE_CALLSITE_SECTION=1 の場合は elog_meta セクションに連続して並ぶ。
+ * 先頭4メンバの配置は elog-decode が実行ファイルから読み出す際の前提なので
+ * 変更しないこと（メンバの追加は末尾へ）
+ * 引数の型は fmt の変換指定から決まるため、別途保持しない
+ */
+typedef struct elog_callsite {
+  const char *fmt;        /**< ユーザー指定のフォーマット文字列 */
+  const char *file;       /**< ファイル名（ELOG_USE_FILE_LINE=0 の場合 NULL） */
+  uint32_t line;          /**< 行番号 */
+  uint8_t level;          /**< ログレベル */
+  volatile uint8_t flags; /**< ELOG_CALLSITE_* フラグ */
+  uint32_t id; /**< バイナリ出力用 ID（0 は未割り当て、出力側が設定） */
+#if ELOG_USE_DYNAMIC_DEBUG
+  const char *func;       /**< 関数名 */
+#endif
+} elog_callsite_t;
+
+/* 実行時レベルに関係なく出力する（elog_callsite_query で設定） */
+#define ELOG_CALLSITE_ENABLED 0x01
+
+/**
+ * ログレコードをバックエンドへ渡す
+ * ELOG_IMPL から呼ばれる。直接呼び出す必要はない
+ * @param cs  コールサイト記述子
+ * @param fmt cs->fmt と同じフォーマット文字列（形式チェック用）。
+ *            同期シンク出力で ELOG_USE_STATIC_PREFIX=1 の場合は
+ *            プレフィックスと行末まで連結した行全体のリテラル
+ */
+void elog_emit(elog_callsite_t *cs, const char *fmt, ...)
+    ELOG_PRINTF_ATTR(2, 3) ELOG_EMIT_ATTR;
+
+#if !ELOG_SINK_ENABLED
+/**
+ * printf 出力の1行を書き出す（ELOG_USE_COLD_PATH=1 または ELOG_USE_ATOMIC_LINE=1 の
+ * ELOG_IMPL から呼ばれる）
+ * プレフィックス・cs->fmt による引数の整形・行末をまとめて出力する。
+ * 直接呼び出す必要はない
+ * @param cs コールサイト記述子
+ */
+void elog_print(elog_callsite_t *cs, ...) ELOG_COLD;
+
+/* フォーマット文字列と引数の形式チェック用（呼び出されない） */
+static inline void elog_format_check(const char *fmt, ...)
+    ELOG_PRINTF_ATTR(1, 2);
+static inline void elog_format_check(const char *fmt, ...) { (void)fmt; }
+#endif
+
+/**
+ * エンコード済みの引数でログレコードをバックエンドへ渡す
+ * elog.hpp の ELOGPP_* から呼ばれる。直接呼び出す必要はない
+ * @param cs   コールサイト記述子
+ * @param args cs->fmt に従ってエンコードした引数（ELOG_ARGS_MAX 以下）
+ *             形式はライブラリ内部の elog_args_encode と同じ
+ * @param len  args のバイト数
+ */
+void elog_emit_args(elog_callsite_t *cs, const uint8_t *args, size_t len);
+
+#if ELOG_USE_FLIGHT_RECORDER
+/**
+ * フライトレコーダに記録するレベルの上限（既定は ELOG_COMPILED_LEVEL）
+ * 実行時レベルで除外され、このレベル以下のレコードが記録される。
+ * ELOG_LEVEL_OFF で記録を止める
+ */
+extern volatile uint8_t elog_flight_level;
+
+/**
+ * 除外されたレコードを呼び出しスレッドのリングへ記録する
+ * ELOG_IMPL から呼ばれる。直接呼び出す必要はない
+ */
+void elog_flight_record(elog_callsite_t *cs, const char *fmt, ...)
+    ELOG_PRINTF_ATTR(2, 3);
+
+/**
+ * エンコード済みの引数で記録する（elog.hpp の ELOGPP_* から呼ばれる）
+ */
+void elog_flight_record_args(elog_callsite_t *cs, const uint8_t *args,
+                             size_t len);
+
+/**
+ * 呼び出しスレッドのリングに残っているレコードを古い順に出力し、リングを空にする
+ * ELOG_FLIGHT_TRIGGER_LEVEL 以下のレコードの出力前にも自動で呼ばれる
+ */
+void elog_flight_dump(void) ELOG_COLD;
+
+/* レコードを出力する前にリングを出力するか */
+#define ELOG_FLIGHT_TRIGGER(level)              \
+  do {                                          \
+    if ((level) <= ELOG_FLIGHT_TRIGGER_LEVEL) { \
+      elog_flight_dump();                       \
+    }                                           \
+  } while (0)
+#define ELOG_FLIGHT_CHECK(level) ((level) <= elog_flight_level)
+#else
+#define ELOG_FLIGHT_TRIGGER(level) ((void)0)
+#endif
+
+#if ELOG_USE_ASYNC
+/**
+ * キューに積まれたレコードがすべて出力されるまで待つ
+ */
+void elog_async_flush(void);
+#endif
+
+#if ELOG_USE_CRASH_HANDLER
+/**
+ * 致命的なシグナルのハンドラを登録する（2回目以降は何もしない）
+ * 元のハンドラは保存し、出力を終えた後のシグナルの再送で使う。
+ * スタックオーバーフローでも動くよう、呼び出しスレッドには
+ * 代替シグナルスタックも設定する（非同期出力ではキューを割り当てたスレッドにも
+ * 設定する。それ以外のスレッドは各自で sigaltstack() を設定すること）
+ * @return 成功時 0、登録できなかった場合 -1
+ */
+int elog_crash_handler_install(void);
+#endif
+
+#if ELOG_USE_SIGSAFE
+/**
+ * シグナルハンドラ・割り込みからレコードを出力する
+ * ELOG_*_SIGSAFE から呼ばれる。直接呼び出す必要はない
+ * 引数は cs->fmt に従って読む（fmt は形式チェック用）
+ */
+void elog_sigsafe_emit(elog_callsite_t *cs, const char *fmt, ...)
+    ELOG_PRINTF_ATTR(2, 3) ELOG_COLD;
+#endif
+
+#if ELOG_USE_DEDUP
+/**
+ * 保留中の繰り返し件数をすぐに出力する
+ * プロセス終了時と elog_async_flush() でも自動で呼ばれる
+ */
+void elog_dedup_flush(void);
+#endif
+
+#if ELOG_USE_TINY_PRINTF
+/**
+ * elog_tiny_printf の出力先
+ * 整形済みの断片（最大 ELOG_TINY_BUF_SIZE バイト）が順に渡される。
+ * 1行が複数回に分かれることがある
+ */
+typedef void (*elog_tiny_write_fn)(const char *data, size_t len);
+
+/**
+ * elog_tiny_printf の出力先を設定する
+ * NULL で既定に戻す（POSIX では標準出力への write(2)、それ以外では破棄）
+ */
+void elog_tiny_set_output(elog_tiny_write_fn fn);
+
+/**
+ * printf の小さな代替（ELOG_IMPL から呼ばれる）
+ * @return 出力した文字数
+ */
+int elog_tiny_printf(const char *fmt, ...) ELOG_PRINTF_ATTR(1, 2);
+#endif
+
+#if ELOG_USE_CALLSITE_SECTION
+/**
+ * プログラム中のコールサイト記述子の数
+ * 記述子は ELOG_IMPL の展開時にのみ生成されるため、
+ * 実際に記述子を持つバックエンドで使われた呼び出しだけが数えられる
+ * （ELOG_USE_DYNAMIC_DEBUG=1 では printf 出力の呼び出しも含む）
+ */
+size_t elog_callsite_count(void);
+
+/**
+ * インデックスからコールサイト記述子を取得する
+ * @param index 0 ~ elog_callsite_count() - 1
+ * @return 記述子。範囲外の場合 NULL
+ */
+elog_callsite_t *elog_callsite_at(size_t index);
+
+/**
+ * コールサイト記述子のインデックスを取得する
+ */
+size_t elog_callsite_index(const elog_callsite_t *cs);
+#endif
+
+#if ELOG_USE_DYNAMIC_DEBUG
+/**
+ * コールサイトの選択条件（NULL / 0 の項目は条件なし）
+ */
+typedef struct elog_callsite_match {
+  const char *file;   /**< ファイル名（* と ? のワイルドカード可） */
+  const char *func;   /**< 関数名（* と ? のワイルドカード可） */
+  const char *format; /**< フォーマット文字列に含まれる部分文字列 */
+  uint32_t line_min;  /**< 行番号の下限 */
+  uint32_t line_max;  /**< 行番号の上限 */
+} elog_callsite_match_t;
+
+/**
+ * 条件に一致するコールサイトを有効化・無効化する
+ * @param match   選択条件（NULL ですべて）
+ * @param enabled 0 以外で有効化
+ * @return 一致したコールサイトの数
+ */
+size_t elog_callsite_set_enabled(const elog_callsite_match_t *match,
+                                 int enabled);
+
+/**
+ * Linux の dynamic_debug と同じ書式でコールサイトを切り替える
+ * 例: "file net.c line 10-20 func poll* format \"timeout\" +p"
+ * キーワードは file, func, line (N, N-M, N-, -M), format。
+ * 最後にフラグ操作 +p / -p / =p / =_ を置く
+ * @return 一致したコールサイトの数。書式エラーの場合 -1
+ */
+int elog_callsite_query(const char *query);
+#endif
+
+/* ============================================================
+ * 8. 実装マクロ（ELOG_IMPL）
+ * ============================================================ */
+
+/* 動的デバッグ: 記述子を判定より前に置き、有効化フラグも見る */
+#if ELOG_USE_DYNAMIC_DEBUG
+#define ELOG_CALLSITE_DEFINE(level, fmt)                          \
+  static elog_callsite_t elog_callsite_ ELOG_CALLSITE_ATTR = {    \
+      fmt, ELOG_CALLSITE_FILE, __LINE__, (level), 0, 0, __func__}
+#define ELOG_CALLSITE_CHECK(level) \
+  (ELOG_RUNTIME_CHECK(level) ||    \
+   __builtin_expect(elog_callsite_.flags & ELOG_CALLSITE_ENABLED, 0))
+#else
+#define ELOG_CALLSITE_DEFINE(level, fmt)                       \
+  static elog_callsite_t elog_callsite_ ELOG_CALLSITE_ATTR = { \
+      fmt, ELOG_CALLSITE_FILE, __LINE__, (level), 0, 0}
+#if ELOG_JUMP_LABEL_ACTIVE
+/* 除外中は NOP を通り抜けるだけ。出力中は JMP の先で従来の判定も行う */
+#define ELOG_CALLSITE_CHECK(level) \
+  (ELOG_JUMP_LABEL(level) && ELOG_RUNTIME_CHECK(level))
+#else
+#define ELOG_CALLSITE_CHECK(level) ELOG_RUNTIME_CHECK(level)
+#endif
+#endif
+
+/* printf 出力で呼ぶ関数 */
+#if ELOG_USE_TINY_PRINTF
+#define ELOG_PRINTF elog_tiny_printf
+#else
+#define ELOG_PRINTF printf
+#endif
+
+/* printf 出力では動的デバッグ時のみ記述子を置く */
+#if ELOG_USE_DYNAMIC_DEBUG
+#define ELOG_PRINTF_CALLSITE(level, fmt) ELOG_CALLSITE_DEFINE(level, fmt)
+#else
+#define ELOG_PRINTF_CALLSITE(level, fmt) ((void)0)
+#endif
+
+#if ELOG_SINK_ENABLED
+/* elog_emit に渡すフォーマット（同期テキスト出力ではプレフィックスも連結） */
+#if ELOG_USE_STATIC_PREFIX && !ELOG_USE_ASYNC && !ELOG_USE_BINARY
+#define ELOG_EMIT_FMT(level_str, color, fmt) \
+  ELOG_PREFIX_LITERAL(level_str, color) fmt ELOG_COLOR_END "\n"
+#else
+#define ELOG_EMIT_FMT(level_str, color, fmt) fmt
+#endif
+#endif
+
+#if ELOG_USE_FLIGHT_RECORDER
+/* 出力する1行（シンク経由では elog_emit、それ以外は elog_print） */
+#if ELOG_SINK_ENABLED
+#define ELOG_FLIGHT_OUTPUT(level_str, color, fmt, ...)             \
+  elog_emit(&elog_callsite_, ELOG_EMIT_FMT(level_str, color, fmt), \
+            ##__VA_ARGS__)
+#else
+#define ELOG_FLIGHT_OUTPUT(level_str, color, fmt, ...) \
+  do {                                                 \
+    if (0) {                                           \
+      elog_format_check(fmt, ##__VA_ARGS__);           \
+    }                                                  \
+    elog_print(&elog_callsite_, ##__VA_ARGS__);        \
+  } while (0)
+#endif
+
+/* フライトレコーダ: 除外されたレコードはリングへ、エラーの前にはリングを出力 */
+#define ELOG_IMPL_IF(check, level, level_str, color, fmt, ...)  \
+  do {                                                          \
+    ELOG_CALLSITE_DEFINE(level, fmt);                           \
+    if (check) {                                                \
+      ELOG_FLIGHT_TRIGGER(level);                               \
+      ELOG_FLIGHT_OUTPUT(level_str, color, fmt, ##__VA_ARGS__); \
+    } else if (ELOG_FLIGHT_CHECK(level)) {                      \
+      elog_flight_record(&elog_callsite_, fmt, ##__VA_ARGS__);  \
+    }                                                           \
+  } while (0)
+#elif ELOG_SINK_ENABLED
+/* シンク経由: 記述子と引数だけをバックエンドへ渡す */
+#define ELOG_IMPL_IF(check, level, level_str, color, fmt, ...)         \
+  do {                                                                 \
+    ELOG_CALLSITE_DEFINE(level, fmt);                                  \
+    if (check) {                                                       \
+      elog_emit(&elog_callsite_, ELOG_EMIT_FMT(level_str, color, fmt), \
+                ##__VA_ARGS__);                                        \
+    }                                                                  \
+  } while (0)
+#elif ELOG_USE_STATIC_PREFIX && !ELOG_USE_ATOMIC_LINE
+/* 同期 printf 出力（プレフィックスはコンパイル時に連結済み） */
+#define ELOG_IMPL_IF(check, level, level_str, color, fmt, ...)             \
+  do {                                                                     \
+    ELOG_PRINTF_CALLSITE(level, fmt);                                      \
+    if (check) {                                                           \
+      ELOG_PRINTF(ELOG_PREFIX_LITERAL(level_str, color) fmt ELOG_COLOR_END \
+                  "\n", ##__VA_ARGS__);                                    \
+    }                                                                      \
+  } while (0)
+#elif ELOG_USE_COLD_PATH || ELOG_USE_ATOMIC_LINE
+/* 同期 printf 出力（記述子と引数だけを elog_print へ渡す） */
+#define ELOG_IMPL_IF(check, level, level_str, color, fmt, ...) \
+  do {                                                         \
+    ELOG_CALLSITE_DEFINE(level, fmt);                          \
+    if (0) {                                                   \
+      elog_format_check(fmt, ##__VA_ARGS__);                   \
+    }                                                          \
+    if (check) {                                               \
+      elog_print(&elog_callsite_, ##__VA_ARGS__);              \
+    }                                                          \
+  } while (0)
+#else
+/* 同期 printf 出力 */
+#define ELOG_IMPL_IF(check, level, level_str, color, fmt, ...)            \
+  do {                                                                    \
+    ELOG_PRINTF_CALLSITE(level, fmt);                                     \
+    if (check) {                                                          \
+      ELOG_PRINTF("%s%s " ELOG_FILE_LINE_FMT " " fmt "%s\n",              \
+                  ELOG_COLOR_BEGIN(color), level_str ELOG_FILE_LINE_ARGS, \
+                  ##__VA_ARGS__, ELOG_COLOR_END);                         \
+    }                                                                     \
+  } while (0)
+#endif
+
+/* check は判定式。判定済みの呼び出し元（レート制限）は 1 を渡す */
+#define ELOG_IMPL(level, level_str, color, fmt, ...)                     \
+  ELOG_IMPL_IF(ELOG_CALLSITE_CHECK(level), level, level_str, color, fmt, \
+               ##__VA_ARGS__)
+
+/* CRITICAL */
+#if ELOG_COMPILED_LEVEL >= ELOG_LEVEL_CRITICAL
+#define ELOG_CRITICAL(fmt, ...)                                                \
+  ELOG_IMPL(ELOG_LEVEL_CRITICAL, ELOG_LEVEL_FMT_CRITICAL, ELOG_COLOR_CRITICAL, \
+            fmt, ##__VA_ARGS__)
+#else
+#define ELOG_CRITICAL(fmt, ...) ((void)0)
+#endif
+
+/* ERROR */
+#if ELOG_COMPILED_LEVEL >= ELOG_LEVEL_ERROR
+#define ELOG_ERROR(fmt, ...)                                               \
+  ELOG_IMPL(ELOG_LEVEL_ERROR, ELOG_LEVEL_FMT_ERROR, ELOG_COLOR_ERROR, fmt, \
+            ##__VA_ARGS__)
+#else
+#define ELOG_ERROR(fmt, ...) ((void)0)
+#endif
+
+/* WARN */
+#if ELOG_COMPILED_LEVEL >= ELOG_LEVEL_WARN
+#define ELOG_WARN(fmt, ...)                                             \
+  ELOG_IMPL(ELOG_LEVEL_WARN, ELOG_LEVEL_FMT_WARN, ELOG_COLOR_WARN, fmt, \
+            ##__VA_ARGS__)
+#else
+#define ELOG_WARN(fmt, ...) ((void)0)
+#endif
+
+/* INFO */
+#if ELOG_COMPILED_LEVEL >= ELOG_LEVEL_INFO
+#define ELOG_INFO(fmt, ...)                                             \
+  ELOG_IMPL(ELOG_LEVEL_INFO, ELOG_LEVEL_FMT_INFO, ELOG_COLOR_INFO, fmt, \
+            ##__VA_ARGS__)
+#else
+#define ELOG_INFO(fmt, ...) ((void)0)
+#endif
+
+/* DEBUG */
+#if ELOG_COMPILED_LEVEL >= ELOG_LEVEL_DEBUG
+#define ELOG_DEBUG(fmt, ...)                                               \
+  ELOG_IMPL(ELOG_LEVEL_DEBUG, ELOG_LEVEL_FMT_DEBUG, ELOG_COLOR_DEBUG, fmt, \
+            ##__VA_ARGS__)
+#else
+#define ELOG_DEBUG(fmt, ...) ((void)0)
+#endif
+
+/* TRACE */
+#if ELOG_COMPILED_LEVEL >= ELOG_LEVEL_TRACE
+#define ELOG_TRACE(fmt, ...)                                               \
+  ELOG_IMPL(ELOG_LEVEL_TRACE, ELOG_LEVEL_FMT_TRACE, ELOG_COLOR_TRACE, fmt, \
+            ##__VA_ARGS__)
+#else
+#define ELOG_TRACE(fmt, ...) ((void)0)
+#endif
+
+/* WARN */
+#if ELOG_COMPILED_LEVEL >= ELOG_LEVEL_WARN
+#define ELOG_WARN(fmt, ...)                                             \
   ELOG_IMPL(ELOG_LEVEL_WARN, ELOG_LEVEL_FMT_WARN, ELOG_COLOR_WARN, fmt, \
             ##__VA_ARGS__)
 #else
@@ -302,6 +1201,659 @@ extern volatile uint8_t elog_runtime_level;
 #define ELOG_TRACE(fmt, ...) ((void)0)
 #endif
 
+/* ============================================================
+ * 9. レート制限・サンプリング
+ * ============================================================ */
+
+#if defined(__GNUC__) || defined(__clang__)
+/**
+ * ELOG_*_EVERY_MS 用の単調増加時計（ミリ秒）
+ * Linux では CLOCK_MONOTONIC_COARSE を使う（分解能は数ミリ秒）
+ */
+uint64_t elog_ratelimit_clock_ms(void);
+
+/**
+ * ELOG_*_SAMPLE 用の一様乱数（スレッドごとの xorshift）
+ */
+uint32_t elog_sample_random(void);
+
+/* 抑止された件数を次に出力する行の末尾に付ける書式 */
+#ifndef ELOG_SUPPRESSED_FMT
+#define ELOG_SUPPRESSED_FMT " (%u suppressed)"
+#endif
+
+/*
+ * 状態を更新する前に行う判定。除外された呼び出しは状態も抑止件数も変えない。
+ * 動的デバッグでは判定に使う記述子を状態より前に置く
+ */
+#define ELOG_RATELIMIT_CALLSITE(level, fmt) ELOG_PRINTF_CALLSITE(level, fmt)
+#define ELOG_RATELIMIT_CHECK(level) ELOG_CALLSITE_CHECK(level)
+
+/* 抑止件数 n が 0 でなければ末尾に付けて出力する（判定は呼び出し元で済ませる） */
+#define ELOG_IMPL_SUPPRESSED(level, level_str, color, n, fmt, ...)      \
+  do {                                                                  \
+    uint32_t elog_rl_n_ = (n);                                          \
+    if (elog_rl_n_ == 0) {                                              \
+      ELOG_IMPL_IF(1, level, level_str, color, fmt, ##__VA_ARGS__);     \
+    } else {                                                            \
+      ELOG_IMPL_IF(1, level, level_str, color, fmt ELOG_SUPPRESSED_FMT, \
+                   ##__VA_ARGS__, (unsigned)elog_rl_n_);                \
+    }                                                                   \
+  } while (0)
+
+/* 最初の1回だけ出力する */
+#define ELOG_IMPL_ONCE(level, level_str, color, fmt, ...)            \
+  do {                                                               \
+    ELOG_RATELIMIT_CALLSITE(level, fmt);                             \
+    static uint8_t elog_rl_done_;                                    \
+    if (ELOG_RATELIMIT_CHECK(level) &&                               \
+        !__atomic_load_n(&elog_rl_done_, __ATOMIC_RELAXED) &&        \
+        !__atomic_exchange_n(&elog_rl_done_, 1, __ATOMIC_RELAXED)) { \
+      ELOG_IMPL_IF(1, level, level_str, color, fmt, ##__VA_ARGS__);  \
+    }                                                                \
+  } while (0)
+
+/* n 回に1回出力する（n は1回だけ評価し、1 以下なら毎回出力する） */
+#define ELOG_IMPL_EVERY_N(level, level_str, color, n, fmt, ...)           \
+  do {                                                                    \
+    ELOG_RATELIMIT_CALLSITE(level, fmt);                                  \
+    static uint32_t elog_rl_count_;                                       \
+    if (ELOG_RATELIMIT_CHECK(level)) {                                    \
+      long long elog_rl_every_ = (long long)(n);                          \
+      if (elog_rl_every_ <= 1) {                                          \
+        ELOG_IMPL_IF(1, level, level_str, color, fmt, ##__VA_ARGS__);     \
+      } else {                                                            \
+        uint32_t elog_rl_period_ = elog_rl_every_ > (long long)UINT32_MAX \
+                                       ? UINT32_MAX                       \
+                                       : (uint32_t)elog_rl_every_;        \
+        uint32_t elog_rl_c_ =                                             \
+            __atomic_fetch_add(&elog_rl_count_, 1, __ATOMIC_RELAXED);     \
+        if (elog_rl_c_ % elog_rl_period_ == 0) {                          \
+          ELOG_IMPL_SUPPRESSED(level, level_str, color,                   \
+                               elog_rl_c_ == 0 ? 0 : elog_rl_period_ - 1, \
+                               fmt, ##__VA_ARGS__);                       \
+        }                                                                 \
+      }                                                                   \
+    }                                                                     \
+  } while (0)
+
+/* ms ミリ秒に1回まで出力する */
+#define ELOG_IMPL_EVERY_MS(level, level_str, color, ms, fmt, ...)           \
+  do {                                                                      \
+    ELOG_RATELIMIT_CALLSITE(level, fmt);                                    \
+    static uint64_t elog_rl_next_;                                          \
+    static uint32_t elog_rl_suppressed_;                                    \
+    if (ELOG_RATELIMIT_CHECK(level)) {                                      \
+      uint64_t elog_rl_now_ = elog_ratelimit_clock_ms();                    \
+      uint64_t elog_rl_at_ =                                                \
+          __atomic_load_n(&elog_rl_next_, __ATOMIC_RELAXED);                \
+      if (elog_rl_now_ >= elog_rl_at_ &&                                    \
+          __atomic_compare_exchange_n(&elog_rl_next_, &elog_rl_at_,         \
+                                      elog_rl_now_ + (uint64_t)(ms), 0,     \
+                                      __ATOMIC_RELAXED,                     \
+                                      __ATOMIC_RELAXED)) {                  \
+        ELOG_IMPL_SUPPRESSED(                                               \
+            level, level_str, color,                                        \
+            __atomic_exchange_n(&elog_rl_suppressed_, 0, __ATOMIC_RELAXED), \
+            fmt, ##__VA_ARGS__);                                            \
+      } else {                                                              \
+        __atomic_fetch_add(&elog_rl_suppressed_, 1, __ATOMIC_RELAXED);      \
+      }                                                                     \
+    }                                                                       \
+  } while (0)
+
+/* 確率 p（0.0 ~ 1.0）で出力する */
+#define ELOG_IMPL_SAMPLE(level, level_str, color, p, fmt, ...)              \
+  do {                                                                      \
+    ELOG_RATELIMIT_CALLSITE(level, fmt);                                    \
+    static uint32_t elog_rl_suppressed_;                                    \
+    if (ELOG_RATELIMIT_CHECK(level)) {                                      \
+      if ((double)elog_sample_random() < (p) * 4294967296.0) {              \
+        ELOG_IMPL_SUPPRESSED(                                               \
+            level, level_str, color,                                        \
+            __atomic_exchange_n(&elog_rl_suppressed_, 0, __ATOMIC_RELAXED), \
+            fmt, ##__VA_ARGS__);                                            \
+      } else {                                                              \
+        __atomic_fetch_add(&elog_rl_suppressed_, 1, __ATOMIC_RELAXED);      \
+      }                                                                     \
+    }                                                                       \
+  } while (0)
+
+/* CRITICAL */
+#if ELOG_COMPILED_LEVEL >= ELOG_LEVEL_CRITICAL
+#define ELOG_CRITICAL_ONCE(fmt, ...)                           \
+  ELOG_IMPL_ONCE(ELOG_LEVEL_CRITICAL, ELOG_LEVEL_FMT_CRITICAL, \
+                 ELOG_COLOR_CRITICAL, fmt, ##__VA_ARGS__)
+#define ELOG_CRITICAL_EVERY_N(n, fmt, ...)                        \
+  ELOG_IMPL_EVERY_N(ELOG_LEVEL_CRITICAL, ELOG_LEVEL_FMT_CRITICAL, \
+                    ELOG_COLOR_CRITICAL, n, fmt, ##__VA_ARGS__)
+#define ELOG_CRITICAL_EVERY_MS(ms, fmt, ...)                       \
+  ELOG_IMPL_EVERY_MS(ELOG_LEVEL_CRITICAL, ELOG_LEVEL_FMT_CRITICAL, \
+                     ELOG_COLOR_CRITICAL, ms, fmt, ##__VA_ARGS__)
+#define ELOG_CRITICAL_SAMPLE(p, fmt, ...)                        \
+  ELOG_IMPL_SAMPLE(ELOG_LEVEL_CRITICAL, ELOG_LEVEL_FMT_CRITICAL, \
+                   ELOG_COLOR_CRITICAL, p, fmt, ##__VA_ARGS__)
+#else
+#define ELOG_CRITICAL_ONCE(fmt, ...) ((void)0)
+#define ELOG_CRITICAL_EVERY_N(n, fmt, ...) ((void)0)
+#define ELOG_CRITICAL_EVERY_MS(ms, fmt, ...) ((void)0)
+#define ELOG_CRITICAL_SAMPLE(p, fmt, ...) ((void)0)
+#endif
+
+/* ERROR */
+#if ELOG_COMPILED_LEVEL >= ELOG_LEVEL_ERROR
+#define ELOG_ERROR_ONCE(fmt, ...)                                          \
+  ELOG_IMPL_ONCE(ELOG_LEVEL_ERROR, ELOG_LEVEL_FMT_ERROR, ELOG_COLOR_ERROR, \
+                 fmt, ##__VA_ARGS__)
+#define ELOG_ERROR_EVERY_N(n, fmt, ...)                                       \
+  ELOG_IMPL_EVERY_N(ELOG_LEVEL_ERROR, ELOG_LEVEL_FMT_ERROR, ELOG_COLOR_ERROR, \
+                    n, fmt, ##__VA_ARGS__)
+#define ELOG_ERROR_EVERY_MS(ms, fmt, ...)                                      \
+  ELOG_IMPL_EVERY_MS(ELOG_LEVEL_ERROR, ELOG_LEVEL_FMT_ERROR, ELOG_COLOR_ERROR, \
+                     ms, fmt, ##__VA_ARGS__)
+#define ELOG_ERROR_SAMPLE(p, fmt, ...)                                       \
+  ELOG_IMPL_SAMPLE(ELOG_LEVEL_ERROR, ELOG_LEVEL_FMT_ERROR, ELOG_COLOR_ERROR, \
+                   p, fmt, ##__VA_ARGS__)
+#else
+#define ELOG_ERROR_ONCE(fmt, ...) ((void)0)
+#define ELOG_ERROR_EVERY_N(n, fmt, ...) ((void)0)
+#define ELOG_ERROR_EVERY_MS(ms, fmt, ...) ((void)0)
+#define ELOG_ERROR_SAMPLE(p, fmt, ...) ((void)0)
+#endif
+
+/* WARN */
+#if ELOG_COMPILED_LEVEL >= ELOG_LEVEL_WARN
+#define ELOG_WARN_ONCE(fmt, ...)                                             \
+  ELOG_IMPL_ONCE(ELOG_LEVEL_WARN, ELOG_LEVEL_FMT_WARN, ELOG_COLOR_WARN, fmt, \
+                 ##__VA_ARGS__)
+#define ELOG_WARN_EVERY_N(n, fmt, ...)                                        \
+  ELOG_IMPL_EVERY_N(ELOG_LEVEL_WARN, ELOG_LEVEL_FMT_WARN, ELOG_COLOR_WARN, n, \
+                    fmt, ##__VA_ARGS__)
+#define ELOG_WARN_EVERY_MS(ms, fmt, ...)                                    \
+  ELOG_IMPL_EVERY_MS(ELOG_LEVEL_WARN, ELOG_LEVEL_FMT_WARN, ELOG_COLOR_WARN, \
+                     ms, fmt, ##__VA_ARGS__)
+#define ELOG_WARN_SAMPLE(p, fmt, ...)                                        \
+  ELOG_IMPL_SAMPLE(ELOG_LEVEL_WARN, ELOG_LEVEL_FMT_WARN, ELOG_COLOR_WARN, p, \
+                   fmt, ##__VA_ARGS__)
+#else
+#define ELOG_WARN_ONCE(fmt, ...) ((void)0)
+#define ELOG_WARN_EVERY_N(n, fmt, ...) ((void)0)
+#define ELOG_WARN_EVERY_MS(ms, fmt, ...) ((void)0)
+#define ELOG_WARN_SAMPLE(p, fmt, ...) ((void)0)
+#endif
+
+/* INFO */
+#if ELOG_COMPILED_LEVEL >= ELOG_LEVEL_INFO
+#define ELOG_INFO_ONCE(fmt, ...)                                             \
+  ELOG_IMPL_ONCE(ELOG_LEVEL_INFO, ELOG_LEVEL_FMT_INFO, ELOG_COLOR_INFO, fmt, \
+                 ##__VA_ARGS__)
+#define ELOG_INFO_EVERY_N(n, fmt, ...)                                        \
+  ELOG_IMPL_EVERY_N(ELOG_LEVEL_INFO, ELOG_LEVEL_FMT_INFO, ELOG_COLOR_INFO, n, \
+                    fmt, ##__VA_ARGS__)
+#define ELOG_INFO_EVERY_MS(ms, fmt, ...)                                    \
+  ELOG_IMPL_EVERY_MS(ELOG_LEVEL_INFO, ELOG_LEVEL_FMT_INFO, ELOG_COLOR_INFO, \
+                     ms, fmt, ##__VA_ARGS__)
+#define ELOG_INFO_SAMPLE(p, fmt, ...)                                        \
+  ELOG_IMPL_SAMPLE(ELOG_LEVEL_INFO, ELOG_LEVEL_FMT_INFO, ELOG_COLOR_INFO, p, \
+                   fmt, ##__VA_ARGS__)
+#else
+#define ELOG_INFO_ONCE(fmt, ...) ((void)0)
+#define ELOG_INFO_EVERY_N(n, fmt, ...) ((void)0)
+#define ELOG_INFO_EVERY_MS(ms, fmt, ...) ((void)0)
+#define ELOG_INFO_SAMPLE(p, fmt, ...) ((void)0)
+#endif
+
+/* DEBUG */
+#if ELOG_COMPILED_LEVEL >= ELOG_LEVEL_DEBUG
+#define ELOG_DEBUG_ONCE(fmt, ...)                                          \
+  ELOG_IMPL_ONCE(ELOG_LEVEL_DEBUG, ELOG_LEVEL_FMT_DEBUG, ELOG_COLOR_DEBUG, \
+                 fmt, ##__VA_ARGS__)
+#define ELOG_DEBUG_EVERY_N(n, fmt, ...)                                       \
+  ELOG_IMPL_EVERY_N(ELOG_LEVEL_DEBUG, ELOG_LEVEL_FMT_DEBUG, ELOG_COLOR_DEBUG, \
+                    n, fmt, ##__VA_ARGS__)
+#define ELOG_DEBUG_EVERY_MS(ms, fmt, ...)                                      \
+  ELOG_IMPL_EVERY_MS(ELOG_LEVEL_DEBUG, ELOG_LEVEL_FMT_DEBUG, ELOG_COLOR_DEBUG, \
+                     ms, fmt, ##__VA_ARGS__)
+#define ELOG_DEBUG_SAMPLE(p, fmt, ...)                                       \
+  ELOG_IMPL_SAMPLE(ELOG_LEVEL_DEBUG, ELOG_LEVEL_FMT_DEBUG, ELOG_COLOR_DEBUG, \
+                   p, fmt, ##__VA_ARGS__)
+#else
+#define ELOG_DEBUG_ONCE(fmt, ...) ((void)0)
+#define ELOG_DEBUG_EVERY_N(n, fmt, ...) ((void)0)
+#define ELOG_DEBUG_EVERY_MS(ms, fmt, ...) ((void)0)
+#define ELOG_DEBUG_SAMPLE(p, fmt, ...) ((void)0)
+#endif
+
+/* TRACE */
+#if ELOG_COMPILED_LEVEL >= ELOG_LEVEL_TRACE
+#define ELOG_TRACE_ONCE(fmt, ...)                                          \
+  ELOG_IMPL_ONCE(ELOG_LEVEL_TRACE, ELOG_LEVEL_FMT_TRACE, ELOG_COLOR_TRACE, \
+                 fmt, ##__VA_ARGS__)
+#define ELOG_TRACE_EVERY_N(n, fmt, ...)                                       \
+  ELOG_IMPL_EVERY_N(ELOG_LEVEL_TRACE, ELOG_LEVEL_FMT_TRACE, ELOG_COLOR_TRACE, \
+                    n, fmt, ##__VA_ARGS__)
+#define ELOG_TRACE_EVERY_MS(ms, fmt, ...)                                      \
+  ELOG_IMPL_EVERY_MS(ELOG_LEVEL_TRACE, ELOG_LEVEL_FMT_TRACE, ELOG_COLOR_TRACE, \
+                     ms, fmt, ##__VA_ARGS__)
+#define ELOG_TRACE_SAMPLE(p, fmt, ...)                                       \
+  ELOG_IMPL_SAMPLE(ELOG_LEVEL_TRACE, ELOG_LEVEL_FMT_TRACE, ELOG_COLOR_TRACE, \
+                   p, fmt, ##__VA_ARGS__)
+#else
+#define ELOG_TRACE_ONCE(fmt, ...) ((void)0)
+#define ELOG_TRACE_EVERY_N(n, fmt, ...) ((void)0)
+#define ELOG_TRACE_EVERY_MS(ms, fmt, ...) ((void)0)
+#define ELOG_TRACE_SAMPLE(p, fmt, ...) ((void)0)
+#endif
+#endif /* __GNUC__ || __clang__ */
+
+/* ============================================================
+ * 10. 構造化ログ（キーと値）
+ * ============================================================ */
+
+#if !ELOG_USE_BINARY
+/* フィールドの型 */
+#define ELOG_KV_TYPE_INT 1
+#define ELOG_KV_TYPE_UINT 2
+#define ELOG_KV_TYPE_FLOAT 3
+#define ELOG_KV_TYPE_BOOL 4
+#define ELOG_KV_TYPE_STR 5
+
+/**
+ * 構造化ログのフィールド1つ
+ * ELOG_KV_INT() などで作り、ELOG_*_KV の引数に並べる
+ */
+typedef struct elog_kv {
+  const char *key; /**< キー（静的な文字列） */
+  uint8_t type;    /**< ELOG_KV_TYPE_* */
+  union {
+    int64_t i;
+    uint64_t u;
+    double f;
+    const char *s; /**< NULL は null として出力 */
+  } v;
+} elog_kv_t;
+
+static inline elog_kv_t elog_kv_int(const char *key, int64_t v) {
+  elog_kv_t kv;
+  kv.key = key;
+  kv.type = ELOG_KV_TYPE_INT;
+  kv.v.i = v;
+  return kv;
+}
+
+static inline elog_kv_t elog_kv_uint(const char *key, uint64_t v) {
+  elog_kv_t kv;
+  kv.key = key;
+  kv.type = ELOG_KV_TYPE_UINT;
+  kv.v.u = v;
+  return kv;
+}
+
+static inline elog_kv_t elog_kv_float(const char *key, double v) {
+  elog_kv_t kv;
+  kv.key = key;
+  kv.type = ELOG_KV_TYPE_FLOAT;
+  kv.v.f = v;
+  return kv;
+}
+
+static inline elog_kv_t elog_kv_bool(const char *key, int v) {
+  elog_kv_t kv;
+  kv.key = key;
+  kv.type = ELOG_KV_TYPE_BOOL;
+  kv.v.u = v != 0;
+  return kv;
+}
+
+static inline elog_kv_t elog_kv_str(const char *key, const char *v) {
+  elog_kv_t kv;
+  kv.key = key;
+  kv.type = ELOG_KV_TYPE_STR;
+  kv.v.s = v;
+  return kv;
+}
+
+/* フィールドを作るマクロ */
+#define ELOG_KV_INT(key, v) elog_kv_int(key, (int64_t)(v))
+#define ELOG_KV_UINT(key, v) elog_kv_uint(key, (uint64_t)(v))
+#define ELOG_KV_FLOAT(key, v) elog_kv_float(key, (double)(v))
+#define ELOG_KV_BOOL(key, v) elog_kv_bool(key, (v) ? 1 : 0)
+#define ELOG_KV_STR(key, v) elog_kv_str(key, (v))
+
+/**
+ * エンコーダ: 1レコードを改行まで含めた1行に整形する
+ * cap を超えるフィールドは落とし、行の形（JSON の閉じ括弧・改行）は保つ
+ * @param dst     出力先
+ * @param cap     dst のバイト数
+ * @param cs      コールサイト記述子（cs->fmt がメッセージ）
+ * @param kv      フィールド
+ * @param n       フィールド数
+ * @param wall_ns 呼び出し時刻（UNIX 時刻の ns）。ELOG_USE_TIMESTAMP=0 では 0
+ * @return 書き込んだバイト数
+ */
+typedef size_t (*elog_kv_encoder_t)(char *dst, size_t cap,
+                                    const elog_callsite_t *cs,
+                                    const elog_kv_t *kv, size_t n,
+                                    uint64_t wall_ns);
+
+/** 組み込みのエンコーダ: [LEVEL] [file: line] msg key=value ... */
+size_t elog_kv_encode_text(char *dst, size_t cap, const elog_callsite_t *cs,
+                           const elog_kv_t *kv, size_t n, uint64_t wall_ns);
+
+/** 組み込みのエンコーダ: level=info file=x.c line=1 msg="..." key=value ... */
+size_t elog_kv_encode_logfmt(char *dst, size_t cap, const elog_callsite_t *cs,
+                             const elog_kv_t *kv, size_t n, uint64_t wall_ns);
+
+/** 組み込みのエンコーダ: {"level":"info",...,"msg":"...","key":value} */
+size_t elog_kv_encode_json(char *dst, size_t cap, const elog_callsite_t *cs,
+                           const elog_kv_t *kv, size_t n, uint64_t wall_ns);
+
+/**
+ * 構造化ログのエンコーダを設定する
+ * NULL で ELOG_KV_FORMAT の既定に戻す
+ */
+void elog_kv_set_encoder(elog_kv_encoder_t encoder);
+
+/**
+ * 構造化ログのレコードを出力する
+ * ELOG_*_KV から呼ばれる。直接呼び出す必要はない
+ */
+void elog_emit_kv(elog_callsite_t *cs, const elog_kv_t *kv, size_t n)
+    ELOG_COLD;
+
+/* 記述子の fmt にメッセージを置き、フィールドは有効な場合だけ作る */
+#define ELOG_IMPL_KV(level, msg, ...)                       \
+  do {                                                      \
+    ELOG_CALLSITE_DEFINE(level, msg);                       \
+    if (ELOG_CALLSITE_CHECK(level)) {                       \
+      const elog_kv_t elog_kv_[] = {__VA_ARGS__};           \
+      ELOG_FLIGHT_TRIGGER(level);                           \
+      elog_emit_kv(&elog_callsite_, elog_kv_,               \
+                   sizeof(elog_kv_) / sizeof(elog_kv_[0])); \
+    }                                                       \
+  } while (0)
+
+#if ELOG_COMPILED_LEVEL >= ELOG_LEVEL_CRITICAL
+#define ELOG_CRITICAL_KV(msg, ...) \
+  ELOG_IMPL_KV(ELOG_LEVEL_CRITICAL, msg, __VA_ARGS__)
+#else
+#define ELOG_CRITICAL_KV(msg, ...) ((void)0)
+#endif
+
+#if ELOG_COMPILED_LEVEL >= ELOG_LEVEL_ERROR
+#define ELOG_ERROR_KV(msg, ...) ELOG_IMPL_KV(ELOG_LEVEL_ERROR, msg, __VA_ARGS__)
+#else
+#define ELOG_ERROR_KV(msg, ...) ((void)0)
+#endif
+
+#if ELOG_COMPILED_LEVEL >= ELOG_LEVEL_WARN
+#define ELOG_WARN_KV(msg, ...) ELOG_IMPL_KV(ELOG_LEVEL_WARN, msg, __VA_ARGS__)
+#else
+#define ELOG_WARN_KV(msg, ...) ((void)0)
+#endif
+
+#if ELOG_COMPILED_LEVEL >= ELOG_LEVEL_INFO
+#define ELOG_INFO_KV(msg, ...) ELOG_IMPL_KV(ELOG_LEVEL_INFO, msg, __VA_ARGS__)
+#else
+#define ELOG_INFO_KV(msg, ...) ((void)0)
+#endif
+
+#if ELOG_COMPILED_LEVEL >= ELOG_LEVEL_DEBUG
+#define ELOG_DEBUG_KV(msg, ...) ELOG_IMPL_KV(ELOG_LEVEL_DEBUG, msg, __VA_ARGS__)
+#else
+#define ELOG_DEBUG_KV(msg, ...) ((void)0)
+#endif
+
+#if ELOG_COMPILED_LEVEL >= ELOG_LEVEL_TRACE
+#define ELOG_TRACE_KV(msg, ...) ELOG_IMPL_KV(ELOG_LEVEL_TRACE, msg, __VA_ARGS__)
+#else
+#define ELOG_TRACE_KV(msg, ...) ((void)0)
+#endif
+#endif /* !ELOG_USE_BINARY */
+
+/* ============================================================
+ * 11. シグナルハンドラ・割り込みからの出力
+ * ============================================================ */
+
+#if ELOG_USE_SIGSAFE
+/* 記述子は通常の ELOG_IMPL と同じ（実行時レベル・動的デバッグも効く） */
+#define ELOG_IMPL_SIGSAFE(level, fmt, ...)                    \
+  do {                                                        \
+    ELOG_CALLSITE_DEFINE(level, fmt);                         \
+    if (ELOG_CALLSITE_CHECK(level)) {                         \
+      elog_sigsafe_emit(&elog_callsite_, fmt, ##__VA_ARGS__); \
+    }                                                         \
+  } while (0)
+
+#if ELOG_COMPILED_LEVEL >= ELOG_LEVEL_CRITICAL
+#define ELOG_CRITICAL_SIGSAFE(fmt, ...) \
+  ELOG_IMPL_SIGSAFE(ELOG_LEVEL_CRITICAL, fmt, ##__VA_ARGS__)
+#else
+#define ELOG_CRITICAL_SIGSAFE(fmt, ...) ((void)0)
+#endif
+
+#if ELOG_COMPILED_LEVEL >= ELOG_LEVEL_ERROR
+#define ELOG_ERROR_SIGSAFE(fmt, ...) \
+  ELOG_IMPL_SIGSAFE(ELOG_LEVEL_ERROR, fmt, ##__VA_ARGS__)
+#else
+#define ELOG_ERROR_SIGSAFE(fmt, ...) ((void)0)
+#endif
+
+#if ELOG_COMPILED_LEVEL >= ELOG_LEVEL_WARN
+#define ELOG_WARN_SIGSAFE(fmt, ...) \
+  ELOG_IMPL_SIGSAFE(ELOG_LEVEL_WARN, fmt, ##__VA_ARGS__)
+#else
+#define ELOG_WARN_SIGSAFE(fmt, ...) ((void)0)
+#endif
+
+#if ELOG_COMPILED_LEVEL >= ELOG_LEVEL_INFO
+#define ELOG_INFO_SIGSAFE(fmt, ...) \
+  ELOG_IMPL_SIGSAFE(ELOG_LEVEL_INFO, fmt, ##__VA_ARGS__)
+#else
+#define ELOG_INFO_SIGSAFE(fmt, ...) ((void)0)
+#endif
+
+#if ELOG_COMPILED_LEVEL >= ELOG_LEVEL_DEBUG
+#define ELOG_DEBUG_SIGSAFE(fmt, ...) \
+  ELOG_IMPL_SIGSAFE(ELOG_LEVEL_DEBUG, fmt, ##__VA_ARGS__)
+#else
+#define ELOG_DEBUG_SIGSAFE(fmt, ...) ((void)0)
+#endif
+
+#if ELOG_COMPILED_LEVEL >= ELOG_LEVEL_TRACE
+#define ELOG_TRACE_SIGSAFE(fmt, ...) \
+  ELOG_IMPL_SIGSAFE(ELOG_LEVEL_TRACE, fmt, ##__VA_ARGS__)
+#else
+#define ELOG_TRACE_SIGSAFE(fmt, ...) ((void)0)
+#endif
+#endif /* ELOG_USE_SIGSAFE */
+
+/* ============================================================
+ * 12. スコープタイマー
+ * ============================================================ */
+
+#if ELOG_USE_SCOPE_TIMER && (defined(__GNUC__) || defined(__clang__))
+/** スレッドごとのヒストグラム（中身は elog_timer.c） */
+typedef struct elog_timer_hist elog_timer_hist_t;
+
+/**
+ * スコープタイマー1つ分の状態（ELOG_*_SCOPE_TIMER のコールサイトごとに1つ）
+ * 集計の行は cs の記述子で出力する
+ */
+typedef struct elog_timer {
+  elog_callsite_t *cs;      /**< 集計の行の記述子 */
+  elog_timer_hist_t *hists; /**< スレッドごとのヒストグラムのリスト */
+  struct elog_timer *next;  /**< 登録済みタイマーのリスト */
+  uint64_t next_report;     /**< 次に集計を出力する時刻（ns） */
+  uint32_t *last;           /**< 前回の集計時点のバケットの合計 */
+  uint8_t busy;             /**< 集計中 */
+} elog_timer_t;
+
+/** 計測中のスコープ（hist が NULL なら記録しない） */
+typedef struct {
+  elog_timer_hist_t *hist;
+  uint64_t start;
+} elog_timer_scope_t;
+
+/** スコープタイマーの時計（単調増加、ns） */
+uint64_t elog_timer_now(void);
+
+/**
+ * 呼び出しスレッドのヒストグラムを用意する（スレッド・タイマーごとに初回のみ）
+ * 終了したスレッドのものがあれば再利用する
+ * @return 確保できなかった場合 NULL
+ */
+elog_timer_hist_t *elog_timer_attach(elog_timer_t *t) ELOG_COLD;
+
+/**
+ * 所要時間（end - start）を記録する。間隔が過ぎていれば集計も出力する
+ * ELOG_*_SCOPE_TIMER から呼ばれる。直接呼び出す必要はない
+ */
+void elog_timer_record(elog_timer_hist_t *h, uint64_t start, uint64_t end);
+
+/**
+ * 全タイマーの未出力の集計をすぐに出力する
+ * プロセス終了時にも自動で呼ばれる
+ */
+void elog_timer_flush(void);
+
+/* スコープを抜けるときに呼ばれる（cleanup 属性） */
+static inline void elog_timer_scope_end(elog_timer_scope_t *s) {
+  if (s->hist != NULL) {
+    elog_timer_record(s->hist, s->start, elog_timer_now());
+  }
+}
+
+/* 集計の行（name は文字列リテラル） */
+#define ELOG_TIMER_FMT(name) \
+  "timer " name ": count=%llu p50=%lluns p99=%lluns max=%lluns"
+
+/*
+ * 宣言した位置からスコープの終わりまでを計測する
+ * レベル判定はスコープに入るときに行い、除外中は時計も読まない
+ */
+#define ELOG_IMPL_SCOPE_TIMER(level, name) \
+  ELOG_IMPL_SCOPE_TIMER_ID(level, name,    \
+                           ELOG_CONCAT(elog_timer_scope_, __COUNTER__))
+#define ELOG_IMPL_SCOPE_TIMER_ID(level, name, var)                          \
+  elog_timer_scope_t var __attribute__((cleanup(elog_timer_scope_end))) =   \
+      __extension__({                                                       \
+        ELOG_CALLSITE_DEFINE(level, ELOG_TIMER_FMT(name));                  \
+        static elog_timer_t elog_timer_ = {&elog_callsite_, 0, 0, 0, 0, 0}; \
+        static __thread elog_timer_hist_t *elog_timer_hist_;                \
+        elog_timer_scope_t elog_timer_s_ = {0, 0};                          \
+        if (ELOG_CALLSITE_CHECK(level)) {                                   \
+          if (__builtin_expect(elog_timer_hist_ == 0, 0)) {                 \
+            elog_timer_hist_ = elog_timer_attach(&elog_timer_);             \
+          }                                                                 \
+          elog_timer_s_.hist = elog_timer_hist_;                            \
+          elog_timer_s_.start = elog_timer_now();                           \
+        }                                                                   \
+        elog_timer_s_;                                                      \
+      })
+
+#if ELOG_COMPILED_LEVEL >= ELOG_LEVEL_CRITICAL
+#define ELOG_CRITICAL_SCOPE_TIMER(name) \
+  ELOG_IMPL_SCOPE_TIMER(ELOG_LEVEL_CRITICAL, name)
+#else
+#define ELOG_CRITICAL_SCOPE_TIMER(name) ((void)0)
+#endif
+
+#if ELOG_COMPILED_LEVEL >= ELOG_LEVEL_ERROR
+#define ELOG_ERROR_SCOPE_TIMER(name) ELOG_IMPL_SCOPE_TIMER(ELOG_LEVEL_ERROR, name)
+#else
+#define ELOG_ERROR_SCOPE_TIMER(name) ((void)0)
+#endif
+
+#if ELOG_COMPILED_LEVEL >= ELOG_LEVEL_WARN
+#define ELOG_WARN_SCOPE_TIMER(name) ELOG_IMPL_SCOPE_TIMER(ELOG_LEVEL_WARN, name)
+#else
+#define ELOG_WARN_SCOPE_TIMER(name) ((void)0)
+#endif
+
+#if ELOG_COMPILED_LEVEL >= ELOG_LEVEL_INFO
+#define ELOG_INFO_SCOPE_TIMER(name) ELOG_IMPL_SCOPE_TIMER(ELOG_LEVEL_INFO, name)
+#else
+#define ELOG_INFO_SCOPE_TIMER(name) ((void)0)
+#endif
+
+#if ELOG_COMPILED_LEVEL >= ELOG_LEVEL_DEBUG
+#define ELOG_DEBUG_SCOPE_TIMER(name) ELOG_IMPL_SCOPE_TIMER(ELOG_LEVEL_DEBUG, name)
+#else
+#define ELOG_DEBUG_SCOPE_TIMER(name) ((void)0)
+#endif
+
+#if ELOG_COMPILED_LEVEL >= ELOG_LEVEL_TRACE
+#define ELOG_TRACE_SCOPE_TIMER(name) ELOG_IMPL_SCOPE_TIMER(ELOG_LEVEL_TRACE, name)
+#else
+#define ELOG_TRACE_SCOPE_TIMER(name) ((void)0)
+#endif
+
+/* レベルを指定しない場合は DEBUG */
+#define ELOG_SCOPE_TIMER(name) ELOG_DEBUG_SCOPE_TIMER(name)
+#endif /* ELOG_USE_SCOPE_TIMER && (__GNUC__ || __clang__) */
+
+/* ============================================================
+ * 13. トレースイベント
+ * ============================================================ */
+
+#if ELOG_USE_TRACE_EVENTS
+/* イベントの種類（Chrome のトレースイベントの "ph"） */
+#define ELOG_TRACE_BEGIN 'B'
+#define ELOG_TRACE_END 'E'
+#define ELOG_TRACE_INSTANT 'i'
+#define ELOG_TRACE_COUNTER 'C'
+
+/** 記録中なら 1（elog_trace_open() から elog_trace_close() まで） */
+extern volatile uint8_t elog_trace_active;
+
+/**
+ * トレースの記録を始める（記録中なら先に閉じる）
+ * path へ JSON を書き出すスレッドを起動し、プロセス終了時には自動で閉じる
+ * @return 成功時 0、ファイルを開けないかスレッドを起動できない場合 -1
+ */
+int elog_trace_open(const char *path);
+
+/**
+ * トレースの記録を終える
+ * 残りのイベントを書き出し、JSON を閉じる（記録中でなければ何もしない）
+ */
+void elog_trace_close(void);
+
+/**
+ * イベントを呼び出しスレッドのリングに記録する（満杯なら捨てて数える）
+ * ELOG_SPAN_BEGIN などから呼ばれる。直接呼び出す必要はない
+ * @param cs    記述子（cs->fmt がイベント名）
+ * @param phase ELOG_TRACE_*
+ * @param value ELOG_TRACE_COUNTER の値（それ以外は 0）
+ */
+void elog_trace_record(elog_callsite_t *cs, char phase, int64_t value);
+
+/* 記述子は ELOG_TRACE と同じレベル判定・動的デバッグに従う */
+#define ELOG_IMPL_TRACE_EVENT(phase, name, value)                  \
+  do {                                                             \
+    ELOG_CALLSITE_DEFINE(ELOG_LEVEL_TRACE, name);                  \
+    if (ELOG_CALLSITE_CHECK(ELOG_LEVEL_TRACE) &&                   \
+        __builtin_expect(elog_trace_active, 0)) {                  \
+      elog_trace_record(&elog_callsite_, phase, (int64_t)(value)); \
+    }                                                              \
+  } while (0)
+
+/* name は文字列リテラル。BEGIN と END は同じスレッドで対にする */
+#if ELOG_COMPILED_LEVEL >= ELOG_LEVEL_TRACE
+#define ELOG_SPAN_BEGIN(name) ELOG_IMPL_TRACE_EVENT(ELOG_TRACE_BEGIN, name, 0)
+#define ELOG_SPAN_END(name) ELOG_IMPL_TRACE_EVENT(ELOG_TRACE_END, name, 0)
+#define ELOG_INSTANT(name) ELOG_IMPL_TRACE_EVENT(ELOG_TRACE_INSTANT, name, 0)
+#define ELOG_COUNTER(name, value) \
+  ELOG_IMPL_TRACE_EVENT(ELOG_TRACE_COUNTER, name, value)
+#else
+#define ELOG_SPAN_BEGIN(name) ((void)0)
+#define ELOG_SPAN_END(name) ((void)0)
+#define ELOG_INSTANT(name) ((void)0)
+#define ELOG_COUNTER(name, value) ((void)0)
+#endif
+#endif /* ELOG_USE_TRACE_EVENTS */
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,522 @@
+/**
+ * @file elog.hpp
+ * @brief elog - C++17 向けの型安全なフロントエンド
+ *
+ * ELOGPP_* マクロはフォーマット文字列（printf 形式）をコンパイル時に解析し、
+ * 引数の数や型が変換指定と合わない呼び出しをコンパイルエラーにする。
+ * 引数はコールサイトごとに生成されるエンコーダでバイト列に詰め、
+ * elog_emit_args() でバックエンドへ渡す。実行時にフォーマット文字列を
+ * 走査することはなく、文字列化は出力側（またはデコーダ）で行う。
+ *
+ * ELOG_COMPILED_LEVEL で除外されるレベルは C のマクロと同じく ((void)0) に
+ * 展開され、引数も評価されない。実行時レベル・モジュール・動的デバッグ・
+ * ジャンプラベルの判定も ELOG_IMPL と共通。
+ *
+ * C のマクロとの違い:
+ * - %s に std::string / std::string_view も渡せる（長さはそのまま使う）
+ * - 整数は変換指定の型より大きくなければ符号・種類を問わない
+ * - %n, %ls, %lc と、L 修飾の整数・文字・文字列の変換は使えない
+ * - ELOG_USE_STATIC_PREFIX=1 でも行頭は実行時に組み立てる
+ */
+
+#ifndef ELOG_HPP
+#define ELOG_HPP
+
+#if __cplusplus < 201703L
+#error "elog.hpp requires C++17"
+#endif
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+#include "elog/elog.h"
+
+/**
+ * 1つの呼び出しに渡せる引数（'*' の幅・精度を含む）の最大数
+ */
+#ifndef ELOGPP_MAX_ARGS
+#define ELOGPP_MAX_ARGS 32
+#endif
+
+namespace elog {
+namespace detail {
+
+/* ============================================================
+ * 1. フォーマット文字列の解析（コンパイル時）
+ * ============================================================ */
+
+/* 1つの引数として受け付ける型の分類 */
+enum class arg_kind : uint8_t {
+  sint,  /* %d %i */
+  uint,  /* %u %o %x %X */
+  chr,   /* %c */
+  ptr,   /* %p */
+  dbl,   /* %f %e %g %a（大文字も） */
+  str,   /* %s */
+  width, /* 幅の '*' */
+  prec   /* 精度の '*' */
+};
+
+/* 精度が '*' で、直前の引数で与えられる */
+constexpr int prec_from_arg = -2;
+
+struct arg_spec {
+  arg_kind kind;
+  uint8_t size;  /* 整数の変換指定が受け取る型のバイト数 */
+  int precision; /* %s の精度（-1 はなし） */
+};
+
+struct format_info {
+  arg_spec args[ELOGPP_MAX_ARGS];
+  std::size_t count;
+  bool ok;
+};
+
+constexpr bool is_digit(char c) { return c >= '0' && c <= '9'; }
+
+constexpr bool push_arg(format_info &info, arg_kind kind, uint8_t size,
+                        int precision) {
+  if (info.count == ELOGPP_MAX_ARGS) {
+    return false;
+  }
+  info.args[info.count++] = arg_spec{kind, size, precision};
+  return true;
+}
+
+/* 長さ修飾子を読み、整数の変換指定が受け取る型のバイト数を返す */
+constexpr uint8_t parse_length(const char *&f, bool &wide) {
+  wide = false;
+  switch (*f) {
+    case 'h':
+      f += f[1] == 'h' ? 2 : 1;
+      return sizeof(int); /* 実引数は int に昇格される */
+    case 'l':
+      if (f[1] == 'l') {
+        f += 2;
+        return sizeof(long long);
+      }
+      f++;
+      wide = true;
+      return sizeof(long);
+    case 'j':
+      f++;
+      return sizeof(intmax_t);
+    case 'z':
+      f++;
+      return sizeof(std::size_t);
+    case 't':
+      f++;
+      return sizeof(std::ptrdiff_t);
+    case 'L':
+      f++;
+      return sizeof(long double);
+    default:
+      return sizeof(int);
+  }
+}
+
+constexpr format_info parse_format(const char *f) {
+  format_info info{};
+
+  info.ok = true;
+  while (*f != '\0') {
+    int precision = -1;
+    uint8_t size = 0;
+    bool wide = false;
+    bool big_l = false; /* L は浮動小数点の変換にだけ付けられる */
+
+    if (*f++ != '%') {
+      continue;
+    }
+    while (*f == '-' || *f == '+' || *f == ' ' || *f == '#' || *f == '0') {
+      f++;
+    }
+    if (*f == '*') {
+      f++;
+      info.ok = info.ok && push_arg(info, arg_kind::width, sizeof(int), -1);
+    } else {
+      while (is_digit(*f)) {
+        f++;
+      }
+    }
+    if (*f == '.') {
+      f++;
+      precision = 0;
+      if (*f == '*') {
+        f++;
+        precision = prec_from_arg;
+        info.ok = info.ok && push_arg(info, arg_kind::prec, sizeof(int), -1);
+      } else {
+        while (is_digit(*f)) {
+          precision = precision * 10 + (*f++ - '0');
+        }
+      }
+    }
+    big_l = *f == 'L';
+    size = parse_length(f, wide);
+
+    switch (*f++) {
+      case 'd':
+      case 'i':
+        info.ok = info.ok && !big_l &&
+                  push_arg(info, arg_kind::sint, size, -1);
+        break;
+      case 'u':
+      case 'o':
+      case 'x':
+      case 'X':
+        info.ok = info.ok && !big_l &&
+                  push_arg(info, arg_kind::uint, size, -1);
+        break;
+      case 'c':
+        info.ok = info.ok && !wide && !big_l &&
+                  push_arg(info, arg_kind::chr, sizeof(int), -1);
+        break;
+      case 's':
+        info.ok = info.ok && !wide && !big_l &&
+                  push_arg(info, arg_kind::str, 0, precision);
+        break;
+      case 'p':
+        info.ok = info.ok && !big_l && push_arg(info, arg_kind::ptr, 0, -1);
+        break;
+      case 'f':
+      case 'F':
+      case 'e':
+      case 'E':
+      case 'g':
+      case 'G':
+      case 'a':
+      case 'A':
+        info.ok = info.ok && push_arg(info, arg_kind::dbl, 0, -1);
+        break;
+      case '%':
+        break;
+      default: /* %n、未知の変換文字、途中で終わった指定 */
+        info.ok = false;
+        return info;
+    }
+  }
+  return info;
+}
+
+/* フォーマット型（ELOGPP_IMPL が定義する）ごとの解析結果 */
+template <typename Fmt>
+inline constexpr format_info format_v = parse_format(Fmt::str());
+
+/* ============================================================
+ * 2. 引数の型の照合
+ * ============================================================ */
+
+template <typename T>
+using arg_t = std::decay_t<T>;
+
+template <typename T>
+constexpr bool is_cstring_v = std::is_same_v<arg_t<T>, const char *> ||
+                              std::is_same_v<arg_t<T>, char *>;
+
+template <typename T>
+constexpr bool is_string_v = is_cstring_v<T> ||
+                             std::is_same_v<arg_t<T>, std::string_view> ||
+                             std::is_same_v<arg_t<T>, std::string>;
+
+template <typename T>
+constexpr bool is_integer_v =
+    std::is_integral_v<arg_t<T>> || std::is_enum_v<arg_t<T>>;
+
+template <typename T>
+constexpr bool accepts(const arg_spec &spec) {
+  switch (spec.kind) {
+    case arg_kind::sint:
+    case arg_kind::uint:
+    case arg_kind::chr:
+    case arg_kind::width:
+    case arg_kind::prec:
+      return is_integer_v<T> && sizeof(arg_t<T>) <= spec.size;
+    case arg_kind::dbl:
+      return std::is_floating_point_v<arg_t<T>>;
+    case arg_kind::str:
+      return is_string_v<T>;
+    case arg_kind::ptr:
+      return std::is_pointer_v<arg_t<T>> || std::is_null_pointer_v<arg_t<T>>;
+  }
+  return false;
+}
+
+/* ============================================================
+ * 3. エンコード（elog_args_encode と同じ形式）
+ * ============================================================ */
+
+/* varint 1つの最大バイト数 */
+constexpr std::size_t varint_max = 10;
+
+struct writer {
+  uint8_t *p;
+  uint8_t *end;
+  int precision; /* 直前の '*' で与えられた精度 */
+};
+
+inline uint8_t *put_varint(uint8_t *p, uint64_t v) {
+  while (v >= 0x80) {
+    *p++ = static_cast<uint8_t>(v | 0x80);
+    v >>= 7;
+  }
+  *p++ = static_cast<uint8_t>(v);
+  return p;
+}
+
+inline uint8_t *put_svarint(uint8_t *p, int64_t v) {
+  return put_varint(p, (static_cast<uint64_t>(v) << 1) ^
+                           static_cast<uint64_t>(v >> 63));
+}
+
+/* 整数を変換指定の型（size バイト）へ揃える（printf が受け取る値と同じ） */
+template <std::size_t Size>
+struct sized_int;
+template <>
+struct sized_int<4> {
+  using s = int32_t;
+  using u = uint32_t;
+};
+template <>
+struct sized_int<8> {
+  using s = int64_t;
+  using u = uint64_t;
+};
+
+template <typename T>
+constexpr auto integer_value(const T &v) {
+  if constexpr (std::is_enum_v<T>) {
+    return static_cast<std::underlying_type_t<T>>(v);
+  } else {
+    return v;
+  }
+}
+
+/* 長さ + 1（0 は NULL）に続けて本体。入りきらない分は切り捨てる */
+inline bool put_string(writer &w, const char *s, std::size_t n,
+                       int precision) {
+  std::size_t room = static_cast<std::size_t>(w.end - w.p);
+
+  if (s == nullptr) {
+    if (room < 1) {
+      return false;
+    }
+    *w.p++ = 0;
+    return true;
+  }
+  if (precision >= 0 && static_cast<std::size_t>(precision) < n) {
+    n = static_cast<std::size_t>(precision);
+  }
+  if (room < varint_max + 1) {
+    return false;
+  }
+  if (n > room - varint_max) {
+    n = room - varint_max;
+  }
+  w.p = put_varint(w.p, static_cast<uint64_t>(n) + 1);
+  std::memcpy(w.p, s, n);
+  w.p += n;
+  return true;
+}
+
+/* I 番目の引数を詰める。入りきらなければ false */
+template <typename Fmt, std::size_t I, typename T>
+inline bool put(writer &w, const T &arg) {
+  constexpr arg_spec spec = format_v<Fmt>.args[I];
+  static_assert(accepts<T>(spec),
+                "elog: argument type does not match the format string");
+
+  if constexpr (!accepts<T>(spec)) {
+    return false; /* エラーは static_assert だけにする */
+  } else if constexpr (spec.kind == arg_kind::str) {
+    int precision =
+        spec.precision == prec_from_arg ? w.precision : spec.precision;
+
+    if constexpr (is_cstring_v<T>) {
+      const char *s = arg;
+      std::size_t n = 0;
+
+      /* 精度があれば NUL で終わらないバッファも読めるよう、その先は見ない */
+      if (s != nullptr) {
+        n = precision >= 0 ? strnlen(s, static_cast<std::size_t>(precision))
+                           : std::strlen(s);
+      }
+      return put_string(w, s, n, precision);
+    } else {
+      return put_string(w, arg.data(), arg.size(), precision);
+    }
+  } else if constexpr (spec.kind == arg_kind::dbl) {
+    double d = static_cast<double>(arg);
+
+    if (static_cast<std::size_t>(w.end - w.p) < sizeof(d)) {
+      return false;
+    }
+    std::memcpy(w.p, &d, sizeof(d));
+    w.p += sizeof(d);
+    return true;
+  } else {
+    if (static_cast<std::size_t>(w.end - w.p) < varint_max) {
+      return false;
+    }
+    if constexpr (std::is_null_pointer_v<arg_t<T>>) {
+      w.p = put_varint(w.p, 0);
+    } else if constexpr (spec.kind == arg_kind::ptr) {
+      arg_t<T> ptr = arg;
+      w.p = put_varint(w.p, reinterpret_cast<uintptr_t>(ptr));
+    } else if constexpr (spec.kind == arg_kind::uint) {
+      using U = typename sized_int<spec.size>::u;
+      w.p = put_varint(w.p, static_cast<U>(integer_value(arg)));
+    } else if constexpr (spec.kind == arg_kind::chr) {
+      w.p = put_varint(w.p, static_cast<uint64_t>(
+                                static_cast<int>(integer_value(arg))));
+    } else {
+      using S = typename sized_int<spec.size>::s;
+      int64_t v = static_cast<S>(integer_value(arg));
+
+      if constexpr (spec.kind == arg_kind::prec) {
+        w.precision = static_cast<int>(v);
+      }
+      w.p = put_svarint(w.p, v);
+    }
+    return true;
+  }
+}
+
+/* 入りきらなかった引数以降は出力側で "?" になる */
+template <typename Fmt, std::size_t... I, typename... Args>
+inline std::size_t encode(uint8_t *dst, std::size_t cap,
+                          std::index_sequence<I...>, const Args &...args) {
+  writer w{dst, dst + cap, -1};
+  uint8_t *done = dst;
+
+  (void)w; /* 引数がない呼び出しでは使われない */
+  (void)((put<Fmt, I>(w, args) && (done = w.p, true)) && ...);
+  return static_cast<std::size_t>(done - dst);
+}
+
+/* ============================================================
+ * 4. バックエンドへの受け渡し
+ * ============================================================ */
+
+/* 引数をエンコードして out（elog_emit_args など）へ渡す */
+template <typename Fmt, typename... Args>
+inline void emit_to(void (*out)(elog_callsite_t *, const uint8_t *, size_t),
+                    elog_callsite_t *cs, const Args &...args) {
+  constexpr format_info info = format_v<Fmt>;
+  static_assert(info.ok,
+                "elog: invalid or unsupported conversion in the format string "
+                "(%n, %ls, %lc and L with %d/%u/%x/%c/%s/%p are not "
+                "supported)");
+  static_assert(!info.ok || info.count == sizeof...(Args),
+                "elog: number of arguments does not match the format string");
+
+  if constexpr (info.ok && info.count == sizeof...(Args)) {
+    uint8_t buf[ELOG_ARGS_MAX];
+
+    out(cs, buf,
+        encode<Fmt>(buf, sizeof(buf), std::index_sequence_for<Args...>{},
+                    args...));
+  }
+}
+
+template <typename Fmt, typename... Args>
+inline void emit(elog_callsite_t *cs, const Args &...args) {
+  emit_to<Fmt>(elog_emit_args, cs, args...);
+}
+
+#if ELOG_USE_FLIGHT_RECORDER
+/* 除外されたレコードをフライトレコーダへ記録する */
+template <typename Fmt, typename... Args>
+inline void record(elog_callsite_t *cs, const Args &...args) {
+  emit_to<Fmt>(elog_flight_record_args, cs, args...);
+}
+#endif
+
+}  // namespace detail
+}  // namespace elog
+
+/* ============================================================
+ * 5. ログマクロ
+ * ============================================================ */
+
+/*
+ * フォーマット文字列はコンパイル時定数として型に持たせる
+ * （C++17 では文字列リテラルを直接テンプレート引数にできないため）
+ */
+#if ELOG_USE_FLIGHT_RECORDER
+/* 除外されたレコードはリングへ、エラーの前にはリングを出力（ELOG_IMPL と同じ） */
+#define ELOGPP_IMPL(level, fmt, ...)                                       \
+  do {                                                                     \
+    struct elogpp_fmt_ {                                                   \
+      static constexpr const char *str() { return fmt; }                   \
+    };                                                                     \
+    ELOG_CALLSITE_DEFINE(level, fmt);                                      \
+    if (ELOG_CALLSITE_CHECK(level)) {                                      \
+      ELOG_FLIGHT_TRIGGER(level);                                          \
+      ::elog::detail::emit<elogpp_fmt_>(&elog_callsite_, ##__VA_ARGS__);   \
+    } else if (ELOG_FLIGHT_CHECK(level)) {                                 \
+      ::elog::detail::record<elogpp_fmt_>(&elog_callsite_, ##__VA_ARGS__); \
+    }                                                                      \
+  } while (0)
+#else
+#define ELOGPP_IMPL(level, fmt, ...)                                     \
+  do {                                                                   \
+    struct elogpp_fmt_ {                                                 \
+      static constexpr const char *str() { return fmt; }                 \
+    };                                                                   \
+    ELOG_CALLSITE_DEFINE(level, fmt);                                    \
+    if (ELOG_CALLSITE_CHECK(level)) {                                    \
+      ::elog::detail::emit<elogpp_fmt_>(&elog_callsite_, ##__VA_ARGS__); \
+    }                                                                    \
+  } while (0)
+#endif
+
+/* CRITICAL */
+#if ELOG_COMPILED_LEVEL >= ELOG_LEVEL_CRITICAL
+#define ELOGPP_CRITICAL(fmt, ...) \
+  ELOGPP_IMPL(ELOG_LEVEL_CRITICAL, fmt, ##__VA_ARGS__)
+#else
+#define ELOGPP_CRITICAL(fmt, ...) ((void)0)
+#endif
+
+/* ERROR */
+#if ELOG_COMPILED_LEVEL >= ELOG_LEVEL_ERROR
+#define ELOGPP_ERROR(fmt, ...) ELOGPP_IMPL(ELOG_LEVEL_ERROR, fmt, ##__VA_ARGS__)
+#else
+#define ELOGPP_ERROR(fmt, ...) ((void)0)
+#endif
+
+/* WARN */
+#if ELOG_COMPILED_LEVEL >= ELOG_LEVEL_WARN
+#define ELOGPP_WARN(fmt, ...) ELOGPP_IMPL(ELOG_LEVEL_WARN, fmt, ##__VA_ARGS__)
+#else
+#define ELOGPP_WARN(fmt, ...) ((void)0)
+#endif
+
+/* INFO */
+#if ELOG_COMPILED_LEVEL >= ELOG_LEVEL_INFO
+#define ELOGPP_INFO(fmt, ...) ELOGPP_IMPL(ELOG_LEVEL_INFO, fmt, ##__VA_ARGS__)
+#else
+#define ELOGPP_INFO(fmt, ...) ((void)0)
+#endif
+
+/* DEBUG */
+#if ELOG_COMPILED_LEVEL >= ELOG_LEVEL_DEBUG
+#define ELOGPP_DEBUG(fmt, ...) ELOGPP_IMPL(ELOG_LEVEL_DEBUG, fmt, ##__VA_ARGS__)
+#else
+#define ELOGPP_DEBUG(fmt, ...) ((void)0)
+#endif
+
+/* TRACE */
+#if ELOG_COMPILED_LEVEL >= ELOG_LEVEL_TRACE
+#define ELOGPP_TRACE(fmt, ...) ELOGPP_IMPL(ELOG_LEVEL_TRACE, fmt, ##__VA_ARGS__)
+#else
+#define ELOGPP_TRACE(fmt, ...) ((void)0)
+#endif
+
+#endif /* ELOG_HPP */
@@ -0,0 +1,51 @@
+/**
+ * @file elog_decode.h
+ * @brief elog - バイナリログのデコーダ
+ *
+ * ELOG_USE_BINARY=1 で出力されたストリームをテキストへ復元する。
+ * ホスト側ツールから使うことを想定している。
+ */
+
+#ifndef ELOG_DECODE_H
+#define ELOG_DECODE_H
+
+#include <stddef.h>
+#include <stdio.h>
+
+#include "elog/elog.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * デコードオプション
+ */
+typedef enum {
+  ELOG_DECODE_TIMESTAMP = 1 << 0 /**< 各行の先頭に記録時刻を付ける */
+} elog_decode_flags_t;
+
+/**
+ * バイナリストリームを読み込み、テキスト行として出力する
+ * @param in    バイナリストリーム
+ * @param out   テキスト出力先
+ * @param flags elog_decode_flags_t の論理和
+ * @return 成功時 0、ストリームが不正な場合 -1
+ */
+int elog_binary_decode(FILE *in, FILE *out, unsigned flags);
+
+/**
+ * コールサイト表を与えてデコードする
+ * ストリームに定義レコードがない場合（ELOG_BINARY_EMBED_CALLSITES=0）に使う。
+ * sites[id - 1] が ID id の記述子。ストリーム内の定義レコードは表より優先される
+ * @param sites  コールサイト表（fmt が NULL の要素は未定義扱い）
+ * @param nsites 表の要素数
+ */
+int elog_binary_decode_with(FILE *in, FILE *out, unsigned flags,
+                            const elog_callsite_t *sites, size_t nsites);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ELOG_DECODE_H */
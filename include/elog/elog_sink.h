@@ -0,0 +1,131 @@
+/**
+ * @file elog_sink.h
+ * @brief elog - 出力先（シンク）
+ *
+ * ELOG_USE_SINK / ELOG_USE_ASYNC / ELOG_USE_BINARY のいずれかが有効な場合、
+ * 整形済みの出力はここに登録されたシンクへ渡される。
+ * 初期状態では標準出力シンクだけが登録されている。
+ *
+ * シンクはライブラリが保持し続けるため、静的な領域に置くこと。
+ * バイナリ出力ではストリームヘッダーとコールサイト定義が一度しか
+ * 書かれないので、シンクは最初のログ呼び出しより前に登録すること。
+ */
+
+#ifndef ELOG_SINK_H
+#define ELOG_SINK_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "elog/elog.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * シンク
+ * 独自のシンクは、この構造体を先頭メンバに持つ構造体として定義する
+ */
+typedef struct elog_sink {
+  /**
+   * 整形済みデータを書き込む
+   * 非同期バックエンドでは複数行がまとめて渡される。
+   * 呼び出しはライブラリ内で直列化される
+   */
+  void (*write)(struct elog_sink *sink, const void *data, size_t len);
+  /** 溜めているデータを出力する（NULL 可） */
+  void (*flush)(struct elog_sink *sink);
+  /** elog_sink_remove() 時に呼ばれる（NULL 可） */
+  void (*close)(struct elog_sink *sink);
+  /** ライブラリが使用する */
+  struct elog_sink *next;
+} elog_sink_t;
+
+/**
+ * ファイルディスクリプタへ書き込むシンク
+ * buf を与えると cap バイト溜まるか flush されるまで write(2) を遅らせる
+ */
+typedef struct {
+  elog_sink_t sink;
+  int fd;
+  int owns_fd; /**< close で fd を閉じるか */
+  char *buf;
+  size_t cap;
+  size_t len;
+} elog_fd_sink_t;
+
+/**
+ * 共有メモリのリングへ書き込むシンク
+ * mmap したファイルへレコードを書き、古いものから上書きする。
+ * 書き込みにシステムコールを使わず、プロセスが異常終了しても
+ * コミット済みのレコードは elog-recover で取り出せる
+ */
+typedef struct {
+  elog_sink_t sink;
+  void *map;       /**< マップしたファイル全体 */
+  size_t map_size; /**< map のバイト数 */
+  uint8_t *data;   /**< データ領域 */
+  uint64_t size;   /**< データ領域のバイト数 */
+  uint64_t head;   /**< 次に書く位置 */
+  uint64_t seq;    /**< 最後に書いたレコードの通し番号 */
+} elog_shm_sink_t;
+
+/**
+ * シンクを登録する（登録済みのシンクには何もしない）
+ */
+void elog_sink_add(elog_sink_t *sink);
+
+/**
+ * シンクの登録を解除する。残りを flush した後で close を呼ぶ
+ */
+void elog_sink_remove(elog_sink_t *sink);
+
+/**
+ * 登録されたすべてのシンクを flush する
+ */
+void elog_sink_flush(void);
+
+/**
+ * 組み込みの標準出力シンク（stdio 経由、初期状態で登録済み）
+ */
+elog_sink_t *elog_sink_stdout(void);
+
+/**
+ * 組み込みの標準エラー出力シンク（stdio 経由）
+ */
+elog_sink_t *elog_sink_stderr(void);
+
+/**
+ * fd シンクを初期化する
+ * @param s   シンク
+ * @param fd  書き込み先（close では閉じない）
+ * @param buf バッファ（NULL の場合は書き込みごとに write(2)）
+ * @param cap バッファのバイト数
+ */
+void elog_fd_sink_init(elog_fd_sink_t *s, int fd, char *buf, size_t cap);
+
+/**
+ * ファイルを追記モードで開き、fd シンクとして初期化する
+ * close でファイルを閉じる
+ * @return 成功時 0、開けなかった場合 -1
+ */
+int elog_file_sink_open(elog_fd_sink_t *s, const char *path, char *buf,
+                        size_t cap);
+
+/**
+ * ファイルを共有メモリのリングとして開き、シンクとして初期化する
+ * 同じ大きさのリングが既にあれば、その続きに書く（それ以外は作り直す）。
+ * close でマップを解除する（ファイルは残す）
+ * @param s    シンク
+ * @param path ファイル（/dev/shm 以下、またはディスク上）
+ * @param size データ領域のバイト数（4096 以上。1レコードは 1/4 まで）
+ * @return 成功時 0、開けなかった場合 -1
+ */
+int elog_shm_sink_open(elog_shm_sink_t *s, const char *path, size_t size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ELOG_SINK_H */
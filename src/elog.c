@@ -5,6 +5,16 @@
 
 #include "elog/elog.h"
 
+#include <stdarg.h>
+#include <string.h>
+
+#if ELOG_USE_ATOMIC_LINE
+#include <errno.h>
+#include <unistd.h>
+#endif
+
+#include "elog_internal.h"
+
 #if ELOG_USE_RUNTIME_LEVEL
 /**
  * 実行時ログレベル変数の実態
@@ -12,3 +22,173 @@
  */
 volatile uint8_t elog_runtime_level = ELOG_COMPILED_LEVEL;
 #endif
+
+#if ELOG_USE_CALLSITE_SECTION
+/*
+ * elog_meta セクションの先頭・終端（リンカが自動定義）
+ * 記述子が1つもない場合はセクション自体が存在しないため weak 参照にする
+ */
+extern elog_callsite_t __start_elog_meta[] __attribute__((weak));
+extern elog_callsite_t __stop_elog_meta[] __attribute__((weak));
+
+size_t elog_callsite_count(void) {
+  if (__start_elog_meta == NULL) {
+    return 0;
+  }
+  return (size_t)(__stop_elog_meta - __start_elog_meta);
+}
+
+elog_callsite_t *elog_callsite_at(size_t index) {
+  if (index >= elog_callsite_count()) {
+    return NULL;
+  }
+  return &__start_elog_meta[index];
+}
+
+size_t elog_callsite_index(const elog_callsite_t *cs) {
+  return (size_t)(cs - __start_elog_meta);
+}
+#endif
+
+/* モジュール */
+
+#if ELOG_USE_CALLSITE_SECTION
+/* elog_modules セクションの先頭・終端（リンカが自動定義） */
+extern elog_module_t __start_elog_modules[] __attribute__((weak));
+extern elog_module_t __stop_elog_modules[] __attribute__((weak));
+
+void elog_module_register(elog_module_t *module) {
+  /* セクションから列挙できるため登録は不要 */
+  (void)module;
+}
+
+elog_module_t *elog_module_next(const elog_module_t *prev) {
+  const elog_module_t *m = prev != NULL ? prev + 1 : __start_elog_modules;
+
+  if (m == NULL || m >= __stop_elog_modules) {
+    return NULL;
+  }
+  return (elog_module_t *)m;
+}
+#else
+static elog_module_t *elog_modules_head;
+
+void elog_module_register(elog_module_t *module) {
+  elog_module_t *m;
+
+  for (m = elog_modules_head; m != NULL; m = m->next) {
+    if (m == module) {
+      return;
+    }
+  }
+  module->next = elog_modules_head;
+  elog_modules_head = module;
+}
+
+elog_module_t *elog_module_next(const elog_module_t *prev) {
+  return prev != NULL ? prev->next : elog_modules_head;
+}
+#endif
+
+elog_module_t *elog_module_find(const char *name) {
+  elog_module_t *m;
+
+  for (m = elog_module_next(NULL); m != NULL; m = elog_module_next(m)) {
+    if (strcmp(m->name, name) == 0) {
+      return m;
+    }
+  }
+  return NULL;
+}
+
+int elog_set_module_level(const char *name, uint8_t level) {
+  elog_module_t *m = elog_module_find(name);
+
+  if (m == NULL) {
+    return -1;
+  }
+  m->level = level;
+  return 0;
+}
+
+/* printf 出力のコールド経路・エンコード済み引数の出力（シンクを使わない構成） */
+
+#if !ELOG_SINK_ENABLED
+#if ELOG_USE_ATOMIC_LINE && !ELOG_USE_TINY_PRINTF
+/* 1行分の整形バッファ（スタックを使わないようスレッドごとに持つ） */
+static __thread char elog_print_buf[ELOG_LINE_MAX];
+#endif
+
+void elog_print_line(const char *data, size_t len) {
+#if ELOG_USE_TINY_PRINTF
+  /* elog_tiny_printf と同じ出力先へ書く */
+  elog_tiny_write(data, len);
+#elif ELOG_USE_ATOMIC_LINE
+  /* stdio を通さず1回で書く（部分書き込み・シグナル割り込みのときだけ続きを書く） */
+  while (len > 0) {
+    ssize_t n = write(STDOUT_FILENO, data, len);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return;
+    }
+    data += n;
+    len -= (size_t)n;
+  }
+#else
+  /* ELOG_IMPL の printf 出力と同じ形の行を stdout へ書く */
+  fwrite(data, 1, len, stdout);
+#endif
+}
+
+void elog_print(elog_callsite_t *cs, ...) {
+  va_list ap;
+
+  va_start(ap, cs);
+#if ELOG_USE_TINY_PRINTF
+  elog_tiny_vprint(cs, ap);
+#elif ELOG_USE_ATOMIC_LINE
+  elog_print_line(elog_print_buf,
+                  elog_line_vformat(elog_print_buf, sizeof(elog_print_buf), cs,
+                                    cs->fmt, ap));
+#else
+  {
+    char prefix[ELOG_LINE_MAX];
+    size_t n = elog_line_prefix(prefix, sizeof(prefix), cs);
+
+    /* 3回に分けて書くため、1行が他のスレッドの出力と混ざらないようにする */
+    flockfile(stdout);
+    fwrite(prefix, 1, n, stdout);
+    vprintf(cs->fmt, ap);
+    fputs(ELOG_COLOR_END "\n", stdout);
+    funlockfile(stdout);
+  }
+#endif
+  va_end(ap);
+}
+
+void elog_emit_args_at(elog_callsite_t *cs, uint64_t ts, const uint8_t *args,
+                       size_t len) {
+  char line[ELOG_LINE_MAX];
+
+  /* タイムスタンプはシンク経由の出力でのみ付く */
+  (void)ts;
+  elog_print_line(line, elog_line_format(line, sizeof(line), cs, args, len));
+}
+
+void elog_emit_args(elog_callsite_t *cs, const uint8_t *args, size_t len) {
+  elog_emit_args_at(cs, 0, args, len);
+}
+#endif
+
+void elog_emit_report(elog_callsite_t *cs, ...) {
+  uint8_t args[ELOG_REPORT_ARGS_MAX];
+  size_t len;
+  va_list ap;
+
+  va_start(ap, cs);
+  len = elog_args_encode(args, sizeof(args), cs->fmt, ap);
+  va_end(ap);
+  elog_emit_args(cs, args, len);
+}
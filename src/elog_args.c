@@ -0,0 +1,455 @@
+/**
+ * @file elog_args.c
+ * @brief elog - printf 引数のエンコード・復元
+ *
+ * ログ呼び出し側ではフォーマット文字列を走査して引数を生のまま詰めるだけにし、
+ * 文字列化（整数・浮動小数点の変換）は復元側で行う。
+ */
+
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "elog_internal.h"
+
+/* ============================================================
+ * 1. フォーマット指定子の解析
+ * ============================================================ */
+
+const char *elog_spec_parse(const char *p, elog_spec_t *spec) {
+  size_t nflags = 0;
+
+  spec->width = -1;
+  spec->precision = -1;
+  spec->width_star = 0;
+  spec->prec_star = 0;
+  spec->len = ELOG_LEN_NONE;
+
+  /* フラグ */
+  while (*p == '-' || *p == '+' || *p == ' ' || *p == '#' || *p == '0') {
+    if (nflags < sizeof(spec->flags) - 1) {
+      spec->flags[nflags++] = *p;
+    }
+    p++;
+  }
+  spec->flags[nflags] = '\0';
+
+  /* 幅 */
+  if (*p == '*') {
+    spec->width_star = 1;
+    p++;
+  } else if (*p >= '0' && *p <= '9') {
+    spec->width = 0;
+    while (*p >= '0' && *p <= '9') {
+      spec->width = spec->width * 10 + (*p++ - '0');
+    }
+  }
+
+  /* 精度 */
+  if (*p == '.') {
+    p++;
+    spec->precision = 0;
+    if (*p == '*') {
+      spec->prec_star = 1;
+      p++;
+    } else {
+      while (*p >= '0' && *p <= '9') {
+        spec->precision = spec->precision * 10 + (*p++ - '0');
+      }
+    }
+  }
+
+  /* 長さ修飾子 */
+  switch (*p) {
+    case 'h':
+      p++;
+      if (*p == 'h') {
+        spec->len = ELOG_LEN_HH;
+        p++;
+      } else {
+        spec->len = ELOG_LEN_H;
+      }
+      break;
+    case 'l':
+      p++;
+      if (*p == 'l') {
+        spec->len = ELOG_LEN_LL;
+        p++;
+      } else {
+        spec->len = ELOG_LEN_L;
+      }
+      break;
+    case 'j':
+      spec->len = ELOG_LEN_J;
+      p++;
+      break;
+    case 'z':
+      spec->len = ELOG_LEN_Z;
+      p++;
+      break;
+    case 't':
+      spec->len = ELOG_LEN_T;
+      p++;
+      break;
+    case 'L':
+      spec->len = ELOG_LEN_BIG_L;
+      p++;
+      break;
+    default:
+      break;
+  }
+
+  /* 変換文字 */
+  switch (*p) {
+    case 'd': case 'i': case 'u': case 'o': case 'x': case 'X':
+    case 'c': case 's': case 'p': case 'n': case '%':
+    case 'f': case 'F': case 'e': case 'E': case 'g': case 'G':
+    case 'a': case 'A':
+      spec->conv = *p;
+      return p + 1;
+    default:
+      return NULL;
+  }
+}
+
+/* ============================================================
+ * 2. エンコード
+ * ============================================================ */
+
+uint8_t *elog_varint_put(uint8_t *p, const uint8_t *end, uint64_t v) {
+  while (v >= 0x80) {
+    if (p >= end) {
+      return NULL;
+    }
+    *p++ = (uint8_t)(v | 0x80);
+    v >>= 7;
+  }
+  if (p >= end) {
+    return NULL;
+  }
+  *p++ = (uint8_t)v;
+  return p;
+}
+
+uint8_t *elog_svarint_put(uint8_t *p, const uint8_t *end, int64_t v) {
+  return elog_varint_put(p, end, ((uint64_t)v << 1) ^ (uint64_t)(v >> 63));
+}
+
+int64_t elog_va_signed(uint8_t len, va_list *ap) {
+  switch (len) {
+    case ELOG_LEN_L:
+      return va_arg(*ap, long);
+    case ELOG_LEN_LL:
+      return va_arg(*ap, long long);
+    case ELOG_LEN_J:
+      return va_arg(*ap, intmax_t);
+    case ELOG_LEN_Z:
+      return (int64_t)va_arg(*ap, size_t);
+    case ELOG_LEN_T:
+      return va_arg(*ap, ptrdiff_t);
+    default:
+      return va_arg(*ap, int);
+  }
+}
+
+uint64_t elog_va_unsigned(uint8_t len, va_list *ap) {
+  switch (len) {
+    case ELOG_LEN_L:
+      return va_arg(*ap, unsigned long);
+    case ELOG_LEN_LL:
+      return va_arg(*ap, unsigned long long);
+    case ELOG_LEN_J:
+      return va_arg(*ap, uintmax_t);
+    case ELOG_LEN_Z:
+      return va_arg(*ap, size_t);
+    case ELOG_LEN_T:
+      return (uint64_t)va_arg(*ap, ptrdiff_t);
+    default:
+      return va_arg(*ap, unsigned int);
+  }
+}
+
+/* 本体で va_list をポインタ経由で扱うためのラッパー */
+static size_t elog_args_encode_ap(uint8_t *dst, size_t cap, const char *fmt,
+                                  va_list *ap) {
+  uint8_t *p = dst;
+  uint8_t *done = dst;
+  const uint8_t *end = dst + cap;
+  elog_spec_t spec;
+
+  while (*fmt != '\0') {
+    done = p;
+    if (*fmt++ != '%') {
+      continue;
+    }
+    fmt = elog_spec_parse_fast(fmt, &spec);
+    if (fmt == NULL) {
+      break;
+    }
+    if (spec.width_star &&
+        (p = elog_svarint_put(p, end, va_arg(*ap, int))) == NULL) {
+      return (size_t)(done - dst);
+    }
+    if (spec.prec_star) {
+      spec.precision = va_arg(*ap, int);
+      if ((p = elog_svarint_put(p, end, spec.precision)) == NULL) {
+        return (size_t)(done - dst);
+      }
+    }
+
+    switch (spec.conv) {
+      case 'd':
+      case 'i':
+        p = elog_svarint_put(p, end, elog_va_signed(spec.len, ap));
+        break;
+      case 'u':
+      case 'o':
+      case 'x':
+      case 'X':
+        p = elog_varint_put(p, end, elog_va_unsigned(spec.len, ap));
+        break;
+      case 'c':
+        p = elog_varint_put(p, end, (uint64_t)va_arg(*ap, int));
+        break;
+      case 'p':
+        p = elog_varint_put(p, end, (uintptr_t)va_arg(*ap, void *));
+        break;
+      case 'n':
+        (void)va_arg(*ap, void *);
+        break;
+      case '%':
+        break;
+      case 's': {
+        /* 長さ + 1（0 は NULL）に続けて本体。入りきらない分は切り捨てる */
+        const char *str = (spec.len == ELOG_LEN_L)
+                              ? (va_arg(*ap, void *), "(wide)")
+                              : va_arg(*ap, const char *);
+        size_t n = 0;
+        if (str != NULL) {
+          /* 精度があれば NUL で終わらないバッファも読めるよう、その先は見ない */
+          n = spec.precision >= 0 ? strnlen(str, (size_t)spec.precision)
+                                  : strlen(str);
+          if (end - p < 2) {
+            p = NULL;
+            break;
+          }
+          if (n > (size_t)(end - p) - 2) {
+            n = (size_t)(end - p) - 2;
+          }
+        }
+        p = elog_varint_put(p, end, str == NULL ? 0 : (uint64_t)n + 1);
+        if (p == NULL || (size_t)(end - p) < n) {
+          p = NULL;
+          break;
+        }
+        memcpy(p, str, n);
+        p += n;
+        break;
+      }
+      default: {
+        /* 浮動小数点は double に揃えて 8 バイトで格納する */
+        double d = (spec.len == ELOG_LEN_BIG_L)
+                       ? (double)va_arg(*ap, long double)
+                       : va_arg(*ap, double);
+        if (end - p < (ptrdiff_t)sizeof(d)) {
+          p = NULL;
+          break;
+        }
+        memcpy(p, &d, sizeof(d));
+        p += sizeof(d);
+        break;
+      }
+    }
+    if (p == NULL) {
+      /* 入りきらなかった引数以降は復元時に "?" になる */
+      return (size_t)(done - dst);
+    }
+  }
+  return (size_t)(p - dst);
+}
+
+size_t elog_args_encode(uint8_t *dst, size_t cap, const char *fmt,
+                        va_list ap) {
+  va_list cp;
+  size_t n;
+
+  va_copy(cp, ap);
+  n = elog_args_encode_ap(dst, cap, fmt, &cp);
+  va_end(cp);
+  return n;
+}
+
+/* ============================================================
+ * 3. 復元
+ * ============================================================ */
+
+const uint8_t *elog_varint_get(const uint8_t *p, const uint8_t *end,
+                               uint64_t *v) {
+  uint64_t r = 0;
+  unsigned shift = 0;
+
+  while (p < end && shift < 64) {
+    uint8_t b = *p++;
+    r |= (uint64_t)(b & 0x7F) << shift;
+    if ((b & 0x80) == 0) {
+      *v = r;
+      return p;
+    }
+    shift += 7;
+  }
+  return NULL;
+}
+
+const uint8_t *elog_svarint_get(const uint8_t *p, const uint8_t *end,
+                                int64_t *v) {
+  uint64_t u = 0;
+
+  p = elog_varint_get(p, end, &u);
+  *v = (int64_t)(u >> 1) ^ -(int64_t)(u & 1);
+  return p;
+}
+
+size_t elog_args_format(char *dst, size_t cap, const char *fmt,
+                        const uint8_t *src, size_t len) {
+  const uint8_t *p = src;
+  const uint8_t *end = src + len;
+  size_t pos = 0;
+  elog_spec_t spec;
+
+  if (cap == 0) {
+    return 0;
+  }
+
+  while (*fmt != '\0' && pos + 1 < cap) {
+    const char *lit = fmt;
+    size_t n = 0;
+
+    /* 変換指定までのリテラル */
+    while (*fmt != '\0' && *fmt != '%') {
+      fmt++;
+    }
+    if (fmt != lit) {
+      size_t l = (size_t)(fmt - lit);
+      if (l > cap - 1 - pos) {
+        l = cap - 1 - pos;
+      }
+      memcpy(dst + pos, lit, l);
+      pos += l;
+      continue;
+    }
+
+    fmt = elog_spec_parse_fast(fmt + 1, &spec);
+    if (fmt == NULL) {
+      break;
+    }
+    if (spec.conv == '%') {
+      dst[pos++] = '%';
+      continue;
+    }
+
+    /* 打ち切られた引数 */
+    if (p == NULL || (p >= end && spec.conv != 'n')) {
+      dst[pos++] = '?';
+      p = NULL;
+      continue;
+    }
+
+    if (spec.width_star) {
+      int64_t w = 0;
+      if ((p = elog_svarint_get(p, end, &w)) == NULL) {
+        continue;
+      }
+      if (w < 0) {
+        /* 負の幅は '-' フラグ扱い（printf と同じ） */
+        size_t fl = strlen(spec.flags);
+        if (fl < sizeof(spec.flags) - 1) {
+          spec.flags[fl] = '-';
+          spec.flags[fl + 1] = '\0';
+        }
+        w = -w;
+      }
+      spec.width = (int)w;
+    }
+    if (spec.prec_star) {
+      int64_t pr = 0;
+      if ((p = elog_svarint_get(p, end, &pr)) == NULL) {
+        continue;
+      }
+      spec.precision = pr < 0 ? -1 : (int)pr;
+    }
+
+    switch (spec.conv) {
+      case 'd':
+      case 'i': {
+        int64_t v = 0;
+        if ((p = elog_svarint_get(p, end, &v)) == NULL) {
+          continue;
+        }
+        n = elog_format_signed(dst + pos, cap - pos, &spec, v);
+        break;
+      }
+      case 'u':
+      case 'o':
+      case 'x':
+      case 'X': {
+        uint64_t v = 0;
+        if ((p = elog_varint_get(p, end, &v)) == NULL) {
+          continue;
+        }
+        n = elog_format_unsigned(dst + pos, cap - pos, &spec, v);
+        break;
+      }
+      case 'c': {
+        uint64_t v = 0;
+        if ((p = elog_varint_get(p, end, &v)) == NULL) {
+          continue;
+        }
+        n = elog_format_char(dst + pos, cap - pos, &spec, (int)v);
+        break;
+      }
+      case 'p': {
+        uint64_t v = 0;
+        if ((p = elog_varint_get(p, end, &v)) == NULL) {
+          continue;
+        }
+        n = elog_format_pointer(dst + pos, cap - pos, &spec, (uintptr_t)v);
+        break;
+      }
+      case 'n':
+        break;
+      case 's': {
+        uint64_t v = 0;
+        if ((p = elog_varint_get(p, end, &v)) == NULL) {
+          continue;
+        }
+        if (v == 0) {
+          n = elog_format_string(dst + pos, cap - pos, &spec, "(null)", 6);
+          break;
+        }
+        v -= 1;
+        if (v > (uint64_t)(end - p)) {
+          v = (uint64_t)(end - p);
+        }
+        n = elog_format_string(dst + pos, cap - pos, &spec, (const char *)p,
+                               (size_t)v);
+        p += v;
+        break;
+      }
+      default: {
+        double d;
+        if (end - p < (ptrdiff_t)sizeof(d)) {
+          p = NULL;
+          continue;
+        }
+        memcpy(&d, p, sizeof(d));
+        p += sizeof(d);
+        n = elog_format_double(dst + pos, cap - pos, &spec, d);
+        break;
+      }
+    }
+    pos += n;
+  }
+
+  dst[pos] = '\0';
+  return pos;
+}
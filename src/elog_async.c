@@ -0,0 +1,567 @@
+/**
+ * @file elog_async.c
+ * @brief elog - 非同期バックエンド
+ *
+ * ログ呼び出しスレッド（プロデューサ）はそれぞれ専用の単一プロデューサ
+ * リングを持ち、固定長レコードを書き込む。リングは最初のログ呼び出しで
+ * 作られ、グローバルなリストに登録される。単一のバックグラウンドスレッド
+ * （コンシューマ）が全リングからまとめて読み出し、タイムスタンプ順に
+ * マージして整形・出力する。
+ *
+ * ELOG_USE_BINARY=1 の場合、コンシューマはテキストの代わりに
+ * バイナリストリームを出力する。
+ *
+ * リングが満杯の場合、呼び出し側をブロックせずにレコードを破棄し、
+ * 破棄数を後から1行で報告する。スレッド終了時にはリングを終了済みにし、
+ * コンシューマが残りを出力した後で新しいスレッドに再利用させる。
+ */
+
+#include "elog/elog.h"
+#include "elog/elog_sink.h"
+
+#if ELOG_USE_ASYNC
+
+#include <pthread.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "elog_internal.h"
+
+#if (ELOG_ASYNC_QUEUE_SIZE & (ELOG_ASYNC_QUEUE_SIZE - 1)) != 0
+#error "ELOG_ASYNC_QUEUE_SIZE must be a power of two"
+#endif
+
+/* コンシューマがキューを空と判断した後に眠る時間 */
+#ifndef ELOG_ASYNC_POLL_US
+#define ELOG_ASYNC_POLL_US 1000
+#endif
+
+/* 出力1回あたりにまとめるバイト数 */
+#ifndef ELOG_ASYNC_BATCH_SIZE
+#define ELOG_ASYNC_BATCH_SIZE 16384
+#endif
+
+#define ELOG_ASYNC_MASK ((uint64_t)ELOG_ASYNC_QUEUE_SIZE - 1)
+
+/* 1回のパスでマージするリング数の上限（超過分は次のパスへ） */
+#ifndef ELOG_ASYNC_MAX_MERGE
+#define ELOG_ASYNC_MAX_MERGE 256
+#endif
+
+/* ============================================================
+ * 1. レコードとスレッドごとのリング
+ * ============================================================ */
+
+typedef struct {
+  elog_callsite_t *cs; /* コールサイト記述子 */
+  uint64_t ts;         /* elog_clock_read() の値（マージに使う） */
+  uint16_t len;        /* args の有効バイト数 */
+  uint8_t args[ELOG_ARGS_MAX]; /* 合計が ELOG_ASYNC_RECORD_SIZE になる */
+} elog_async_slot_t;
+
+/* リングの状態 */
+enum {
+  ELOG_THREAD_ACTIVE = 0, /* 所有スレッドが書き込み中 */
+  ELOG_THREAD_EXITED,     /* 所有スレッドが終了（残りを出力待ち） */
+  ELOG_THREAD_FREE        /* 空になり、再利用できる */
+};
+
+typedef struct elog_thread {
+  /* プロデューサのみが書き込む */
+  uint64_t tail __attribute__((aligned(ELOG_CACHE_LINE)));
+  uint64_t head_cache; /* 最後に読んだ head（満杯判定用） */
+  uint64_t dropped;    /* コンシューマが exchange で回収する */
+
+  /* コンシューマのみが書き込む */
+  uint64_t head __attribute__((aligned(ELOG_CACHE_LINE)));
+  uint64_t limit; /* 今回のパスで読み出す位置（tail のスナップショット） */
+
+  int state __attribute__((aligned(ELOG_CACHE_LINE)));
+  struct elog_thread *next; /* 登録リスト（先頭に追加のみ） */
+#if ELOG_USE_CRASH_HANDLER
+  void *crash_stack; /* 所有スレッドの代替シグナルスタック（リングと共に再利用） */
+#endif
+
+  elog_async_slot_t slots[ELOG_ASYNC_QUEUE_SIZE]
+      __attribute__((aligned(ELOG_CACHE_LINE)));
+} elog_thread_t;
+
+static elog_thread_t *elog_async_threads; /* 登録リストの先頭 */
+static __thread elog_thread_t *elog_async_self;
+static pthread_key_t elog_async_key;
+
+/* リングを割り当てられなかった呼び出しの破棄数 */
+static uint64_t elog_async_dropped;
+
+/* ============================================================
+ * 2. コンシューマスレッドの状態
+ * ============================================================ */
+
+static pthread_once_t elog_async_once = PTHREAD_ONCE_INIT;
+static pthread_t elog_async_thread;
+static pthread_mutex_t elog_async_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t elog_async_wake = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t elog_async_done = PTHREAD_COND_INITIALIZER;
+static uint64_t elog_async_passes; /* 完了した読み出しパス数（mutex で保護） */
+static int elog_async_flush_req;    /* mutex で保護 */
+static int elog_async_stop;         /* mutex で保護 */
+static int elog_async_running;
+
+static char elog_async_batch[ELOG_ASYNC_BATCH_SIZE];
+static size_t elog_async_batch_len;
+
+#if !ELOG_USE_BINARY
+/* 破棄されたレコード数を報告する行の記述子 */
+static const elog_callsite_t elog_async_drop_cs = {
+    "%llu records dropped (async queue full)", "elog", 0, ELOG_LEVEL_WARN, 0,
+    0
+#if ELOG_USE_DYNAMIC_DEBUG
+    , "elog_async"
+#endif
+};
+#endif
+
+/* ============================================================
+ * 3. コンシューマ
+ * ============================================================ */
+
+static void elog_async_flush_batch(void) {
+  if (elog_async_batch_len > 0) {
+    elog_sink_dispatch(elog_async_batch, elog_async_batch_len);
+    elog_sink_flush();
+    elog_async_batch_len = 0;
+  }
+}
+
+#if ELOG_USE_BINARY
+/* バイナリストリームをバッチへ追加する（elog_write_fn） */
+static void elog_async_append(const void *data, size_t len) {
+  const char *p = (const char *)data;
+
+  while (len > 0) {
+    size_t n = sizeof(elog_async_batch) - elog_async_batch_len;
+    if (n == 0) {
+      elog_async_flush_batch();
+      continue;
+    }
+    if (n > len) {
+      n = len;
+    }
+    memcpy(elog_async_batch + elog_async_batch_len, p, n);
+    elog_async_batch_len += n;
+    p += n;
+    len -= n;
+  }
+}
+#else
+/* バッチに1行分の空きを確保する */
+static char *elog_async_reserve_line(void) {
+  if (sizeof(elog_async_batch) - elog_async_batch_len < ELOG_LINE_MAX) {
+    elog_async_flush_batch();
+  }
+  return elog_async_batch + elog_async_batch_len;
+}
+#endif
+
+/* 破棄されたレコード数を報告する */
+static void elog_async_report_dropped(uint64_t dropped) {
+#if ELOG_USE_BINARY
+  elog_binary_write_dropped(dropped, elog_async_append);
+#else
+  char *line = elog_async_reserve_line();
+  size_t cap = ELOG_LINE_MAX - ELOG_LINE_SUFFIX_LEN;
+  size_t n;
+
+  n = elog_line_stamp(line, cap, ELOG_USE_TIMESTAMP ? elog_clock_read() : 0);
+  n += elog_line_prefix(line + n, cap - n, &elog_async_drop_cs);
+  n += elog_format(line + n, cap - n, elog_async_drop_cs.fmt,
+                   (unsigned long long)dropped);
+  n += elog_line_suffix(line + n, ELOG_LINE_SUFFIX_LEN);
+  elog_async_batch_len += n;
+#endif
+}
+
+#if ELOG_USE_DEDUP
+/* 次のパスで保留中の繰り返し件数を報告させる */
+static int elog_async_dedup_force;
+
+/* 直前のレコードの繰り返し件数を報告する（ts は報告の契機の時刻） */
+static void elog_async_report_repeated(const elog_dedup_repeat_t *rep,
+                                       uint64_t ts) {
+#if ELOG_USE_BINARY
+  (void)ts;
+  elog_binary_write_repeated(rep->cs, rep->count, elog_async_append);
+#else
+  char *line = elog_async_reserve_line();
+  size_t n = elog_line_stamp(line, ELOG_LINE_MAX, ts);
+
+  n += elog_line_repeated(line + n, ELOG_LINE_MAX - n, rep->cs, rep->count);
+  elog_async_batch_len += n;
+#endif
+}
+#endif
+
+/* 1レコードを整形してバッチへ追加する */
+static void elog_async_output(const elog_async_slot_t *slot) {
+#if ELOG_USE_DEDUP
+  elog_dedup_repeat_t rep;
+  int suppressed = elog_dedup_check(slot->cs, slot->args, slot->len, &rep);
+
+  if (rep.count > 0) {
+    elog_async_report_repeated(&rep, slot->ts);
+  }
+  if (suppressed) {
+    return;
+  }
+#endif
+#if ELOG_USE_BINARY
+  elog_binary_write(slot->cs, elog_clock_ns(slot->ts), slot->args, slot->len,
+                    elog_async_append);
+#else
+  {
+    char *line = elog_async_reserve_line();
+    size_t n = elog_line_stamp(line, ELOG_LINE_MAX, slot->ts);
+
+    n += elog_line_format(line + n, ELOG_LINE_MAX - n, slot->cs, slot->args,
+                          slot->len);
+    elog_async_batch_len += n;
+  }
+#endif
+}
+
+/* 集めたリングをタイムスタンプ順にマージして出力する */
+static size_t elog_async_merge(elog_thread_t **rings, size_t nrings) {
+  size_t count = 0;
+  size_t i;
+
+  while (nrings > 0) {
+    elog_thread_t *t;
+    elog_async_slot_t *slot;
+    size_t min = 0;
+
+    for (i = 1; i < nrings; i++) {
+      if (rings[i]->slots[rings[i]->head & ELOG_ASYNC_MASK].ts <
+          rings[min]->slots[rings[min]->head & ELOG_ASYNC_MASK].ts) {
+        min = i;
+      }
+    }
+    t = rings[min];
+    slot = &t->slots[t->head & ELOG_ASYNC_MASK];
+    elog_async_output(slot);
+    __atomic_store_n(&t->head, t->head + 1, __ATOMIC_RELEASE);
+    count++;
+    if (t->head == t->limit) {
+      rings[min] = rings[--nrings];
+    }
+  }
+  return count;
+}
+
+/*
+ * 全リングから、パス開始時点までに書き込まれたレコードを出力する
+ * @return 読み出したレコード数
+ */
+static size_t elog_async_drain(void) {
+  elog_thread_t *rings[ELOG_ASYNC_MAX_MERGE];
+  size_t nrings = 0;
+  size_t count = 0;
+  uint64_t dropped = __atomic_exchange_n(&elog_async_dropped, 0,
+                                         __ATOMIC_RELAXED);
+  elog_thread_t *t;
+
+  /* シグナルハンドラで記録したレコードをこのスレッドのリングへ移す */
+  elog_sigsafe_poll();
+  for (t = __atomic_load_n(&elog_async_threads, __ATOMIC_ACQUIRE); t != NULL;
+       t = t->next) {
+    int state = __atomic_load_n(&t->state, __ATOMIC_ACQUIRE);
+
+    if (state == ELOG_THREAD_FREE) {
+      continue;
+    }
+    dropped += __atomic_exchange_n(&t->dropped, 0, __ATOMIC_RELAXED);
+    t->limit = __atomic_load_n(&t->tail, __ATOMIC_ACQUIRE);
+    if (t->limit != t->head) {
+      if (nrings == ELOG_ASYNC_MAX_MERGE) {
+        count += elog_async_merge(rings, nrings);
+        nrings = 0;
+      }
+      rings[nrings++] = t;
+    } else if (state == ELOG_THREAD_EXITED) {
+      /* 終了済みで空になったリングは再利用に回す */
+      __atomic_store_n(&t->state, ELOG_THREAD_FREE, __ATOMIC_RELEASE);
+    }
+  }
+  count += elog_async_merge(rings, nrings);
+
+#if ELOG_USE_DEDUP
+  {
+    elog_dedup_repeat_t rep;
+    int force = __atomic_exchange_n(&elog_async_dedup_force, 0,
+                                    __ATOMIC_RELAXED);
+
+    /* 同じレコードが続いている間も、間隔ごとに件数を報告する */
+    if (elog_dedup_expire(force, &rep)) {
+      elog_async_report_repeated(&rep,
+                                 ELOG_USE_TIMESTAMP ? elog_clock_read() : 0);
+    }
+  }
+#endif
+
+  if (dropped > 0) {
+    elog_async_report_dropped(dropped);
+  }
+
+  elog_async_flush_batch();
+  return count;
+}
+
+static void *elog_async_main(void *arg) {
+  (void)arg;
+
+  for (;;) {
+    size_t n = elog_async_drain();
+
+    pthread_mutex_lock(&elog_async_mutex);
+    elog_async_passes++;
+    pthread_cond_broadcast(&elog_async_done);
+    if (n == 0) {
+      if (elog_async_stop) {
+        pthread_mutex_unlock(&elog_async_mutex);
+        break;
+      }
+      if (!elog_async_flush_req) {
+        struct timespec ts;
+        clock_gettime(CLOCK_REALTIME, &ts);
+        ts.tv_nsec += ELOG_ASYNC_POLL_US * 1000L;
+        if (ts.tv_nsec >= 1000000000L) {
+          ts.tv_sec += ts.tv_nsec / 1000000000L;
+          ts.tv_nsec %= 1000000000L;
+        }
+        pthread_cond_timedwait(&elog_async_wake, &elog_async_mutex, &ts);
+      }
+      elog_async_flush_req = 0;
+    }
+    pthread_mutex_unlock(&elog_async_mutex);
+  }
+  return NULL;
+}
+
+/* コンシューマに次のパスをすぐ始めさせる */
+static void elog_async_wakeup(void) {
+  pthread_mutex_lock(&elog_async_mutex);
+  elog_async_flush_req = 1;
+  pthread_cond_signal(&elog_async_wake);
+  pthread_mutex_unlock(&elog_async_mutex);
+}
+
+/* プロセス終了時に残りを出力してスレッドを止める */
+static void elog_async_shutdown(void) {
+#if ELOG_USE_SCOPE_TIMER && (defined(__GNUC__) || defined(__clang__))
+  /* スコープタイマーの最後の集計をキューに入れてから止める */
+  elog_timer_flush();
+#endif
+#if ELOG_USE_DEDUP
+  __atomic_store_n(&elog_async_dedup_force, 1, __ATOMIC_RELAXED);
+#endif
+  pthread_mutex_lock(&elog_async_mutex);
+  elog_async_stop = 1;
+  pthread_cond_signal(&elog_async_wake);
+  pthread_mutex_unlock(&elog_async_mutex);
+  pthread_join(elog_async_thread, NULL);
+  elog_async_running = 0;
+}
+
+/* スレッド終了時: リングを終了済みにし、残りをすぐ出力させる */
+static void elog_async_thread_exit(void *arg) {
+  elog_thread_t *t = (elog_thread_t *)arg;
+
+  elog_async_self = NULL;
+#if ELOG_USE_CRASH_HANDLER
+  /* 次にリングを使うスレッドへスタックを渡す前に外す */
+  elog_crash_thread_detach(t->crash_stack);
+#endif
+  __atomic_store_n(&t->state, ELOG_THREAD_EXITED, __ATOMIC_RELEASE);
+  if (elog_async_running) {
+    elog_async_wakeup();
+  }
+}
+
+static void elog_async_init(void) {
+  pthread_key_create(&elog_async_key, elog_async_thread_exit);
+  if (pthread_create(&elog_async_thread, NULL, elog_async_main, NULL) == 0) {
+    elog_async_running = 1;
+    atexit(elog_async_shutdown);
+  }
+}
+
+#if ELOG_USE_CRASH_HANDLER
+void elog_async_crash_drain(elog_write_fn write) {
+  elog_thread_t *t;
+
+  /* コンシューマは止められないので、読み出しても head は進めない */
+  if (elog_async_batch_len > 0) {
+    write(elog_async_batch, elog_async_batch_len);
+  }
+  for (t = __atomic_load_n(&elog_async_threads, __ATOMIC_ACQUIRE); t != NULL;
+       t = t->next) {
+    uint64_t head = __atomic_load_n(&t->head, __ATOMIC_ACQUIRE);
+    uint64_t tail = __atomic_load_n(&t->tail, __ATOMIC_ACQUIRE);
+
+    for (; head != tail; head++) {
+      const elog_async_slot_t *slot = &t->slots[head & ELOG_ASYNC_MASK];
+#if ELOG_USE_BINARY
+      elog_binary_write(slot->cs, elog_clock_ns_sigsafe(slot->ts), slot->args,
+                        slot->len, write);
+#else
+      /* 時刻の整形（localtime_r）はシグナルハンドラから呼べないので付けない */
+      char line[ELOG_LINE_MAX];
+
+      write(line, elog_line_format(line, sizeof(line), slot->cs, slot->args,
+                                   slot->len));
+#endif
+    }
+  }
+}
+#endif /* ELOG_USE_CRASH_HANDLER */
+
+/* ============================================================
+ * 4. プロデューサ
+ * ============================================================ */
+
+/* 呼び出しスレッドにリングを割り当てる（空きがあれば再利用する） */
+static elog_thread_t *elog_async_attach(void) {
+  elog_thread_t *t;
+
+  for (t = __atomic_load_n(&elog_async_threads, __ATOMIC_ACQUIRE); t != NULL;
+       t = t->next) {
+    int expected = ELOG_THREAD_FREE;
+    if (__atomic_compare_exchange_n(&t->state, &expected, ELOG_THREAD_ACTIVE,
+                                    0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+      t->head_cache = __atomic_load_n(&t->head, __ATOMIC_RELAXED);
+      break;
+    }
+  }
+
+  if (t == NULL) {
+    if (posix_memalign((void **)&t, ELOG_CACHE_LINE, sizeof(*t)) != 0) {
+      return NULL;
+    }
+    memset(t, 0, offsetof(elog_thread_t, slots));
+    t->state = ELOG_THREAD_ACTIVE;
+    t->next = __atomic_load_n(&elog_async_threads, __ATOMIC_RELAXED);
+    while (!__atomic_compare_exchange_n(&elog_async_threads, &t->next, t, 1,
+                                        __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {
+    }
+  }
+
+#if ELOG_USE_CRASH_HANDLER
+  /* 致命的なシグナルのハンドラがスタックオーバーフローでも動くように */
+  if (t->crash_stack == NULL) {
+    t->crash_stack = malloc(ELOG_CRASH_STACK_SIZE);
+  }
+  elog_crash_thread_attach(t->crash_stack);
+#endif
+  pthread_setspecific(elog_async_key, t);
+  elog_async_self = t;
+  return t;
+}
+
+/*
+ * 呼び出しスレッドのリングに空きスロットを1つ確保する
+ * 満杯なら破棄数を数えて NULL を返す。書き終えたら elog_async_publish() する
+ */
+static elog_async_slot_t *elog_async_reserve(elog_thread_t **tp) {
+  elog_thread_t *t = elog_async_self;
+  uint64_t tail;
+
+  if (t == NULL) {
+    pthread_once(&elog_async_once, elog_async_init);
+    if ((t = elog_async_attach()) == NULL) {
+      __atomic_fetch_add(&elog_async_dropped, 1, __ATOMIC_RELAXED);
+      return NULL;
+    }
+  }
+
+  tail = t->tail;
+  if (tail - t->head_cache >= ELOG_ASYNC_QUEUE_SIZE) {
+    t->head_cache = __atomic_load_n(&t->head, __ATOMIC_ACQUIRE);
+    if (tail - t->head_cache >= ELOG_ASYNC_QUEUE_SIZE) {
+      /* 満杯: 呼び出し側を待たせずに破棄する */
+      __atomic_fetch_add(&t->dropped, 1, __ATOMIC_RELAXED);
+      return NULL;
+    }
+  }
+  *tp = t;
+  return &t->slots[tail & ELOG_ASYNC_MASK];
+}
+
+static void elog_async_publish(elog_thread_t *t) {
+  __atomic_store_n(&t->tail, t->tail + 1, __ATOMIC_RELEASE);
+}
+
+void elog_emit(elog_callsite_t *cs, const char *fmt, ...) {
+  elog_thread_t *t;
+  elog_async_slot_t *slot = elog_async_reserve(&t);
+  va_list ap;
+
+  if (slot == NULL) {
+    return;
+  }
+  slot->cs = cs;
+  slot->ts = elog_clock_read();
+  va_start(ap, fmt);
+  slot->len = (uint16_t)elog_args_encode(slot->args, sizeof(slot->args), fmt, ap);
+  va_end(ap);
+  elog_async_publish(t);
+}
+
+void elog_emit_args_at(elog_callsite_t *cs, uint64_t ts, const uint8_t *args,
+                       size_t len) {
+  elog_thread_t *t;
+  elog_async_slot_t *slot = elog_async_reserve(&t);
+
+  if (slot == NULL) {
+    return;
+  }
+  if (len > sizeof(slot->args)) {
+    len = sizeof(slot->args);
+  }
+  slot->cs = cs;
+  slot->ts = ts;
+  slot->len = (uint16_t)len;
+  memcpy(slot->args, args, len);
+  elog_async_publish(t);
+}
+
+void elog_emit_args(elog_callsite_t *cs, const uint8_t *args, size_t len) {
+  elog_emit_args_at(cs, elog_clock_read(), args, len);
+}
+
+void elog_async_flush(void) {
+  uint64_t target;
+
+  if (!elog_async_running) {
+    return;
+  }
+#if ELOG_USE_DEDUP
+  __atomic_store_n(&elog_async_dedup_force, 1, __ATOMIC_RELAXED);
+#endif
+
+  /* 実行中のパスは呼び出し前のレコードを見逃しうるため、その次のパスを待つ */
+  pthread_mutex_lock(&elog_async_mutex);
+  target = elog_async_passes + 2;
+  while (elog_async_passes < target && !elog_async_stop) {
+    elog_async_flush_req = 1;
+    pthread_cond_signal(&elog_async_wake);
+    pthread_cond_wait(&elog_async_done, &elog_async_mutex);
+  }
+  pthread_mutex_unlock(&elog_async_mutex);
+}
+
+#if ELOG_USE_DEDUP
+void elog_dedup_flush(void) { elog_async_flush(); }
+#endif
+
+#endif /* ELOG_USE_ASYNC */
@@ -0,0 +1,221 @@
+/**
+ * @file elog_binary.c
+ * @brief elog - バイナリ出力（遅延整形）
+ *
+ * ログ呼び出しではコールサイト ID・タイムスタンプ・生の引数だけを書き出し、
+ * テキストへの復元は elog_binary_decode() で後から行う。
+ * フォーマット文字列とファイル名はコールサイトごとに一度だけ出力される。
+ */
+
+#include "elog/elog.h"
+
+#if ELOG_USE_BINARY
+
+#include <string.h>
+#include <time.h>
+
+#include "elog_internal.h"
+
+#if !ELOG_BINARY_EMBED_CALLSITES && !ELOG_USE_CALLSITE_SECTION
+#error "ELOG_BINARY_EMBED_CALLSITES=0 requires ELOG_USE_CALLSITE_SECTION"
+#endif
+
+/* ============================================================
+ * 1. ストリーム書き出し（呼び出しは直列化済み）
+ * ============================================================ */
+
+#if ELOG_USE_CALLSITE_SECTION
+/*
+ * elog-decode が elog_meta セクションを読むための情報
+ * {マジック, 記述子の間隔, ポインタサイズ}
+ */
+static const uint32_t elog_binary_meta_info[3]
+    __attribute__((section("elog_meta_info"), used)) = {
+        ELOG_META_INFO_MAGIC, sizeof(elog_callsite_t), sizeof(void *)};
+#endif
+
+static int elog_binary_started;
+static uint64_t elog_binary_last_ts;
+#if !ELOG_USE_CALLSITE_SECTION
+static uint32_t elog_binary_next_id = 1;
+#endif
+
+static void elog_binary_write_header(uint64_t ts, elog_write_fn write) {
+  uint8_t buf[ELOG_BIN_MAGIC_LEN + 1 + 40];
+  uint8_t *p = buf;
+  const uint8_t *end = buf + sizeof(buf);
+  struct timespec rt;
+
+  clock_gettime(CLOCK_REALTIME, &rt);
+  memcpy(p, ELOG_BIN_MAGIC, ELOG_BIN_MAGIC_LEN);
+  p += ELOG_BIN_MAGIC_LEN;
+  *p++ = ELOG_BIN_VERSION;
+#if ELOG_USE_CALLSITE_SECTION
+  p = elog_varint_put(p, end, ELOG_BIN_FLAG_SECTION_ID);
+#else
+  p = elog_varint_put(p, end, 0);
+#endif
+  p = elog_varint_put(p, end,
+                      (uint64_t)rt.tv_sec * 1000000000u + (uint64_t)rt.tv_nsec);
+  p = elog_varint_put(p, end, ts);
+  write(buf, (size_t)(p - buf));
+
+  elog_binary_last_ts = ts;
+  elog_binary_started = 1;
+}
+
+/* 初めて出力するコールサイトに ID を割り当て、定義レコードを書く */
+static void elog_binary_write_callsite(elog_callsite_t *cs,
+                                       elog_write_fn write) {
+#if ELOG_BINARY_EMBED_CALLSITES
+  uint8_t buf[32];
+  uint8_t *p = buf;
+  const uint8_t *end = buf + sizeof(buf);
+  size_t file_len = cs->file != NULL ? strlen(cs->file) : 0;
+  size_t fmt_len = strlen(cs->fmt);
+#endif
+
+#if ELOG_USE_CALLSITE_SECTION
+  cs->id = (uint32_t)elog_callsite_index(cs) + 1;
+#else
+  cs->id = elog_binary_next_id++;
+#endif
+
+#if ELOG_BINARY_EMBED_CALLSITES
+  *p++ = ELOG_BIN_TAG_CALLSITE;
+  p = elog_varint_put(p, end, cs->id);
+  *p++ = cs->level;
+  p = elog_varint_put(p, end, cs->line);
+  p = elog_varint_put(p, end, cs->file != NULL ? file_len + 1 : 0);
+  write(buf, (size_t)(p - buf));
+  write(cs->file, file_len);
+
+  p = elog_varint_put(buf, end, fmt_len);
+  write(buf, (size_t)(p - buf));
+  write(cs->fmt, fmt_len);
+#else
+  (void)write;
+#endif
+}
+
+void elog_binary_write(elog_callsite_t *cs, uint64_t ts, const uint8_t *args,
+                       size_t len, elog_write_fn write) {
+  /* 通常はヘッダーと引数をまとめて1回で書き出す */
+  uint8_t buf[32 + ELOG_LINE_MAX];
+  uint8_t *p = buf;
+  const uint8_t *end = buf + 32;
+
+  if (!elog_binary_started) {
+    elog_binary_write_header(ts, write);
+  }
+  if (cs->id == 0) {
+    elog_binary_write_callsite(cs, write);
+  }
+
+  *p++ = ELOG_BIN_TAG_RECORD;
+  p = elog_varint_put(p, end, cs->id);
+  p = elog_svarint_put(p, end, (int64_t)(ts - elog_binary_last_ts));
+  p = elog_varint_put(p, end, len);
+  if (len <= ELOG_LINE_MAX) {
+    memcpy(p, args, len);
+    write(buf, (size_t)(p - buf) + len);
+  } else {
+    write(buf, (size_t)(p - buf));
+    write(args, len);
+  }
+  elog_binary_last_ts = ts;
+}
+
+void elog_binary_write_dropped(uint64_t count, elog_write_fn write) {
+  uint8_t buf[16];
+  uint8_t *p = buf;
+
+  if (!elog_binary_started) {
+    elog_binary_write_header(elog_now_ns(), write);
+  }
+  *p++ = ELOG_BIN_TAG_DROPPED;
+  p = elog_varint_put(p, buf + sizeof(buf), count);
+  write(buf, (size_t)(p - buf));
+}
+
+void elog_binary_write_repeated(const elog_callsite_t *cs, uint32_t count,
+                                elog_write_fn write) {
+  uint8_t buf[16];
+  uint8_t *p = buf;
+
+  /* 繰り返されたレコードは出力済みなので、ヘッダーと ID は割り当て済み */
+  *p++ = ELOG_BIN_TAG_REPEATED;
+  p = elog_varint_put(p, buf + sizeof(buf), cs->id);
+  p = elog_varint_put(p, buf + sizeof(buf), count);
+  write(buf, (size_t)(p - buf));
+}
+
+/* ============================================================
+ * 2. 同期出力（ELOG_USE_ASYNC=0）
+ * ============================================================ */
+
+#if !ELOG_USE_ASYNC
+
+/* ストリームの状態を守るロック */
+static elog_lock_t elog_binary_lock = ELOG_LOCK_INITIALIZER;
+
+/* 1レコードを書き出す（ts は elog_clock_read() の値） */
+static void elog_binary_emit(elog_callsite_t *cs, uint64_t ts,
+                             const uint8_t *args, size_t len) {
+  ts = elog_clock_ns(ts);
+  elog_lock(&elog_binary_lock);
+#if ELOG_USE_DEDUP
+  {
+    elog_dedup_repeat_t rep;
+    int suppressed = elog_dedup_check(cs, args, len, &rep);
+
+    if (rep.count > 0) {
+      elog_binary_write_repeated(rep.cs, rep.count, elog_sink_dispatch);
+    }
+    if (!suppressed) {
+      elog_binary_write(cs, ts, args, len, elog_sink_dispatch);
+    }
+  }
+#else
+  elog_binary_write(cs, ts, args, len, elog_sink_dispatch);
+#endif
+  elog_unlock(&elog_binary_lock);
+}
+
+void elog_emit(elog_callsite_t *cs, const char *fmt, ...) {
+  uint8_t args[ELOG_LINE_MAX];
+  uint64_t ts = elog_clock_read();
+  size_t len;
+  va_list ap;
+
+  elog_sigsafe_poll();
+  va_start(ap, fmt);
+  len = elog_args_encode(args, sizeof(args), fmt, ap);
+  va_end(ap);
+  elog_binary_emit(cs, ts, args, len);
+}
+
+void elog_emit_args_at(elog_callsite_t *cs, uint64_t ts, const uint8_t *args,
+                       size_t len) {
+  elog_binary_emit(cs, ts, args, len);
+}
+
+void elog_emit_args(elog_callsite_t *cs, const uint8_t *args, size_t len) {
+  elog_emit_args_at(cs, elog_clock_read(), args, len);
+}
+
+#if ELOG_USE_DEDUP
+void elog_dedup_flush(void) {
+  elog_dedup_repeat_t rep;
+
+  elog_lock(&elog_binary_lock);
+  if (elog_dedup_expire(1, &rep)) {
+    elog_binary_write_repeated(rep.cs, rep.count, elog_sink_dispatch);
+  }
+  elog_unlock(&elog_binary_lock);
+}
+#endif
+
+#endif /* !ELOG_USE_ASYNC */
+
+#endif /* ELOG_USE_BINARY */
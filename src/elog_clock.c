@@ -0,0 +1,192 @@
+/**
+ * @file elog_clock.c
+ * @brief elog - タイムスタンプの変換
+ *
+ * ログ呼び出しでは elog_clock_read() で生の値（TSC または粗い単調クロック）
+ * だけを取り、ここで出力時に単調クロックの ns、さらに壁時計へ変換する。
+ * TSC の周波数は読み込み時の組からの経過で較正し、以後も取り直す（待ちはしない）。
+ */
+
+#include "elog/elog.h"
+
+#if ELOG_USE_TIMESTAMP
+
+#include <time.h>
+
+#include "elog_internal.h"
+
+/* 読み込みからこの時間が経つまでは、変換のたびに較正し直す */
+#ifndef ELOG_TSC_CALIBRATE_MS
+#define ELOG_TSC_CALIBRATE_MS 10
+#endif
+
+/* 最初の較正に要る最小の経過（読み込み直後の変換だけがこれを待つ） */
+#define ELOG_TSC_MIN_ELAPSED_NS 100000u
+
+/* 較正をやり直す間隔（基準点からの経過がこれを超えたら取り直す） */
+#ifndef ELOG_TSC_REFRESH_MS
+#define ELOG_TSC_REFRESH_MS 1000
+#endif
+
+static elog_lock_t elog_clock_lock = ELOG_LOCK_INITIALIZER;
+
+/* ============================================================
+ * 1. TSC の較正（ELOG_TIMESTAMP_CLOCK=ELOG_CLOCK_TSC）
+ * ============================================================ */
+
+#if ELOG_TIMESTAMP_CLOCK == ELOG_CLOCK_TSC
+
+/*
+ * 変換は基準点 (elog_tsc_base, elog_tsc_mono) からの差分に倍率を掛ける。
+ * 倍率は最初の組 (elog_tsc_first, elog_tsc_mono_first) からの経過で求めるため、
+ * 基準点を取り直すたびに精度が上がり、誤差も積み上がらない。
+ * 最初の組はライブラリの読み込み時に取るため、最初の変換でも眠らずに済む。
+ * 状態は elog_clock_lock で守る（変換は出力側のみで行う）
+ */
+static uint64_t elog_tsc_first;
+static uint64_t elog_tsc_mono_first;
+static uint64_t elog_tsc_base;
+static uint64_t elog_tsc_mono;
+static uint64_t elog_tsc_mult; /* ns = TSC の差 * mult >> 32 */
+static uint64_t elog_tsc_refresh;
+
+/*
+ * シグナルハンドラ用の基準点と倍率の写し。較正のたびに使っていない側へ書いてから
+ * elog_tsc_seq を進める。読む側はロックを取らず、読む間に2回以上進んでいれば
+ * 読み直す（較正中に落ちたスレッドが書きかけのまま止まっても、もう一方は読める）
+ */
+typedef struct {
+  uint64_t base;
+  uint64_t mono;
+  uint64_t mult;
+} elog_tsc_snap_t;
+
+static elog_tsc_snap_t elog_tsc_snaps[2];
+static uint32_t elog_tsc_seq;
+
+/* 基準点からの差を単調クロックの ns にする（基準点より前の値も扱う） */
+static uint64_t elog_tsc_convert(uint64_t base, uint64_t mono, uint64_t mult,
+                                 uint64_t ts) {
+  if (ts < base) {
+    return mono - (uint64_t)(((unsigned __int128)(base - ts) * mult) >> 32);
+  }
+  return mono + (uint64_t)(((unsigned __int128)(ts - base) * mult) >> 32);
+}
+
+static void elog_tsc_sample(uint64_t *tsc, uint64_t *mono) {
+  *tsc = __builtin_ia32_rdtsc();
+  *mono = elog_now_ns();
+}
+
+/* 他のコンストラクタからの出力で先に取っていれば、そちらを使う */
+static void elog_tsc_start(void) {
+  if (elog_tsc_first == 0) {
+    elog_tsc_sample(&elog_tsc_first, &elog_tsc_mono_first);
+  }
+}
+
+__attribute__((constructor)) static void elog_tsc_init(void) {
+  elog_lock(&elog_clock_lock);
+  elog_tsc_start();
+  elog_unlock(&elog_clock_lock);
+}
+
+static void elog_tsc_rebase(void) {
+  uint64_t t, m;
+
+  elog_tsc_start();
+  elog_tsc_sample(&t, &m);
+  if (elog_tsc_mult == 0) {
+    /* 読み込み直後は倍率が定まるだけの経過を回って待つ（長くても 0.1 ms） */
+    while (m - elog_tsc_mono_first < ELOG_TSC_MIN_ELAPSED_NS) {
+#if defined(__x86_64__) || defined(__i386__)
+      __builtin_ia32_pause();
+#endif
+      elog_tsc_sample(&t, &m);
+    }
+  }
+  if (t > elog_tsc_first) {
+    elog_tsc_mult = (uint64_t)(((unsigned __int128)(m - elog_tsc_mono_first)
+                                << 32) /
+                               (t - elog_tsc_first));
+  }
+  elog_tsc_base = t;
+  elog_tsc_mono = m;
+  if (elog_tsc_mult > 0) {
+    uint32_t seq = __atomic_load_n(&elog_tsc_seq, __ATOMIC_RELAXED);
+    elog_tsc_snap_t *snap = &elog_tsc_snaps[(seq + 1) & 1];
+
+    /* 経過が短いうちの倍率は粗いので、次の変換でまた取り直す */
+    elog_tsc_refresh =
+        m - elog_tsc_mono_first < (uint64_t)ELOG_TSC_CALIBRATE_MS * 1000000u
+            ? t
+            : t + (((uint64_t)ELOG_TSC_REFRESH_MS * 1000000u) << 32) /
+                      elog_tsc_mult;
+    __atomic_store_n(&snap->base, t, __ATOMIC_RELAXED);
+    __atomic_store_n(&snap->mono, m, __ATOMIC_RELAXED);
+    __atomic_store_n(&snap->mult, elog_tsc_mult, __ATOMIC_RELAXED);
+    __atomic_store_n(&elog_tsc_seq, seq + 1, __ATOMIC_RELEASE);
+  }
+}
+
+uint64_t elog_clock_ns(uint64_t ts) {
+  uint64_t ns;
+
+  elog_lock(&elog_clock_lock);
+  if (elog_tsc_mult == 0 || ts >= elog_tsc_refresh) {
+    elog_tsc_rebase();
+  }
+  /* 基準点より前に取った値（キューに残っていたもの）も扱う */
+  ns = elog_tsc_convert(elog_tsc_base, elog_tsc_mono, elog_tsc_mult, ts);
+  elog_unlock(&elog_clock_lock);
+  return ns;
+}
+
+uint64_t elog_clock_ns_sigsafe(uint64_t ts) {
+  int tries;
+
+  for (tries = 0; tries < 4; tries++) {
+    uint32_t seq = __atomic_load_n(&elog_tsc_seq, __ATOMIC_ACQUIRE);
+    const elog_tsc_snap_t *snap = &elog_tsc_snaps[seq & 1];
+    uint64_t base = __atomic_load_n(&snap->base, __ATOMIC_RELAXED);
+    uint64_t mono = __atomic_load_n(&snap->mono, __ATOMIC_RELAXED);
+    uint64_t mult = __atomic_load_n(&snap->mult, __ATOMIC_RELAXED);
+
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    if (mult == 0) {
+      break; /* まだ較正していない */
+    }
+    if (__atomic_load_n(&elog_tsc_seq, __ATOMIC_RELAXED) - seq < 2) {
+      return elog_tsc_convert(base, mono, mult, ts);
+    }
+  }
+  return elog_now_ns();
+}
+
+#endif /* ELOG_TIMESTAMP_CLOCK == ELOG_CLOCK_TSC */
+
+/* ============================================================
+ * 2. 壁時計への変換
+ * ============================================================ */
+
+static int64_t elog_wall_offset; /* 壁時計 ns - 単調クロック ns */
+static int elog_wall_ready;
+
+uint64_t elog_clock_wall_ns(uint64_t mono_ns) {
+  if (!__atomic_load_n(&elog_wall_ready, __ATOMIC_ACQUIRE)) {
+    struct timespec rt;
+
+    elog_lock(&elog_clock_lock);
+    if (!elog_wall_ready) {
+      clock_gettime(CLOCK_REALTIME, &rt);
+      elog_wall_offset =
+          (int64_t)((uint64_t)rt.tv_sec * 1000000000u + (uint64_t)rt.tv_nsec -
+                    elog_now_ns());
+      __atomic_store_n(&elog_wall_ready, 1, __ATOMIC_RELEASE);
+    }
+    elog_unlock(&elog_clock_lock);
+  }
+  return mono_ns + (uint64_t)elog_wall_offset;
+}
+
+#endif /* ELOG_USE_TIMESTAMP */
@@ -0,0 +1,242 @@
+/**
+ * @file elog_crash.c
+ * @brief elog - 致命的なシグナルのハンドラ（ELOG_USE_CRASH_HANDLER=1）
+ *
+ * SIGSEGV などを受けたとき、まだ出力されていないレコードを write(2) で
+ * 書き出し、シグナルの情報とバックトレース（アドレスのみ）を
+ * ELOG_LEVEL_CRITICAL のレコードとして出力してから、元の処理で
+ * シグナルを再送する。
+ * ハンドラ内ではロック・malloc・stdio の関数を使わない。stdout / stderr の
+ * バッファは glibc の FILE の内部から直接書き出す（それ以外の libc では捨てる）。
+ */
+
+#include "elog/elog.h"
+
+#if ELOG_USE_CRASH_HANDLER
+
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#if defined(__GLIBC__)
+#include <execinfo.h>
+
+/* 実行ファイルの読み込み先（PIE のアドレスを addr2line 用に戻すのに使う） */
+extern const char __executable_start[];
+#define ELOG_CRASH_BASE ((const void *)__executable_start)
+#else
+#define ELOG_CRASH_BASE NULL
+#endif
+
+#include "elog_internal.h"
+
+/* バックトレースに含めるフレーム数 */
+#ifndef ELOG_CRASH_FRAMES
+#define ELOG_CRASH_FRAMES 32
+#endif
+
+static const int elog_crash_signals[] = {SIGSEGV, SIGBUS, SIGFPE, SIGILL,
+                                         SIGABRT};
+static const char *const elog_crash_names[] = {"SIGSEGV", "SIGBUS", "SIGFPE",
+                                               "SIGILL", "SIGABRT"};
+
+#define ELOG_CRASH_NSIGNALS \
+  (sizeof(elog_crash_signals) / sizeof(elog_crash_signals[0]))
+
+static struct sigaction elog_crash_old[ELOG_CRASH_NSIGNALS];
+static char elog_crash_stack[ELOG_CRASH_STACK_SIZE];
+static uint8_t elog_crash_installed;
+static uint8_t elog_crash_active;
+
+/* シグナルの情報とバックトレースの1フレームを出力する記述子 */
+static elog_callsite_t elog_crash_cs ELOG_CALLSITE_ATTR = {
+    "fatal signal %d (%s) code=%d addr=%p base=%p", "elog", 0,
+    ELOG_LEVEL_CRITICAL, 0, 0
+#if ELOG_USE_DYNAMIC_DEBUG
+    , "elog_crash"
+#endif
+};
+static elog_callsite_t elog_crash_frame_cs ELOG_CALLSITE_ATTR = {
+    "  #%d %p", "elog", 0, ELOG_LEVEL_CRITICAL, 0, 0
+#if ELOG_USE_DYNAMIC_DEBUG
+    , "elog_crash"
+#endif
+};
+
+/* ============================================================
+ * 1. 出力（async-signal-safe）
+ * ============================================================ */
+
+static void elog_crash_write_fd(int fd, const char *p, size_t len) {
+  while (len > 0) {
+    ssize_t n = write(fd, p, len);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return;
+    }
+    p += n;
+    len -= (size_t)n;
+  }
+}
+
+/* stdio のバッファに残っているデータを fd へ直接書き出す */
+static void elog_crash_drain_stdio(FILE *fp, int fd) {
+#if defined(__GLIBC__)
+  if (fp->_IO_write_ptr > fp->_IO_write_base) {
+    elog_crash_write_fd(fd, fp->_IO_write_base,
+                        (size_t)(fp->_IO_write_ptr - fp->_IO_write_base));
+    fp->_IO_write_ptr = fp->_IO_write_base;
+  }
+#else
+  (void)fp;
+  (void)fd;
+#endif
+}
+
+/* 通常の出力と同じ出力先へ書く（elog_write_fn） */
+static void elog_crash_out(const void *data, size_t len) {
+#if ELOG_SINK_ENABLED
+  elog_sink_crash_write(data, len);
+#elif ELOG_USE_TINY_PRINTF
+  elog_tiny_write((const char *)data, len);
+#else
+  elog_crash_write_fd(STDOUT_FILENO, (const char *)data, len);
+#endif
+}
+
+/* 1レコードを出力する（引数は cs->fmt に従う） */
+static void elog_crash_record(elog_callsite_t *cs, ...) {
+  uint8_t args[64];
+  size_t len;
+  va_list ap;
+
+  va_start(ap, cs);
+  len = elog_args_encode(args, sizeof(args), cs->fmt, ap);
+  va_end(ap);
+#if ELOG_USE_BINARY
+  elog_binary_write(cs, elog_clock_ns_sigsafe(elog_clock_read()), args, len,
+                    elog_crash_out);
+#else
+  {
+    char line[ELOG_LINE_MAX];
+
+    elog_crash_out(line, elog_line_format(line, sizeof(line), cs, args, len));
+  }
+#endif
+}
+
+/* ============================================================
+ * 2. ハンドラ
+ * ============================================================ */
+
+static void elog_crash_handler(int sig, siginfo_t *info, void *uctx) {
+  const char *name = "?";
+  size_t i;
+
+  (void)uctx;
+  if (__atomic_test_and_set(&elog_crash_active, __ATOMIC_ACQUIRE)) {
+    /* 別のスレッドが出力中。そのスレッドの再送でプロセスが終わる */
+    for (;;) {
+      pause();
+    }
+  }
+
+  /* 古いものから: stdio のバッファ、シンクのバッファ、非同期キュー */
+  elog_crash_drain_stdio(stdout, STDOUT_FILENO);
+  elog_crash_drain_stdio(stderr, STDERR_FILENO);
+#if ELOG_SINK_ENABLED
+  elog_sink_crash_flush();
+#endif
+#if ELOG_USE_ASYNC
+  elog_async_crash_drain(elog_crash_out);
+#endif
+
+  for (i = 0; i < ELOG_CRASH_NSIGNALS; i++) {
+    if (elog_crash_signals[i] == sig) {
+      name = elog_crash_names[i];
+    }
+  }
+  elog_crash_record(&elog_crash_cs, sig, name, info->si_code, info->si_addr,
+                    ELOG_CRASH_BASE);
+#if defined(__GLIBC__)
+  {
+    void *frames[ELOG_CRASH_FRAMES];
+    int n = backtrace(frames, ELOG_CRASH_FRAMES);
+    int f;
+
+    for (f = 0; f < n; f++) {
+      elog_crash_record(&elog_crash_frame_cs, f, frames[f]);
+    }
+  }
+#endif
+
+  /* 元の処理に戻して再送する（ハンドラから戻った後に届く） */
+  for (i = 0; i < ELOG_CRASH_NSIGNALS; i++) {
+    if (elog_crash_signals[i] == sig) {
+      sigaction(sig, &elog_crash_old[i], NULL);
+    }
+  }
+  raise(sig);
+}
+
+int elog_crash_handler_install(void) {
+  struct sigaction sa;
+  stack_t ss;
+  size_t i;
+
+  if (__atomic_test_and_set(&elog_crash_installed, __ATOMIC_RELAXED)) {
+    return 0;
+  }
+#if defined(__GLIBC__)
+  {
+    /* backtrace() は初回に libgcc を読み込む（malloc する）ので先に済ませる */
+    void *frame;
+    backtrace(&frame, 1);
+  }
+#endif
+
+  /* スタックオーバーフローでもハンドラを動かせるようにする */
+  ss.ss_sp = elog_crash_stack;
+  ss.ss_size = sizeof(elog_crash_stack);
+  ss.ss_flags = 0;
+  sigaltstack(&ss, NULL);
+
+  memset(&sa, 0, sizeof(sa));
+  sa.sa_sigaction = elog_crash_handler;
+  sa.sa_flags = SA_SIGINFO | SA_ONSTACK;
+  sigemptyset(&sa.sa_mask);
+  for (i = 0; i < ELOG_CRASH_NSIGNALS; i++) {
+    if (sigaction(elog_crash_signals[i], &sa, &elog_crash_old[i]) != 0) {
+      return -1;
+    }
+  }
+  return 0;
+}
+
+void elog_crash_thread_attach(void *stack) {
+  stack_t ss;
+
+  if (stack == NULL ||
+      (sigaltstack(NULL, &ss) == 0 && !(ss.ss_flags & SS_DISABLE))) {
+    return;
+  }
+  ss.ss_sp = stack;
+  ss.ss_size = ELOG_CRASH_STACK_SIZE;
+  ss.ss_flags = 0;
+  sigaltstack(&ss, NULL);
+}
+
+void elog_crash_thread_detach(void *stack) {
+  stack_t ss;
+
+  if (stack != NULL && sigaltstack(NULL, &ss) == 0 && ss.ss_sp == stack &&
+      !(ss.ss_flags & SS_ONSTACK)) {
+    ss.ss_flags = SS_DISABLE;
+    sigaltstack(&ss, NULL);
+  }
+}
+
+#endif /* ELOG_USE_CRASH_HANDLER */
@@ -0,0 +1,265 @@
+/**
+ * @file elog_decode.c
+ * @brief elog - バイナリログのデコーダ
+ *
+ * ELOG_USE_BINARY のストリームを読み、テキスト出力と同じ形の行を復元する。
+ * ホスト側で使うため、こちらは動的メモリ確保を行う。
+ */
+
+#include "elog/elog_decode.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "elog_internal.h"
+
+/* デコード中の状態 */
+typedef struct {
+  FILE *in;
+  elog_callsite_t *sites; /* ID で引くコールサイト表 */
+  uint32_t nsites;
+  uint64_t wall0; /* ストリーム開始時の壁時計 ns */
+  uint64_t mono0; /* ストリーム開始時の単調クロック ns */
+  uint64_t ts;    /* 直前レコードの時刻 */
+} elog_decoder_t;
+
+static int elog_read_varint(FILE *in, uint64_t *v) {
+  uint64_t r = 0;
+  unsigned shift = 0;
+  int c;
+
+  while ((c = fgetc(in)) != EOF && shift < 64) {
+    r |= (uint64_t)(c & 0x7F) << shift;
+    if ((c & 0x80) == 0) {
+      *v = r;
+      return 0;
+    }
+    shift += 7;
+  }
+  return -1;
+}
+
+static char *elog_strdup(const char *str) {
+  char *s;
+
+  if (str == NULL) {
+    return NULL;
+  }
+  s = (char *)malloc(strlen(str) + 1);
+  if (s != NULL) {
+    strcpy(s, str);
+  }
+  return s;
+}
+
+/* コールサイト表を id 個まで広げる */
+static int elog_decode_grow(elog_decoder_t *d, uint64_t id) {
+  elog_callsite_t *sites;
+
+  if (id <= d->nsites) {
+    return 0;
+  }
+  sites = (elog_callsite_t *)realloc(d->sites,
+                                     sizeof(elog_callsite_t) * (size_t)id);
+  if (sites == NULL) {
+    return -1;
+  }
+  memset(sites + d->nsites, 0,
+         sizeof(elog_callsite_t) * (size_t)(id - d->nsites));
+  d->sites = sites;
+  d->nsites = (uint32_t)id;
+  return 0;
+}
+
+/* コールサイトのファイル名・フォーマットとして受け付ける最大の長さ */
+#define ELOG_DECODE_STRING_MAX 65536
+
+/*
+ * 長さ len の文字列を読み込み、NUL 終端した新しい領域を返す。
+ * len はストリームの値（壊れていることもある）なので、上限を超えたら読まない
+ */
+static char *elog_read_string(FILE *in, uint64_t len) {
+  char *s;
+
+  if (len > ELOG_DECODE_STRING_MAX) {
+    return NULL;
+  }
+  s = (char *)malloc((size_t)len + 1);
+  if (s == NULL) {
+    return NULL;
+  }
+  if (len > 0 && fread(s, 1, (size_t)len, in) != (size_t)len) {
+    free(s);
+    return NULL;
+  }
+  s[len] = '\0';
+  return s;
+}
+
+static int elog_decode_callsite(elog_decoder_t *d) {
+  uint64_t id, line, file_len, fmt_len;
+  int level;
+  elog_callsite_t *cs;
+
+  if (elog_read_varint(d->in, &id) != 0 || id == 0 || id > UINT32_MAX ||
+      (level = fgetc(d->in)) == EOF || elog_read_varint(d->in, &line) != 0 ||
+      elog_read_varint(d->in, &file_len) != 0) {
+    return -1;
+  }
+
+  if (elog_decode_grow(d, id) != 0) {
+    return -1;
+  }
+
+  cs = &d->sites[id - 1];
+  free((void *)cs->file);
+  free((void *)cs->fmt);
+  cs->file = NULL;
+  cs->fmt = NULL;
+  if (file_len > 0 &&
+      (cs->file = elog_read_string(d->in, file_len - 1)) == NULL) {
+    return -1;
+  }
+  if (elog_read_varint(d->in, &fmt_len) != 0 ||
+      (cs->fmt = elog_read_string(d->in, fmt_len)) == NULL) {
+    return -1;
+  }
+  cs->line = (uint32_t)line;
+  cs->level = (uint8_t)level;
+  cs->id = (uint32_t)id;
+  return 0;
+}
+
+static void elog_decode_time(const elog_decoder_t *d, FILE *out) {
+  char buf[80];
+
+  fwrite(buf, 1,
+         elog_line_time(buf, sizeof(buf), d->wall0 + (d->ts - d->mono0)), out);
+}
+
+static int elog_decode_record(elog_decoder_t *d, FILE *out, unsigned flags) {
+  uint8_t args[65536];
+  char line[ELOG_LINE_MAX];
+  uint64_t id, delta, len;
+  size_t n;
+
+  if (elog_read_varint(d->in, &id) != 0 ||
+      elog_read_varint(d->in, &delta) != 0 ||
+      elog_read_varint(d->in, &len) != 0 || len > sizeof(args) ||
+      fread(args, 1, (size_t)len, d->in) != (size_t)len) {
+    return -1;
+  }
+  /* zigzag */
+  d->ts += (uint64_t)((int64_t)(delta >> 1) ^ -(int64_t)(delta & 1));
+
+  if (id == 0 || id > d->nsites || d->sites[id - 1].fmt == NULL) {
+    fprintf(out, "<unknown callsite %llu>\n", (unsigned long long)id);
+    return 0;
+  }
+  if (flags & ELOG_DECODE_TIMESTAMP) {
+    elog_decode_time(d, out);
+  }
+  n = elog_line_format(line, sizeof(line), &d->sites[id - 1], args,
+                       (size_t)len);
+  fwrite(line, 1, n, out);
+  return 0;
+}
+
+/* 繰り返し件数は、繰り返されたレコードと同じ行頭で1行にする */
+static int elog_decode_repeated(elog_decoder_t *d, FILE *out,
+                                unsigned flags) {
+  char line[ELOG_LINE_MAX];
+  uint64_t id, count;
+  size_t n;
+
+  if (elog_read_varint(d->in, &id) != 0 ||
+      elog_read_varint(d->in, &count) != 0) {
+    return -1;
+  }
+  if (id == 0 || id > d->nsites || d->sites[id - 1].fmt == NULL) {
+    fprintf(out, "<unknown callsite %llu>\n", (unsigned long long)id);
+    return 0;
+  }
+  if (flags & ELOG_DECODE_TIMESTAMP) {
+    elog_decode_time(d, out);
+  }
+  n = elog_line_repeated(line, sizeof(line), &d->sites[id - 1],
+                         (uint32_t)count);
+  fwrite(line, 1, n, out);
+  return 0;
+}
+
+int elog_binary_decode(FILE *in, FILE *out, unsigned flags) {
+  return elog_binary_decode_with(in, out, flags, NULL, 0);
+}
+
+int elog_binary_decode_with(FILE *in, FILE *out, unsigned flags,
+                            const elog_callsite_t *sites, size_t nsites) {
+  elog_decoder_t d;
+  char magic[ELOG_BIN_MAGIC_LEN];
+  uint64_t stream_flags;
+  int result = 0;
+  int tag;
+  uint32_t i;
+
+  memset(&d, 0, sizeof(d));
+  d.in = in;
+
+  if (fread(magic, 1, sizeof(magic), in) != sizeof(magic) ||
+      memcmp(magic, ELOG_BIN_MAGIC, sizeof(magic)) != 0 ||
+      fgetc(in) != ELOG_BIN_VERSION ||
+      elog_read_varint(in, &stream_flags) != 0 ||
+      elog_read_varint(in, &d.wall0) != 0 ||
+      elog_read_varint(in, &d.mono0) != 0) {
+    return -1;
+  }
+  d.ts = d.mono0;
+
+  /* ID がセクション内インデックスでなければ与えられた表は使えない */
+  if ((stream_flags & ELOG_BIN_FLAG_SECTION_ID) == 0) {
+    nsites = 0;
+  }
+
+  /* 与えられた表をコピー（定義レコードで上書きされうるため所有する） */
+  if (nsites > 0 && elog_decode_grow(&d, nsites) != 0) {
+    return -1;
+  }
+  for (i = 0; i < nsites; i++) {
+    d.sites[i] = sites[i];
+    d.sites[i].fmt = elog_strdup(sites[i].fmt);
+    d.sites[i].file = elog_strdup(sites[i].file);
+  }
+
+  while (result == 0 && (tag = fgetc(in)) != EOF) {
+    switch (tag) {
+      case ELOG_BIN_TAG_CALLSITE:
+        result = elog_decode_callsite(&d);
+        break;
+      case ELOG_BIN_TAG_RECORD:
+        result = elog_decode_record(&d, out, flags);
+        break;
+      case ELOG_BIN_TAG_DROPPED: {
+        uint64_t count;
+        result = elog_read_varint(in, &count);
+        if (result == 0) {
+          fprintf(out, "<%llu records dropped>\n", (unsigned long long)count);
+        }
+        break;
+      }
+      case ELOG_BIN_TAG_REPEATED:
+        result = elog_decode_repeated(&d, out, flags);
+        break;
+      default:
+        result = -1;
+        break;
+    }
+  }
+
+  for (i = 0; i < d.nsites; i++) {
+    free((void *)d.sites[i].file);
+    free((void *)d.sites[i].fmt);
+  }
+  free(d.sites);
+  return result;
+}
@@ -0,0 +1,106 @@
+/**
+ * @file elog_dedup.c
+ * @brief elog - 重複メッセージの抑止
+ *
+ * 直前に出力したレコードのコールサイトと引数のハッシュだけを覚えておき、
+ * 同じ内容が続く間は出力せずに件数を数える。件数は内容が変わったとき、
+ * または ELOG_DEDUP_WINDOW_MS ごとに1行で報告する。
+ * 状態は1件分の固定領域のみで、レコードごとの確保はしない。
+ * 呼び出しの直列化は各バックエンドが行う。
+ */
+
+#include "elog/elog.h"
+
+#if ELOG_USE_DEDUP
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "elog_internal.h"
+
+#define ELOG_DEDUP_FNV_OFFSET 0xcbf29ce484222325ull
+#define ELOG_DEDUP_FNV_PRIME 0x100000001b3ull
+
+static const elog_callsite_t *elog_dedup_cs; /* 直前のコールサイト */
+static uint64_t elog_dedup_hash;             /* 直前の内容のハッシュ */
+static size_t elog_dedup_len;                /* 直前の内容のバイト数 */
+static uint64_t elog_dedup_since_ms;         /* 件数を数え始めた時刻 */
+static uint32_t elog_dedup_repeats;          /* 未報告の繰り返し件数 */
+
+/* FNV-1a を 8 バイト単位で回したもの（比較用で、互換性は不要） */
+static uint64_t elog_dedup_hash_bytes(const void *data, size_t len) {
+  const uint8_t *p = (const uint8_t *)data;
+  uint64_t h = ELOG_DEDUP_FNV_OFFSET;
+  uint64_t w;
+
+  for (; len >= sizeof(w); p += sizeof(w), len -= sizeof(w)) {
+    memcpy(&w, p, sizeof(w));
+    h = (h ^ w) * ELOG_DEDUP_FNV_PRIME;
+  }
+  for (; len > 0; p++, len--) {
+    h = (h ^ *p) * ELOG_DEDUP_FNV_PRIME;
+  }
+  return h;
+}
+
+static uint64_t elog_dedup_now_ms(void) { return elog_now_ns() / 1000000u; }
+
+/* 未報告の件数を rep へ移し、次の区間を始める */
+static void elog_dedup_take(elog_dedup_repeat_t *rep, uint64_t now) {
+  rep->cs = elog_dedup_cs;
+  rep->count = elog_dedup_repeats;
+  elog_dedup_repeats = 0;
+  elog_dedup_since_ms = now;
+}
+
+int elog_dedup_check(const elog_callsite_t *cs, const void *data, size_t len,
+                     elog_dedup_repeat_t *rep) {
+  uint64_t hash = elog_dedup_hash_bytes(data, len);
+  uint64_t now = elog_dedup_now_ms();
+
+  rep->cs = NULL;
+  rep->count = 0;
+
+  if (cs == elog_dedup_cs && hash == elog_dedup_hash &&
+      len == elog_dedup_len) {
+#if !ELOG_USE_ASYNC
+    static uint8_t atexit_registered;
+
+    /* 非同期ではコンシューマの停止時に報告する */
+    if (!atexit_registered) {
+      atexit_registered = 1;
+      atexit(elog_dedup_flush);
+    }
+#endif
+    elog_dedup_repeats++;
+    if (now - elog_dedup_since_ms >= ELOG_DEDUP_WINDOW_MS) {
+      elog_dedup_take(rep, now);
+    }
+    return 1;
+  }
+
+  if (elog_dedup_repeats > 0) {
+    elog_dedup_take(rep, now);
+  }
+  elog_dedup_cs = cs;
+  elog_dedup_hash = hash;
+  elog_dedup_len = len;
+  elog_dedup_since_ms = now;
+  return 0;
+}
+
+int elog_dedup_expire(int force, elog_dedup_repeat_t *rep) {
+  uint64_t now;
+
+  if (elog_dedup_repeats == 0) {
+    return 0;
+  }
+  now = elog_dedup_now_ms();
+  if (!force && now - elog_dedup_since_ms < ELOG_DEDUP_WINDOW_MS) {
+    return 0;
+  }
+  elog_dedup_take(rep, now);
+  return 1;
+}
+
+#endif /* ELOG_USE_DEDUP */
@@ -0,0 +1,234 @@
+/**
+ * @file elog_dyndbg.c
+ * @brief elog - コールサイトごとの有効化（動的デバッグ）
+ *
+ * elog_meta セクションの記述子を走査し、条件に一致したものの
+ * ELOG_CALLSITE_ENABLED フラグを切り替える。問い合わせの書式は
+ * Linux の dynamic_debug の control ファイルに合わせている。
+ */
+
+#include "elog/elog.h"
+
+#if ELOG_USE_DYNAMIC_DEBUG
+
+#include <stdlib.h>
+#include <string.h>
+
+/* 問い合わせ中の1つの値の最大長 */
+#define ELOG_QUERY_VALUE_MAX 128
+
+/* ============================================================
+ * 1. 照合
+ * ============================================================ */
+
+/* * と ? だけを扱うワイルドカード照合 */
+static int elog_glob_match(const char *pat, const char *str) {
+  const char *star = NULL;
+  const char *retry = NULL;
+
+  while (*str != '\0') {
+    if (*pat == '*') {
+      star = pat++;
+      retry = str;
+    } else if (*pat == '?' || *pat == *str) {
+      pat++;
+      str++;
+    } else if (star != NULL) {
+      pat = star + 1;
+      str = ++retry;
+    } else {
+      return 0;
+    }
+  }
+  while (*pat == '*') {
+    pat++;
+  }
+  return *pat == '\0';
+}
+
+static int elog_callsite_matches(const elog_callsite_t *cs,
+                                 const elog_callsite_match_t *m) {
+  if (m == NULL) {
+    return 1;
+  }
+  if (m->file != NULL &&
+      (cs->file == NULL || !elog_glob_match(m->file, cs->file))) {
+    return 0;
+  }
+  if (m->func != NULL &&
+      (cs->func == NULL || !elog_glob_match(m->func, cs->func))) {
+    return 0;
+  }
+  if (m->format != NULL && strstr(cs->fmt, m->format) == NULL) {
+    return 0;
+  }
+  if (m->line_min != 0 && cs->line < m->line_min) {
+    return 0;
+  }
+  if (m->line_max != 0 && cs->line > m->line_max) {
+    return 0;
+  }
+  return 1;
+}
+
+size_t elog_callsite_set_enabled(const elog_callsite_match_t *match,
+                                 int enabled) {
+  size_t i, n = elog_callsite_count(), hits = 0;
+
+  for (i = 0; i < n; i++) {
+    elog_callsite_t *cs = elog_callsite_at(i);
+
+    if (!elog_callsite_matches(cs, match)) {
+      continue;
+    }
+    if (enabled) {
+      cs->flags = (uint8_t)(cs->flags | ELOG_CALLSITE_ENABLED);
+    } else {
+      cs->flags = (uint8_t)(cs->flags & ~ELOG_CALLSITE_ENABLED);
+    }
+    hits++;
+  }
+  return hits;
+}
+
+/* ============================================================
+ * 2. 問い合わせの解析
+ * ============================================================ */
+
+/*
+ * 次の語を dst へ取り出す（"..." で囲めば空白を含められる）
+ * @return 1: 取り出した, 0: 語がない, -1: 長すぎる・引用符が閉じていない
+ */
+static int elog_query_word(const char **sp, char *dst) {
+  const char *s = *sp;
+  size_t len = 0;
+  char quote = 0;
+
+  while (*s == ' ' || *s == '\t' || *s == '\n') {
+    s++;
+  }
+  if (*s == '\0') {
+    return 0;
+  }
+  if (*s == '"' || *s == '\'') {
+    quote = *s++;
+  }
+  while (*s != '\0') {
+    if (quote != 0 ? *s == quote
+                   : (*s == ' ' || *s == '\t' || *s == '\n')) {
+      break;
+    }
+    if (len + 1 >= ELOG_QUERY_VALUE_MAX) {
+      return -1;
+    }
+    dst[len++] = *s++;
+  }
+  if (quote != 0) {
+    if (*s != quote) {
+      return -1;
+    }
+    s++;
+  }
+  dst[len] = '\0';
+  *sp = s;
+  return 1;
+}
+
+/* 行番号の指定: N, N-M, N-, -M */
+static int elog_query_lines(const char *s, elog_callsite_match_t *m) {
+  char *end;
+
+  if (*s != '-') {
+    m->line_min = (uint32_t)strtoul(s, &end, 10);
+    if (end == s) {
+      return -1;
+    }
+    s = end;
+    if (*s == '\0') {
+      m->line_max = m->line_min;
+      return 0;
+    }
+  }
+  if (*s++ != '-') {
+    return -1;
+  }
+  if (*s != '\0') {
+    m->line_max = (uint32_t)strtoul(s, &end, 10);
+    if (end == s || *end != '\0') {
+      return -1;
+    }
+  }
+  return 0;
+}
+
+/* フラグ操作: +p, -p, =p, =_（= のみも無効化） */
+static int elog_query_flags(const char *s, int *enabled) {
+  char op = *s++;
+  int p = 0;
+
+  if (op != '+' && op != '-' && op != '=') {
+    return -1;
+  }
+  if (*s == '\0' && op != '=') {
+    return -1;
+  }
+  for (; *s != '\0'; s++) {
+    if (*s == 'p') {
+      p = 1;
+    } else if (*s != '_') {
+      return -1;
+    }
+  }
+  *enabled = op == '-' ? 0 : (op == '+' ? 1 : p);
+  return 0;
+}
+
+int elog_callsite_query(const char *query) {
+  char key[ELOG_QUERY_VALUE_MAX];
+  char file[ELOG_QUERY_VALUE_MAX];
+  char func[ELOG_QUERY_VALUE_MAX];
+  char format[ELOG_QUERY_VALUE_MAX];
+  char value[ELOG_QUERY_VALUE_MAX];
+  elog_callsite_match_t m;
+  const char *s = query;
+  int enabled = -1;
+  int r;
+
+  memset(&m, 0, sizeof(m));
+  while ((r = elog_query_word(&s, key)) > 0) {
+    if (enabled >= 0) {
+      return -1; /* フラグ操作は最後 */
+    }
+    if (key[0] == '+' || key[0] == '-' || key[0] == '=') {
+      if (elog_query_flags(key, &enabled) != 0) {
+        return -1;
+      }
+      continue;
+    }
+    if (elog_query_word(&s, value) <= 0) {
+      return -1;
+    }
+    if (strcmp(key, "file") == 0) {
+      strcpy(file, value);
+      m.file = file;
+    } else if (strcmp(key, "func") == 0) {
+      strcpy(func, value);
+      m.func = func;
+    } else if (strcmp(key, "format") == 0) {
+      strcpy(format, value);
+      m.format = format;
+    } else if (strcmp(key, "line") == 0) {
+      if (elog_query_lines(value, &m) != 0) {
+        return -1;
+      }
+    } else {
+      return -1;
+    }
+  }
+  if (r < 0 || enabled < 0) {
+    return -1;
+  }
+  return (int)elog_callsite_set_enabled(&m, enabled);
+}
+
+#endif /* ELOG_USE_DYNAMIC_DEBUG */
@@ -0,0 +1,105 @@
+/**
+ * @file elog_flight.c
+ * @brief elog - フライトレコーダ（ELOG_USE_FLIGHT_RECORDER=1）
+ *
+ * 実行時レベルで除外されたレコードを、整形せずにエンコード済み引数のまま
+ * スレッドごとの固定長リングへ記録する（古いものから上書き）。
+ * リングはエラーレベルのレコードを出力する直前、または elog_flight_dump() で
+ * 記録した時刻のままバックエンド（elog_emit_args_at）へ流す。
+ * リングは所有スレッドだけが読み書きするため、ロックは使わない。
+ */
+
+#include "elog/elog.h"
+
+#if ELOG_USE_FLIGHT_RECORDER
+
+#include <stdarg.h>
+#include <string.h>
+
+#include "elog_internal.h"
+
+#if (ELOG_FLIGHT_RECORDS & (ELOG_FLIGHT_RECORDS - 1)) != 0
+#error "ELOG_FLIGHT_RECORDS must be a power of two"
+#endif
+
+#define ELOG_FLIGHT_MASK ((uint64_t)ELOG_FLIGHT_RECORDS - 1)
+
+/* 時刻を残す必要がある構成（タイムスタンプ表示・非同期のマージ・バイナリ） */
+#define ELOG_FLIGHT_USE_TS \
+  (ELOG_USE_TIMESTAMP || ELOG_USE_ASYNC || ELOG_USE_BINARY)
+
+volatile uint8_t elog_flight_level = ELOG_COMPILED_LEVEL;
+
+/* ============================================================
+ * 1. スレッドごとのリング
+ * ============================================================ */
+
+typedef struct {
+  elog_callsite_t *cs; /* コールサイト記述子 */
+  uint64_t ts;         /* elog_clock_read() の値（不要な構成では 0） */
+  uint16_t len;        /* args の有効バイト数 */
+  uint8_t args[ELOG_FLIGHT_RECORD_SIZE - sizeof(void *) - sizeof(uint64_t) -
+               sizeof(uint16_t)];
+} elog_flight_slot_t;
+
+typedef struct {
+  uint64_t head; /* 次に出力するレコード */
+  uint64_t tail; /* 次に書き込むレコード */
+  elog_flight_slot_t slots[ELOG_FLIGHT_RECORDS];
+} elog_flight_ring_t;
+
+static __thread elog_flight_ring_t elog_flight_ring;
+
+/* 書き込む位置を返す（満杯なら最も古いレコードを捨てる） */
+static elog_flight_slot_t *elog_flight_reserve(elog_callsite_t *cs) {
+  elog_flight_ring_t *r = &elog_flight_ring;
+  elog_flight_slot_t *slot = &r->slots[r->tail & ELOG_FLIGHT_MASK];
+
+  if (r->tail - r->head == ELOG_FLIGHT_RECORDS) {
+    r->head++;
+  }
+  slot->cs = cs;
+  slot->ts = ELOG_FLIGHT_USE_TS ? elog_clock_read() : 0;
+  return slot;
+}
+
+/* ============================================================
+ * 2. 記録と出力
+ * ============================================================ */
+
+void elog_flight_record(elog_callsite_t *cs, const char *fmt, ...) {
+  elog_flight_slot_t *slot = elog_flight_reserve(cs);
+  va_list ap;
+
+  va_start(ap, fmt);
+  slot->len = (uint16_t)elog_args_encode(slot->args, sizeof(slot->args), fmt,
+                                         ap);
+  va_end(ap);
+  elog_flight_ring.tail++;
+}
+
+void elog_flight_record_args(elog_callsite_t *cs, const uint8_t *args,
+                             size_t len) {
+  elog_flight_slot_t *slot = elog_flight_reserve(cs);
+
+  /* 入りきらない引数は出力側で "?" になる */
+  if (len > sizeof(slot->args)) {
+    len = sizeof(slot->args);
+  }
+  memcpy(slot->args, args, len);
+  slot->len = (uint16_t)len;
+  elog_flight_ring.tail++;
+}
+
+void elog_flight_dump(void) {
+  elog_flight_ring_t *r = &elog_flight_ring;
+
+  while (r->head != r->tail) {
+    const elog_flight_slot_t *slot = &r->slots[r->head & ELOG_FLIGHT_MASK];
+
+    r->head++;
+    elog_emit_args_at(slot->cs, slot->ts, slot->args, slot->len);
+  }
+}
+
+#endif /* ELOG_USE_FLIGHT_RECORDER */
@@ -0,0 +1,757 @@
+/**
+ * @file elog_format.c
+ * @brief elog - 値の整形（snprintf の置き換え）
+ *
+ * ログで使う printf の部分集合（%d %i %u %o %x %X %c %s %p %f %F と
+ * フラグ・幅・精度）を libc を通さずに整形する。整数は2桁ずつの表引き、
+ * %f は整数部と精度分の小数部をそれぞれ整数として変換する。
+ * ロケール・FILE ロックとは無関係で、出力は glibc の snprintf と同じになる。
+ * 表現できないもの（%e %g %a、long double、丸めが際どい値など）は
+ * snprintf に任せる。
+ */
+
+#include <math.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "elog_internal.h"
+
+/* ============================================================
+ * 1. libc による整形
+ * ============================================================ */
+
+/* snprintf の戻り値を書き込めた文字数に丸める */
+static size_t elog_fmt_clamp(int n, size_t cap) {
+  if (n < 0 || cap == 0) {
+    return 0;
+  }
+  return (size_t)n < cap ? (size_t)n : cap - 1;
+}
+
+/* 解析結果から単一の変換指定を組み立てる（'*' は数値に置き換える） */
+static void elog_spec_build(char *out, size_t cap, const elog_spec_t *spec) {
+  static const char *const len_str[] = {"", "hh", "h", "l", "ll",
+                                        "j", "z", "t", "L"};
+  char width[16] = "";
+  char prec[16] = "";
+
+  if (spec->width >= 0) {
+    snprintf(width, sizeof(width), "%d", spec->width);
+  }
+  if (spec->precision >= 0) {
+    snprintf(prec, sizeof(prec), ".%d", spec->precision);
+  }
+  snprintf(out, cap, "%%%s%s%s%s%c", spec->flags, width, prec,
+           len_str[spec->len], spec->conv);
+}
+
+#if !ELOG_USE_FAST_FORMAT
+static size_t elog_fmt_libc_signed(char *dst, size_t cap,
+                                   const elog_spec_t *spec, int64_t v) {
+  char one[48];
+
+  elog_spec_build(one, sizeof(one), spec);
+  switch (spec->len) {
+    case ELOG_LEN_L:
+      return elog_fmt_clamp(snprintf(dst, cap, one, (long)v), cap);
+    case ELOG_LEN_LL:
+      return elog_fmt_clamp(snprintf(dst, cap, one, (long long)v), cap);
+    case ELOG_LEN_J:
+      return elog_fmt_clamp(snprintf(dst, cap, one, (intmax_t)v), cap);
+    case ELOG_LEN_Z:
+      return elog_fmt_clamp(snprintf(dst, cap, one, (size_t)v), cap);
+    case ELOG_LEN_T:
+      return elog_fmt_clamp(snprintf(dst, cap, one, (ptrdiff_t)v), cap);
+    default:
+      return elog_fmt_clamp(snprintf(dst, cap, one, (int)v), cap);
+  }
+}
+
+static size_t elog_fmt_libc_unsigned(char *dst, size_t cap,
+                                     const elog_spec_t *spec, uint64_t v) {
+  char one[48];
+
+  elog_spec_build(one, sizeof(one), spec);
+  switch (spec->len) {
+    case ELOG_LEN_L:
+      return elog_fmt_clamp(snprintf(dst, cap, one, (unsigned long)v), cap);
+    case ELOG_LEN_LL:
+      return elog_fmt_clamp(snprintf(dst, cap, one, (unsigned long long)v),
+                            cap);
+    case ELOG_LEN_J:
+      return elog_fmt_clamp(snprintf(dst, cap, one, (uintmax_t)v), cap);
+    case ELOG_LEN_Z:
+      return elog_fmt_clamp(snprintf(dst, cap, one, (size_t)v), cap);
+    case ELOG_LEN_T:
+      return elog_fmt_clamp(snprintf(dst, cap, one, (ptrdiff_t)v), cap);
+    default:
+      return elog_fmt_clamp(snprintf(dst, cap, one, (unsigned int)v), cap);
+  }
+}
+#endif /* !ELOG_USE_FAST_FORMAT */
+
+static size_t elog_fmt_libc_char(char *dst, size_t cap,
+                                 const elog_spec_t *spec, int c) {
+  elog_spec_t one_spec = *spec;
+  char one[48];
+
+  one_spec.len = ELOG_LEN_NONE;
+  elog_spec_build(one, sizeof(one), &one_spec);
+  return elog_fmt_clamp(snprintf(dst, cap, one, c), cap);
+}
+
+static size_t elog_fmt_libc_pointer(char *dst, size_t cap,
+                                    const elog_spec_t *spec, uintptr_t v) {
+  char one[48];
+
+  elog_spec_build(one, sizeof(one), spec);
+  return elog_fmt_clamp(snprintf(dst, cap, one, (void *)v), cap);
+}
+
+static size_t elog_fmt_libc_string(char *dst, size_t cap,
+                                   const elog_spec_t *spec, const char *s,
+                                   size_t len) {
+  elog_spec_t one_spec = *spec;
+  char one[48];
+
+  /* 本体は NUL 終端されていないので精度で長さを制限する */
+  one_spec.len = ELOG_LEN_NONE;
+  if (one_spec.precision < 0 || (size_t)one_spec.precision > len) {
+    one_spec.precision = (int)len;
+  }
+  elog_spec_build(one, sizeof(one), &one_spec);
+  return elog_fmt_clamp(snprintf(dst, cap, one, s), cap);
+}
+
+static size_t elog_fmt_libc_double(char *dst, size_t cap,
+                                   const elog_spec_t *spec, double v) {
+  char one[48];
+
+  elog_spec_build(one, sizeof(one), spec);
+  if (spec->len == ELOG_LEN_BIG_L) {
+    return elog_fmt_clamp(snprintf(dst, cap, one, (long double)v), cap);
+  }
+  return elog_fmt_clamp(snprintf(dst, cap, one, v), cap);
+}
+
+#if ELOG_USE_FAST_FORMAT
+
+/* ============================================================
+ * 2. 数字列の生成
+ * ============================================================ */
+
+#define ELOG_FMT_MINUS 0x01u
+#define ELOG_FMT_PLUS 0x02u
+#define ELOG_FMT_SPACE 0x04u
+#define ELOG_FMT_ALT 0x08u
+#define ELOG_FMT_ZERO 0x10u
+
+/* 64 ビットの8進数（22桁）と %f の整数部 + 小数部が入る大きさ */
+#define ELOG_FMT_DIGITS_MAX 48
+
+/* 00 〜 99 の2桁表 */
+static const char elog_fmt_digits2[200] =
+    "0001020304050607080910111213141516171819"
+    "2021222324252627282930313233343536373839"
+    "4041424344454647484950515253545556575859"
+    "6061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+static const char elog_fmt_hex_lower[] = "0123456789abcdef";
+static const char elog_fmt_hex_upper[] = "0123456789ABCDEF";
+
+static unsigned elog_fmt_flags(const elog_spec_t *spec) {
+  unsigned flags = 0;
+  const char *f;
+
+  for (f = spec->flags; *f != '\0'; f++) {
+    switch (*f) {
+      case '-':
+        flags |= ELOG_FMT_MINUS;
+        break;
+      case '+':
+        flags |= ELOG_FMT_PLUS;
+        break;
+      case ' ':
+        flags |= ELOG_FMT_SPACE;
+        break;
+      case '#':
+        flags |= ELOG_FMT_ALT;
+        break;
+      default:
+        flags |= ELOG_FMT_ZERO;
+        break;
+    }
+  }
+  return flags;
+}
+
+/* v を10進で end の手前へ書き、先頭を返す */
+static char *elog_fmt_dec(char *end, uint64_t v) {
+  while (v >= 100) {
+    unsigned r = (unsigned)(v % 100);
+
+    v /= 100;
+    end -= 2;
+    memcpy(end, &elog_fmt_digits2[r * 2], 2);
+  }
+  if (v >= 10) {
+    end -= 2;
+    memcpy(end, &elog_fmt_digits2[v * 2], 2);
+  } else {
+    *--end = (char)('0' + v);
+  }
+  return end;
+}
+
+/* v の10進の桁数 */
+static inline size_t elog_fmt_dec_len(uint64_t v) {
+  size_t n = 1;
+
+  for (; v >= 10000; v /= 10000) {
+    n += 4;
+  }
+  return n + (v >= 10) + (v >= 100) + (v >= 1000);
+}
+
+/* v を width 桁（0 埋め）の10進で end の手前へ書き、先頭を返す */
+static char *elog_fmt_dec_fixed(char *end, uint64_t v, int width) {
+  for (; width >= 2; width -= 2) {
+    unsigned r = (unsigned)(v % 100);
+
+    v /= 100;
+    end -= 2;
+    memcpy(end, &elog_fmt_digits2[r * 2], 2);
+  }
+  if (width > 0) {
+    *--end = (char)('0' + v % 10);
+  }
+  return end;
+}
+
+static char *elog_fmt_radix(char *end, uint64_t v, char conv) {
+  const char *digits = conv == 'X' ? elog_fmt_hex_upper : elog_fmt_hex_lower;
+
+  switch (conv) {
+    case 'x':
+    case 'X':
+      do {
+        *--end = digits[v & 0xf];
+        v >>= 4;
+      } while (v != 0);
+      return end;
+    case 'o':
+      do {
+        *--end = (char)('0' + (v & 7));
+        v >>= 3;
+      } while (v != 0);
+      return end;
+    default:
+      return elog_fmt_dec(end, v);
+  }
+}
+
+/* ============================================================
+ * 3. 幅合わせ
+ * ============================================================ */
+
+/*
+ * 16 バイトまでは両端から重ねて固定長で写す（libc を呼ばない）
+ * ログの引数やリテラルの断片はほとんどがこの範囲に収まる
+ */
+static inline void elog_fmt_copy(char *dst, const char *s, size_t n) {
+  if (n > 16) {
+    memcpy(dst, s, n);
+  } else if (n >= 8) {
+    memcpy(dst, s, 8);
+    memcpy(dst + n - 8, s + n - 8, 8);
+  } else if (n >= 4) {
+    memcpy(dst, s, 4);
+    memcpy(dst + n - 4, s + n - 4, 4);
+  } else if (n > 0) {
+    dst[0] = s[0];
+    dst[n / 2] = s[n / 2];
+    dst[n - 1] = s[n - 1];
+  }
+}
+
+static inline size_t elog_fmt_put(char *dst, size_t cap, size_t pos,
+                                  const char *s, size_t n) {
+  if (n > cap - 1 - pos) {
+    n = cap - 1 - pos;
+  }
+  elog_fmt_copy(dst + pos, s, n);
+  return pos + n;
+}
+
+/* 埋める文字数は 0 のことが多いので、そのときは libc を呼ばない */
+static inline size_t elog_fmt_fill(char *dst, size_t cap, size_t pos, char c,
+                                   size_t n) {
+  if (n > cap - 1 - pos) {
+    n = cap - 1 - pos;
+  }
+  if (n > 0) {
+    memset(dst + pos, c, n);
+  }
+  return pos + n;
+}
+
+/*
+ * [空白][prefix][0 埋め][body][空白] の形で幅に合わせて書く
+ * ELOG_FMT_ZERO は呼び出し側で適用できる場合だけ残しておくこと
+ */
+static size_t elog_fmt_emit(char *dst, size_t cap, unsigned flags, int width,
+                            const char *prefix, size_t plen, size_t zeros,
+                            const char *body, size_t blen) {
+  size_t total = plen + zeros + blen;
+  size_t pad = width > 0 && (size_t)width > total ? (size_t)width - total : 0;
+  size_t pos = 0;
+
+  if (cap == 0) {
+    return 0;
+  }
+  if (!(flags & ELOG_FMT_MINUS)) {
+    if (flags & ELOG_FMT_ZERO) {
+      zeros += pad;
+    } else {
+      pos = elog_fmt_fill(dst, cap, pos, ' ', pad);
+    }
+    pad = 0;
+  }
+  pos = elog_fmt_put(dst, cap, pos, prefix, plen);
+  pos = elog_fmt_fill(dst, cap, pos, '0', zeros);
+  pos = elog_fmt_put(dst, cap, pos, body, blen);
+  pos = elog_fmt_fill(dst, cap, pos, ' ', pad);
+  dst[pos] = '\0';
+  return pos;
+}
+
+/* 符号の文字（なければ 0 文字） */
+static size_t elog_fmt_sign(char *out, unsigned flags, int negative) {
+  if (negative) {
+    *out = '-';
+  } else if (flags & ELOG_FMT_PLUS) {
+    *out = '+';
+  } else if (flags & ELOG_FMT_SPACE) {
+    *out = ' ';
+  } else {
+    return 0;
+  }
+  return 1;
+}
+
+/* ============================================================
+ * 4. 整数
+ * ============================================================ */
+
+static int64_t elog_fmt_trunc_signed(uint8_t len, int64_t v) {
+  switch (len) {
+    case ELOG_LEN_HH:
+      return (signed char)v;
+    case ELOG_LEN_H:
+      return (short)v;
+    case ELOG_LEN_L:
+      return (long)v;
+    case ELOG_LEN_LL:
+    case ELOG_LEN_J:
+      return v;
+    case ELOG_LEN_Z:
+    case ELOG_LEN_T:
+      return (ptrdiff_t)v;
+    default:
+      return (int)v;
+  }
+}
+
+static uint64_t elog_fmt_trunc_unsigned(uint8_t len, uint64_t v) {
+  switch (len) {
+    case ELOG_LEN_HH:
+      return (unsigned char)v;
+    case ELOG_LEN_H:
+      return (unsigned short)v;
+    case ELOG_LEN_L:
+      return (unsigned long)v;
+    case ELOG_LEN_LL:
+    case ELOG_LEN_J:
+      return v;
+    case ELOG_LEN_Z:
+    case ELOG_LEN_T:
+      return (size_t)v;
+    default:
+      return (unsigned int)v;
+  }
+}
+
+static size_t elog_fmt_integer(char *dst, size_t cap, const elog_spec_t *spec,
+                               unsigned flags, char *prefix, size_t plen,
+                               uint64_t v) {
+  char buf[ELOG_FMT_DIGITS_MAX];
+  char *end = buf + sizeof(buf);
+  char *body = end;
+  size_t blen, zeros = 0;
+
+  /* 幅・精度なしの10進（ほとんどの呼び出し）は dst へ直接書く */
+  if (spec->conv != 'o' && spec->conv != 'x' && spec->conv != 'X' &&
+      spec->width <= 0 && spec->precision < 0 && cap > plen + 20) {
+    blen = plen + elog_fmt_dec_len(v);
+    if (plen > 0) {
+      dst[0] = prefix[0];
+    }
+    elog_fmt_dec(dst + blen, v);
+    dst[blen] = '\0';
+    return blen;
+  }
+
+  /* 精度 0 の 0 は数字を書かない */
+  if (spec->precision != 0 || v != 0) {
+    body = elog_fmt_radix(end, v, spec->conv);
+  }
+  blen = (size_t)(end - body);
+  if (spec->precision > 0 && (size_t)spec->precision > blen) {
+    zeros = (size_t)spec->precision - blen;
+  }
+  if (flags & ELOG_FMT_ALT) {
+    if (spec->conv == 'o') {
+      /* 先頭が 0 になるようにする */
+      if (zeros == 0 && (blen == 0 || *body != '0')) {
+        zeros = 1;
+      }
+    } else if ((spec->conv == 'x' || spec->conv == 'X') && v != 0) {
+      prefix[plen++] = '0';
+      prefix[plen++] = spec->conv;
+    }
+  }
+  if (spec->precision >= 0) {
+    flags &= ~ELOG_FMT_ZERO;
+  }
+  return elog_fmt_emit(dst, cap, flags, spec->width, prefix, plen, zeros, body,
+                       blen);
+}
+
+size_t elog_format_signed(char *dst, size_t cap, const elog_spec_t *spec,
+                          int64_t v) {
+  unsigned flags = elog_fmt_flags(spec);
+  char prefix[4];
+  size_t plen;
+
+  v = elog_fmt_trunc_signed(spec->len, v);
+  plen = elog_fmt_sign(prefix, flags, v < 0);
+  return elog_fmt_integer(dst, cap, spec, flags, prefix, plen,
+                          v < 0 ? 0 - (uint64_t)v : (uint64_t)v);
+}
+
+size_t elog_format_unsigned(char *dst, size_t cap, const elog_spec_t *spec,
+                            uint64_t v) {
+  char prefix[4];
+
+  return elog_fmt_integer(dst, cap, spec, elog_fmt_flags(spec), prefix, 0,
+                          elog_fmt_trunc_unsigned(spec->len, v));
+}
+
+/* ============================================================
+ * 5. 文字・文字列・ポインタ
+ * ============================================================ */
+
+size_t elog_format_char(char *dst, size_t cap, const elog_spec_t *spec,
+                        int c) {
+  unsigned flags = elog_fmt_flags(spec);
+  char ch = (char)c;
+
+  if (flags & ELOG_FMT_ZERO) {
+    return elog_fmt_libc_char(dst, cap, spec, c);
+  }
+  return elog_fmt_emit(dst, cap, flags, spec->width, "", 0, 0, &ch, 1);
+}
+
+size_t elog_format_string(char *dst, size_t cap, const elog_spec_t *spec,
+                          const char *s, size_t len) {
+  unsigned flags = elog_fmt_flags(spec);
+
+  if (flags & ELOG_FMT_ZERO) {
+    return elog_fmt_libc_string(dst, cap, spec, s, len);
+  }
+  if (spec->precision >= 0 && (size_t)spec->precision < len) {
+    len = (size_t)spec->precision;
+  }
+  return elog_fmt_emit(dst, cap, flags, spec->width, "", 0, 0, s, len);
+}
+
+size_t elog_format_pointer(char *dst, size_t cap, const elog_spec_t *spec,
+                           uintptr_t v) {
+#if defined(__GLIBC__)
+  unsigned flags = elog_fmt_flags(spec);
+  char buf[ELOG_FMT_DIGITS_MAX];
+  char *end = buf + sizeof(buf);
+  char *body;
+
+  /* glibc の表記（"0x..." / "(nil)"）。フラグ・精度付きは任せる */
+  if ((flags & ~ELOG_FMT_MINUS) != 0 || spec->precision >= 0) {
+    return elog_fmt_libc_pointer(dst, cap, spec, v);
+  }
+  if (v == 0) {
+    return elog_fmt_emit(dst, cap, flags, spec->width, "", 0, 0, "(nil)", 5);
+  }
+  body = elog_fmt_radix(end, v, 'x');
+  return elog_fmt_emit(dst, cap, flags, spec->width, "0x", 2, 0, body,
+                       (size_t)(end - body));
+#else
+  /* %p の表記は libc ごとに異なる */
+  return elog_fmt_libc_pointer(dst, cap, spec, v);
+#endif
+}
+
+/* ============================================================
+ * 6. 浮動小数点（%f）
+ * ============================================================ */
+
+/* 高速に扱う精度の上限（小数部を 64 ビット整数で持てる範囲） */
+#define ELOG_FMT_FLOAT_PREC_MAX 9
+
+/* 整数部をそのまま uint64_t で扱える上限 */
+#define ELOG_FMT_FLOAT_MAX 1e18
+
+/*
+ * 小数部 * 10^精度 の端数がこれより 0.5 に近い場合は丸めの向きを
+ * 決められないので snprintf に任せる（乗算の誤差は 1e-7 未満）
+ */
+#define ELOG_FMT_FLOAT_TIE_EPS 1e-6
+
+static const double elog_fmt_pow10[ELOG_FMT_FLOAT_PREC_MAX + 1] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9};
+
+size_t elog_format_double(char *dst, size_t cap, const elog_spec_t *spec,
+                          double v) {
+  unsigned flags = elog_fmt_flags(spec);
+  int prec = spec->precision >= 0 ? spec->precision : 6;
+  char buf[ELOG_FMT_DIGITS_MAX];
+  char *end = buf + sizeof(buf);
+  char *body;
+  char prefix[4];
+  size_t plen;
+  double a, scaled, rem;
+  uint64_t ip, frac;
+
+  if ((spec->conv != 'f' && spec->conv != 'F') ||
+      prec > ELOG_FMT_FLOAT_PREC_MAX || !isfinite(v)) {
+    return elog_fmt_libc_double(dst, cap, spec, v);
+  }
+  a = signbit(v) ? -v : v;
+  if (a >= ELOG_FMT_FLOAT_MAX) {
+    return elog_fmt_libc_double(dst, cap, spec, v);
+  }
+
+  /* 整数部を引いた残りは誤差なく求まる。乗算だけが丸められる */
+  ip = (uint64_t)a;
+  scaled = (a - (double)ip) * elog_fmt_pow10[prec];
+  frac = (uint64_t)scaled;
+  rem = scaled - (double)frac;
+  if (rem > 0.5 - ELOG_FMT_FLOAT_TIE_EPS && rem < 0.5 + ELOG_FMT_FLOAT_TIE_EPS) {
+    return elog_fmt_libc_double(dst, cap, spec, v);
+  }
+  if (rem > 0.5 && ++frac == (uint64_t)elog_fmt_pow10[prec]) {
+    frac = 0;
+    ip++;
+  }
+
+  body = elog_fmt_dec_fixed(end, frac, prec);
+  if (prec > 0 || (flags & ELOG_FMT_ALT)) {
+    *--body = '.';
+  }
+  body = elog_fmt_dec(body, ip);
+
+  plen = elog_fmt_sign(prefix, flags, signbit(v) != 0);
+  return elog_fmt_emit(dst, cap, flags, spec->width, prefix, plen, 0, body,
+                       (size_t)(end - body));
+}
+
+#else /* !ELOG_USE_FAST_FORMAT */
+
+size_t elog_format_signed(char *dst, size_t cap, const elog_spec_t *spec,
+                          int64_t v) {
+  return elog_fmt_libc_signed(dst, cap, spec, v);
+}
+
+size_t elog_format_unsigned(char *dst, size_t cap, const elog_spec_t *spec,
+                            uint64_t v) {
+  return elog_fmt_libc_unsigned(dst, cap, spec, v);
+}
+
+size_t elog_format_char(char *dst, size_t cap, const elog_spec_t *spec,
+                        int c) {
+  return elog_fmt_libc_char(dst, cap, spec, c);
+}
+
+size_t elog_format_string(char *dst, size_t cap, const elog_spec_t *spec,
+                          const char *s, size_t len) {
+  return elog_fmt_libc_string(dst, cap, spec, s, len);
+}
+
+size_t elog_format_pointer(char *dst, size_t cap, const elog_spec_t *spec,
+                           uintptr_t v) {
+  return elog_fmt_libc_pointer(dst, cap, spec, v);
+}
+
+size_t elog_format_double(char *dst, size_t cap, const elog_spec_t *spec,
+                          double v) {
+  return elog_fmt_libc_double(dst, cap, spec, v);
+}
+
+#endif /* ELOG_USE_FAST_FORMAT */
+
+/* ============================================================
+ * 7. フォーマット文字列全体
+ * ============================================================ */
+
+#if ELOG_USE_FAST_FORMAT
+/* 本体で va_list をポインタ経由で扱うためのラッパー */
+static size_t elog_vformat_ap(char *dst, size_t cap, const char *fmt,
+                              va_list *ap) {
+  size_t pos = 0;
+  elog_spec_t spec;
+
+  while (*fmt != '\0' && pos + 1 < cap) {
+    const char *next;
+
+    /* 変換指定までのリテラル（走査しながら写す） */
+    if (*fmt != '%') {
+      do {
+        dst[pos++] = *fmt++;
+      } while (*fmt != '\0' && *fmt != '%' && pos + 1 < cap);
+      continue;
+    }
+
+    next = elog_spec_parse_fast(fmt + 1, &spec);
+    if (next == NULL) {
+      /* 解釈できない指定以降は libc に任せる */
+      pos += elog_fmt_clamp(vsnprintf(dst + pos, cap - pos, fmt, *ap),
+                            cap - pos);
+      return pos;
+    }
+    if ((spec.conv == 's' || spec.conv == 'c') && spec.len == ELOG_LEN_L) {
+      /* ワイド文字は libc に任せる */
+      pos += elog_fmt_clamp(vsnprintf(dst + pos, cap - pos, fmt, *ap),
+                            cap - pos);
+      return pos;
+    }
+    fmt = next;
+    if (spec.conv == '%') {
+      dst[pos++] = '%';
+      continue;
+    }
+
+    if (spec.width_star) {
+      spec.width = va_arg(*ap, int);
+      if (spec.width < 0) {
+        /* 負の幅は '-' フラグ扱い（printf と同じ） */
+        size_t fl = strlen(spec.flags);
+        if (fl < sizeof(spec.flags) - 1) {
+          spec.flags[fl] = '-';
+          spec.flags[fl + 1] = '\0';
+        }
+        spec.width = -spec.width;
+      }
+    }
+    if (spec.prec_star) {
+      spec.precision = va_arg(*ap, int);
+      if (spec.precision < 0) {
+        spec.precision = -1;
+      }
+    }
+
+    switch (spec.conv) {
+      case 'd':
+      case 'i':
+        pos += elog_format_signed(dst + pos, cap - pos, &spec,
+                                  elog_va_signed(spec.len, ap));
+        break;
+      case 'u':
+      case 'o':
+      case 'x':
+      case 'X':
+        pos += elog_format_unsigned(dst + pos, cap - pos, &spec,
+                                    elog_va_unsigned(spec.len, ap));
+        break;
+      case 'c':
+        pos += elog_format_char(dst + pos, cap - pos, &spec, va_arg(*ap, int));
+        break;
+      case 'p':
+        pos += elog_format_pointer(dst + pos, cap - pos, &spec,
+                                   (uintptr_t)va_arg(*ap, void *));
+        break;
+      case 'n':
+        /* 書き込み先は使わない（エンコードと同じ） */
+        (void)va_arg(*ap, void *);
+        break;
+      case 's': {
+        const char *s = va_arg(*ap, const char *);
+        char one[48];
+
+        if (s == NULL) {
+          /* NULL の表記（精度による違いを含む）は libc に任せる */
+          spec.len = ELOG_LEN_NONE;
+          elog_spec_build(one, sizeof(one), &spec);
+          pos += elog_fmt_clamp(snprintf(dst + pos, cap - pos, one, s),
+                                cap - pos);
+          break;
+        }
+        if (spec.width < 0 && spec.precision < 0) {
+          /* 修飾のない %s は長さを数えずに写す */
+          while (*s != '\0' && pos + 1 < cap) {
+            dst[pos++] = *s++;
+          }
+          break;
+        }
+        pos += elog_format_string(
+            dst + pos, cap - pos, &spec, s,
+            spec.precision >= 0 ? strnlen(s, (size_t)spec.precision)
+                                : strlen(s));
+        break;
+      }
+      default:
+        if (spec.len == ELOG_LEN_BIG_L) {
+          long double ld = va_arg(*ap, long double);
+          char one[48];
+
+          elog_spec_build(one, sizeof(one), &spec);
+          pos += elog_fmt_clamp(snprintf(dst + pos, cap - pos, one, ld),
+                                cap - pos);
+        } else {
+          pos += elog_format_double(dst + pos, cap - pos, &spec,
+                                    va_arg(*ap, double));
+        }
+        break;
+    }
+  }
+
+  dst[pos] = '\0';
+  return pos;
+}
+#endif /* ELOG_USE_FAST_FORMAT */
+
+size_t elog_vformat(char *dst, size_t cap, const char *fmt, va_list ap) {
+#if ELOG_USE_FAST_FORMAT
+  va_list aq;
+  size_t n;
+
+  if (cap == 0) {
+    return 0;
+  }
+  va_copy(aq, ap);
+  n = elog_vformat_ap(dst, cap, fmt, &aq);
+  va_end(aq);
+  return n;
+#else
+  return elog_fmt_clamp(vsnprintf(dst, cap, fmt, ap), cap);
+#endif
+}
+
+size_t elog_format(char *dst, size_t cap, const char *fmt, ...) {
+  va_list ap;
+  size_t n;
+
+  va_start(ap, fmt);
+  n = elog_vformat(dst, cap, fmt, ap);
+  va_end(ap);
+  return n;
+}
@@ -0,0 +1,570 @@
+/**
+ * @file elog_internal.h
+ * @brief elog - ライブラリ内部で共有するヘルパー（非公開）
+ */
+
+#ifndef ELOG_INTERNAL_H
+#define ELOG_INTERNAL_H
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "elog/elog.h"
+#include "elog/elog_sink.h"
+
+#if defined(__unix__)
+#include <sched.h>
+#endif
+#if ELOG_SINK_ENABLED || ELOG_USE_SCOPE_TIMER
+#include <pthread.h>
+#endif
+
+/* ============================================================
+ * 1. フォーマット指定子の解析
+ * ============================================================ */
+
+/* 長さ修飾子 */
+typedef enum {
+  ELOG_LEN_NONE = 0,
+  ELOG_LEN_HH,
+  ELOG_LEN_H,
+  ELOG_LEN_L,
+  ELOG_LEN_LL,
+  ELOG_LEN_J,
+  ELOG_LEN_Z,
+  ELOG_LEN_T,
+  ELOG_LEN_BIG_L
+} elog_len_t;
+
+/* 変換指定子1つ分の解析結果 */
+typedef struct {
+  char flags[6];     /* "-+ #0" のうち指定されたもの（NUL 終端） */
+  int width;         /* 幅（未指定は -1） */
+  int precision;     /* 精度（未指定は -1） */
+  uint8_t width_star; /* 幅が '*' */
+  uint8_t prec_star;  /* 精度が '*' */
+  uint8_t len;       /* elog_len_t */
+  char conv;         /* 変換文字（'%' を含む） */
+} elog_spec_t;
+
+/**
+ * '%' の直後から変換指定子を1つ解析する
+ * @return 変換文字の次の位置。解釈できない場合 NULL
+ */
+const char *elog_spec_parse(const char *p, elog_spec_t *spec);
+
+/* elog_spec_parse と同じ。修飾のない1文字の指定は呼び出しを省く */
+static inline const char *elog_spec_parse_fast(const char *p,
+                                               elog_spec_t *spec) {
+  switch (*p) {
+    case 'd': case 'i': case 'u': case 'x': case 'X': case 'c':
+    case 's': case 'p': case 'f': case '%':
+      spec->flags[0] = '\0';
+      spec->width = -1;
+      spec->precision = -1;
+      spec->width_star = 0;
+      spec->prec_star = 0;
+      spec->len = ELOG_LEN_NONE;
+      spec->conv = *p;
+      return p + 1;
+    default:
+      return elog_spec_parse(p, spec);
+  }
+}
+
+/* ============================================================
+ * 2. 引数エンコード（非同期・バイナリ共通）
+ * ============================================================ */
+
+/* varint（LEB128）/ zigzag varint の読み書き。領域不足・不正時は NULL */
+uint8_t *elog_varint_put(uint8_t *p, const uint8_t *end, uint64_t v);
+uint8_t *elog_svarint_put(uint8_t *p, const uint8_t *end, int64_t v);
+const uint8_t *elog_varint_get(const uint8_t *p, const uint8_t *end,
+                               uint64_t *v);
+const uint8_t *elog_svarint_get(const uint8_t *p, const uint8_t *end,
+                                int64_t *v);
+
+/* 長さ修飾子に合わせて va_list から整数を1つ取り出す */
+int64_t elog_va_signed(uint8_t len, va_list *ap);
+uint64_t elog_va_unsigned(uint8_t len, va_list *ap);
+
+/**
+ * フォーマット文字列に従って可変長引数をバイト列へエンコードする
+ * 整数は zigzag/varint、浮動小数点は 8 バイト、文字列は長さ + 本体
+ * 容量が足りない場合はそこで打ち切る
+ * @return 書き込んだバイト数
+ */
+size_t elog_args_encode(uint8_t *dst, size_t cap, const char *fmt,
+                        va_list ap);
+
+/**
+ * エンコード済み引数とフォーマット文字列からメッセージを復元する
+ * 出力は常に NUL 終端され、cap を超える分は切り捨てる
+ * @return 書き込んだ文字数（NUL を除く）
+ */
+size_t elog_args_format(char *dst, size_t cap, const char *fmt,
+                        const uint8_t *src, size_t len);
+
+/* ============================================================
+ * 3. 行の整形
+ * ============================================================ */
+
+/* レベルごとの表示文字列・カラー（elog_level.c、elog_level_t で引く） */
+extern const char *const elog_level_strs[];
+extern const char *const elog_level_names[];
+extern const char *const elog_level_colors[];
+
+/* 行末（リセットコード + 改行）のバイト数 */
+#define ELOG_LINE_SUFFIX_LEN (sizeof(ELOG_COLOR_END) - 1 + 1)
+
+/**
+ * 行頭（カラー・レベル・ファイル名:行番号）を書き込む
+ * @return 書き込んだ文字数
+ */
+size_t elog_line_prefix(char *dst, size_t cap, const elog_callsite_t *cs);
+
+/**
+ * 行末（リセットコード + 改行）を書き込む
+ * cap は ELOG_LINE_SUFFIX_LEN 以上であること
+ * @return 書き込んだ文字数
+ */
+size_t elog_line_suffix(char *dst, size_t cap);
+
+/**
+ * エンコード済みレコードから1行を整形する
+ * @return 書き込んだ文字数
+ */
+size_t elog_line_format(char *dst, size_t cap, const elog_callsite_t *cs,
+                        const uint8_t *args, size_t len);
+
+/**
+ * 行頭のタイムスタンプ（ELOG_TIMESTAMP_FMT + ".uuuuuu "）を書き込む
+ * 日時の部分は秒が変わったときだけ作り直す（スレッドごとにキャッシュ）
+ * @param wall_ns 壁時計の ns
+ * @return 書き込んだ文字数
+ */
+size_t elog_line_time(char *dst, size_t cap, uint64_t wall_ns);
+
+/**
+ * 直前のレコードの繰り返し件数を報告する1行を整形する
+ * @return 書き込んだ文字数
+ */
+size_t elog_line_repeated(char *dst, size_t cap, const elog_callsite_t *cs,
+                          uint32_t count);
+
+/**
+ * 可変長引数から1行を整形する（同期出力用）
+ * @return 書き込んだ文字数
+ */
+size_t elog_line_vformat(char *dst, size_t cap, const elog_callsite_t *cs,
+                         const char *fmt, va_list ap);
+
+/* ============================================================
+ * 4. 時刻
+ * ============================================================ */
+
+/**
+ * 単調増加クロック（ナノ秒）
+ */
+static inline uint64_t elog_now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+/**
+ * ログ呼び出し時に取るタイムスタンプ（ELOG_TIMESTAMP_CLOCK の生の値）
+ * ns への変換は elog_clock_ns() で出力側が行う
+ */
+static inline uint64_t elog_clock_read(void) {
+#if ELOG_USE_TIMESTAMP && ELOG_TIMESTAMP_CLOCK == ELOG_CLOCK_TSC
+  return __builtin_ia32_rdtsc();
+#elif ELOG_USE_TIMESTAMP
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+#else
+  return elog_now_ns();
+#endif
+}
+
+#if ELOG_USE_TIMESTAMP && ELOG_TIMESTAMP_CLOCK == ELOG_CLOCK_TSC
+/**
+ * elog_clock_read() の値を単調クロック（elog_now_ns と同じ基準）の ns へ変換する
+ * TSC の周波数は読み込み時からの経過で較正する（眠らない）
+ */
+uint64_t elog_clock_ns(uint64_t ts);
+
+/**
+ * elog_clock_ns() と同じ変換をロックなしで行う（致命的なシグナルのハンドラ用）
+ * 最後に較正した値の写しを使う。較正前は呼び出した時点の単調クロックを返す
+ */
+uint64_t elog_clock_ns_sigsafe(uint64_t ts);
+#else
+static inline uint64_t elog_clock_ns(uint64_t ts) { return ts; }
+static inline uint64_t elog_clock_ns_sigsafe(uint64_t ts) { return ts; }
+#endif
+
+/**
+ * 単調クロックの ns を壁時計（UNIX 時刻）の ns へ変換する
+ */
+uint64_t elog_clock_wall_ns(uint64_t mono_ns);
+
+/**
+ * elog_clock_read() の値から行頭のタイムスタンプを書き込む
+ * @return 書き込んだ文字数（ELOG_USE_TIMESTAMP=0 では常に 0）
+ */
+static inline size_t elog_line_stamp(char *dst, size_t cap, uint64_t ts) {
+#if ELOG_USE_TIMESTAMP
+  return elog_line_time(dst, cap, elog_clock_wall_ns(elog_clock_ns(ts)));
+#else
+  (void)dst;
+  (void)cap;
+  (void)ts;
+  return 0;
+#endif
+}
+
+/* ============================================================
+ * 5. バイナリストリーム
+ * ============================================================ */
+
+/*
+ * ストリーム形式（整数は特記なき限り varint）
+ *   ヘッダー:   "ELOGBIN" + バージョン(1バイト) + フラグ
+ *               + 壁時計 ns + 単調クロック ns
+ *   0x01 定義:  ID, レベル(1バイト), 行番号, ファイル名長+1, ファイル名,
+ *               フォーマット長, フォーマット
+ *   0x02 記録:  ID, 直前レコードからの時刻差(zigzag), 引数長, エンコード済み引数
+ *   0x03 破棄:  破棄されたレコード数
+ *   0x04 繰り返し: ID, 直前の記録と同じ内容で抑止したレコード数
+ * コールサイトの定義レコードは、その ID を使う最初の記録より前に出力される
+ * （ELOG_BINARY_EMBED_CALLSITES=0 の場合は出力しない）。
+ * フラグ ELOG_BIN_FLAG_SECTION_ID が立っている場合、ID は elog_meta
+ * セクション内のインデックス + 1。記述子の間隔は elog_meta_info セクション
+ * （マジック, 間隔, ポインタサイズ の uint32_t 3つ）に記録される。
+ */
+#define ELOG_BIN_MAGIC "ELOGBIN"
+#define ELOG_BIN_MAGIC_LEN 7
+#define ELOG_BIN_VERSION 2
+#define ELOG_BIN_FLAG_SECTION_ID 0x01
+#define ELOG_META_INFO_MAGIC 0x454C4D49u /* "ELMI" */
+#define ELOG_BIN_TAG_CALLSITE 0x01
+#define ELOG_BIN_TAG_RECORD 0x02
+#define ELOG_BIN_TAG_DROPPED 0x03
+#define ELOG_BIN_TAG_REPEATED 0x04
+
+/* 出力先への書き込み関数 */
+typedef void (*elog_write_fn)(const void *data, size_t len);
+
+/**
+ * 1レコードをバイナリストリームへ書き出す
+ * 必要に応じてストリームヘッダーとコールサイト定義を先に書く
+ * 呼び出しは直列化されていること（非同期ではコンシューマ、同期ではロック内）
+ */
+void elog_binary_write(elog_callsite_t *cs, uint64_t ts, const uint8_t *args,
+                       size_t len, elog_write_fn write);
+
+/**
+ * 破棄されたレコード数をバイナリストリームへ書き出す
+ */
+void elog_binary_write_dropped(uint64_t count, elog_write_fn write);
+
+/**
+ * 直前の記録の繰り返し件数をバイナリストリームへ書き出す
+ */
+void elog_binary_write_repeated(const elog_callsite_t *cs, uint32_t count,
+                                elog_write_fn write);
+
+/* ============================================================
+ * 6. 排他制御・出力先
+ * ============================================================ */
+
+/* スレッドごとの状態やリングの読み書き位置を分ける境界 */
+#define ELOG_CACHE_LINE 64
+
+/* スピンロック（pthread 非依存。保持中に I/O や待ちのない短い区間だけに使う） */
+typedef volatile uint8_t elog_spinlock_t;
+
+/* 何回か回っても取れなければ保持しているスレッドに CPU を譲る */
+#define ELOG_SPIN_TRIES 64
+
+static inline void elog_spin_lock(elog_spinlock_t *lock) {
+  int spins = 0;
+
+  while (__atomic_test_and_set(lock, __ATOMIC_ACQUIRE)) {
+    if (++spins < ELOG_SPIN_TRIES) {
+#if defined(__x86_64__) || defined(__i386__)
+      __builtin_ia32_pause();
+#endif
+    } else {
+      spins = 0;
+#if defined(__unix__)
+      sched_yield();
+#endif
+    }
+  }
+}
+
+static inline void elog_spin_unlock(elog_spinlock_t *lock) {
+  __atomic_clear(lock, __ATOMIC_RELEASE);
+}
+
+#if ELOG_SINK_ENABLED || ELOG_USE_SCOPE_TIMER
+/*
+ * 出力側のロック。保持したままシンクへ書く（write(2)・fwrite で止まりうる）
+ * ため、待つスレッドは回らずに眠らせる
+ */
+typedef pthread_mutex_t elog_lock_t;
+
+#define ELOG_LOCK_INITIALIZER PTHREAD_MUTEX_INITIALIZER
+
+static inline void elog_lock(elog_lock_t *lock) { pthread_mutex_lock(lock); }
+
+static inline void elog_unlock(elog_lock_t *lock) {
+  pthread_mutex_unlock(lock);
+}
+#endif
+
+/**
+ * 登録されたすべてのシンクへ書き込む（elog_write_fn として使える）
+ */
+void elog_sink_dispatch(const void *data, size_t len);
+
+/**
+ * elog_emit_args() と同じ。時刻（elog_clock_read() の値）を呼び出し側が渡す
+ * （フライトレコーダが記録した時刻のまま出力するのに使う）
+ */
+void elog_emit_args_at(elog_callsite_t *cs, uint64_t ts, const uint8_t *args,
+                       size_t len);
+
+/**
+ * ライブラリ自身の報告（破棄件数・集計など）を通常の経路で出力する
+ * 引数は cs->fmt に従い、エンコード後 ELOG_REPORT_ARGS_MAX バイトまで
+ */
+#define ELOG_REPORT_ARGS_MAX 64
+void elog_emit_report(elog_callsite_t *cs, ...);
+
+#if ELOG_SINK_ENABLED
+/**
+ * 致命的なシグナルのハンドラから呼ぶ: シンクのロックを（すぐに取れれば）
+ * 取ったまま離さず、fd シンクのバッファに残っているデータを write(2) で書き出す
+ */
+void elog_sink_crash_flush(void);
+
+/**
+ * 致命的なシグナルのハンドラから、ロックを取らずにシンクへ直接書く
+ * （elog_write_fn として使える）。標準出力・標準エラー出力・fd シンクは
+ * write(2)、共有メモリのシンクはリングへ書き、それ以外のシンクには書かない
+ */
+void elog_sink_crash_write(const void *data, size_t len);
+#endif
+
+#if ELOG_USE_ASYNC
+/**
+ * 致命的なシグナルのハンドラから、整形済みでまだシンクへ渡していないバッチと
+ * 全リングに残っているレコードを write へ書き出す（リングごとの順、時刻なし）
+ */
+void elog_async_crash_drain(elog_write_fn write);
+#endif
+
+#if ELOG_USE_CRASH_HANDLER
+/* 代替シグナルスタックのバイト数 */
+#ifndef ELOG_CRASH_STACK_SIZE
+#define ELOG_CRASH_STACK_SIZE 65536
+#endif
+
+/**
+ * 呼び出しスレッドの代替シグナルスタックに stack（ELOG_CRASH_STACK_SIZE バイト）
+ * を設定する。既に設定されていれば何もしない（非同期のリングの割り当て時に呼ぶ）
+ */
+void elog_crash_thread_attach(void *stack);
+
+/**
+ * スレッド終了時: 代替シグナルスタックが stack なら外す
+ */
+void elog_crash_thread_detach(void *stack);
+#endif
+
+#if !ELOG_SINK_ENABLED
+/**
+ * シンクを使わない構成で、整形済みの1行を printf 出力と同じ出力先へ書く
+ * （小さな printf の出力先、ELOG_USE_ATOMIC_LINE=1 では write(2) 1回、
+ * それ以外は stdout）
+ */
+void elog_print_line(const char *data, size_t len);
+#endif
+
+/* ============================================================
+ * 7. 重複抑止（ELOG_USE_DEDUP=1）
+ * ============================================================ */
+
+/* 報告すべき繰り返し件数 */
+typedef struct {
+  const elog_callsite_t *cs; /**< 繰り返されたレコードのコールサイト */
+  uint32_t count;            /**< 抑止した件数（0 なら報告なし） */
+} elog_dedup_repeat_t;
+
+/**
+ * レコードを直前のものと比べる（コールサイト + 整形済み引数のハッシュ）
+ * 同じ内容なら件数を数えて 1 を返す。rep->count が 0 以外なら、
+ * レコードより先にその繰り返し件数を出力すること
+ * （内容が変わった、または ELOG_DEDUP_WINDOW_MS が過ぎた）
+ * 呼び出しは直列化されていること
+ * @return 1: 出力しない, 0: 出力する
+ */
+int elog_dedup_check(const elog_callsite_t *cs, const void *data, size_t len,
+                     elog_dedup_repeat_t *rep);
+
+/**
+ * 保留中の繰り返し件数を取り出す
+ * @param force 0 の場合は ELOG_DEDUP_WINDOW_MS が過ぎたときのみ
+ * @return 1: rep に報告すべき件数を入れた, 0: なし
+ */
+int elog_dedup_expire(int force, elog_dedup_repeat_t *rep);
+
+/* ============================================================
+ * 8. 値の整形（elog_format.c）
+ * ============================================================ */
+
+/*
+ * 変換1つ分を snprintf と同じ形で dst へ書く。spec の幅・精度は解決済み
+ * （'*' は数値に置き換え、負の幅は '-' フラグにしておく）であること。
+ * 整数は spec->len に合わせて切り詰めてから整形する。
+ * いずれも最大 cap - 1 文字を書いて NUL 終端し、書いた文字数を返す
+ */
+size_t elog_format_signed(char *dst, size_t cap, const elog_spec_t *spec,
+                          int64_t v);
+size_t elog_format_unsigned(char *dst, size_t cap, const elog_spec_t *spec,
+                            uint64_t v);
+size_t elog_format_char(char *dst, size_t cap, const elog_spec_t *spec, int c);
+size_t elog_format_pointer(char *dst, size_t cap, const elog_spec_t *spec,
+                           uintptr_t v);
+size_t elog_format_double(char *dst, size_t cap, const elog_spec_t *spec,
+                          double v);
+
+/**
+ * 文字列を整形する。s は NUL 終端されていなくてよく、len はその長さ
+ * （精度による切り詰めはこの関数で行う）
+ */
+size_t elog_format_string(char *dst, size_t cap, const elog_spec_t *spec,
+                          const char *s, size_t len);
+
+/**
+ * vsnprintf の代わり（ELOG_USE_FAST_FORMAT=0 では vsnprintf そのもの）
+ * @return 書き込んだ文字数（NUL を除く、最大 cap - 1）
+ */
+size_t elog_vformat(char *dst, size_t cap, const char *fmt, va_list ap);
+size_t elog_format(char *dst, size_t cap, const char *fmt, ...)
+    ELOG_PRINTF_ATTR(3, 4);
+
+/* ============================================================
+ * 9. 小さな printf（ELOG_USE_TINY_PRINTF=1）
+ * ============================================================ */
+
+/**
+ * elog_tiny_set_output() で設定した出力先へ書き込む
+ */
+void elog_tiny_write(const char *data, size_t len);
+
+/**
+ * 記述子のプレフィックス・cs->fmt で整形した引数・行末を出力先へ書き込む
+ * （elog_print の小さな printf 版）
+ */
+void elog_tiny_vprint(const elog_callsite_t *cs, va_list ap);
+
+/**
+ * 記述子のプレフィックス・cs->fmt で整形した引数・行末を dst に組み立てる
+ * （ELOG_USE_SIGSAFE=1 でシンクも小さな printf も使わない構成。
+ * 切り捨てた場合も行末を保つ）
+ * @return 書き込んだバイト数（NUL 終端しない）
+ */
+size_t elog_tiny_vformat_line(char *dst, size_t cap, const elog_callsite_t *cs,
+                              va_list ap);
+
+/* ============================================================
+ * 10. 共有メモリのリング（elog_shm.c）
+ * ============================================================ */
+
+/*
+ * ファイル形式（整数はホストのバイト順）
+ *   ヘッダー（64 バイト）の後にデータ領域が続く。
+ *   レコード: マーカー(4) 本体の長さ(4) 通し番号(8) 本体、
+ *             ELOG_SHM_ALIGN バイト境界までの詰め物
+ * head / tail は単調に増える位置で、データ領域内の位置はバイト数で割った余り。
+ * レコードはデータ領域の終端をまたがず、終端までの残りは PAD レコードで埋める。
+ * 書き込み側は上書きする範囲より先に tail を進め、マーカーを 0 にしてから
+ * 本体を書き、最後にマーカーを COMMIT にする。
+ */
+#define ELOG_SHM_MAGIC "ELOGSHM"
+#define ELOG_SHM_VERSION 1
+#define ELOG_SHM_ALIGN 16
+#define ELOG_SHM_MIN_SIZE 4096 /* データ領域の最小バイト数 */
+#define ELOG_SHM_COMMIT 0x54494d43u /* "CMIT" */
+#define ELOG_SHM_PAD 0x44444150u    /* "PADD" */
+
+typedef struct {
+  char magic[7];       /* ELOG_SHM_MAGIC（初期化の最後に書く） */
+  uint8_t version;     /* ELOG_SHM_VERSION */
+  uint64_t data_off;   /* ファイル先頭からデータ領域までのバイト数 */
+  uint64_t data_size;  /* データ領域のバイト数（ELOG_SHM_ALIGN の倍数） */
+  uint64_t head;       /* 次に書くレコードの位置 */
+  uint64_t tail;       /* 最も古いレコードの位置 */
+  uint8_t reserved[24];
+} elog_shm_header_t;
+
+typedef struct {
+  uint32_t mark; /* ELOG_SHM_COMMIT / ELOG_SHM_PAD（書き込み中は 0） */
+  uint32_t len;  /* 本体のバイト数 */
+  uint64_t seq;  /* 通し番号（1 つずつ増える） */
+} elog_shm_record_t;
+
+/**
+ * ファイルの内容から、tail から途切れずにコミットされたレコードの本体を
+ * 古い順に取り出す（書き込み中・上書き済みのレコードに当たったところで止める）
+ * @param map   ファイル全体
+ * @param size  map のバイト数
+ * @param write 本体の出力先
+ * @return 取り出したレコード数。ヘッダーが不正な場合 -1
+ */
+long elog_shm_recover(const void *map, size_t size, elog_write_fn write);
+
+#if ELOG_SINK_ENABLED
+/**
+ * 共有メモリのシンクの write（メモリへの書き込みだけなので、
+ * 致命的なシグナルのハンドラからも呼べる）
+ */
+void elog_shm_sink_write(elog_sink_t *sink, const void *data, size_t len);
+#endif
+
+/* ============================================================
+ * 11. シグナルハンドラからの出力（elog_sigsafe.c）
+ * ============================================================ */
+
+#if ELOG_USE_SIGSAFE && ELOG_SINK_ENABLED
+/* リングの読み書きの位置（elog_sigsafe_poll が読む） */
+extern uint64_t elog_sigsafe_head;
+extern uint64_t elog_sigsafe_tail;
+
+/**
+ * ELOG_*_SIGSAFE のリングにコミット済みのレコードを古い順に出力する
+ * シグナルハンドラの外から呼ぶこと（同時に呼ばれた場合は片方だけが出力する）
+ */
+void elog_sigsafe_drain(void);
+
+/* リングにレコードがあれば出力する（通常の出力経路から呼ぶ） */
+static inline void elog_sigsafe_poll(void) {
+  if (__builtin_expect(__atomic_load_n(&elog_sigsafe_tail, __ATOMIC_RELAXED) !=
+                           __atomic_load_n(&elog_sigsafe_head,
+                                           __ATOMIC_RELAXED),
+                       0)) {
+    elog_sigsafe_drain();
+  }
+}
+#else
+#define elog_sigsafe_poll() ((void)0)
+#endif
+
+#endif /* ELOG_INTERNAL_H */
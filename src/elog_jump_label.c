@@ -0,0 +1,129 @@
+/**
+ * @file elog_jump_label.c
+ * @brief elog - ジャンプラベルの書き換え（x86-64）
+ *
+ * ELOG_JUMP_LABEL が elog_jump セクションに残した表を走査し、
+ * 実行時レベルで出力される呼び出しは JMP、除外される呼び出しは
+ * 5バイトの NOP に書き換える。コンパイル直後はすべて JMP
+ * （初期レベル = ELOG_COMPILED_LEVEL ですべて出力される）。
+ *
+ * 命令は 8 バイト境界をまたがないため、コードページを一時的に
+ * 書き込み可能にし、命令を含む 8 バイトを1回のストアで置き換える。
+ * 他のスレッドは古い命令か新しい命令のどちらかを実行する。
+ */
+
+#include "elog/elog.h"
+
+#if ELOG_USE_JUMP_LABEL && ELOG_USE_RUNTIME_LEVEL
+
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "elog_internal.h"
+
+/* ELOG_JUMP_LABEL が出力する表の1項目 */
+typedef struct {
+  int32_t code;   /**< 命令の位置（このフィールドからの相対） */
+  int32_t target; /**< 出力処理の位置（このフィールドからの相対） */
+  int32_t level;  /**< ログレベル */
+} elog_jump_entry_t;
+
+/* elog_jump セクションの先頭・終端（リンカが自動定義） */
+extern elog_jump_entry_t __start_elog_jump[] __attribute__((weak));
+extern elog_jump_entry_t __stop_elog_jump[] __attribute__((weak));
+
+#define ELOG_JUMP_INSN_LEN 5
+#define ELOG_JUMP_OP_JMP 0xe9
+
+static const uint8_t elog_jump_nop[ELOG_JUMP_INSN_LEN] = {0x0f, 0x1f, 0x44,
+                                                          0x00, 0x00};
+
+static elog_spinlock_t elog_jump_lock;
+
+/* 書き換えに一度失敗したら以降は変数の判定だけに任せる */
+static int elog_jump_disabled;
+
+/* 書き込み可能にしているページ（0 はなし） */
+static uintptr_t elog_jump_page;
+
+static uintptr_t elog_jump_page_mask(void) {
+  static uintptr_t mask;
+
+  if (mask == 0) {
+    mask = ~((uintptr_t)sysconf(_SC_PAGESIZE) - 1);
+  }
+  return mask;
+}
+
+static void elog_jump_protect(void) {
+  if (elog_jump_page != 0) {
+    mprotect((void *)elog_jump_page, ~elog_jump_page_mask() + 1,
+             PROT_READ | PROT_EXEC);
+    elog_jump_page = 0;
+  }
+}
+
+static int elog_jump_unprotect(uintptr_t addr) {
+  uintptr_t page = addr & elog_jump_page_mask();
+
+  if (page == elog_jump_page) {
+    return 0;
+  }
+  elog_jump_protect();
+  if (mprotect((void *)page, ~elog_jump_page_mask() + 1,
+               PROT_READ | PROT_WRITE | PROT_EXEC) != 0) {
+    return -1;
+  }
+  elog_jump_page = page;
+  return 0;
+}
+
+/* 1つの呼び出し箇所を JMP または NOP にする */
+static int elog_jump_patch(const elog_jump_entry_t *e, int enable) {
+  uintptr_t code = (uintptr_t)&e->code + (intptr_t)e->code;
+  uintptr_t target = (uintptr_t)&e->target + (intptr_t)e->target;
+  uint8_t insn[ELOG_JUMP_INSN_LEN];
+  uint64_t *word = (uint64_t *)(code & ~(uintptr_t)7);
+  uint64_t value;
+
+  if ((*(const uint8_t *)code == ELOG_JUMP_OP_JMP) == (enable != 0)) {
+    return 0;
+  }
+  if (enable) {
+    int32_t rel = (int32_t)(target - (code + ELOG_JUMP_INSN_LEN));
+    insn[0] = ELOG_JUMP_OP_JMP;
+    memcpy(&insn[1], &rel, sizeof(rel));
+  } else {
+    memcpy(insn, elog_jump_nop, sizeof(insn));
+  }
+  if (elog_jump_unprotect(code) != 0) {
+    return -1;
+  }
+  value = *word;
+  memcpy((uint8_t *)&value + (code & 7), insn, sizeof(insn));
+  __atomic_store_n(word, value, __ATOMIC_RELEASE);
+  return 0;
+}
+
+int elog_set_level(uint8_t level) {
+  const elog_jump_entry_t *e;
+  int ret = 0;
+
+  elog_spin_lock(&elog_jump_lock);
+  elog_runtime_level = level;
+  if (!elog_jump_disabled && __start_elog_jump != NULL) {
+    for (e = __start_elog_jump; e < __stop_elog_jump; e++) {
+      if (elog_jump_patch(e, e->level <= (int32_t)level) != 0) {
+        elog_jump_disabled = 1;
+        ret = -1;
+        break;
+      }
+    }
+    elog_jump_protect();
+  }
+  elog_spin_unlock(&elog_jump_lock);
+  return ret;
+}
+
+#endif /* ELOG_USE_JUMP_LABEL && ELOG_USE_RUNTIME_LEVEL */
@@ -0,0 +1,421 @@
+/**
+ * @file elog_kv.c
+ * @brief elog - 構造化ログ（ELOG_*_KV）のエンコーダと出力
+ *
+ * フィールドは呼び出し時に選択中のエンコーダで1行に整形し、そのまま出力する
+ * （非同期バックエンドでもキューを通さず、呼び出しスレッドからシンクへ書く）。
+ * 文字列のエスケープは、エスケープの要らない区間を 16 バイト（SSE2）または
+ * 8 バイト（SWAR）ずつ探してまとめてコピーする。
+ */
+
+#include "elog/elog.h"
+
+#if !ELOG_USE_BINARY
+
+#include <math.h>
+#include <string.h>
+
+#include "elog_internal.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+/* ============================================================
+ * 1. 出力バッファ
+ * ============================================================ */
+
+/* 溢れたら以降の書き込みを捨て、full を立てる */
+typedef struct {
+  char *p;
+  size_t len;
+  size_t cap;
+  int full;
+} elog_kv_out_t;
+
+static void elog_kv_put(elog_kv_out_t *o, const char *s, size_t n) {
+  if (o->full || n > o->cap - o->len) {
+    o->full = 1;
+    return;
+  }
+  memcpy(o->p + o->len, s, n);
+  o->len += n;
+}
+
+static void elog_kv_putc(elog_kv_out_t *o, char c) { elog_kv_put(o, &c, 1); }
+
+static void elog_kv_puts(elog_kv_out_t *o, const char *s) {
+  elog_kv_put(o, s, strlen(s));
+}
+
+/* ============================================================
+ * 2. エスケープ
+ * ============================================================ */
+
+/* 探す文字: JSON は " \ と制御文字、logfmt はさらに空白と = */
+#define ELOG_KV_SCAN_JSON 0
+#define ELOG_KV_SCAN_LOGFMT 1
+
+static int elog_kv_special(unsigned char c, int logfmt) {
+  return c < 0x20 || c == '"' || c == '\\' ||
+         (logfmt && (c == ' ' || c == '='));
+}
+
+#if !defined(__SSE2__)
+/* 8 バイトのいずれかが 0 / n 未満なら 0 でない（n は 0x80 以下） */
+#define ELOG_KV_REP(c) (0x0101010101010101ull * (uint8_t)(c))
+#define ELOG_KV_HAS_ZERO(x) \
+  (((x) - ELOG_KV_REP(1)) & ~(x) & ELOG_KV_REP(0x80))
+#define ELOG_KV_HAS_LESS(x, n) \
+  (((x) - ELOG_KV_REP(n)) & ~(x) & ELOG_KV_REP(0x80))
+#endif
+
+/* s の先頭から、最初に特別な扱いが要る文字の位置を返す（なければ len） */
+static size_t elog_kv_scan(const char *s, size_t len, int logfmt) {
+  size_t i = 0;
+
+#if defined(__SSE2__)
+  const __m128i quote = _mm_set1_epi8('"');
+  const __m128i bslash = _mm_set1_epi8('\\');
+  const __m128i ctl = _mm_set1_epi8(0x1f);
+  const __m128i space = _mm_set1_epi8(' ');
+  const __m128i eq = _mm_set1_epi8('=');
+
+  for (; i + 16 <= len; i += 16) {
+    __m128i x = _mm_loadu_si128((const __m128i *)(const void *)(s + i));
+    /* max(x, 0x1f) == 0x1f は x <= 0x1f（符号なし） */
+    __m128i m = _mm_or_si128(
+        _mm_or_si128(_mm_cmpeq_epi8(x, quote), _mm_cmpeq_epi8(x, bslash)),
+        _mm_cmpeq_epi8(_mm_max_epu8(x, ctl), ctl));
+    int bits;
+
+    if (logfmt) {
+      m = _mm_or_si128(
+          m, _mm_or_si128(_mm_cmpeq_epi8(x, space), _mm_cmpeq_epi8(x, eq)));
+    }
+    bits = _mm_movemask_epi8(m);
+    if (bits != 0) {
+      return i + (size_t)__builtin_ctz((unsigned)bits);
+    }
+  }
+#else
+  for (; i + 8 <= len; i += 8) {
+    uint64_t x;
+    uint64_t m;
+
+    memcpy(&x, s + i, sizeof(x));
+    m = ELOG_KV_HAS_LESS(x, 0x20) | ELOG_KV_HAS_ZERO(x ^ ELOG_KV_REP('"')) |
+        ELOG_KV_HAS_ZERO(x ^ ELOG_KV_REP('\\'));
+    if (logfmt) {
+      m |= ELOG_KV_HAS_ZERO(x ^ ELOG_KV_REP(' ')) |
+           ELOG_KV_HAS_ZERO(x ^ ELOG_KV_REP('='));
+    }
+    if (m != 0) {
+      /* 位置は下のループで確定する */
+      break;
+    }
+  }
+#endif
+  for (; i < len; i++) {
+    if (elog_kv_special((unsigned char)s[i], logfmt)) {
+      break;
+    }
+  }
+  return i;
+}
+
+/* 引用符の内側を書く（" \ と制御文字をエスケープ。JSON と logfmt で共通） */
+static void elog_kv_put_escaped(elog_kv_out_t *o, const char *s, size_t len) {
+  static const char hex[] = "0123456789abcdef";
+
+  while (len > 0) {
+    size_t run = elog_kv_scan(s, len, ELOG_KV_SCAN_JSON);
+    unsigned char c;
+
+    elog_kv_put(o, s, run);
+    if (run == len) {
+      return;
+    }
+    c = (unsigned char)s[run];
+    switch (c) {
+      case '"':
+        elog_kv_put(o, "\\\"", 2);
+        break;
+      case '\\':
+        elog_kv_put(o, "\\\\", 2);
+        break;
+      case '\n':
+        elog_kv_put(o, "\\n", 2);
+        break;
+      case '\r':
+        elog_kv_put(o, "\\r", 2);
+        break;
+      case '\t':
+        elog_kv_put(o, "\\t", 2);
+        break;
+      default: {
+        char u[6] = {'\\', 'u', '0', '0', hex[c >> 4], hex[c & 15]};
+        elog_kv_put(o, u, sizeof(u));
+        break;
+      }
+    }
+    s += run + 1;
+    len -= run + 1;
+  }
+}
+
+/* JSON の文字列 */
+static void elog_kv_put_json_str(elog_kv_out_t *o, const char *s) {
+  elog_kv_putc(o, '"');
+  elog_kv_put_escaped(o, s, strlen(s));
+  elog_kv_putc(o, '"');
+}
+
+/* logfmt の値（空・空白・= ・" などを含む場合だけ引用符で囲む） */
+static void elog_kv_put_logfmt_str(elog_kv_out_t *o, const char *s) {
+  size_t len = strlen(s);
+
+  if (len > 0 && elog_kv_scan(s, len, ELOG_KV_SCAN_LOGFMT) == len) {
+    elog_kv_put(o, s, len);
+    return;
+  }
+  elog_kv_putc(o, '"');
+  elog_kv_put_escaped(o, s, len);
+  elog_kv_putc(o, '"');
+}
+
+/* ============================================================
+ * 3. 値
+ * ============================================================ */
+
+/* 数値・真偽値を書く。JSON では有限でない浮動小数点を null にする */
+static void elog_kv_put_scalar(elog_kv_out_t *o, const elog_kv_t *kv,
+                               int json) {
+  char buf[32];
+  size_t n;
+
+  switch (kv->type) {
+    case ELOG_KV_TYPE_INT:
+      n = elog_format(buf, sizeof(buf), "%lld", (long long)kv->v.i);
+      break;
+    case ELOG_KV_TYPE_UINT:
+      n = elog_format(buf, sizeof(buf), "%llu", (unsigned long long)kv->v.u);
+      break;
+    case ELOG_KV_TYPE_FLOAT:
+      if (json && !isfinite(kv->v.f)) {
+        elog_kv_put(o, "null", 4);
+        return;
+      }
+      n = elog_format(buf, sizeof(buf), "%g", kv->v.f);
+      break;
+    case ELOG_KV_TYPE_BOOL:
+      elog_kv_puts(o, kv->v.u ? "true" : "false");
+      return;
+    default:
+      elog_kv_put(o, "null", 4);
+      return;
+  }
+  elog_kv_put(o, buf, n);
+}
+
+static void elog_kv_put_value(elog_kv_out_t *o, const elog_kv_t *kv,
+                              int json) {
+  if (kv->type != ELOG_KV_TYPE_STR) {
+    elog_kv_put_scalar(o, kv, json);
+  } else if (kv->v.s == NULL) {
+    elog_kv_put(o, "null", 4);
+  } else if (json) {
+    elog_kv_put_json_str(o, kv->v.s);
+  } else {
+    elog_kv_put_logfmt_str(o, kv->v.s);
+  }
+}
+
+/* 時刻（ELOG_TIMESTAMP_FMT + ".uuuuuu"）を書く */
+static void elog_kv_put_time(elog_kv_out_t *o, uint64_t wall_ns, int json) {
+  char buf[64];
+  size_t n = elog_line_time(buf, sizeof(buf), wall_ns);
+
+  /* 末尾の空白を除く */
+  buf[n > 0 ? n - 1 : 0] = '\0';
+  if (json) {
+    elog_kv_put_json_str(o, buf);
+  } else {
+    elog_kv_put_logfmt_str(o, buf);
+  }
+}
+
+/* ============================================================
+ * 4. エンコーダ
+ * ============================================================ */
+
+/*
+ * フィールドを順に書く。入りきらないフィールドは、それ以降も含めて落とす
+ * （途中まで書いた分は取り消す）
+ */
+static void elog_kv_put_fields(elog_kv_out_t *o, const elog_kv_t *kv,
+                               size_t n, int json) {
+  size_t i;
+
+  for (i = 0; i < n && !o->full; i++) {
+    size_t mark = o->len;
+
+    if (json) {
+      /* メッセージまで入らず "{" だけの場合は区切りを付けない */
+      if (o->len > 1) {
+        elog_kv_putc(o, ',');
+      }
+      elog_kv_put_json_str(o, kv[i].key);
+      elog_kv_putc(o, ':');
+    } else {
+      elog_kv_putc(o, ' ');
+      elog_kv_puts(o, kv[i].key);
+      elog_kv_putc(o, '=');
+    }
+    elog_kv_put_value(o, &kv[i], json);
+    if (o->full) {
+      o->len = mark;
+    }
+  }
+}
+
+/* 行末の分を除いた容量で出力バッファを始める */
+static int elog_kv_begin(elog_kv_out_t *o, char *dst, size_t cap,
+                         size_t tail) {
+  if (cap <= tail) {
+    return 0;
+  }
+  o->p = dst;
+  o->len = 0;
+  o->cap = cap - tail;
+  o->full = 0;
+  return 1;
+}
+
+/* 確保しておいた容量に行末を書く */
+static size_t elog_kv_end(elog_kv_out_t *o, const char *tail, size_t n) {
+  memcpy(o->p + o->len, tail, n);
+  return o->len + n;
+}
+
+size_t elog_kv_encode_text(char *dst, size_t cap, const elog_callsite_t *cs,
+                           const elog_kv_t *kv, size_t n, uint64_t wall_ns) {
+  static const char suffix[] = ELOG_COLOR_END "\n";
+  elog_kv_out_t o;
+
+  if (!elog_kv_begin(&o, dst, cap, sizeof(suffix) - 1)) {
+    return 0;
+  }
+  if (wall_ns != 0) {
+    o.len = elog_line_time(o.p, o.cap, wall_ns);
+  }
+  o.len += elog_line_prefix(o.p + o.len, o.cap - o.len, cs);
+  elog_kv_puts(&o, cs->fmt);
+  elog_kv_put_fields(&o, kv, n, 0);
+  return elog_kv_end(&o, suffix, sizeof(suffix) - 1);
+}
+
+size_t elog_kv_encode_logfmt(char *dst, size_t cap, const elog_callsite_t *cs,
+                             const elog_kv_t *kv, size_t n, uint64_t wall_ns) {
+  uint8_t level = cs->level <= ELOG_LEVEL_TRACE ? cs->level : ELOG_LEVEL_TRACE;
+  elog_kv_out_t o;
+  char buf[16];
+
+  if (!elog_kv_begin(&o, dst, cap, 1)) {
+    return 0;
+  }
+  if (wall_ns != 0) {
+    elog_kv_put(&o, "time=", 5);
+    elog_kv_put_time(&o, wall_ns, 0);
+    elog_kv_putc(&o, ' ');
+  }
+  elog_kv_put(&o, "level=", 6);
+  elog_kv_puts(&o, elog_level_names[level]);
+  if (cs->file != NULL) {
+    elog_kv_put(&o, " file=", 6);
+    elog_kv_put_logfmt_str(&o, cs->file);
+    elog_kv_put(&o, " line=", 6);
+    elog_kv_put(&o, buf, elog_format(buf, sizeof(buf), "%u",
+                                     (unsigned)cs->line));
+  }
+  elog_kv_put(&o, " msg=", 5);
+  elog_kv_put_logfmt_str(&o, cs->fmt);
+  elog_kv_put_fields(&o, kv, n, 0);
+  return elog_kv_end(&o, "\n", 1);
+}
+
+size_t elog_kv_encode_json(char *dst, size_t cap, const elog_callsite_t *cs,
+                           const elog_kv_t *kv, size_t n, uint64_t wall_ns) {
+  uint8_t level = cs->level <= ELOG_LEVEL_TRACE ? cs->level : ELOG_LEVEL_TRACE;
+  elog_kv_out_t o;
+  char buf[16];
+
+  if (!elog_kv_begin(&o, dst, cap, 2)) {
+    return 0;
+  }
+  elog_kv_putc(&o, '{');
+  if (wall_ns != 0) {
+    elog_kv_put(&o, "\"time\":", 7);
+    elog_kv_put_time(&o, wall_ns, 1);
+    elog_kv_putc(&o, ',');
+  }
+  elog_kv_put(&o, "\"level\":\"", 9);
+  elog_kv_puts(&o, elog_level_names[level]);
+  elog_kv_putc(&o, '"');
+  if (cs->file != NULL) {
+    elog_kv_put(&o, ",\"file\":", 8);
+    elog_kv_put_json_str(&o, cs->file);
+    elog_kv_put(&o, ",\"line\":", 8);
+    elog_kv_put(&o, buf, elog_format(buf, sizeof(buf), "%u",
+                                     (unsigned)cs->line));
+  }
+  elog_kv_put(&o, ",\"msg\":", 7);
+  elog_kv_put_json_str(&o, cs->fmt);
+  if (o.full) {
+    /* メッセージまで入らない場合は空のオブジェクトにする */
+    o.len = 1;
+    o.full = 0;
+  }
+  elog_kv_put_fields(&o, kv, n, 1);
+  return elog_kv_end(&o, "}\n", 2);
+}
+
+/* ============================================================
+ * 5. エンコーダの選択と出力
+ * ============================================================ */
+
+#if ELOG_KV_FORMAT == ELOG_KV_FORMAT_JSON
+#define ELOG_KV_DEFAULT_ENCODER elog_kv_encode_json
+#elif ELOG_KV_FORMAT == ELOG_KV_FORMAT_LOGFMT
+#define ELOG_KV_DEFAULT_ENCODER elog_kv_encode_logfmt
+#else
+#define ELOG_KV_DEFAULT_ENCODER elog_kv_encode_text
+#endif
+
+static elog_kv_encoder_t elog_kv_encoder = ELOG_KV_DEFAULT_ENCODER;
+
+void elog_kv_set_encoder(elog_kv_encoder_t encoder) {
+  __atomic_store_n(&elog_kv_encoder,
+                   encoder != NULL ? encoder : ELOG_KV_DEFAULT_ENCODER,
+                   __ATOMIC_RELEASE);
+}
+
+void elog_emit_kv(elog_callsite_t *cs, const elog_kv_t *kv, size_t n) {
+  uint64_t wall_ns = 0;
+  char line[ELOG_LINE_MAX];
+  size_t len;
+
+#if ELOG_USE_TIMESTAMP
+  wall_ns = elog_clock_wall_ns(elog_clock_ns(elog_clock_read()));
+#endif
+  len = __atomic_load_n(&elog_kv_encoder, __ATOMIC_ACQUIRE)(
+      line, sizeof(line), cs, kv, n, wall_ns);
+
+#if ELOG_SINK_ENABLED
+  elog_sink_dispatch(line, len);
+#else
+  elog_print_line(line, len);
+#endif
+}
+
+#endif /* !ELOG_USE_BINARY */
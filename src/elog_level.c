@@ -0,0 +1,36 @@
+/**
+ * @file elog_level.c
+ * @brief elog - レベルごとの表示文字列・カラー
+ *
+ * 行整形（elog_line.c）・構造化ログ（elog_kv.c）・小さな printf（elog_tiny.c）が
+ * 参照する。小さな printf の構成で行整形と snprintf を引き込まないよう、
+ * 別ファイルに置く。
+ */
+
+#include "elog_internal.h"
+
+/* elog_level_t の順 */
+const char *const elog_level_strs[] = {
+    "",
+    ELOG_LEVEL_FMT_CRITICAL,
+    ELOG_LEVEL_FMT_ERROR,
+    ELOG_LEVEL_FMT_WARN,
+    ELOG_LEVEL_FMT_INFO,
+    ELOG_LEVEL_FMT_DEBUG,
+    ELOG_LEVEL_FMT_TRACE,
+};
+
+/* 構造化ログ（logfmt・JSON）の level の値 */
+const char *const elog_level_names[] = {
+    "off", "critical", "error", "warn", "info", "debug", "trace",
+};
+
+const char *const elog_level_colors[] = {
+    "",
+    ELOG_COLOR_BEGIN(ELOG_COLOR_CRITICAL),
+    ELOG_COLOR_BEGIN(ELOG_COLOR_ERROR),
+    ELOG_COLOR_BEGIN(ELOG_COLOR_WARN),
+    ELOG_COLOR_BEGIN(ELOG_COLOR_INFO),
+    ELOG_COLOR_BEGIN(ELOG_COLOR_DEBUG),
+    ELOG_COLOR_BEGIN(ELOG_COLOR_TRACE),
+};
@@ -0,0 +1,110 @@
+/**
+ * @file elog_line.c
+ * @brief elog - バックエンド共通の行整形
+ *
+ * ELOG_IMPL の printf 出力と同じ形の行を組み立てる。
+ */
+
+#include <string.h>
+#include <time.h>
+
+#include "elog_internal.h"
+
+size_t elog_line_time(char *dst, size_t cap, uint64_t wall_ns) {
+  /* 直前に整形した秒と日時の文字列 */
+  static __thread uint64_t cached_sec = UINT64_MAX;
+  static __thread char cached[64];
+  static __thread size_t cached_len;
+  uint64_t sec = wall_ns / 1000000000u;
+  unsigned us = (unsigned)(wall_ns % 1000000000u / 1000u);
+  char *p;
+  int i;
+
+  if (sec != cached_sec) {
+    time_t t = (time_t)sec;
+    struct tm tm;
+
+    localtime_r(&t, &tm);
+    cached_len = strftime(cached, sizeof(cached), ELOG_TIMESTAMP_FMT, &tm);
+    cached_sec = sec;
+  }
+  /* 日時 + ".uuuuuu " */
+  if (cap < cached_len + 8) {
+    return 0;
+  }
+  memcpy(dst, cached, cached_len);
+  p = dst + cached_len;
+  p[0] = '.';
+  for (i = 6; i >= 1; i--) {
+    p[i] = (char)('0' + us % 10);
+    us /= 10;
+  }
+  p[7] = ' ';
+  return cached_len + 8;
+}
+
+size_t elog_line_prefix(char *dst, size_t cap, const elog_callsite_t *cs) {
+  uint8_t level = cs->level <= ELOG_LEVEL_TRACE ? cs->level : ELOG_LEVEL_TRACE;
+
+#if ELOG_USE_FILE_LINE
+  return elog_format(dst, cap, "%s%s " ELOG_FILE_LINE_FMT " ",
+                     elog_level_colors[level], elog_level_strs[level],
+                     cs->file != NULL ? cs->file : "", (int)cs->line);
+#else
+  return elog_format(dst, cap, "%s%s  ", elog_level_colors[level],
+                     elog_level_strs[level]);
+#endif
+}
+
+size_t elog_line_suffix(char *dst, size_t cap) {
+  static const char suffix[] = ELOG_COLOR_END "\n";
+
+  if (cap < sizeof(suffix) - 1) {
+    return 0;
+  }
+  memcpy(dst, suffix, sizeof(suffix) - 1);
+  return sizeof(suffix) - 1;
+}
+
+size_t elog_line_format(char *dst, size_t cap, const elog_callsite_t *cs,
+                        const uint8_t *args, size_t len) {
+  size_t pos;
+
+  if (cap <= ELOG_LINE_SUFFIX_LEN) {
+    return 0;
+  }
+  cap -= ELOG_LINE_SUFFIX_LEN;
+  pos = elog_line_prefix(dst, cap, cs);
+  pos += elog_args_format(dst + pos, cap - pos, cs->fmt, args, len);
+  pos += elog_line_suffix(dst + pos, ELOG_LINE_SUFFIX_LEN);
+  return pos;
+}
+
+size_t elog_line_vformat(char *dst, size_t cap, const elog_callsite_t *cs,
+                         const char *fmt, va_list ap) {
+  size_t pos;
+
+  if (cap <= ELOG_LINE_SUFFIX_LEN) {
+    return 0;
+  }
+  cap -= ELOG_LINE_SUFFIX_LEN;
+  pos = elog_line_prefix(dst, cap, cs);
+  pos += elog_vformat(dst + pos, cap - pos, fmt, ap);
+  pos += elog_line_suffix(dst + pos, ELOG_LINE_SUFFIX_LEN);
+  return pos;
+}
+
+size_t elog_line_repeated(char *dst, size_t cap, const elog_callsite_t *cs,
+                          uint32_t count) {
+  size_t pos;
+
+  if (cap <= ELOG_LINE_SUFFIX_LEN) {
+    return 0;
+  }
+  cap -= ELOG_LINE_SUFFIX_LEN;
+  pos = elog_line_prefix(dst, cap, cs);
+  pos += elog_format(dst + pos, cap - pos, ELOG_DEDUP_REPEAT_FMT,
+                     (unsigned)count);
+  pos += elog_line_suffix(dst + pos, ELOG_LINE_SUFFIX_LEN);
+  return pos;
+}
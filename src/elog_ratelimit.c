@@ -0,0 +1,46 @@
+/**
+ * @file elog_ratelimit.c
+ * @brief elog - レート制限・サンプリング用の時計と乱数
+ *
+ * ELOG_*_EVERY_MS / ELOG_*_SAMPLE の抑止判定は呼び出しごとに行われるため、
+ * どちらもロックやシステムコールなしで返る。
+ */
+
+#include "elog/elog.h"
+
+#if defined(__GNUC__) || defined(__clang__)
+
+#include <time.h>
+
+uint64_t elog_ratelimit_clock_ms(void) {
+  struct timespec ts;
+
+#ifdef CLOCK_MONOTONIC_COARSE
+  clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+#else
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+#endif
+  return (uint64_t)ts.tv_sec * 1000u + (uint64_t)ts.tv_nsec / 1000000u;
+}
+
+uint32_t elog_sample_random(void) {
+  static __thread uint32_t state;
+  uint32_t x = state;
+
+  if (x == 0) {
+    /* スレッドごとに異なる種（TLS のアドレスと時刻） */
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    x = (uint32_t)(uintptr_t)&state ^ (uint32_t)ts.tv_nsec;
+    if (x == 0) {
+      x = 0x9e3779b9u;
+    }
+  }
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  state = x;
+  return x;
+}
+
+#endif /* __GNUC__ || __clang__ */
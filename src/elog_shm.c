@@ -0,0 +1,225 @@
+/**
+ * @file elog_shm.c
+ * @brief elog - 共有メモリのリング（クラッシュ後に読み出せる出力先）
+ *
+ * 整形済みのデータを mmap したファイル（/dev/shm やディスク上）のリングへ
+ * レコードとして書き込む。書き込みはメモリへの store だけで、システムコールは
+ * 使わない。プロセスが異常終了してもページはカーネルに残るため、
+ * elog-recover（elog_shm_recover）でコミット済みのレコードを取り出せる。
+ * 書き込みはシンクのロックで直列化されるので、書き手は常に1つ。
+ */
+
+#include "elog/elog_sink.h"
+
+#include <string.h>
+
+#include "elog_internal.h"
+
+#if ELOG_SINK_ENABLED
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/* ヘッダーを含めたレコードのバイト数 */
+static uint64_t elog_shm_rec_size(uint32_t len) {
+  return ((uint64_t)sizeof(elog_shm_record_t) + len + ELOG_SHM_ALIGN - 1) &
+         ~(uint64_t)(ELOG_SHM_ALIGN - 1);
+}
+
+/* ============================================================
+ * 1. 読み出し
+ * ============================================================ */
+
+/* tail から途切れずにコミットされたレコードをたどる。
+ * write が NULL でなければ本体を渡す。end には最後のレコードの次の位置、
+ * seq には最後のレコードの通し番号を返す */
+static long elog_shm_scan(const elog_shm_header_t *h, const uint8_t *data,
+                          elog_write_fn write, uint64_t *end, uint64_t *seq) {
+  uint64_t size = h->data_size;
+  uint64_t tail = __atomic_load_n(&h->tail, __ATOMIC_ACQUIRE);
+  uint64_t pos = tail;
+  uint64_t last = 0;
+  long count = 0;
+  int first = 1;
+
+  /* 1周を超えてたどらない */
+  while (pos - tail < size) {
+    uint64_t off = pos % size;
+    const elog_shm_record_t *r = (const elog_shm_record_t *)(data + off);
+    uint32_t mark = __atomic_load_n(&r->mark, __ATOMIC_ACQUIRE);
+
+    if (mark != ELOG_SHM_COMMIT && mark != ELOG_SHM_PAD) {
+      break;
+    }
+    if (r->len > size - off - sizeof(elog_shm_record_t) ||
+        (!first && r->seq != last + 1)) {
+      break;
+    }
+    if (mark == ELOG_SHM_COMMIT) {
+      if (write != NULL) {
+        write(r + 1, r->len);
+      }
+      count++;
+    }
+    last = r->seq;
+    first = 0;
+    pos += elog_shm_rec_size(r->len);
+  }
+  *end = pos;
+  *seq = last;
+  return count;
+}
+
+/* ヘッダーが size バイトのファイルとして正しいか */
+static int elog_shm_valid(const elog_shm_header_t *h, size_t size) {
+  return size >= sizeof(*h) &&
+         memcmp(h->magic, ELOG_SHM_MAGIC, sizeof(h->magic)) == 0 &&
+         h->version == ELOG_SHM_VERSION && h->data_off >= sizeof(*h) &&
+         h->data_size >= ELOG_SHM_ALIGN &&
+         h->data_size % ELOG_SHM_ALIGN == 0 &&
+         h->data_off <= size && h->data_size <= size - h->data_off;
+}
+
+long elog_shm_recover(const void *map, size_t size, elog_write_fn write) {
+  const elog_shm_header_t *h = (const elog_shm_header_t *)map;
+  uint64_t end, seq;
+
+  if (!elog_shm_valid(h, size)) {
+    return -1;
+  }
+  return elog_shm_scan(h, (const uint8_t *)map + h->data_off, write, &end,
+                       &seq);
+}
+
+#if ELOG_SINK_ENABLED
+
+/* ============================================================
+ * 2. 書き込み
+ * ============================================================ */
+
+static elog_shm_record_t *elog_shm_at(elog_shm_sink_t *s, uint64_t pos) {
+  return (elog_shm_record_t *)(s->data + pos % s->size);
+}
+
+/* head から n バイト書けるよう、最も古いレコードから捨てる */
+static void elog_shm_reserve(elog_shm_sink_t *s, uint64_t n) {
+  elog_shm_header_t *h = (elog_shm_header_t *)s->map;
+  uint64_t tail = h->tail;
+
+  while (s->head + n - tail > s->size) {
+    tail += elog_shm_rec_size(elog_shm_at(s, tail)->len);
+  }
+  if (tail != h->tail) {
+    __atomic_store_n(&h->tail, tail, __ATOMIC_RELEASE);
+  }
+}
+
+/* 1レコードを書く（PAD の場合 data は NULL） */
+static void elog_shm_put(elog_shm_sink_t *s, uint32_t mark, const void *data,
+                         uint32_t len) {
+  elog_shm_header_t *h = (elog_shm_header_t *)s->map;
+  uint64_t n = elog_shm_rec_size(len);
+  elog_shm_record_t *r;
+
+  elog_shm_reserve(s, n);
+  r = elog_shm_at(s, s->head);
+  /* 上書きする前に古いマーカーを消す */
+  __atomic_store_n(&r->mark, 0, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+  r->len = len;
+  r->seq = ++s->seq;
+  if (data != NULL) {
+    memcpy(r + 1, data, len);
+  }
+  __atomic_store_n(&r->mark, mark, __ATOMIC_RELEASE);
+  s->head += n;
+  __atomic_store_n(&h->head, s->head, __ATOMIC_RELEASE);
+}
+
+void elog_shm_sink_write(elog_sink_t *sink, const void *data, size_t len) {
+  elog_shm_sink_t *s = (elog_shm_sink_t *)sink;
+  /* 1レコードはデータ領域の 1/4 まで（それより長いデータは分けて書く） */
+  size_t max = (size_t)(s->size / 4 - sizeof(elog_shm_record_t));
+  const char *p = (const char *)data;
+
+  while (len > 0) {
+    size_t chunk = len < max ? len : max;
+    uint64_t rest = s->size - s->head % s->size;
+
+    /* 終端をまたぐ場合は残りを PAD で埋めて先頭へ戻る */
+    if (elog_shm_rec_size((uint32_t)chunk) > rest) {
+      elog_shm_put(s, ELOG_SHM_PAD, NULL,
+                   (uint32_t)(rest - sizeof(elog_shm_record_t)));
+    }
+    elog_shm_put(s, ELOG_SHM_COMMIT, p, (uint32_t)chunk);
+    p += chunk;
+    len -= chunk;
+  }
+}
+
+static void elog_shm_sink_close(elog_sink_t *sink) {
+  elog_shm_sink_t *s = (elog_shm_sink_t *)sink;
+
+  munmap(s->map, s->map_size);
+  s->map = NULL;
+}
+
+int elog_shm_sink_open(elog_shm_sink_t *s, const char *path, size_t size) {
+  size_t map_size;
+  elog_shm_header_t *h;
+  struct stat st;
+  uint64_t end;
+  int fd;
+
+  size &= ~(size_t)(ELOG_SHM_ALIGN - 1);
+  if (size < ELOG_SHM_MIN_SIZE) {
+    return -1;
+  }
+  map_size = sizeof(elog_shm_header_t) + size;
+
+  fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+  if (fd < 0) {
+    return -1;
+  }
+  if (fstat(fd, &st) != 0 ||
+      ((size_t)st.st_size != map_size && ftruncate(fd, 0) != 0) ||
+      ftruncate(fd, (off_t)map_size) != 0) {
+    close(fd);
+    return -1;
+  }
+  h = (elog_shm_header_t *)mmap(NULL, map_size, PROT_READ | PROT_WRITE,
+                                MAP_SHARED, fd, 0);
+  close(fd);
+  if (h == (elog_shm_header_t *)MAP_FAILED) {
+    return -1;
+  }
+
+  memset(s, 0, sizeof(*s));
+  s->sink.write = elog_shm_sink_write;
+  s->sink.close = elog_shm_sink_close;
+  s->map = h;
+  s->map_size = map_size;
+  s->data = (uint8_t *)h + sizeof(*h);
+  s->size = size;
+
+  if (elog_shm_valid(h, map_size) && h->data_off == sizeof(*h) &&
+      h->data_size == size) {
+    /* 前回の実行のリングがあれば、その続きに書く */
+    elog_shm_scan(h, s->data, NULL, &end, &s->seq);
+    s->head = end;
+    __atomic_store_n(&h->head, end, __ATOMIC_RELEASE);
+  } else {
+    memset(h, 0, sizeof(*h));
+    memset(s->data, 0, size);
+    h->version = ELOG_SHM_VERSION;
+    h->data_off = sizeof(*h);
+    h->data_size = size;
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    memcpy(h->magic, ELOG_SHM_MAGIC, sizeof(h->magic));
+  }
+  return 0;
+}
+
+#endif /* ELOG_SINK_ENABLED */
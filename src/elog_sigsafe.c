@@ -0,0 +1,188 @@
+/**
+ * @file elog_sigsafe.c
+ * @brief elog - シグナルハンドラ・割り込みからの出力（ELOG_USE_SIGSAFE=1）
+ *
+ * ELOG_*_SIGSAFE から呼ばれ、ロック・malloc・stdio を使わずに1レコードを出す。
+ * シンクを使う構成では、引数をエンコードしたままプロセス全体で1つの
+ * 固定長リングへ書き込む。書き込み位置は CAS 1回で予約し、
+ * スロットの通し番号でコミットを知らせる（満杯なら捨てて件数を数える）。
+ * リングは通常のログ出力（elog_emit・elog_sink_flush・非同期の
+ * コンシューマ）のついでに、記録した時刻のまま elog_emit_args_at へ流す。
+ * シンクを使わない構成では小さな printf のフォーマッタでスタック上に
+ * 1行を組み立て、1回の write(2)（ELOG_USE_TINY_PRINTF=1 では出力先の関数）
+ * で書く。
+ */
+
+#include "elog/elog.h"
+
+#if ELOG_USE_SIGSAFE
+
+#include <errno.h>
+#include <stdarg.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "elog_internal.h"
+
+#if ELOG_SINK_ENABLED
+
+#if (ELOG_SIGSAFE_RECORDS & (ELOG_SIGSAFE_RECORDS - 1)) != 0
+#error "ELOG_SIGSAFE_RECORDS must be a power of two"
+#endif
+
+#define ELOG_SIGSAFE_MASK ((uint64_t)ELOG_SIGSAFE_RECORDS - 1)
+
+/* ============================================================
+ * 1. リング
+ * ============================================================ */
+
+/*
+ * seq は位置 pos のスロットについて、(pos & ~MASK) なら空き、
+ * (pos & ~MASK) + 1 ならコミット済み。読み出した後は次の周の空き
+ * （+ ELOG_SIGSAFE_RECORDS）にする。0 初期化のままで最初の周の空きになる
+ */
+typedef struct {
+  uint64_t seq;
+  elog_callsite_t *cs; /* コールサイト記述子 */
+  uint64_t ts;         /* elog_clock_read() の値 */
+  uint16_t len;        /* args の有効バイト数 */
+  uint8_t args[ELOG_SIGSAFE_RECORD_SIZE - 2 * sizeof(uint64_t) -
+               sizeof(void *) - sizeof(uint16_t)];
+} elog_sigsafe_slot_t;
+
+/* 書き込み側（任意のスレッド・シグナルハンドラ）と読み出し側を別の行に置く */
+uint64_t elog_sigsafe_tail __attribute__((aligned(64)));
+uint64_t elog_sigsafe_head __attribute__((aligned(64)));
+
+static elog_sigsafe_slot_t elog_sigsafe_slots[ELOG_SIGSAFE_RECORDS];
+static uint64_t elog_sigsafe_dropped;
+static uint8_t elog_sigsafe_draining;
+
+/* 破棄されたレコード数を報告する行の記述子 */
+static elog_callsite_t elog_sigsafe_drop_cs ELOG_CALLSITE_ATTR = {
+    "%llu records dropped (signal-safe ring full)", "elog", 0,
+    ELOG_LEVEL_WARN, 0, 0
+#if ELOG_USE_DYNAMIC_DEBUG
+    , "elog_sigsafe"
+#endif
+};
+
+void elog_sigsafe_emit(elog_callsite_t *cs, const char *fmt, ...) {
+  uint64_t pos = __atomic_load_n(&elog_sigsafe_tail, __ATOMIC_RELAXED);
+  elog_sigsafe_slot_t *slot;
+  va_list ap;
+
+  (void)fmt;
+  for (;;) {
+    uint64_t lap = pos & ~ELOG_SIGSAFE_MASK;
+    uint64_t seq;
+
+    slot = &elog_sigsafe_slots[pos & ELOG_SIGSAFE_MASK];
+    seq = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+    if (seq == lap) {
+      if (__atomic_compare_exchange_n(&elog_sigsafe_tail, &pos, pos + 1, 1,
+                                      __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+        break;
+      }
+    } else if ((int64_t)(seq - lap) < 0) {
+      /* 前の周のレコードがまだ読み出されていない */
+      __atomic_fetch_add(&elog_sigsafe_dropped, 1, __ATOMIC_RELAXED);
+      return;
+    } else {
+      pos = __atomic_load_n(&elog_sigsafe_tail, __ATOMIC_RELAXED);
+    }
+  }
+
+  slot->cs = cs;
+  slot->ts = elog_clock_read();
+  va_start(ap, fmt);
+  slot->len = (uint16_t)elog_args_encode(slot->args, sizeof(slot->args),
+                                         cs->fmt, ap);
+  va_end(ap);
+  __atomic_store_n(&slot->seq, (pos & ~ELOG_SIGSAFE_MASK) + 1,
+                   __ATOMIC_RELEASE);
+}
+
+/* ============================================================
+ * 2. 読み出し
+ * ============================================================ */
+
+void elog_sigsafe_drain(void) {
+  uint64_t dropped;
+
+  if (__atomic_test_and_set(&elog_sigsafe_draining, __ATOMIC_ACQUIRE)) {
+    return;
+  }
+  for (;;) {
+    uint64_t pos = elog_sigsafe_head;
+    elog_sigsafe_slot_t *slot = &elog_sigsafe_slots[pos & ELOG_SIGSAFE_MASK];
+
+    /* 予約済みで書き込み中のレコードがあれば、次の機会に回す */
+    if (__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) !=
+        (pos & ~ELOG_SIGSAFE_MASK) + 1) {
+      break;
+    }
+    elog_emit_args_at(slot->cs, slot->ts, slot->args, slot->len);
+    __atomic_store_n(&slot->seq,
+                     (pos & ~ELOG_SIGSAFE_MASK) + ELOG_SIGSAFE_RECORDS,
+                     __ATOMIC_RELEASE);
+    __atomic_store_n(&elog_sigsafe_head, pos + 1, __ATOMIC_RELEASE);
+  }
+  dropped = __atomic_exchange_n(&elog_sigsafe_dropped, 0, __ATOMIC_RELAXED);
+  if (dropped > 0) {
+    elog_emit_report(&elog_sigsafe_drop_cs, (unsigned long long)dropped);
+  }
+  __atomic_clear(&elog_sigsafe_draining, __ATOMIC_RELEASE);
+}
+
+#if !ELOG_USE_ASYNC
+/* 後に通常の出力がないまま終了した場合も残りを出す
+ * （シグナルハンドラからは atexit を登録できないため、デストラクタで行う。
+ * 非同期バックエンドではコンシューマの終了処理が出す） */
+__attribute__((destructor)) static void elog_sigsafe_exit(void) {
+  elog_sink_flush();
+}
+#endif
+
+#else /* !ELOG_SINK_ENABLED */
+
+/* ============================================================
+ * 1. 直接出力
+ * ============================================================ */
+
+void elog_sigsafe_emit(elog_callsite_t *cs, const char *fmt, ...) {
+  /* 割り込まれた側の errno を壊さない */
+  int saved_errno = errno;
+  va_list ap;
+
+  (void)fmt;
+  va_start(ap, fmt);
+#if ELOG_USE_TINY_PRINTF
+  elog_tiny_vprint(cs, ap);
+#else
+  {
+    char line[ELOG_LINE_MAX];
+    const char *p = line;
+    size_t len = elog_tiny_vformat_line(line, sizeof(line), cs, ap);
+
+    /* 部分書き込み・シグナル割り込みのときだけ続きを書く */
+    while (len > 0) {
+      ssize_t n = write(STDOUT_FILENO, p, len);
+      if (n < 0) {
+        if (errno == EINTR) {
+          continue;
+        }
+        break;
+      }
+      p += n;
+      len -= (size_t)n;
+    }
+  }
+#endif
+  va_end(ap);
+  errno = saved_errno;
+}
+
+#endif /* ELOG_SINK_ENABLED */
+
+#endif /* ELOG_USE_SIGSAFE */
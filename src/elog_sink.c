@@ -0,0 +1,355 @@
+/**
+ * @file elog_sink.c
+ * @brief elog - 出力先（シンク）
+ *
+ * 整形済みのデータを登録されたシンクへ配る。
+ * シンクの一覧と書き込みは1つのミューテックスで直列化する。
+ */
+
+#include "elog/elog_sink.h"
+
+#if ELOG_SINK_ENABLED
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "elog_internal.h"
+
+/* ============================================================
+ * 1. 組み込みシンク
+ * ============================================================ */
+
+static void elog_stdout_write(elog_sink_t *sink, const void *data,
+                              size_t len) {
+  (void)sink;
+  fwrite(data, 1, len, stdout);
+}
+
+static void elog_stdout_flush(elog_sink_t *sink) {
+  (void)sink;
+  fflush(stdout);
+}
+
+static void elog_stderr_write(elog_sink_t *sink, const void *data,
+                              size_t len) {
+  (void)sink;
+  fwrite(data, 1, len, stderr);
+}
+
+static void elog_stderr_flush(elog_sink_t *sink) {
+  (void)sink;
+  fflush(stderr);
+}
+
+static elog_sink_t elog_stdout_sink = {elog_stdout_write, elog_stdout_flush,
+                                       NULL, NULL};
+static elog_sink_t elog_stderr_sink = {elog_stderr_write, elog_stderr_flush,
+                                       NULL, NULL};
+
+elog_sink_t *elog_sink_stdout(void) { return &elog_stdout_sink; }
+
+elog_sink_t *elog_sink_stderr(void) { return &elog_stderr_sink; }
+
+/* 部分書き込み・シグナル割り込みを考慮してすべて書き出す */
+static void elog_fd_write_all(int fd, const char *p, size_t len) {
+  while (len > 0) {
+    ssize_t n = write(fd, p, len);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return;
+    }
+    p += n;
+    len -= (size_t)n;
+  }
+}
+
+static void elog_fd_sink_flush(elog_sink_t *sink) {
+  elog_fd_sink_t *s = (elog_fd_sink_t *)sink;
+
+  if (s->len > 0) {
+    elog_fd_write_all(s->fd, s->buf, s->len);
+    s->len = 0;
+  }
+}
+
+static void elog_fd_sink_write(elog_sink_t *sink, const void *data,
+                               size_t len) {
+  elog_fd_sink_t *s = (elog_fd_sink_t *)sink;
+
+  if (s->len + len > s->cap) {
+    elog_fd_sink_flush(sink);
+  }
+  if (len >= s->cap) {
+    /* バッファなし、またはバッファより大きい書き込みはそのまま出す */
+    elog_fd_write_all(s->fd, (const char *)data, len);
+    return;
+  }
+  memcpy(s->buf + s->len, data, len);
+  s->len += len;
+}
+
+static void elog_fd_sink_close(elog_sink_t *sink) {
+  elog_fd_sink_t *s = (elog_fd_sink_t *)sink;
+
+  if (s->owns_fd && s->fd >= 0) {
+    close(s->fd);
+    s->fd = -1;
+  }
+}
+
+void elog_fd_sink_init(elog_fd_sink_t *s, int fd, char *buf, size_t cap) {
+  s->sink.write = elog_fd_sink_write;
+  s->sink.flush = elog_fd_sink_flush;
+  s->sink.close = elog_fd_sink_close;
+  s->sink.next = NULL;
+  s->fd = fd;
+  s->owns_fd = 0;
+  s->buf = buf;
+  s->cap = buf != NULL ? cap : 0;
+  s->len = 0;
+}
+
+int elog_file_sink_open(elog_fd_sink_t *s, const char *path, char *buf,
+                        size_t cap) {
+  int fd = open(path, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+
+  if (fd < 0) {
+    return -1;
+  }
+  elog_fd_sink_init(s, fd, buf, cap);
+  s->owns_fd = 1;
+  return 0;
+}
+
+/* ============================================================
+ * 2. シンクの登録と配送
+ * ============================================================ */
+
+static elog_sink_t *elog_sinks = &elog_stdout_sink;
+static elog_lock_t elog_sink_lock = ELOG_LOCK_INITIALIZER;
+static uint8_t elog_sink_atexit_registered;
+
+static void elog_sink_flush_locked(void) {
+  elog_sink_t *s;
+
+  for (s = elog_sinks; s != NULL; s = s->next) {
+    if (s->flush != NULL) {
+      s->flush(s);
+    }
+  }
+}
+
+void elog_sink_add(elog_sink_t *sink) {
+  elog_sink_t *s;
+
+  /* プロセス終了時にバッファを持つシンクの残りを出力する */
+  if (!__atomic_test_and_set(&elog_sink_atexit_registered, __ATOMIC_RELAXED)) {
+    atexit(elog_sink_flush);
+  }
+
+  elog_lock(&elog_sink_lock);
+  for (s = elog_sinks; s != NULL && s != sink; s = s->next) {
+  }
+  if (s == NULL) {
+    sink->next = elog_sinks;
+    elog_sinks = sink;
+  }
+  elog_unlock(&elog_sink_lock);
+}
+
+void elog_sink_remove(elog_sink_t *sink) {
+  elog_sink_t **p;
+
+  elog_lock(&elog_sink_lock);
+  for (p = &elog_sinks; *p != NULL; p = &(*p)->next) {
+    if (*p == sink) {
+      *p = sink->next;
+      sink->next = NULL;
+      if (sink->flush != NULL) {
+        sink->flush(sink);
+      }
+      if (sink->close != NULL) {
+        sink->close(sink);
+      }
+      break;
+    }
+  }
+  elog_unlock(&elog_sink_lock);
+}
+
+void elog_sink_flush(void) {
+#if !ELOG_USE_ASYNC
+  /* シグナルハンドラで記録したレコードを先に出す（非同期ではコンシューマが出す） */
+  elog_sigsafe_poll();
+#endif
+  elog_lock(&elog_sink_lock);
+  elog_sink_flush_locked();
+  elog_unlock(&elog_sink_lock);
+}
+
+void elog_sink_dispatch(const void *data, size_t len) {
+  elog_sink_t *s;
+
+  if (len == 0) {
+    return;
+  }
+  elog_lock(&elog_sink_lock);
+  for (s = elog_sinks; s != NULL; s = s->next) {
+    s->write(s, data, len);
+  }
+  elog_unlock(&elog_sink_lock);
+}
+
+#if ELOG_USE_CRASH_HANDLER
+/* 他のスレッドがシンクへ書き終えるのを待つ回数（取れなければロックなしで進む） */
+#define ELOG_SINK_CRASH_SPINS 1000000
+
+void elog_sink_crash_flush(void) {
+  elog_sink_t *s;
+  long i;
+
+  for (i = 0; i < ELOG_SINK_CRASH_SPINS &&
+              pthread_mutex_trylock(&elog_sink_lock) != 0;
+       i++) {
+  }
+  for (s = elog_sinks; s != NULL; s = s->next) {
+    if (s->write == elog_fd_sink_write) {
+      elog_fd_sink_t *fs = (elog_fd_sink_t *)s;
+
+      if (fs->len > 0) {
+        elog_fd_write_all(fs->fd, fs->buf, fs->len);
+        fs->len = 0;
+      }
+    }
+  }
+}
+
+void elog_sink_crash_write(const void *data, size_t len) {
+  elog_sink_t *s;
+
+  for (s = elog_sinks; s != NULL; s = s->next) {
+    if (s == &elog_stdout_sink) {
+      elog_fd_write_all(STDOUT_FILENO, (const char *)data, len);
+    } else if (s == &elog_stderr_sink) {
+      elog_fd_write_all(STDERR_FILENO, (const char *)data, len);
+    } else if (s->write == elog_fd_sink_write) {
+      elog_fd_write_all(((elog_fd_sink_t *)s)->fd, (const char *)data, len);
+    } else if (s->write == elog_shm_sink_write) {
+      elog_shm_sink_write(s, data, len);
+    }
+  }
+}
+#endif /* ELOG_USE_CRASH_HANDLER */
+
+/* ============================================================
+ * 3. 同期テキスト出力（ELOG_USE_SINK=1、非同期・バイナリ無効時）
+ * ============================================================ */
+
+#if !ELOG_USE_ASYNC && !ELOG_USE_BINARY
+
+#if ELOG_USE_DEDUP
+/* 重複抑止の状態と、繰り返し件数の行・本体の行の順序を守るロック */
+static elog_lock_t elog_dedup_lock = ELOG_LOCK_INITIALIZER;
+
+/* 繰り返し件数の行を出力する（ロック内） */
+static void elog_dedup_report(const elog_dedup_repeat_t *rep) {
+  char line[ELOG_LINE_MAX];
+  size_t pos;
+
+  if (rep->count > 0) {
+    pos = elog_line_stamp(line, sizeof(line),
+                          ELOG_USE_TIMESTAMP ? elog_clock_read() : 0);
+    pos += elog_line_repeated(line + pos, sizeof(line) - pos, rep->cs,
+                              rep->count);
+    elog_sink_dispatch(line, pos);
+  }
+}
+
+void elog_dedup_flush(void) {
+  elog_dedup_repeat_t rep;
+
+  elog_lock(&elog_dedup_lock);
+  if (elog_dedup_expire(1, &rep)) {
+    elog_dedup_report(&rep);
+  }
+  elog_unlock(&elog_dedup_lock);
+}
+#endif
+
+/*
+ * 整形済みの1行を出力する
+ * body は行のうちタイムスタンプを除いた部分、len はその長さ
+ */
+static void elog_emit_line(const elog_callsite_t *cs, const char *line,
+                           const char *body, size_t len) {
+#if ELOG_USE_DEDUP
+  elog_dedup_repeat_t rep;
+  int suppressed;
+
+  /* 行頭はコールサイトごとに同じなので、時刻を除いた行全体を比べる */
+  elog_lock(&elog_dedup_lock);
+  suppressed = elog_dedup_check(cs, body, len, &rep);
+  elog_dedup_report(&rep);
+  if (!suppressed) {
+    elog_sink_dispatch(line, (size_t)(body - line) + len);
+  }
+  elog_unlock(&elog_dedup_lock);
+#else
+  (void)cs;
+  elog_sink_dispatch(line, (size_t)(body - line) + len);
+#endif
+}
+
+void elog_emit(elog_callsite_t *cs, const char *fmt, ...) {
+  /* 時刻は呼び出し直後に取る（無効時は読まない） */
+  uint64_t ts = ELOG_USE_TIMESTAMP ? elog_clock_read() : 0;
+  char line[ELOG_LINE_MAX];
+  char *body;
+  size_t cap, len;
+  va_list ap;
+
+  elog_sigsafe_poll();
+  /* タイムスタンプ（有効時）の後ろに本体を整形する */
+  len = elog_line_stamp(line, sizeof(line), ts);
+  body = line + len;
+  cap = sizeof(line) - len;
+
+  va_start(ap, fmt);
+#if ELOG_USE_STATIC_PREFIX
+  /* fmt はプレフィックスと行末まで連結済み */
+  len = elog_vformat(body, cap, fmt, ap);
+  if (len + 1 >= cap) {
+    /* 切り捨てた場合も行末を保つ */
+    len = cap - 1 - ELOG_LINE_SUFFIX_LEN;
+    len += elog_line_suffix(body + len, ELOG_LINE_SUFFIX_LEN);
+  }
+#else
+  len = elog_line_vformat(body, cap, cs, fmt, ap);
+#endif
+  va_end(ap);
+  elog_emit_line(cs, line, body, len);
+}
+
+void elog_emit_args_at(elog_callsite_t *cs, uint64_t ts, const uint8_t *args,
+                       size_t len) {
+  char line[ELOG_LINE_MAX];
+  size_t pos = elog_line_stamp(line, sizeof(line), ts);
+
+  /* ELOG_USE_STATIC_PREFIX=1 でも行頭は実行時に組み立てる */
+  elog_emit_line(cs, line, line + pos,
+                 elog_line_format(line + pos, sizeof(line) - pos, cs, args,
+                                  len));
+}
+
+void elog_emit_args(elog_callsite_t *cs, const uint8_t *args, size_t len) {
+  elog_emit_args_at(cs, ELOG_USE_TIMESTAMP ? elog_clock_read() : 0, args, len);
+}
+
+#endif /* !ELOG_USE_ASYNC && !ELOG_USE_BINARY */
+
+#endif /* ELOG_SINK_ENABLED */
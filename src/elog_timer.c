@@ -0,0 +1,252 @@
+/**
+ * @file elog_timer.c
+ * @brief elog - スコープタイマー（ELOG_USE_SCOPE_TIMER=1）
+ *
+ * ELOG_*_SCOPE_TIMER の所要時間を、コールサイト・スレッドごとの
+ * 対数線形ヒストグラム（2のべき乗の区間をそれぞれ16分割、誤差 6.25% 以内）
+ * に数える。ヒストグラムは所有スレッドだけが書くため、記録はロックも
+ * アトミックな read-modify-write も使わない。
+ * ELOG_TIMER_PERIOD_MS が過ぎた後の最初の記録で、CAS に勝ったスレッドが
+ * 全スレッドのバケットを合計し、前回との差から件数・p50・p99・最大を
+ * タイマーの記述子で1行に出力する。
+ * 終了したスレッドのヒストグラムは件数を残したまま、次に同じタイマーを
+ * 使うスレッドが引き継ぐ。
+ */
+
+#include "elog/elog.h"
+
+#if ELOG_USE_SCOPE_TIMER && (defined(__GNUC__) || defined(__clang__))
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "elog_internal.h"
+
+/* 2のべき乗の区間あたりのバケット数（2^ELOG_TIMER_SUB_BITS） */
+#define ELOG_TIMER_SUB_BITS 4
+#define ELOG_TIMER_SUB (1u << ELOG_TIMER_SUB_BITS)
+
+/* 記録できる最大の所要時間（2^40 ns ≒ 18分、超えたものは最後のバケット） */
+#define ELOG_TIMER_MAX_BITS 40
+
+#define ELOG_TIMER_BUCKETS \
+  ((ELOG_TIMER_MAX_BITS - ELOG_TIMER_SUB_BITS + 1) * ELOG_TIMER_SUB)
+
+#define ELOG_TIMER_PERIOD_NS ((uint64_t)ELOG_TIMER_PERIOD_MS * 1000000u)
+
+
+#define ELOG_TIMER_HIST_ACTIVE 0
+#define ELOG_TIMER_HIST_FREE 1
+
+/* ============================================================
+ * 1. ヒストグラム
+ * ============================================================ */
+
+struct elog_timer_hist {
+  elog_timer_hist_t *next;       /* 同じタイマーのヒストグラム */
+  elog_timer_hist_t *owner_next; /* 同じスレッドが持つヒストグラム */
+  elog_timer_t *timer;
+  int state;                     /* ELOG_TIMER_HIST_* */
+  uint64_t max;                  /* 前回の集計以降の最大（ns） */
+  uint32_t buckets[ELOG_TIMER_BUCKETS];
+};
+
+/* 所要時間（ns）のバケット番号 */
+static inline uint32_t elog_timer_bucket(uint64_t v) {
+  uint32_t shift;
+
+  if (v < 2 * ELOG_TIMER_SUB) {
+    return (uint32_t)v;
+  }
+  if (v >= (uint64_t)1 << ELOG_TIMER_MAX_BITS) {
+    return ELOG_TIMER_BUCKETS - 1;
+  }
+  shift = (uint32_t)(63 - __builtin_clzll(v)) - ELOG_TIMER_SUB_BITS;
+  return shift * ELOG_TIMER_SUB + (uint32_t)(v >> shift);
+}
+
+/* バケットに入る最大の値（ns） */
+static uint64_t elog_timer_bucket_max(uint32_t idx) {
+  uint32_t shift;
+
+  if (idx < 2 * ELOG_TIMER_SUB) {
+    return idx;
+  }
+  shift = idx / ELOG_TIMER_SUB - 1;
+  return (((uint64_t)(idx % ELOG_TIMER_SUB + ELOG_TIMER_SUB) + 1) << shift) - 1;
+}
+
+uint64_t elog_timer_now(void) { return elog_now_ns(); }
+
+/* ============================================================
+ * 2. スレッドへの割り当て
+ * ============================================================ */
+
+static elog_timer_t *elog_timer_list; /* 登録済みのタイマー */
+static elog_lock_t elog_timer_lock = ELOG_LOCK_INITIALIZER;
+static pthread_key_t elog_timer_key;
+static pthread_once_t elog_timer_once = PTHREAD_ONCE_INIT;
+static __thread elog_timer_hist_t *elog_timer_owned;
+
+/* スレッド終了時: 持っていたヒストグラムを件数ごと空きにする */
+static void elog_timer_thread_exit(void *arg) {
+  elog_timer_hist_t *h, *next;
+
+  /* FREE にした時点で他のスレッドが取り、owner_next を書き換えうる */
+  for (h = (elog_timer_hist_t *)arg; h != NULL; h = next) {
+    next = h->owner_next;
+    __atomic_store_n(&h->state, ELOG_TIMER_HIST_FREE, __ATOMIC_RELEASE);
+  }
+  elog_timer_owned = NULL;
+}
+
+static void elog_timer_init(void) {
+  pthread_key_create(&elog_timer_key, elog_timer_thread_exit);
+  atexit(elog_timer_flush);
+}
+
+elog_timer_hist_t *elog_timer_attach(elog_timer_t *t) {
+  elog_timer_hist_t *h;
+
+  pthread_once(&elog_timer_once, elog_timer_init);
+  for (h = __atomic_load_n(&t->hists, __ATOMIC_ACQUIRE); h != NULL;
+       h = h->next) {
+    int expected = ELOG_TIMER_HIST_FREE;
+    if (__atomic_compare_exchange_n(&h->state, &expected,
+                                    ELOG_TIMER_HIST_ACTIVE, 0,
+                                    __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+      break;
+    }
+  }
+
+  elog_lock(&elog_timer_lock);
+  if (t->last == NULL) {
+    /* 最初に使われたタイマーを集計の対象に加える */
+    t->last = (uint32_t *)calloc(ELOG_TIMER_BUCKETS, sizeof(uint32_t));
+    if (t->last == NULL) {
+      elog_unlock(&elog_timer_lock);
+      return NULL;
+    }
+    t->next_report = elog_now_ns() + ELOG_TIMER_PERIOD_NS;
+    t->next = elog_timer_list;
+    __atomic_store_n(&elog_timer_list, t, __ATOMIC_RELEASE);
+  }
+  if (h == NULL) {
+    if (posix_memalign((void **)&h, ELOG_CACHE_LINE, sizeof(*h)) != 0) {
+      elog_unlock(&elog_timer_lock);
+      return NULL;
+    }
+    memset(h, 0, sizeof(*h));
+    h->timer = t;
+    h->state = ELOG_TIMER_HIST_ACTIVE;
+    h->next = t->hists;
+    __atomic_store_n(&t->hists, h, __ATOMIC_RELEASE);
+  }
+  elog_unlock(&elog_timer_lock);
+
+  h->owner_next = elog_timer_owned;
+  elog_timer_owned = h;
+  pthread_setspecific(elog_timer_key, h);
+  return h;
+}
+
+/* ============================================================
+ * 3. 集計
+ * ============================================================ */
+
+/* 小さい方から rank 番目の値が入るバケットの上限（最大で頭打ち） */
+static uint64_t elog_timer_quantile(const uint32_t *counts, uint64_t rank,
+                                    uint64_t max) {
+  uint64_t seen = 0;
+  uint32_t i;
+
+  for (i = 0; i < ELOG_TIMER_BUCKETS; i++) {
+    seen += counts[i];
+    if (seen >= rank) {
+      uint64_t v = elog_timer_bucket_max(i);
+      return v < max ? v : max;
+    }
+  }
+  return max;
+}
+
+/* 前回の集計以降の件数・p50・p99・最大を出力する */
+static void elog_timer_report(elog_timer_t *t) {
+  uint32_t counts[ELOG_TIMER_BUCKETS];
+  elog_timer_hist_t *h;
+  uint64_t count = 0, max = 0;
+  uint32_t i;
+
+  /* 同じタイマーを別のスレッドが集計中なら任せる */
+  if (__atomic_test_and_set(&t->busy, __ATOMIC_ACQUIRE)) {
+    return;
+  }
+  memset(counts, 0, sizeof(counts));
+  for (h = __atomic_load_n(&t->hists, __ATOMIC_ACQUIRE); h != NULL;
+       h = h->next) {
+    uint64_t m = __atomic_exchange_n(&h->max, 0, __ATOMIC_RELAXED);
+
+    if (m > max) {
+      max = m;
+    }
+    for (i = 0; i < ELOG_TIMER_BUCKETS; i++) {
+      counts[i] += __atomic_load_n(&h->buckets[i], __ATOMIC_RELAXED);
+    }
+  }
+  /* 件数は 32bit で折り返すが、差は1回の間隔で 2^32 未満なら正しい */
+  for (i = 0; i < ELOG_TIMER_BUCKETS; i++) {
+    uint32_t total = counts[i];
+
+    counts[i] = total - t->last[i];
+    t->last[i] = total;
+    count += counts[i];
+  }
+  if (count > 0) {
+    elog_emit_report(t->cs, (unsigned long long)count,
+                     (unsigned long long)elog_timer_quantile(
+                         counts, (count + 1) / 2, max),
+                     (unsigned long long)elog_timer_quantile(
+                         counts, (count * 99 + 99) / 100, max),
+                     (unsigned long long)max);
+  }
+  __atomic_clear(&t->busy, __ATOMIC_RELEASE);
+}
+
+void elog_timer_record(elog_timer_hist_t *h, uint64_t start, uint64_t end) {
+  elog_timer_t *t = h->timer;
+  uint64_t v = end - start;
+  uint32_t idx = elog_timer_bucket(v);
+  uint64_t at;
+
+  /* 書くのは所有スレッドだけ。集計側が途中の値を読まないようにだけする */
+  __atomic_store_n(&h->buckets[idx],
+                   __atomic_load_n(&h->buckets[idx], __ATOMIC_RELAXED) + 1,
+                   __ATOMIC_RELAXED);
+  if (v > __atomic_load_n(&h->max, __ATOMIC_RELAXED)) {
+    __atomic_store_n(&h->max, v, __ATOMIC_RELAXED);
+  }
+
+  at = __atomic_load_n(&t->next_report, __ATOMIC_RELAXED);
+  if (__builtin_expect(end >= at, 0) &&
+      __atomic_compare_exchange_n(&t->next_report, &at,
+                                  end + ELOG_TIMER_PERIOD_NS, 0,
+                                  __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    elog_timer_report(t);
+  }
+}
+
+void elog_timer_flush(void) {
+  elog_timer_t *t;
+
+  for (t = __atomic_load_n(&elog_timer_list, __ATOMIC_ACQUIRE); t != NULL;
+       t = t->next) {
+    elog_timer_report(t);
+  }
+#if ELOG_SINK_ENABLED && !ELOG_USE_ASYNC
+  /* 終了時に呼ばれた場合もシンクのバッファに残さない */
+  elog_sink_flush();
+#endif
+}
+
+#endif /* ELOG_USE_SCOPE_TIMER && (__GNUC__ || __clang__) */
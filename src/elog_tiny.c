@@ -0,0 +1,559 @@
+/**
+ * @file elog_tiny.c
+ * @brief elog - 組み込み向けの小さな printf（ELOG_USE_TINY_PRINTF=1）
+ *
+ * printf 出力の ELOG_IMPL から libc の printf の代わりに呼ばれる。
+ * 整形しながらスタック上の ELOG_TINY_BUF_SIZE バイトのバッファへ溜め、
+ * 一杯になるたびに出力先の関数へ渡す。状態はすべて呼び出しごとの
+ * スタック上にあり、静的な状態は出力先の関数ポインタだけなので、
+ * 割り込みや別スレッドから同時に呼んでもよい（出力が混ざることはある）。
+ * 浮動小数点は ELOG_TINY_FLOAT=1 の場合のみ扱う。libc の関数は
+ * POSIX での既定の出力先（write(2)）以外使わない。
+ * ELOG_USE_SIGSAFE=1 でシンクを使わない構成では、シグナルハンドラからの
+ * 出力（elog_sigsafe.c）が1行をメモリ上で組み立てるのにも使う。
+ */
+
+#include "elog/elog.h"
+
+#if ELOG_USE_TINY_PRINTF || (ELOG_USE_SIGSAFE && !ELOG_SINK_ENABLED)
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "elog_internal.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <unistd.h>
+#endif
+
+/* ============================================================
+ * 1. 出力先
+ * ============================================================ */
+
+#if ELOG_USE_TINY_PRINTF
+#if defined(__unix__) || defined(__APPLE__)
+static void elog_tiny_write_stdout(const char *data, size_t len) {
+  while (len > 0) {
+    ssize_t n = write(STDOUT_FILENO, data, len);
+    if (n <= 0) {
+      return;
+    }
+    data += n;
+    len -= (size_t)n;
+  }
+}
+#define ELOG_TINY_DEFAULT_OUTPUT elog_tiny_write_stdout
+#else
+/* 出力先が設定されるまでは捨てる */
+static void elog_tiny_write_none(const char *data, size_t len) {
+  (void)data;
+  (void)len;
+}
+#define ELOG_TINY_DEFAULT_OUTPUT elog_tiny_write_none
+#endif
+
+static elog_tiny_write_fn elog_tiny_output = ELOG_TINY_DEFAULT_OUTPUT;
+
+void elog_tiny_set_output(elog_tiny_write_fn fn) {
+  __atomic_store_n(&elog_tiny_output,
+                   fn != NULL ? fn : ELOG_TINY_DEFAULT_OUTPUT,
+                   __ATOMIC_RELEASE);
+}
+
+void elog_tiny_write(const char *data, size_t len) {
+  __atomic_load_n(&elog_tiny_output, __ATOMIC_ACQUIRE)(data, len);
+}
+#endif /* ELOG_USE_TINY_PRINTF */
+
+/* ============================================================
+ * 2. 出力バッファ
+ * ============================================================ */
+
+/* 一杯になったバッファの渡し先（elog_tiny_write_fn と同じ形） */
+typedef void (*elog_tiny_out_fn)(const char *data, size_t len);
+
+typedef struct {
+  elog_tiny_out_fn write; /* NULL: buf に書くだけ（溢れた分は捨てる） */
+  char *buf;
+  size_t cap;
+  size_t len;
+  int total;
+} elog_tiny_out_t;
+
+static void elog_tiny_flush(elog_tiny_out_t *o) {
+  if (o->len > 0 && o->write != NULL) {
+    o->write(o->buf, o->len);
+    o->len = 0;
+  }
+}
+
+static void elog_tiny_putc(elog_tiny_out_t *o, char c) {
+  if (o->len == o->cap) {
+    if (o->write == NULL) {
+      o->total++;
+      return;
+    }
+    elog_tiny_flush(o);
+  }
+  o->buf[o->len++] = c;
+  o->total++;
+}
+
+static void elog_tiny_puts(elog_tiny_out_t *o, const char *s, size_t n) {
+  while (n-- > 0) {
+    elog_tiny_putc(o, *s++);
+  }
+}
+
+static void elog_tiny_pad(elog_tiny_out_t *o, char c, int n) {
+  while (n-- > 0) {
+    elog_tiny_putc(o, c);
+  }
+}
+
+/* ============================================================
+ * 3. 変換
+ * ============================================================ */
+
+#define ELOG_TINY_MINUS 0x01u
+#define ELOG_TINY_PLUS 0x02u
+#define ELOG_TINY_SPACE 0x04u
+#define ELOG_TINY_ALT 0x08u
+#define ELOG_TINY_ZERO 0x10u
+
+/* 変換指定1つ分（解析結果） */
+typedef struct {
+  unsigned flags;
+  int width;
+  int precision; /* 未指定は -1 */
+  char len;      /* 'H'(hh) 'h' 'l' 'L'(ll) 'j' 'z' 't' または 0 */
+  char conv;
+} elog_tiny_spec_t;
+
+/* [空白][prefix][0 埋め][body][空白] を幅に合わせて出力する */
+static void elog_tiny_field(elog_tiny_out_t *o, const elog_tiny_spec_t *sp,
+                            const char *prefix, int plen, int zeros,
+                            const char *body, int blen) {
+  int pad = sp->width - plen - zeros - blen;
+
+  if (!(sp->flags & ELOG_TINY_MINUS)) {
+    if (sp->flags & ELOG_TINY_ZERO) {
+      zeros += pad > 0 ? pad : 0;
+    } else {
+      elog_tiny_pad(o, ' ', pad);
+    }
+    pad = 0;
+  }
+  elog_tiny_puts(o, prefix, (size_t)plen);
+  elog_tiny_pad(o, '0', zeros);
+  elog_tiny_puts(o, body, (size_t)blen);
+  elog_tiny_pad(o, ' ', pad);
+}
+
+/*
+ * v を base 進で end の手前へ書き、先頭を返す
+ * 32 ビットに収まる値は 32 ビットの除算で済ませる（64 ビット除算の
+ * ランタイム呼び出しを避ける）
+ */
+static char *elog_tiny_digits(char *end, uint64_t v, unsigned base,
+                              int upper) {
+  const char *digits = upper ? "0123456789ABCDEF" : "0123456789abcdef";
+
+  while (v > UINT32_MAX) {
+    *--end = digits[v % base];
+    v /= base;
+  }
+  {
+    uint32_t w = (uint32_t)v;
+    do {
+      *--end = digits[w % base];
+      w /= base;
+    } while (w != 0);
+  }
+  return end;
+}
+
+static void elog_tiny_integer(elog_tiny_out_t *o, elog_tiny_spec_t *sp,
+                              uint64_t v, int negative) {
+  char buf[24]; /* 64 ビットの8進数は22桁 */
+  char *end = buf + sizeof(buf);
+  char *body = end;
+  char prefix[2];
+  int plen = 0, blen, zeros = 0;
+  unsigned base = sp->conv == 'o' ? 8 : (sp->conv == 'x' || sp->conv == 'X' ||
+                                         sp->conv == 'p') ? 16 : 10;
+
+  if (negative) {
+    prefix[plen++] = '-';
+  } else if (sp->flags & ELOG_TINY_PLUS) {
+    prefix[plen++] = '+';
+  } else if (sp->flags & ELOG_TINY_SPACE) {
+    prefix[plen++] = ' ';
+  }
+  if (sp->precision != 0 || v != 0) {
+    body = elog_tiny_digits(end, v, base, sp->conv == 'X');
+  }
+  blen = (int)(end - body);
+  if (sp->precision > blen) {
+    zeros = sp->precision - blen;
+  }
+  if ((sp->flags & ELOG_TINY_ALT) && base != 10 &&
+      (v != 0 || sp->conv == 'p')) {
+    if (base == 8) {
+      zeros = zeros > 0 ? zeros : 1;
+    } else {
+      prefix[0] = '0';
+      prefix[1] = sp->conv == 'X' ? 'X' : 'x';
+      plen = 2;
+    }
+  }
+  if (sp->precision >= 0) {
+    sp->flags &= ~ELOG_TINY_ZERO;
+  }
+  elog_tiny_field(o, sp, prefix, plen, zeros, body, blen);
+}
+
+#if ELOG_TINY_FLOAT
+/* %f（精度は 9 桁まで。2^64 以上は "ovf"） */
+static void elog_tiny_float(elog_tiny_out_t *o, elog_tiny_spec_t *sp,
+                            double v) {
+  static const uint32_t pow10[] = {1,      10,      100,      1000,
+                                   10000,  100000,  1000000,  10000000,
+                                   100000000, 1000000000};
+  char buf[32];
+  char *end = buf + sizeof(buf);
+  char *body;
+  char sign[1];
+  int plen = 0;
+  int prec = sp->precision < 0 ? 6 : sp->precision > 9 ? 9 : sp->precision;
+  uint64_t ip;
+  uint32_t frac;
+  double scaled;
+
+  if (v < 0 || (v == 0 && 1 / v < 0)) {
+    sign[plen++] = '-';
+    v = -v;
+  } else if (sp->flags & ELOG_TINY_PLUS) {
+    sign[plen++] = '+';
+  } else if (sp->flags & ELOG_TINY_SPACE) {
+    sign[plen++] = ' ';
+  }
+
+  if (v != v) {
+    sp->flags &= ~ELOG_TINY_ZERO;
+    elog_tiny_field(o, sp, sign, 0, 0, "nan", 3);
+    return;
+  }
+  if (v >= 18446744073709551616.0) {
+    sp->flags &= ~ELOG_TINY_ZERO;
+    elog_tiny_field(o, sp, sign, plen, 0, v > 1.7976931348623157e308 ? "inf"
+                                                                    : "ovf",
+                    3);
+    return;
+  }
+
+  ip = (uint64_t)v;
+  scaled = (v - (double)ip) * pow10[prec] + 0.5;
+  frac = (uint32_t)scaled;
+  if (frac >= pow10[prec]) {
+    frac -= pow10[prec];
+    ip++;
+  }
+  body = end;
+  if (prec > 0 || (sp->flags & ELOG_TINY_ALT)) {
+    int i;
+    for (i = 0; i < prec; i++) {
+      *--body = (char)('0' + frac % 10);
+      frac /= 10;
+    }
+    *--body = '.';
+  }
+  body = elog_tiny_digits(body, ip, 10, 0);
+  elog_tiny_field(o, sp, sign, plen, 0, body, (int)(end - body));
+}
+#endif /* ELOG_TINY_FLOAT */
+
+/* ============================================================
+ * 4. フォーマット文字列
+ * ============================================================ */
+
+static const char *elog_tiny_parse(const char *p, elog_tiny_spec_t *sp,
+                                   va_list *ap) {
+  sp->flags = 0;
+  sp->width = 0;
+  sp->precision = -1;
+  sp->len = 0;
+
+  for (;; p++) {
+    if (*p == '-') {
+      sp->flags |= ELOG_TINY_MINUS;
+    } else if (*p == '+') {
+      sp->flags |= ELOG_TINY_PLUS;
+    } else if (*p == ' ') {
+      sp->flags |= ELOG_TINY_SPACE;
+    } else if (*p == '#') {
+      sp->flags |= ELOG_TINY_ALT;
+    } else if (*p == '0') {
+      sp->flags |= ELOG_TINY_ZERO;
+    } else {
+      break;
+    }
+  }
+
+  if (*p == '*') {
+    sp->width = va_arg(*ap, int);
+    if (sp->width < 0) {
+      sp->flags |= ELOG_TINY_MINUS;
+      sp->width = -sp->width;
+    }
+    p++;
+  } else {
+    while (*p >= '0' && *p <= '9') {
+      sp->width = sp->width * 10 + (*p++ - '0');
+    }
+  }
+
+  if (*p == '.') {
+    p++;
+    sp->precision = 0;
+    if (*p == '*') {
+      sp->precision = va_arg(*ap, int);
+      if (sp->precision < 0) {
+        sp->precision = -1;
+      }
+      p++;
+    } else {
+      while (*p >= '0' && *p <= '9') {
+        sp->precision = sp->precision * 10 + (*p++ - '0');
+      }
+    }
+  }
+
+  if (*p == 'h' || *p == 'l') {
+    sp->len = *p++;
+    if (*p == sp->len) {
+      sp->len = sp->len == 'h' ? 'H' : 'L';
+      p++;
+    }
+  } else if (*p == 'j' || *p == 'z' || *p == 't' || *p == 'L') {
+    sp->len = *p++;
+  }
+  if (sp->flags & ELOG_TINY_MINUS) {
+    sp->flags &= ~ELOG_TINY_ZERO;
+  }
+  sp->conv = *p;
+  return *p != '\0' ? p + 1 : p;
+}
+
+static int64_t elog_tiny_signed(const elog_tiny_spec_t *sp, va_list *ap) {
+  switch (sp->len) {
+    case 'H':
+      return (signed char)va_arg(*ap, int);
+    case 'h':
+      return (short)va_arg(*ap, int);
+    case 'l':
+      return va_arg(*ap, long);
+    case 'L':
+      return va_arg(*ap, long long);
+    case 'j':
+      return va_arg(*ap, intmax_t);
+    case 'z':
+    case 't':
+      return va_arg(*ap, ptrdiff_t);
+    default:
+      return va_arg(*ap, int);
+  }
+}
+
+static uint64_t elog_tiny_unsigned(const elog_tiny_spec_t *sp, va_list *ap) {
+  switch (sp->len) {
+    case 'H':
+      return (unsigned char)va_arg(*ap, unsigned int);
+    case 'h':
+      return (unsigned short)va_arg(*ap, unsigned int);
+    case 'l':
+      return va_arg(*ap, unsigned long);
+    case 'L':
+      return va_arg(*ap, unsigned long long);
+    case 'j':
+      return va_arg(*ap, uintmax_t);
+    case 'z':
+    case 't':
+      return va_arg(*ap, size_t);
+    default:
+      return va_arg(*ap, unsigned int);
+  }
+}
+
+static void elog_tiny_format(elog_tiny_out_t *o, const char *fmt,
+                             va_list *ap) {
+  elog_tiny_spec_t sp;
+
+  while (*fmt != '\0') {
+    if (*fmt != '%') {
+      elog_tiny_putc(o, *fmt++);
+      continue;
+    }
+    fmt = elog_tiny_parse(fmt + 1, &sp, ap);
+
+    switch (sp.conv) {
+      case 'd':
+      case 'i': {
+        int64_t v = elog_tiny_signed(&sp, ap);
+        elog_tiny_integer(o, &sp, v < 0 ? 0 - (uint64_t)v : (uint64_t)v,
+                          v < 0);
+        break;
+      }
+      case 'u':
+      case 'o':
+      case 'x':
+      case 'X':
+        sp.flags &= ~(ELOG_TINY_PLUS | ELOG_TINY_SPACE);
+        elog_tiny_integer(o, &sp, elog_tiny_unsigned(&sp, ap), 0);
+        break;
+      case 'p':
+        /* 常に 0x + 16進（libc の "(nil)" などの違いは持たない） */
+        sp.flags = (sp.flags & ELOG_TINY_MINUS) | ELOG_TINY_ALT;
+        sp.precision = -1;
+        elog_tiny_integer(o, &sp, (uintptr_t)va_arg(*ap, void *), 0);
+        break;
+      case 'c': {
+        char c = (char)va_arg(*ap, int);
+        elog_tiny_field(o, &sp, "", 0, 0, &c, 1);
+        break;
+      }
+      case 's': {
+        const char *s = va_arg(*ap, const char *);
+        int n = 0;
+
+        if (s == NULL) {
+          s = "(null)";
+        }
+        while (s[n] != '\0' && (sp.precision < 0 || n < sp.precision)) {
+          n++;
+        }
+        sp.flags &= ~ELOG_TINY_ZERO;
+        elog_tiny_field(o, &sp, "", 0, 0, s, n);
+        break;
+      }
+      case 'n':
+        (void)va_arg(*ap, void *);
+        break;
+      case 'f':
+      case 'F':
+      case 'e':
+      case 'E':
+      case 'g':
+      case 'G':
+      case 'a':
+      case 'A':
+        /* %e %g %a も %f として出力する */
+        if (sp.len == 'L') {
+#if ELOG_TINY_FLOAT
+          elog_tiny_float(o, &sp, (double)va_arg(*ap, long double));
+#else
+          (void)va_arg(*ap, long double);
+          elog_tiny_putc(o, '?');
+#endif
+        } else {
+#if ELOG_TINY_FLOAT
+          elog_tiny_float(o, &sp, va_arg(*ap, double));
+#else
+          (void)va_arg(*ap, double);
+          elog_tiny_putc(o, '?');
+#endif
+        }
+        break;
+      case '%':
+        elog_tiny_putc(o, '%');
+        break;
+      case '\0':
+        return;
+      default:
+        /* 解釈できない指定はそのまま出す */
+        elog_tiny_putc(o, '%');
+        elog_tiny_putc(o, sp.conv);
+        break;
+    }
+  }
+}
+
+static void elog_tiny_formatf(elog_tiny_out_t *o, const char *fmt, ...) {
+  va_list ap;
+
+  va_start(ap, fmt);
+  elog_tiny_format(o, fmt, &ap);
+  va_end(ap);
+}
+
+static void elog_tiny_init(elog_tiny_out_t *o, elog_tiny_out_fn write,
+                           char *buf, size_t cap) {
+  o->write = write;
+  o->buf = buf;
+  o->cap = cap;
+  o->len = 0;
+  o->total = 0;
+}
+
+/* 記述子のプレフィックスと cs->fmt で整形した引数（行末は含まない） */
+static void elog_tiny_line(elog_tiny_out_t *o, const elog_callsite_t *cs,
+                           va_list ap) {
+  uint8_t level = cs->level <= ELOG_LEVEL_TRACE ? cs->level : ELOG_LEVEL_TRACE;
+  va_list aq;
+
+#if ELOG_USE_FILE_LINE
+  elog_tiny_formatf(o, "%s%s " ELOG_FILE_LINE_FMT " ",
+                    elog_level_colors[level], elog_level_strs[level],
+                    cs->file != NULL ? cs->file : "", (int)cs->line);
+#else
+  elog_tiny_formatf(o, "%s%s  ", elog_level_colors[level],
+                    elog_level_strs[level]);
+#endif
+  va_copy(aq, ap);
+  elog_tiny_format(o, cs->fmt, &aq);
+  va_end(aq);
+}
+
+#if ELOG_USE_TINY_PRINTF
+int elog_tiny_printf(const char *fmt, ...) {
+  char buf[ELOG_TINY_BUF_SIZE];
+  elog_tiny_out_t o;
+  va_list ap;
+
+  elog_tiny_init(&o, __atomic_load_n(&elog_tiny_output, __ATOMIC_ACQUIRE), buf,
+                 sizeof(buf));
+  va_start(ap, fmt);
+  elog_tiny_format(&o, fmt, &ap);
+  va_end(ap);
+  elog_tiny_flush(&o);
+  return o.total;
+}
+
+void elog_tiny_vprint(const elog_callsite_t *cs, va_list ap) {
+  static const char suffix[] = ELOG_COLOR_END "\n";
+  char buf[ELOG_TINY_BUF_SIZE];
+  elog_tiny_out_t o;
+
+  elog_tiny_init(&o, __atomic_load_n(&elog_tiny_output, __ATOMIC_ACQUIRE), buf,
+                 sizeof(buf));
+  elog_tiny_line(&o, cs, ap);
+  elog_tiny_puts(&o, suffix, sizeof(suffix) - 1);
+  elog_tiny_flush(&o);
+}
+#else
+size_t elog_tiny_vformat_line(char *dst, size_t cap, const elog_callsite_t *cs,
+                              va_list ap) {
+  static const char suffix[] = ELOG_COLOR_END "\n";
+  elog_tiny_out_t o;
+
+  /* 切り捨てた場合も行末を保つ */
+  elog_tiny_init(&o, NULL, dst, cap - (sizeof(suffix) - 1));
+  elog_tiny_line(&o, cs, ap);
+  o.cap = cap;
+  elog_tiny_puts(&o, suffix, sizeof(suffix) - 1);
+  return o.len;
+}
+#endif /* ELOG_USE_TINY_PRINTF */
+
+#endif /* ELOG_USE_TINY_PRINTF || (ELOG_USE_SIGSAFE && !ELOG_SINK_ENABLED) */
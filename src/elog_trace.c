@@ -0,0 +1,439 @@
+/**
+ * @file elog_trace.c
+ * @brief elog - トレースイベント（ELOG_USE_TRACE_EVENTS=1）
+ *
+ * ELOG_SPAN_BEGIN / END・ELOG_INSTANT・ELOG_COUNTER は、時刻・記述子・値だけの
+ * 固定長イベントを呼び出しスレッド専用の単一プロデューサリングへ書き込む
+ * （整形しない）。elog_trace_open() が起動する書き出しスレッドが全リングを
+ * 巡回し、Chrome のトレースイベント形式の JSON の1行ずつに変換して
+ * ファイルへ書く。
+ * リングが満杯の場合はイベントを捨てて数え、閉じるときに JSON の
+ * otherData と WARN の1行で報告する。スレッド終了時のリングの扱いは
+ * 非同期バックエンドと同じ（残りを書き出した後で新しいスレッドが再利用する）。
+ */
+
+#include "elog/elog.h"
+
+#if ELOG_USE_TRACE_EVENTS
+
+#include <pthread.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#if defined(__linux__)
+#include <sys/syscall.h>
+#endif
+
+#include "elog_internal.h"
+
+#if (ELOG_TRACE_EVENTS & (ELOG_TRACE_EVENTS - 1)) != 0
+#error "ELOG_TRACE_EVENTS must be a power of two"
+#endif
+
+/* 書き出しスレッドが全リングを空と判断した後に眠る時間 */
+#ifndef ELOG_TRACE_POLL_US
+#define ELOG_TRACE_POLL_US 1000
+#endif
+
+/* ファイルの stdio バッファのバイト数 */
+#ifndef ELOG_TRACE_BUFFER_SIZE
+#define ELOG_TRACE_BUFFER_SIZE 65536
+#endif
+
+#define ELOG_TRACE_MASK ((uint64_t)ELOG_TRACE_EVENTS - 1)
+
+volatile uint8_t elog_trace_active;
+
+/* ============================================================
+ * 1. イベントとスレッドごとのリング
+ * ============================================================ */
+
+typedef struct {
+  uint64_t ts;         /* elog_now_ns() の値 */
+  elog_callsite_t *cs; /* 記述子（cs->fmt がイベント名） */
+  int64_t value;       /* ELOG_TRACE_COUNTER の値 */
+  char phase;          /* ELOG_TRACE_* */
+} elog_trace_event_t;
+
+/* リングの状態 */
+enum {
+  ELOG_TRACE_RING_ACTIVE = 0, /* 所有スレッドが書き込み中 */
+  ELOG_TRACE_RING_EXITED,     /* 所有スレッドが終了（残りを書き出し待ち） */
+  ELOG_TRACE_RING_FREE        /* 空になり、再利用できる */
+};
+
+typedef struct elog_trace_ring {
+  /* プロデューサのみが書き込む */
+  uint64_t tail __attribute__((aligned(ELOG_CACHE_LINE)));
+  uint64_t head_cache; /* 最後に読んだ head（満杯判定用） */
+  uint64_t dropped;    /* 書き出し側が exchange で回収する */
+
+  /* 書き出しスレッドのみが書き込む */
+  uint64_t head __attribute__((aligned(ELOG_CACHE_LINE)));
+
+  int state __attribute__((aligned(ELOG_CACHE_LINE)));
+  long tid;                     /* JSON の "tid" */
+  struct elog_trace_ring *next; /* 登録リスト（先頭に追加のみ） */
+
+  elog_trace_event_t events[ELOG_TRACE_EVENTS]
+      __attribute__((aligned(ELOG_CACHE_LINE)));
+} elog_trace_ring_t;
+
+static elog_trace_ring_t *elog_trace_rings; /* 登録リストの先頭 */
+static __thread elog_trace_ring_t *elog_trace_self;
+static pthread_key_t elog_trace_key;
+static pthread_once_t elog_trace_once = PTHREAD_ONCE_INIT;
+
+/* リングを割り当てられなかったイベントの破棄数 */
+static uint64_t elog_trace_unattached;
+
+/* 呼び出しスレッドの ID（Linux ではカーネルのスレッド ID） */
+static long elog_trace_gettid(void) {
+#if defined(__linux__) && defined(SYS_gettid)
+  return (long)syscall(SYS_gettid);
+#else
+  static long next_tid;
+  return __atomic_add_fetch(&next_tid, 1, __ATOMIC_RELAXED);
+#endif
+}
+
+/* スレッド終了時: リングを終了済みにし、残りを書き出させる */
+static void elog_trace_thread_exit(void *arg) {
+  elog_trace_ring_t *r = (elog_trace_ring_t *)arg;
+
+  elog_trace_self = NULL;
+  __atomic_store_n(&r->state, ELOG_TRACE_RING_EXITED, __ATOMIC_RELEASE);
+}
+
+static void elog_trace_init(void) {
+  pthread_key_create(&elog_trace_key, elog_trace_thread_exit);
+  atexit(elog_trace_close);
+}
+
+/* 呼び出しスレッドにリングを割り当てる（空きがあれば再利用する） */
+static elog_trace_ring_t *elog_trace_attach(void) {
+  elog_trace_ring_t *r;
+
+  for (r = __atomic_load_n(&elog_trace_rings, __ATOMIC_ACQUIRE); r != NULL;
+       r = r->next) {
+    int expected = ELOG_TRACE_RING_FREE;
+    if (__atomic_compare_exchange_n(&r->state, &expected,
+                                    ELOG_TRACE_RING_ACTIVE, 0,
+                                    __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+      r->head_cache = __atomic_load_n(&r->head, __ATOMIC_RELAXED);
+      break;
+    }
+  }
+
+  if (r == NULL) {
+    if (posix_memalign((void **)&r, ELOG_CACHE_LINE, sizeof(*r)) != 0) {
+      return NULL;
+    }
+    memset(r, 0, offsetof(elog_trace_ring_t, events));
+    r->state = ELOG_TRACE_RING_ACTIVE;
+    r->tid = elog_trace_gettid();
+    r->next = __atomic_load_n(&elog_trace_rings, __ATOMIC_RELAXED);
+    while (!__atomic_compare_exchange_n(&elog_trace_rings, &r->next, r, 1,
+                                        __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {
+    }
+  } else {
+    r->tid = elog_trace_gettid();
+  }
+
+  pthread_setspecific(elog_trace_key, r);
+  elog_trace_self = r;
+  return r;
+}
+
+void elog_trace_record(elog_callsite_t *cs, char phase, int64_t value) {
+  elog_trace_ring_t *r = elog_trace_self;
+  elog_trace_event_t *e;
+  uint64_t tail;
+
+  if (__builtin_expect(r == NULL, 0)) {
+    pthread_once(&elog_trace_once, elog_trace_init);
+    if ((r = elog_trace_attach()) == NULL) {
+      __atomic_fetch_add(&elog_trace_unattached, 1, __ATOMIC_RELAXED);
+      return;
+    }
+  }
+
+  tail = r->tail;
+  if (tail - r->head_cache >= ELOG_TRACE_EVENTS) {
+    r->head_cache = __atomic_load_n(&r->head, __ATOMIC_ACQUIRE);
+    if (tail - r->head_cache >= ELOG_TRACE_EVENTS) {
+      /* 満杯: 呼び出し側を待たせずに捨てる */
+      __atomic_fetch_add(&r->dropped, 1, __ATOMIC_RELAXED);
+      return;
+    }
+  }
+  e = &r->events[tail & ELOG_TRACE_MASK];
+  e->ts = elog_now_ns();
+  e->cs = cs;
+  e->value = value;
+  e->phase = phase;
+  __atomic_store_n(&r->tail, tail + 1, __ATOMIC_RELEASE);
+}
+
+/* ============================================================
+ * 2. JSON への書き出し
+ * ============================================================ */
+
+/* elog_trace_open / elog_trace_close 全体を直列にする */
+static pthread_mutex_t elog_trace_session = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t elog_trace_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t elog_trace_wake = PTHREAD_COND_INITIALIZER;
+static pthread_t elog_trace_thread;
+static int elog_trace_stop; /* mutex で保護 */
+static FILE *elog_trace_file;
+static char *elog_trace_buf;
+static uint64_t elog_trace_start; /* 記録を始めた時刻（"ts" の基準） */
+static uint64_t elog_trace_written;
+static uint64_t elog_trace_dropped; /* 今回の記録で捨てたイベント数 */
+static long elog_trace_pid;
+
+/* 破棄されたイベント数を報告する行の記述子 */
+static elog_callsite_t elog_trace_drop_cs ELOG_CALLSITE_ATTR = {
+    "%llu trace events dropped (ring full)", "elog", 0, ELOG_LEVEL_WARN, 0, 0
+#if ELOG_USE_DYNAMIC_DEBUG
+    , "elog_trace"
+#endif
+};
+
+/* 1イベントの行の最大バイト数（長い名前・ファイル名は切り詰める） */
+#define ELOG_TRACE_LINE_MAX 512
+
+static char *elog_trace_put_lit(char *p, const char *s) {
+  while (*s != '\0') {
+    *p++ = *s++;
+  }
+  return p;
+}
+
+static char *elog_trace_put_u64(char *p, uint64_t v) {
+  char tmp[20];
+  int n = 0;
+
+  do {
+    tmp[n++] = (char)('0' + v % 10);
+    v /= 10;
+  } while (v != 0);
+  while (n > 0) {
+    *p++ = tmp[--n];
+  }
+  return p;
+}
+
+/* JSON の文字列として書く（'"' '\\' と制御文字をエスケープ、end の手前まで） */
+static char *elog_trace_put_string(char *p, char *end, const char *s) {
+  static const char hex[] = "0123456789abcdef";
+
+  *p++ = '"';
+  for (; *s != '\0' && p < end; s++) {
+    unsigned char c = (unsigned char)*s;
+
+    if (c == '"' || c == '\\') {
+      *p++ = '\\';
+      *p++ = (char)c;
+    } else if (c < 0x20) {
+      p = elog_trace_put_lit(p, "\\u00");
+      *p++ = hex[c >> 4];
+      *p++ = hex[c & 0xf];
+    } else {
+      *p++ = (char)c;
+    }
+  }
+  *p++ = '"';
+  return p;
+}
+
+/* 1イベントを1行で書く（"ts" はマイクロ秒、小数部で ns まで） */
+static void elog_trace_put_event(FILE *f, long tid,
+                                 const elog_trace_event_t *e) {
+  char line[ELOG_TRACE_LINE_MAX];
+  char *end = line + ELOG_TRACE_LINE_MAX / 2 - 8; /* 名前・ファイル名の上限 */
+  const elog_callsite_t *cs = e->cs;
+  uint64_t ts = e->ts - elog_trace_start;
+  unsigned frac = (unsigned)(ts % 1000);
+  char *p = line;
+
+  p = elog_trace_put_lit(p, elog_trace_written++ > 0 ? ",\n{\"name\":"
+                                                      : "\n{\"name\":");
+  p = elog_trace_put_string(p, end, cs->fmt);
+  p = elog_trace_put_lit(p, ",\"cat\":\"elog\",\"ph\":\"");
+  *p++ = e->phase;
+  p = elog_trace_put_lit(p, "\",\"ts\":");
+  p = elog_trace_put_u64(p, ts / 1000);
+  *p++ = '.';
+  *p++ = (char)('0' + frac / 100);
+  *p++ = (char)('0' + frac / 10 % 10);
+  *p++ = (char)('0' + frac % 10);
+  p = elog_trace_put_lit(p, ",\"pid\":");
+  p = elog_trace_put_u64(p, (uint64_t)elog_trace_pid);
+  p = elog_trace_put_lit(p, ",\"tid\":");
+  p = elog_trace_put_u64(p, (uint64_t)tid);
+  switch (e->phase) {
+  case ELOG_TRACE_COUNTER:
+    p = elog_trace_put_lit(p, ",\"args\":{\"value\":");
+    if (e->value < 0) {
+      *p++ = '-';
+    }
+    p = elog_trace_put_u64(p, e->value < 0 ? 0 - (uint64_t)e->value
+                                           : (uint64_t)e->value);
+    *p++ = '}';
+    break;
+  case ELOG_TRACE_INSTANT:
+    p = elog_trace_put_lit(p, ",\"s\":\"t\"");
+    /* fall through */
+  case ELOG_TRACE_BEGIN:
+    if (cs->file != NULL) {
+      p = elog_trace_put_lit(p, ",\"args\":{\"src\":");
+      p = elog_trace_put_string(p, p + ELOG_TRACE_LINE_MAX / 4, cs->file);
+      p = elog_trace_put_lit(p, ",\"line\":");
+      p = elog_trace_put_u64(p, cs->line);
+      *p++ = '}';
+    }
+    break;
+  default:
+    break;
+  }
+  *p++ = '}';
+  fwrite(line, 1, (size_t)(p - line), f);
+}
+
+/* 全リングを1巡して書き出す。書き出したイベント数を返す */
+static size_t elog_trace_drain(void) {
+  elog_trace_ring_t *r;
+  size_t count = 0;
+
+  for (r = __atomic_load_n(&elog_trace_rings, __ATOMIC_ACQUIRE); r != NULL;
+       r = r->next) {
+    int state = __atomic_load_n(&r->state, __ATOMIC_ACQUIRE);
+    uint64_t head = r->head;
+    uint64_t tail = __atomic_load_n(&r->tail, __ATOMIC_ACQUIRE);
+
+    if (state == ELOG_TRACE_RING_FREE) {
+      continue;
+    }
+    for (; head != tail; head++) {
+      const elog_trace_event_t *e = &r->events[head & ELOG_TRACE_MASK];
+
+      /* 前回の記録を閉じた後に書かれたイベントは含めない */
+      if (e->ts >= elog_trace_start) {
+        elog_trace_put_event(elog_trace_file, r->tid, e);
+        count++;
+      }
+    }
+    __atomic_store_n(&r->head, head, __ATOMIC_RELEASE);
+    elog_trace_dropped +=
+        __atomic_exchange_n(&r->dropped, 0, __ATOMIC_RELAXED);
+    if (state == ELOG_TRACE_RING_EXITED &&
+        head == __atomic_load_n(&r->tail, __ATOMIC_ACQUIRE)) {
+      __atomic_store_n(&r->state, ELOG_TRACE_RING_FREE, __ATOMIC_RELEASE);
+    }
+  }
+  elog_trace_dropped +=
+      __atomic_exchange_n(&elog_trace_unattached, 0, __ATOMIC_RELAXED);
+  return count;
+}
+
+static void *elog_trace_main(void *arg) {
+  (void)arg;
+
+  pthread_mutex_lock(&elog_trace_mutex);
+  while (!elog_trace_stop) {
+    size_t n;
+
+    pthread_mutex_unlock(&elog_trace_mutex);
+    n = elog_trace_drain();
+    pthread_mutex_lock(&elog_trace_mutex);
+    if (n == 0 && !elog_trace_stop) {
+      struct timespec ts;
+      clock_gettime(CLOCK_REALTIME, &ts);
+      ts.tv_nsec += ELOG_TRACE_POLL_US * 1000L;
+      if (ts.tv_nsec >= 1000000000L) {
+        ts.tv_sec += ts.tv_nsec / 1000000000L;
+        ts.tv_nsec %= 1000000000L;
+      }
+      pthread_cond_timedwait(&elog_trace_wake, &elog_trace_mutex, &ts);
+    }
+  }
+  pthread_mutex_unlock(&elog_trace_mutex);
+  return NULL;
+}
+
+/* 記録中なら書き出しスレッドを止め、残りを書いて閉じる（session を保持して呼ぶ） */
+static void elog_trace_close_locked(void) {
+  uint64_t dropped;
+
+  if (elog_trace_file == NULL) {
+    return;
+  }
+  __atomic_store_n(&elog_trace_active, 0, __ATOMIC_RELEASE);
+  pthread_mutex_lock(&elog_trace_mutex);
+  elog_trace_stop = 1;
+  pthread_cond_signal(&elog_trace_wake);
+  pthread_mutex_unlock(&elog_trace_mutex);
+  pthread_join(elog_trace_thread, NULL);
+
+  /* 書き出しスレッドは止まったので、残りはここで書く */
+  elog_trace_drain();
+  dropped = elog_trace_dropped;
+  fprintf(elog_trace_file,
+          "\n],\"displayTimeUnit\":\"ns\",\"otherData\":{\"dropped\":%llu}}\n",
+          (unsigned long long)dropped);
+  fclose(elog_trace_file);
+  free(elog_trace_buf);
+  elog_trace_file = NULL;
+  elog_trace_buf = NULL;
+
+  if (dropped > 0) {
+    elog_emit_report(&elog_trace_drop_cs, (unsigned long long)dropped);
+  }
+}
+
+int elog_trace_open(const char *path) {
+  FILE *f;
+
+  pthread_once(&elog_trace_once, elog_trace_init);
+  pthread_mutex_lock(&elog_trace_session);
+  elog_trace_close_locked();
+  if ((f = fopen(path, "w")) == NULL) {
+    pthread_mutex_unlock(&elog_trace_session);
+    return -1;
+  }
+  elog_trace_buf = (char *)malloc(ELOG_TRACE_BUFFER_SIZE);
+  if (elog_trace_buf != NULL) {
+    setvbuf(f, elog_trace_buf, _IOFBF, ELOG_TRACE_BUFFER_SIZE);
+  }
+  elog_trace_start = elog_now_ns();
+  elog_trace_written = 0;
+  elog_trace_dropped = 0;
+  elog_trace_pid = (long)getpid();
+  elog_trace_stop = 0;
+  fputs("{\"traceEvents\":[", f);
+  /* 書き出しスレッドは起動直後から elog_trace_file に書く */
+  elog_trace_file = f;
+  if (pthread_create(&elog_trace_thread, NULL, elog_trace_main, NULL) != 0) {
+    elog_trace_file = NULL;
+    fclose(f);
+    free(elog_trace_buf);
+    elog_trace_buf = NULL;
+    pthread_mutex_unlock(&elog_trace_session);
+    return -1;
+  }
+  __atomic_store_n(&elog_trace_active, 1, __ATOMIC_RELEASE);
+  pthread_mutex_unlock(&elog_trace_session);
+  return 0;
+}
+
+void elog_trace_close(void) {
+  pthread_mutex_lock(&elog_trace_session);
+  elog_trace_close_locked();
+  pthread_mutex_unlock(&elog_trace_session);
+}
+
+#endif /* ELOG_USE_TRACE_EVENTS */
@@ -0,0 +1,314 @@
+/**
+ * @file elog_decode.c
+ * @brief elog-decode - バイナリログをテキストへ復元するホスト側ツール
+ *
+ * 使い方: elog-decode [-t] [-e ELF] [-l] [FILE]
+ *   -t      各行の先頭に記録時刻を付ける
+ *   -e ELF  ログを出力した実行ファイル。elog_meta セクションから
+ *           コールサイト記述子を読み出す
+ *           （ELOG_BINARY_EMBED_CALLSITES=0 のストリームで必要）
+ *   -l      -e で読み出したコールサイト一覧を表示して終了する
+ *   FILE    バイナリストリーム（省略時は標準入力）
+ *
+ * 実行ファイルはリトルエンディアンの ELF32/ELF64 に対応する。
+ * PIE の場合、記述子内のポインタは RELATIVE 再配置の加数から求める。
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "elog/elog_decode.h"
+#include "elog_internal.h"
+
+#define ELF_SHT_RELA 4
+#define ELF_SHT_NOBITS 8
+#define ELF_SHF_ALLOC 0x2
+
+/* ============================================================
+ * 1. ELF の読み込み
+ * ============================================================ */
+
+typedef struct {
+  const char *name;
+  uint32_t type;
+  uint64_t flags;
+  uint64_t addr;
+  uint64_t offset;
+  uint64_t size;
+} elf_section_t;
+
+typedef struct {
+  uint8_t *data;
+  size_t size;
+  int is64;
+  uint16_t machine;
+  elf_section_t *secs;
+  size_t nsecs;
+} elf_file_t;
+
+static uint64_t rd(const uint8_t *p, int n) {
+  uint64_t v = 0;
+  int i;
+
+  for (i = n - 1; i >= 0; i--) {
+    v = (v << 8) | p[i];
+  }
+  return v;
+}
+
+static int elf_load(elf_file_t *elf, const char *path) {
+  FILE *fp = fopen(path, "rb");
+  const uint8_t *h;
+  uint64_t shoff;
+  uint16_t shentsize, shnum, shstrndx;
+  size_t i;
+
+  memset(elf, 0, sizeof(*elf));
+  if (fp == NULL) {
+    perror(path);
+    return -1;
+  }
+  fseek(fp, 0, SEEK_END);
+  elf->size = (size_t)ftell(fp);
+  fseek(fp, 0, SEEK_SET);
+  elf->data = (uint8_t *)malloc(elf->size);
+  if (elf->data == NULL ||
+      fread(elf->data, 1, elf->size, fp) != elf->size) {
+    fclose(fp);
+    fprintf(stderr, "%s: read error\n", path);
+    return -1;
+  }
+  fclose(fp);
+
+  h = elf->data;
+  if (elf->size < 52 || memcmp(h, "\177ELF", 4) != 0 || h[5] != 1) {
+    fprintf(stderr, "%s: not a little-endian ELF file\n", path);
+    return -1;
+  }
+  elf->is64 = h[4] == 2;
+  elf->machine = (uint16_t)rd(h + 18, 2);
+  if (elf->is64) {
+    shoff = rd(h + 40, 8);
+    shentsize = (uint16_t)rd(h + 58, 2);
+    shnum = (uint16_t)rd(h + 60, 2);
+    shstrndx = (uint16_t)rd(h + 62, 2);
+  } else {
+    shoff = rd(h + 32, 4);
+    shentsize = (uint16_t)rd(h + 46, 2);
+    shnum = (uint16_t)rd(h + 48, 2);
+    shstrndx = (uint16_t)rd(h + 50, 2);
+  }
+  if (shoff + (uint64_t)shentsize * shnum > elf->size || shstrndx >= shnum) {
+    fprintf(stderr, "%s: bad section header table\n", path);
+    return -1;
+  }
+
+  elf->secs = (elf_section_t *)calloc(shnum, sizeof(elf_section_t));
+  elf->nsecs = shnum;
+  for (i = 0; i < shnum; i++) {
+    const uint8_t *sh = elf->data + shoff + i * shentsize;
+    elf_section_t *s = &elf->secs[i];
+    s->name = (const char *)(uintptr_t)rd(sh, 4); /* 後で解決 */
+    s->type = (uint32_t)rd(sh + 4, 4);
+    if (elf->is64) {
+      s->flags = rd(sh + 8, 8);
+      s->addr = rd(sh + 16, 8);
+      s->offset = rd(sh + 24, 8);
+      s->size = rd(sh + 32, 8);
+    } else {
+      s->flags = rd(sh + 8, 4);
+      s->addr = rd(sh + 12, 4);
+      s->offset = rd(sh + 16, 4);
+      s->size = rd(sh + 20, 4);
+    }
+  }
+  for (i = 0; i < shnum; i++) {
+    uint64_t off = elf->secs[shstrndx].offset + (uintptr_t)elf->secs[i].name;
+    elf->secs[i].name = off < elf->size ? (const char *)elf->data + off : "";
+  }
+  return 0;
+}
+
+static const elf_section_t *elf_find(const elf_file_t *elf, const char *name) {
+  size_t i;
+
+  for (i = 0; i < elf->nsecs; i++) {
+    if (strcmp(elf->secs[i].name, name) == 0) {
+      return &elf->secs[i];
+    }
+  }
+  return NULL;
+}
+
+/* 仮想アドレスの文字列をファイル内から探す */
+static const char *elf_string_at(const elf_file_t *elf, uint64_t addr) {
+  size_t i;
+
+  for (i = 0; i < elf->nsecs; i++) {
+    const elf_section_t *s = &elf->secs[i];
+    if ((s->flags & ELF_SHF_ALLOC) && s->type != ELF_SHT_NOBITS &&
+        addr >= s->addr && addr < s->addr + s->size) {
+      uint64_t off = s->offset + (addr - s->addr);
+      const char *str = (const char *)elf->data + off;
+      if (memchr(str, '\0', elf->size - off) != NULL) {
+        return str;
+      }
+    }
+  }
+  return NULL;
+}
+
+/* マシンごとの R_*_RELATIVE 再配置の型 */
+static uint32_t elf_relative_type(uint16_t machine) {
+  switch (machine) {
+    case 62: /* x86-64 */
+    case 3:  /* i386 */
+      return 8;
+    case 183: /* AArch64 */
+      return 1027;
+    case 40: /* ARM */
+      return 23;
+    case 243: /* RISC-V */
+      return 3;
+    default:
+      return 0;
+  }
+}
+
+/* addr に適用される RELATIVE 再配置の加数を探す。なければ in-place 値 */
+static uint64_t elf_pointer_at(const elf_file_t *elf, const elf_section_t *sec,
+                               uint64_t addr) {
+  int ps = elf->is64 ? 8 : 4;
+  uint32_t rel = elf_relative_type(elf->machine);
+  size_t i;
+
+  for (i = 0; rel != 0 && i < elf->nsecs; i++) {
+    const elf_section_t *s = &elf->secs[i];
+    size_t ent = elf->is64 ? 24 : 12;
+    uint64_t j;
+
+    if (s->type != ELF_SHT_RELA || s->offset + s->size > elf->size) {
+      continue;
+    }
+    for (j = 0; j + ent <= s->size; j += ent) {
+      const uint8_t *r = elf->data + s->offset + j;
+      uint64_t info = rd(r + ps, ps);
+      uint32_t type = elf->is64 ? (uint32_t)info : (uint32_t)(info & 0xFF);
+      if (rd(r, ps) == addr && type == rel) {
+        return rd(r + 2 * ps, ps);
+      }
+    }
+  }
+  return rd(elf->data + sec->offset + (addr - sec->addr), ps);
+}
+
+/* elog_meta セクションからコールサイト表を作る */
+static elog_callsite_t *elf_load_callsites(const elf_file_t *elf,
+                                           size_t *count) {
+  const elf_section_t *meta = elf_find(elf, "elog_meta");
+  const elf_section_t *info = elf_find(elf, "elog_meta_info");
+  elog_callsite_t *sites;
+  uint32_t stride, ps;
+  size_t i, n;
+
+  if (meta == NULL || info == NULL || info->size < 12 ||
+      rd(elf->data + info->offset, 4) != ELOG_META_INFO_MAGIC) {
+    fprintf(stderr, "elog-decode: no elog_meta section in executable\n");
+    return NULL;
+  }
+  stride = (uint32_t)rd(elf->data + info->offset + 4, 4);
+  ps = (uint32_t)rd(elf->data + info->offset + 8, 4);
+  if (stride == 0 || ps != (elf->is64 ? 8u : 4u)) {
+    fprintf(stderr, "elog-decode: unsupported elog_meta layout\n");
+    return NULL;
+  }
+
+  n = (size_t)(meta->size / stride);
+  sites = (elog_callsite_t *)calloc(n > 0 ? n : 1, sizeof(elog_callsite_t));
+  for (i = 0; i < n; i++) {
+    uint64_t addr = meta->addr + (uint64_t)i * stride;
+    const uint8_t *d = elf->data + meta->offset + (uint64_t)i * stride;
+    uint64_t file = elf_pointer_at(elf, meta, addr + ps);
+
+    /* 配置: fmt, file, line(uint32_t), level(uint8_t) */
+    sites[i].fmt = elf_string_at(elf, elf_pointer_at(elf, meta, addr));
+    sites[i].file = file != 0 ? elf_string_at(elf, file) : NULL;
+    sites[i].line = (uint32_t)rd(d + 2 * ps, 4);
+    sites[i].level = d[2 * ps + 4];
+    sites[i].id = (uint32_t)i + 1;
+  }
+  *count = n;
+  return sites;
+}
+
+/* ============================================================
+ * 2. メイン
+ * ============================================================ */
+
+static void usage(void) {
+  fprintf(stderr, "usage: elog-decode [-t] [-e ELF] [-l] [FILE]\n");
+}
+
+int main(int argc, char **argv) {
+  const char *elf_path = NULL;
+  unsigned flags = 0;
+  int list = 0;
+  elf_file_t elf;
+  elog_callsite_t *sites = NULL;
+  size_t nsites = 0;
+  FILE *in = stdin;
+  int opt;
+  int result;
+
+  while ((opt = getopt(argc, argv, "te:lh")) != -1) {
+    switch (opt) {
+      case 't':
+        flags |= ELOG_DECODE_TIMESTAMP;
+        break;
+      case 'e':
+        elf_path = optarg;
+        break;
+      case 'l':
+        list = 1;
+        break;
+      default:
+        usage();
+        return 2;
+    }
+  }
+
+  if (elf_path != NULL) {
+    if (elf_load(&elf, elf_path) != 0 ||
+        (sites = elf_load_callsites(&elf, &nsites)) == NULL) {
+      return 1;
+    }
+  }
+
+  if (list) {
+    size_t i;
+    if (sites == NULL) {
+      usage();
+      return 2;
+    }
+    for (i = 0; i < nsites; i++) {
+      printf("%zu\t%s:%u\tlevel=%u\t%s\n", i + 1,
+             sites[i].file != NULL ? sites[i].file : "?", sites[i].line,
+             sites[i].level, sites[i].fmt != NULL ? sites[i].fmt : "?");
+    }
+    return 0;
+  }
+
+  if (optind < argc && (in = fopen(argv[optind], "rb")) == NULL) {
+    perror(argv[optind]);
+    return 1;
+  }
+
+  result = elog_binary_decode_with(in, stdout, flags, sites, nsites);
+  if (result != 0) {
+    fprintf(stderr, "elog-decode: malformed or truncated stream\n");
+  }
+  return result == 0 ? 0 : 1;
+}
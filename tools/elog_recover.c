@@ -0,0 +1,79 @@
+/**
+ * @file elog_recover.c
+ * @brief elog-recover - 共有メモリのリングからレコードを取り出すホスト側ツール
+ *
+ * 使い方: elog-recover [-v] FILE
+ *   -v    取り出したレコード数を標準エラー出力に表示する
+ *   FILE  elog_shm_sink_open() で開いたファイル
+ *
+ * コミット済みのレコードを古い順に標準出力へ書き出す。
+ * 書き込み中だったレコードと、それより後（上書き済み）のものは捨てる。
+ * バイナリ出力のストリームは elog-decode へ渡す。リングが一周すると
+ * ストリームヘッダーとコールサイト定義は失われるため、elog-decode -e で
+ * 実行ファイルから記述子を読む。
+ */
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "elog_internal.h"
+
+static void recover_write(const void *data, size_t len) {
+  fwrite(data, 1, len, stdout);
+}
+
+static void usage(void) { fprintf(stderr, "usage: elog-recover [-v] FILE\n"); }
+
+int main(int argc, char **argv) {
+  int verbose = 0;
+  struct stat st;
+  void *map;
+  long count;
+  int opt;
+  int fd;
+
+  while ((opt = getopt(argc, argv, "vh")) != -1) {
+    switch (opt) {
+      case 'v':
+        verbose = 1;
+        break;
+      default:
+        usage();
+        return 2;
+    }
+  }
+  if (optind >= argc) {
+    usage();
+    return 2;
+  }
+
+  fd = open(argv[optind], O_RDONLY);
+  if (fd < 0 || fstat(fd, &st) != 0) {
+    perror(argv[optind]);
+    return 1;
+  }
+  map = st.st_size > 0 ? mmap(NULL, (size_t)st.st_size, PROT_READ,
+                              MAP_PRIVATE, fd, 0)
+                       : MAP_FAILED;
+  close(fd);
+  if (map == MAP_FAILED) {
+    fprintf(stderr, "elog-recover: %s: not an elog ring\n", argv[optind]);
+    return 1;
+  }
+
+  count = elog_shm_recover(map, (size_t)st.st_size, recover_write);
+  fflush(stdout);
+  munmap(map, (size_t)st.st_size);
+  if (count < 0) {
+    fprintf(stderr, "elog-recover: %s: not an elog ring\n", argv[optind]);
+    return 1;
+  }
+  if (verbose) {
+    fprintf(stderr, "elog-recover: %ld records\n", count);
+  }
+  return 0;
+}